@@ -139,7 +139,8 @@ enum
   PROP_MAX_RESIDUAL_PARTITION_ORDER,
   PROP_RICE_PARAMETER_SEARCH_DIST,
   PROP_PADDING,
-  PROP_SEEKPOINTS
+  PROP_SEEKPOINTS,
+  PROP_THREADS
 };
 
 GST_DEBUG_CATEGORY_STATIC (flacenc_debug);
@@ -181,6 +182,9 @@ static FLAC__StreamEncoderTellStatus
 gst_flac_enc_tell_callback (const FLAC__StreamEncoder * encoder,
     FLAC__uint64 * absolute_byte_offset, void *client_data);
 
+static void gst_flac_enc_start_parallel (GstFlacEnc * flacenc);
+static void gst_flac_enc_stop_parallel (GstFlacEnc * flacenc);
+
 typedef struct
 {
   gboolean exhaustive_model_search;
@@ -213,6 +217,31 @@ static const GstFlacEncParams flacenc_params[] = {
 #define DEFAULT_QUALITY 5
 #define DEFAULT_PADDING 0
 #define DEFAULT_SEEKPOINTS -10
+#define DEFAULT_THREADS 1
+
+/* number of FLAC frames that are encoded together by one worker thread */
+#define PARALLEL_FRAMES_PER_JOB 32
+
+typedef struct
+{
+  guint size;
+  guint samples;
+} GstFlacEncJobFrame;
+
+typedef struct
+{
+  FLAC__int32 *data;            /* interleaved input samples */
+  guint samples;                /* per channel */
+
+  GByteArray *frames;           /* encoded frames, back to back */
+  GArray *sizes;                /* GstFlacEncJobFrame for each frame */
+
+  gboolean done;
+  gboolean failed;
+} GstFlacEncJob;
+
+static guint8 crc8_table[256];
+static guint16 crc16_table[256];
 
 #define GST_TYPE_FLAC_ENC_QUALITY (gst_flac_enc_quality_get_type ())
 static GType
@@ -246,6 +275,7 @@ gst_flac_enc_class_init (GstFlacEncClass * klass)
   GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
   GstAudioEncoderClass *base_class;
+  guint i, j;
 
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
@@ -354,6 +384,23 @@ gst_flac_enc_class_init (GstFlacEncClass * klass)
           DEFAULT_SEEKPOINTS,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstFlacEnc:threads:
+   *
+   * Number of threads used for encoding. With more than one thread the
+   * input is split into groups of frames that are encoded independently
+   * and stitched back together into a single stream, which gives the same
+   * output as encoding serially. With loose mid-side stereo the frames
+   * depend on the previous ones and the input is always encoded serially.
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_THREADS,
+      g_param_spec_uint ("threads",
+          "Threads",
+          "Number of threads to encode with (1 = encode serially)", 1, 64,
+          DEFAULT_THREADS,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&src_factory));
   gst_element_class_add_pad_template (gstelement_class,
@@ -370,6 +417,20 @@ gst_flac_enc_class_init (GstFlacEncClass * klass)
   base_class->handle_frame = GST_DEBUG_FUNCPTR (gst_flac_enc_handle_frame);
   base_class->getcaps = GST_DEBUG_FUNCPTR (gst_flac_enc_getcaps);
   base_class->sink_event = GST_DEBUG_FUNCPTR (gst_flac_enc_sink_event);
+
+  /* CRC-8 (x^8 + x^2 + x^1 + x^0) and CRC-16 (x^16 + x^15 + x^2 + x^0)
+   * as used in FLAC frames, needed when renumbering frames */
+  for (i = 0; i < 256; i++) {
+    guint8 crc8 = i;
+    guint16 crc16 = i << 8;
+
+    for (j = 0; j < 8; j++) {
+      crc8 = (crc8 & 0x80) ? (crc8 << 1) ^ 0x07 : (crc8 << 1);
+      crc16 = (crc16 & 0x8000) ? (crc16 << 1) ^ 0x8005 : (crc16 << 1);
+    }
+    crc8_table[i] = crc8;
+    crc16_table[i] = crc16;
+  }
 }
 
 static void
@@ -380,6 +441,10 @@ gst_flac_enc_init (GstFlacEnc * flacenc)
   flacenc->encoder = FLAC__stream_encoder_new ();
   gst_flac_enc_update_quality (flacenc, DEFAULT_QUALITY);
 
+  g_mutex_init (&flacenc->jobs_lock);
+  g_cond_init (&flacenc->jobs_cond);
+  g_queue_init (&flacenc->jobs);
+
   /* arrange granulepos marking (and required perfect ts) */
   gst_audio_encoder_set_mark_granule (enc, TRUE);
   gst_audio_encoder_set_perfect_timestamp (enc, TRUE);
@@ -392,6 +457,9 @@ gst_flac_enc_finalize (GObject * object)
 
   FLAC__stream_encoder_delete (flacenc->encoder);
 
+  g_mutex_clear (&flacenc->jobs_lock);
+  g_cond_clear (&flacenc->jobs_cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -408,6 +476,15 @@ gst_flac_enc_start (GstAudioEncoder * enc)
   flacenc->eos = FALSE;
   flacenc->tags = gst_tag_list_new_empty ();
   flacenc->toc = NULL;
+  flacenc->streaminfo_offset = G_MAXUINT64;
+  flacenc->seektable_offset = G_MAXUINT64;
+  flacenc->seektable = NULL;
+  flacenc->seekpoint = 0;
+  flacenc->next_frame = 0;
+  flacenc->first_frame_offset = 0;
+  flacenc->total_samples = 0;
+  flacenc->min_framesize = G_MAXUINT;
+  flacenc->max_framesize = 0;
 
   return TRUE;
 }
@@ -423,6 +500,10 @@ gst_flac_enc_stop (GstAudioEncoder * enc)
   if (flacenc->toc)
     gst_toc_unref (flacenc->toc);
   flacenc->toc = NULL;
+  gst_flac_enc_stop_parallel (flacenc);
+  g_free (flacenc->data);
+  flacenc->data = NULL;
+  flacenc->data_size = 0;
   if (FLAC__stream_encoder_get_state (flacenc->encoder) !=
       FLAC__STREAM_ENCODER_UNINITIALIZED) {
     flacenc->stopped = TRUE;
@@ -443,6 +524,7 @@ gst_flac_enc_stop (GstAudioEncoder * enc)
     g_free (flacenc->meta);
     flacenc->meta = NULL;
   }
+  flacenc->seektable = NULL;
   g_list_foreach (flacenc->headers, (GFunc) gst_mini_object_unref, NULL);
   g_list_free (flacenc->headers);
   flacenc->headers = NULL;
@@ -681,6 +763,7 @@ gst_flac_enc_set_metadata (GstFlacEnc * flacenc, GstAudioInfo * info,
       FLAC__metadata_object_delete (flacenc->meta[1]);
       flacenc->meta[entries] = NULL;
     } else {
+      flacenc->seektable = flacenc->meta[entries];
       entries++;
     }
   } else if (flacenc->seekpoints && total_samples == GST_CLOCK_TIME_NONE) {
@@ -843,6 +926,15 @@ gst_flac_enc_set_format (GstAudioEncoder * enc, GstAudioInfo * info)
   if (init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
     goto failed_to_initialize;
 
+  /* with loose mid-side stereo libFLAC decides the channel assignment from
+   * the previous frames, which independently encoded jobs can't do */
+  if (flacenc->threads > 1 &&
+      FLAC__stream_encoder_get_loose_mid_side_stereo (flacenc->encoder)) {
+    GST_DEBUG_OBJECT (flacenc, "loose mid-side stereo, encoding serially");
+  } else if (flacenc->threads > 1) {
+    gst_flac_enc_start_parallel (flacenc);
+  }
+
   /* no special feedback to base class; should provide all available samples */
 
   return TRUE;
@@ -989,6 +1081,7 @@ notgst_value_array_append_buffer (GValue * array_val, GstBuffer * buf)
 }
 
 #define HDR_TYPE_STREAMINFO     0
+#define HDR_TYPE_SEEKTABLE      3
 #define HDR_TYPE_VORBISCOMMENT  4
 
 static GstFlowReturn
@@ -1140,6 +1233,11 @@ gst_flac_enc_write_callback (const FLAC__StreamEncoder * encoder,
     if (samples == 0) {
       GST_DEBUG_OBJECT (flacenc, "Got header, queueing (%u bytes)",
           (guint) bytes);
+      /* remember where the blocks that are rewritten at the end are */
+      if (bytes >= 4 && (buffer[0] & 0x7f) == HDR_TYPE_STREAMINFO)
+        flacenc->streaminfo_offset = flacenc->offset;
+      else if (bytes >= 4 && (buffer[0] & 0x7f) == HDR_TYPE_SEEKTABLE)
+        flacenc->seektable_offset = flacenc->offset;
       flacenc->headers = g_list_append (flacenc->headers, outbuf);
       /* note: it's important that we increase our byte offset */
       goto out;
@@ -1245,19 +1343,578 @@ gst_flac_enc_sink_event (GstAudioEncoder * enc, GstEvent * event)
 #define READ_INT24 GST_READ_UINT24_BE
 #endif
 
+static void
+gst_flac_enc_convert (GstFlacEnc * flacenc, FLAC__int32 * data,
+    const guint8 * in, gulong samples, gint width, gint channels)
+{
+  gint *reorder_map = flacenc->channel_reorder_map;
+  gulong i;
+  gint j;
+
+  if (width == 8) {
+    const gint8 *indata = (const gint8 *) in;
+
+    for (i = 0; i < samples; i++)
+      for (j = 0; j < channels; j++)
+        data[i * channels + reorder_map[j]] =
+            (FLAC__int32) indata[i * channels + j];
+  } else if (width == 16) {
+    const gint16 *indata = (const gint16 *) in;
+
+    for (i = 0; i < samples; i++)
+      for (j = 0; j < channels; j++)
+        data[i * channels + reorder_map[j]] =
+            (FLAC__int32) indata[i * channels + j];
+  } else if (width == 24) {
+    const guint8 *indata = in;
+    guint32 val;
+
+    for (i = 0; i < samples; i++)
+      for (j = 0; j < channels; j++) {
+        val = READ_INT24 (&indata[3 * (i * channels + j)]);
+        if (val & 0x00800000)
+          val |= 0xff000000;
+        data[i * channels + reorder_map[j]] = (FLAC__int32) val;
+      }
+  } else if (width == 32) {
+    const gint32 *indata = (const gint32 *) in;
+
+    for (i = 0; i < samples; i++)
+      for (j = 0; j < channels; j++)
+        data[i * channels + reorder_map[j]] =
+            (FLAC__int32) indata[i * channels + j];
+  } else {
+    g_assert_not_reached ();
+  }
+}
+
+/* Parallel encoding
+ *
+ * The input is collected into jobs of PARALLEL_FRAMES_PER_JOB frames. Every
+ * job is encoded by a separate libFLAC encoder instance on a thread pool
+ * while the main encoder only produced the stream headers. As every job
+ * starts at a frame boundary with fresh encoder state, the frames are the
+ * same as the ones of a serial encoder except for the frame number in the
+ * header, which is rewritten together with the CRCs when the frames are
+ * pushed in order. This does not hold for loose mid-side stereo, which is
+ * never encoded in parallel. STREAMINFO and SEEKTABLE are filled in here and rewritten
+ * at EOS, as libFLAC would do for a serial encode. */
+
+static void
+gst_flac_enc_job_free (GstFlacEncJob * job)
+{
+  g_free (job->data);
+  g_byte_array_free (job->frames, TRUE);
+  g_array_free (job->sizes, TRUE);
+  g_slice_free (GstFlacEncJob, job);
+}
+
+static FLAC__StreamEncoderWriteStatus
+gst_flac_enc_job_write_callback (const FLAC__StreamEncoder * encoder,
+    const FLAC__byte buffer[], size_t bytes,
+    unsigned samples, unsigned current_frame, void *client_data)
+{
+  GstFlacEncJob *job = client_data;
+  GstFlacEncJobFrame frame;
+
+  /* headers of the worker encoders are dropped */
+  if (samples == 0)
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+
+  frame.size = bytes;
+  frame.samples = samples;
+  g_byte_array_append (job->frames, buffer, bytes);
+  g_array_append_val (job->sizes, frame);
+
+  return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+/* libFLAC resets all settings in FLAC__stream_encoder_finish(), so the
+ * worker encoders get them copied from the main encoder for every job */
+static void
+gst_flac_enc_configure_encoder (GstFlacEnc * flacenc,
+    FLAC__StreamEncoder * encoder)
+{
+  FLAC__StreamEncoder *src = flacenc->encoder;
+
+#define COPY_SETTING(name)                                                      \
+  FLAC__stream_encoder_set_##name (encoder,                                     \
+      FLAC__stream_encoder_get_##name (src))
+
+  COPY_SETTING (streamable_subset);
+  COPY_SETTING (channels);
+  COPY_SETTING (bits_per_sample);
+  COPY_SETTING (sample_rate);
+  COPY_SETTING (blocksize);
+  COPY_SETTING (do_mid_side_stereo);
+  COPY_SETTING (loose_mid_side_stereo);
+  COPY_SETTING (max_lpc_order);
+  COPY_SETTING (qlp_coeff_precision);
+  COPY_SETTING (do_qlp_coeff_prec_search);
+  COPY_SETTING (do_escape_coding);
+  COPY_SETTING (do_exhaustive_model_search);
+  COPY_SETTING (min_residual_partition_order);
+  COPY_SETTING (max_residual_partition_order);
+  COPY_SETTING (rice_parameter_search_dist);
+
+#undef COPY_SETTING
+
+  /* the MD5 of the whole stream is calculated in the streaming thread */
+  FLAC__stream_encoder_set_do_md5 (encoder, false);
+}
+
+static void
+gst_flac_enc_job_func (gpointer data, gpointer user_data)
+{
+  GstFlacEncJob *job = data;
+  GstFlacEnc *flacenc = GST_FLAC_ENC (user_data);
+  FLAC__StreamEncoder *encoder = NULL;
+  gboolean ok = FALSE;
+
+  g_mutex_lock (&flacenc->jobs_lock);
+  if (flacenc->idle_encoders) {
+    encoder = flacenc->idle_encoders->data;
+    flacenc->idle_encoders =
+        g_list_delete_link (flacenc->idle_encoders, flacenc->idle_encoders);
+  }
+  g_mutex_unlock (&flacenc->jobs_lock);
+
+  if (encoder == NULL)
+    encoder = FLAC__stream_encoder_new ();
+
+  if (encoder) {
+    gst_flac_enc_configure_encoder (flacenc, encoder);
+
+    /* no seek callback, so libFLAC doesn't try to rewrite its headers */
+    if (FLAC__stream_encoder_init_stream (encoder,
+            gst_flac_enc_job_write_callback, NULL, NULL, NULL,
+            job) == FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+      ok = FLAC__stream_encoder_process_interleaved (encoder, job->data,
+          job->samples);
+      ok &= FLAC__stream_encoder_finish (encoder);
+    }
+  }
+
+  g_mutex_lock (&flacenc->jobs_lock);
+  job->done = TRUE;
+  job->failed = !ok;
+  if (encoder)
+    flacenc->idle_encoders = g_list_prepend (flacenc->idle_encoders, encoder);
+  g_cond_broadcast (&flacenc->jobs_cond);
+  g_mutex_unlock (&flacenc->jobs_lock);
+}
+
+static void
+gst_flac_enc_start_parallel (GstFlacEnc * flacenc)
+{
+  GError *err = NULL;
+
+  flacenc->job_samples = PARALLEL_FRAMES_PER_JOB *
+      FLAC__stream_encoder_get_blocksize (flacenc->encoder);
+  flacenc->pool = g_thread_pool_new (gst_flac_enc_job_func, flacenc,
+      flacenc->threads, FALSE, &err);
+  if (flacenc->pool == NULL) {
+    GST_WARNING_OBJECT (flacenc, "failed to create thread pool, encoding "
+        "serially: %s", err->message);
+    g_error_free (err);
+    return;
+  }
+  flacenc->md5 = g_checksum_new (G_CHECKSUM_MD5);
+  flacenc->scratch = g_byte_array_new ();
+
+  GST_DEBUG_OBJECT (flacenc, "encoding with %u threads, %u samples per job",
+      flacenc->threads, flacenc->job_samples);
+}
+
+static void
+gst_flac_enc_stop_parallel (GstFlacEnc * flacenc)
+{
+  GstFlacEncJob *job;
+
+  if (flacenc->pool == NULL)
+    return;
+
+  /* drop queued jobs and wait for the running ones */
+  g_thread_pool_free (flacenc->pool, TRUE, TRUE);
+  flacenc->pool = NULL;
+
+  while ((job = g_queue_pop_head (&flacenc->jobs)))
+    gst_flac_enc_job_free (job);
+  if (flacenc->current_job)
+    gst_flac_enc_job_free (flacenc->current_job);
+  flacenc->current_job = NULL;
+  g_list_free_full (flacenc->free_jobs, (GDestroyNotify) gst_flac_enc_job_free);
+  flacenc->free_jobs = NULL;
+  g_list_free_full (flacenc->idle_encoders,
+      (GDestroyNotify) FLAC__stream_encoder_delete);
+  flacenc->idle_encoders = NULL;
+
+  g_checksum_free (flacenc->md5);
+  flacenc->md5 = NULL;
+  g_byte_array_free (flacenc->scratch, TRUE);
+  flacenc->scratch = NULL;
+}
+
+static GstFlacEncJob *
+gst_flac_enc_get_current_job (GstFlacEnc * flacenc, gint channels)
+{
+  GstFlacEncJob *job;
+
+  if (flacenc->current_job)
+    return flacenc->current_job;
+
+  if (flacenc->free_jobs) {
+    job = flacenc->free_jobs->data;
+    flacenc->free_jobs =
+        g_list_delete_link (flacenc->free_jobs, flacenc->free_jobs);
+    g_byte_array_set_size (job->frames, 0);
+    g_array_set_size (job->sizes, 0);
+  } else {
+    job = g_slice_new0 (GstFlacEncJob);
+    job->data = g_new (FLAC__int32, flacenc->job_samples * channels);
+    job->frames = g_byte_array_new ();
+    job->sizes = g_array_new (FALSE, FALSE, sizeof (GstFlacEncJobFrame));
+  }
+  job->samples = 0;
+  job->done = FALSE;
+  job->failed = FALSE;
+  flacenc->current_job = job;
+
+  return job;
+}
+
+static void
+gst_flac_enc_submit_job (GstFlacEnc * flacenc)
+{
+  GstFlacEncJob *job = flacenc->current_job;
+
+  flacenc->current_job = NULL;
+
+  g_mutex_lock (&flacenc->jobs_lock);
+  g_queue_push_tail (&flacenc->jobs, job);
+  g_mutex_unlock (&flacenc->jobs_lock);
+
+  g_thread_pool_push (flacenc->pool, job, NULL);
+}
+
+static void
+gst_flac_enc_update_md5 (GstFlacEnc * flacenc, const FLAC__int32 * data,
+    guint n)
+{
+  guint bytes =
+      (FLAC__stream_encoder_get_bits_per_sample (flacenc->encoder) + 7) / 8;
+  guint8 *out;
+  guint32 val;
+  guint i, j;
+
+  /* same layout as libFLAC: little endian, as few bytes as possible */
+  g_byte_array_set_size (flacenc->scratch, n * bytes);
+  out = flacenc->scratch->data;
+  for (i = 0; i < n; i++) {
+    val = data[i];
+    for (j = 0; j < bytes; j++) {
+      *out++ = val & 0xff;
+      val >>= 8;
+    }
+  }
+  g_checksum_update (flacenc->md5, flacenc->scratch->data, n * bytes);
+}
+
+static guint
+gst_flac_enc_write_utf8 (guint8 * out, guint64 val)
+{
+  guint len, i;
+
+  if (val < 0x80) {
+    out[0] = val;
+    return 1;
+  } else if (val < 0x800) {
+    len = 2;
+  } else if (val < 0x10000) {
+    len = 3;
+  } else if (val < 0x200000) {
+    len = 4;
+  } else if (val < 0x4000000) {
+    len = 5;
+  } else if (val < 0x80000000) {
+    len = 6;
+  } else {
+    len = 7;
+  }
+
+  for (i = len - 1; i > 0; i--) {
+    out[i] = 0x80 | (val & 0x3f);
+    val >>= 6;
+  }
+  out[0] = ((0xff00 >> len) & 0xff) | val;
+
+  return len;
+}
+
+static GstFlowReturn
+gst_flac_enc_push_frame (GstFlacEnc * flacenc, const guint8 * frame,
+    guint size, guint samples)
+{
+  guint8 header[16];
+  guint hlen, old_len, extra, skip, i;
+  guint8 crc8 = 0;
+  guint16 crc16 = 0;
+  GByteArray *out = flacenc->scratch;
+
+  if (size < 8 || frame[0] != 0xff || (frame[1] & 0xfe) != 0xf8)
+    goto invalid_frame;
+
+  /* length of the coded frame number */
+  if (!(frame[4] & 0x80)) {
+    old_len = 1;
+  } else {
+    old_len = 0;
+    while (old_len < 8 && (frame[4] & (0x80 >> old_len)))
+      old_len++;
+    if (old_len < 2 || old_len > 7)
+      goto invalid_frame;
+  }
+
+  /* optional blocksize and sample rate bytes after the frame number */
+  extra = 0;
+  if ((frame[2] >> 4) == 6)
+    extra += 1;
+  else if ((frame[2] >> 4) == 7)
+    extra += 2;
+  if ((frame[2] & 0x0f) == 12)
+    extra += 1;
+  else if ((frame[2] & 0x0f) == 13 || (frame[2] & 0x0f) == 14)
+    extra += 2;
+
+  skip = 4 + old_len + extra + 1;
+  if (skip + 2 > size)
+    goto invalid_frame;
+
+  memcpy (header, frame, 4);
+  hlen = 4 + gst_flac_enc_write_utf8 (header + 4, flacenc->next_frame);
+  memcpy (header + hlen, frame + 4 + old_len, extra);
+  hlen += extra;
+  for (i = 0; i < hlen; i++)
+    crc8 = crc8_table[crc8 ^ header[i]];
+  header[hlen++] = crc8;
+
+  g_byte_array_set_size (out, 0);
+  g_byte_array_append (out, header, hlen);
+  g_byte_array_append (out, frame + skip, size - skip - 2);
+  for (i = 0; i < out->len; i++)
+    crc16 = (crc16 << 8) ^ crc16_table[(crc16 >> 8) ^ out->data[i]];
+  header[0] = crc16 >> 8;
+  header[1] = crc16 & 0xff;
+  g_byte_array_append (out, header, 2);
+
+  if (flacenc->next_frame == 0)
+    flacenc->first_frame_offset = flacenc->offset;
+
+  /* fill in the seekpoints that fall into this frame */
+  if (flacenc->seektable) {
+    FLAC__StreamMetadata_SeekTable *table =
+        &flacenc->seektable->data.seek_table;
+    guint64 first = flacenc->total_samples;
+    guint64 last = first + samples - 1;
+
+    for (; flacenc->seekpoint < table->num_points; flacenc->seekpoint++) {
+      FLAC__StreamMetadata_SeekPoint *point =
+          &table->points[flacenc->seekpoint];
+
+      if (point->sample_number > last)
+        break;
+      if (point->sample_number >= first) {
+        point->sample_number = first;
+        point->stream_offset = flacenc->offset - flacenc->first_frame_offset;
+        point->frame_samples = samples;
+      }
+    }
+  }
+
+  flacenc->next_frame++;
+  flacenc->total_samples += samples;
+  flacenc->min_framesize = MIN (flacenc->min_framesize, out->len);
+  flacenc->max_framesize = MAX (flacenc->max_framesize, out->len);
+
+  gst_flac_enc_write_callback (flacenc->encoder, out->data, out->len, samples,
+      0, flacenc);
+
+  return flacenc->last_flow;
+
+invalid_frame:
+  {
+    GST_ELEMENT_ERROR (flacenc, STREAM, ENCODE, (NULL),
+        ("invalid frame from encoder thread"));
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* pushes all finished jobs at the head of the queue and waits for more
+ * until at most @max_pending jobs are left */
+static GstFlowReturn
+gst_flac_enc_drain_jobs (GstFlacEnc * flacenc, guint max_pending)
+{
+  GstFlacEncJob *job;
+  GstFlowReturn ret = GST_FLOW_OK;
+  const guint8 *frame;
+  guint i;
+
+  while (ret == GST_FLOW_OK) {
+    g_mutex_lock (&flacenc->jobs_lock);
+    job = g_queue_peek_head (&flacenc->jobs);
+    if (job == NULL || (!job->done
+            && g_queue_get_length (&flacenc->jobs) <= max_pending)) {
+      g_mutex_unlock (&flacenc->jobs_lock);
+      break;
+    }
+    while (!job->done)
+      g_cond_wait (&flacenc->jobs_cond, &flacenc->jobs_lock);
+    g_queue_pop_head (&flacenc->jobs);
+    g_mutex_unlock (&flacenc->jobs_lock);
+
+    if (job->failed) {
+      GST_ELEMENT_ERROR (flacenc, STREAM, ENCODE, (NULL),
+          ("failed to encode frames in encoder thread"));
+      ret = GST_FLOW_ERROR;
+    }
+
+    frame = job->frames->data;
+    for (i = 0; ret == GST_FLOW_OK && i < job->sizes->len; i++) {
+      GstFlacEncJobFrame *f =
+          &g_array_index (job->sizes, GstFlacEncJobFrame, i);
+
+      ret = gst_flac_enc_push_frame (flacenc, frame, f->size, f->samples);
+      frame += f->size;
+    }
+
+    flacenc->free_jobs = g_list_prepend (flacenc->free_jobs, job);
+  }
+
+  return ret;
+}
+
+/* rewrites STREAMINFO and SEEKTABLE with the final values, like
+ * FLAC__stream_encoder_finish() does for a serial encode */
+static void
+gst_flac_enc_rewrite_headers (GstFlacEnc * flacenc)
+{
+  FLAC__StreamEncoder *encoder = flacenc->encoder;
+  guint8 streaminfo[34];
+  guint64 val;
+  gsize len = 16;
+  guint blocksize, i;
+
+  if (!flacenc->got_headers || flacenc->streaminfo_offset == G_MAXUINT64)
+    return;
+
+  blocksize = FLAC__stream_encoder_get_blocksize (encoder);
+  GST_WRITE_UINT16_BE (streaminfo, blocksize);
+  GST_WRITE_UINT16_BE (streaminfo + 2, blocksize);
+  GST_WRITE_UINT24_BE (streaminfo + 4, flacenc->min_framesize);
+  GST_WRITE_UINT24_BE (streaminfo + 7, flacenc->max_framesize);
+  val = ((guint64) FLAC__stream_encoder_get_sample_rate (encoder) << 44) |
+      ((guint64) (FLAC__stream_encoder_get_channels (encoder) - 1) << 41) |
+      ((guint64) (FLAC__stream_encoder_get_bits_per_sample (encoder) -
+          1) << 36) |
+      (flacenc->total_samples & G_GUINT64_CONSTANT (0x0FFFFFFFFF));
+  GST_WRITE_UINT64_BE (streaminfo + 10, val);
+  g_checksum_get_digest (flacenc->md5, streaminfo + 18, &len);
+
+  if (gst_flac_enc_seek_callback (encoder, flacenc->streaminfo_offset + 4,
+          flacenc) != FLAC__STREAM_ENCODER_SEEK_STATUS_OK)
+    return;
+  gst_flac_enc_write_callback (encoder, streaminfo, sizeof (streaminfo), 0, 0,
+      flacenc);
+
+  if (flacenc->seektable && flacenc->seektable_offset != G_MAXUINT64) {
+    FLAC__StreamMetadata_SeekTable *table =
+        &flacenc->seektable->data.seek_table;
+    guint8 *out;
+
+    FLAC__format_seektable_sort (table);
+
+    g_byte_array_set_size (flacenc->scratch, table->num_points * 18);
+    out = flacenc->scratch->data;
+    for (i = 0; i < table->num_points; i++) {
+      GST_WRITE_UINT64_BE (out, table->points[i].sample_number);
+      GST_WRITE_UINT64_BE (out + 8, table->points[i].stream_offset);
+      GST_WRITE_UINT16_BE (out + 16, table->points[i].frame_samples);
+      out += 18;
+    }
+
+    if (gst_flac_enc_seek_callback (encoder, flacenc->seektable_offset + 4,
+            flacenc) != FLAC__STREAM_ENCODER_SEEK_STATUS_OK)
+      return;
+    gst_flac_enc_write_callback (encoder, flacenc->scratch->data,
+        flacenc->scratch->len, 0, 0, flacenc);
+  }
+}
+
+static GstFlowReturn
+gst_flac_enc_finish_parallel (GstFlacEnc * flacenc)
+{
+  GstFlowReturn ret;
+
+  if (flacenc->current_job &&
+      ((GstFlacEncJob *) flacenc->current_job)->samples > 0)
+    gst_flac_enc_submit_job (flacenc);
+
+  ret = gst_flac_enc_drain_jobs (flacenc, 0);
+  if (ret == GST_FLOW_OK)
+    gst_flac_enc_rewrite_headers (flacenc);
+
+  /* the main encoder did not see any samples, don't let it
+   * overwrite the headers again */
+  flacenc->stopped = TRUE;
+  FLAC__stream_encoder_finish (flacenc->encoder);
+  flacenc->stopped = FALSE;
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_flac_enc_handle_frame_parallel (GstFlacEnc * flacenc, const guint8 * in,
+    guint samples, gint width, gint channels)
+{
+  GstFlacEncJob *job;
+  FLAC__int32 *data;
+  guint n;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  while (samples > 0) {
+    job = gst_flac_enc_get_current_job (flacenc, channels);
+    n = MIN (samples, flacenc->job_samples - job->samples);
+    data = job->data + job->samples * channels;
+
+    gst_flac_enc_convert (flacenc, data, in, n, width, channels);
+    gst_flac_enc_update_md5 (flacenc, data, n * channels);
+
+    job->samples += n;
+    in += n * channels * (width >> 3);
+    samples -= n;
+
+    if (job->samples == flacenc->job_samples) {
+      gst_flac_enc_submit_job (flacenc);
+      /* keep the workers busy, but don't queue up unlimited input */
+      ret = gst_flac_enc_drain_jobs (flacenc, 2 * flacenc->threads);
+      if (ret != GST_FLOW_OK)
+        return ret;
+    }
+  }
+
+  return gst_flac_enc_drain_jobs (flacenc, 2 * flacenc->threads);
+}
+
 static GstFlowReturn
 gst_flac_enc_handle_frame (GstAudioEncoder * enc, GstBuffer * buffer)
 {
   GstFlacEnc *flacenc;
-  FLAC__int32 *data;
   gint samples, width, channels;
-  gulong i;
-  gint j;
   FLAC__bool res;
   GstMapInfo map;
   GstAudioInfo *info =
       gst_audio_encoder_get_audio_info (GST_AUDIO_ENCODER (enc));
-  gint *reorder_map;
+  GstFlowReturn ret;
 
   flacenc = GST_FLAC_ENC (enc);
 
@@ -1267,11 +1924,12 @@ gst_flac_enc_handle_frame (GstAudioEncoder * enc, GstBuffer * buffer)
 
   width = GST_AUDIO_INFO_WIDTH (info);
   channels = GST_AUDIO_INFO_CHANNELS (info);
-  reorder_map = flacenc->channel_reorder_map;
 
   if (G_UNLIKELY (!buffer)) {
     if (flacenc->eos) {
       GST_DEBUG_OBJECT (flacenc, "finish encoding");
+      if (flacenc->pool)
+        return gst_flac_enc_finish_parallel (flacenc);
       FLAC__stream_encoder_finish (flacenc->encoder);
     } else {
       /* can't handle intermittent draining/resyncing */
@@ -1285,53 +1943,29 @@ gst_flac_enc_handle_frame (GstAudioEncoder * enc, GstBuffer * buffer)
 
   gst_buffer_map (buffer, &map, GST_MAP_READ);
   samples = map.size / (width >> 3);
-
-  data = g_malloc (samples * sizeof (FLAC__int32));
-
   samples /= channels;
   GST_LOG_OBJECT (flacenc, "processing %d samples, %d channels", samples,
       channels);
-  if (width == 8) {
-    gint8 *indata = (gint8 *) map.data;
-
-    for (i = 0; i < samples; i++)
-      for (j = 0; j < channels; j++)
-        data[i * channels + reorder_map[j]] =
-            (FLAC__int32) indata[i * channels + j];
-  } else if (width == 16) {
-    gint16 *indata = (gint16 *) map.data;
 
-    for (i = 0; i < samples; i++)
-      for (j = 0; j < channels; j++)
-        data[i * channels + reorder_map[j]] =
-            (FLAC__int32) indata[i * channels + j];
-  } else if (width == 24) {
-    guint8 *indata = (guint8 *) map.data;
-    guint32 val;
-
-    for (i = 0; i < samples; i++)
-      for (j = 0; j < channels; j++) {
-        val = READ_INT24 (&indata[3 * (i * channels + j)]);
-        if (val & 0x00800000)
-          val |= 0xff000000;
-        data[i * channels + reorder_map[j]] = (FLAC__int32) val;
-      }
-  } else if (width == 32) {
-    gint32 *indata = (gint32 *) map.data;
+  if (flacenc->pool) {
+    ret = gst_flac_enc_handle_frame_parallel (flacenc, map.data, samples,
+        width, channels);
+    gst_buffer_unmap (buffer, &map);
+    return ret;
+  }
 
-    for (i = 0; i < samples; i++)
-      for (j = 0; j < channels; j++)
-        data[i * channels + reorder_map[j]] =
-            (FLAC__int32) indata[i * channels + j];
-  } else {
-    g_assert_not_reached ();
+  if (flacenc->data_size < samples * channels) {
+    g_free (flacenc->data);
+    flacenc->data_size = samples * channels;
+    flacenc->data = g_new (FLAC__int32, flacenc->data_size);
   }
+
+  gst_flac_enc_convert (flacenc, flacenc->data, map.data, samples, width,
+      channels);
   gst_buffer_unmap (buffer, &map);
 
   res = FLAC__stream_encoder_process_interleaved (flacenc->encoder,
-      (const FLAC__int32 *) data, samples);
-
-  g_free (data);
+      (const FLAC__int32 *) flacenc->data, samples);
 
   if (!res) {
     if (flacenc->last_flow == GST_FLOW_OK)
@@ -1409,6 +2043,9 @@ gst_flac_enc_set_property (GObject * object, guint prop_id,
     case PROP_SEEKPOINTS:
       this->seekpoints = g_value_get_int (value);
       break;
+    case PROP_THREADS:
+      this->threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1485,6 +2122,9 @@ gst_flac_enc_get_property (GObject * object, guint prop_id,
     case PROP_SEEKPOINTS:
       g_value_set_int (value, this->seekpoints);
       break;
+    case PROP_THREADS:
+      g_value_set_uint (value, this->threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -65,6 +65,34 @@ struct _GstFlacEnc {
   GList           *headers;
 
   gint             channel_reorder_map[8];
+
+  /* conversion buffer, reused between calls */
+  FLAC__int32     *data;
+  gsize            data_size;
+
+  /* byte offsets of the STREAMINFO and SEEKTABLE blocks, or G_MAXUINT64 */
+  guint64          streaminfo_offset;
+  guint64          seektable_offset;
+
+  /* parallel encoding */
+  guint            threads;
+  GThreadPool     *pool;
+  GMutex           jobs_lock;
+  GCond            jobs_cond;
+  GQueue           jobs;            /* submitted jobs in stream order */
+  GList           *free_jobs;
+  GList           *idle_encoders;
+  gpointer         current_job;     /* job that is being filled */
+  guint            job_samples;     /* samples per channel and job */
+  guint64          next_frame;
+  guint64          first_frame_offset;
+  guint64          total_samples;
+  guint            min_framesize;
+  guint            max_framesize;
+  FLAC__StreamMetadata *seektable;
+  guint            seekpoint;
+  GChecksum       *md5;
+  GByteArray      *scratch;
 };
 
 struct _GstFlacEncClass {
@@ -30,6 +30,10 @@
  * |[
  * gst-launch-1.0 -v filesrc location=mjpeg.avi ! avidemux !  queue ! jpegdec ! videoconvert ! videoscale ! autovideosink
  * ]| The above pipeline decode the mjpeg stream and renders it to the screen.
+ * |[
+ * gst-launch-1.0 -v filesrc location=photo.jpg ! jpegdec scale=8 ! videoconvert ! pngenc ! filesink location=thumbnail.png
+ * ]| Decodes a thumbnail at 1/8 of the picture size, which is a lot faster
+ * than decoding the whole picture and scaling it down afterwards.
  * </refsect2>
  */
 
@@ -56,12 +60,31 @@
 
 #define JPEG_DEFAULT_IDCT_METHOD	JDCT_FASTEST
 #define JPEG_DEFAULT_MAX_ERRORS 	0
+#define JPEG_DEFAULT_SCALE		1
+#define JPEG_DEFAULT_CROP		0
+
+/* size of the scaled DCT blocks, libjpeg 7 allows different horizontal
+ * and vertical scaling */
+#if JPEG_LIB_VERSION >= 70
+#define DCT_H_SCALED_SIZE(comp) ((comp)->DCT_h_scaled_size)
+#define DCT_V_SCALED_SIZE(comp) ((comp)->DCT_v_scaled_size)
+#define MIN_DCT_V_SCALED_SIZE(cinfo) ((cinfo)->min_DCT_v_scaled_size)
+#else
+#define DCT_H_SCALED_SIZE(comp) ((comp)->DCT_scaled_size)
+#define DCT_V_SCALED_SIZE(comp) ((comp)->DCT_scaled_size)
+#define MIN_DCT_V_SCALED_SIZE(cinfo) ((cinfo)->min_DCT_scaled_size)
+#endif
 
 enum
 {
   PROP_0,
   PROP_IDCT_METHOD,
-  PROP_MAX_ERRORS
+  PROP_MAX_ERRORS,
+  PROP_SCALE,
+  PROP_CROP_LEFT,
+  PROP_CROP_TOP,
+  PROP_CROP_RIGHT,
+  PROP_CROP_BOTTOM
 };
 
 /* *INDENT-OFF* */
@@ -161,6 +184,75 @@ gst_jpeg_dec_class_init (GstJpegDecClass * klass)
           -1, G_MAXINT, JPEG_DEFAULT_MAX_ERRORS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstJpegDec:scale
+   *
+   * Decode the picture at 1/scale of its size, using the scaled IDCT of
+   * libjpeg. This is a lot cheaper than decoding at full size and scaling
+   * down afterwards. Values other than 1, 2, 4 or 8 are rounded down to
+   * one of them. With 0, the scale is picked so that the output is as
+   * large as possible but not larger than what downstream accepts.
+   *
+   * Since: 1.2
+   **/
+  g_object_class_install_property (gobject_class, PROP_SCALE,
+      g_param_spec_uint ("scale", "Scale",
+          "Decode at 1/scale of the picture size (1, 2, 4 or 8, "
+          "0 = automatic from downstream caps)",
+          0, 8, JPEG_DEFAULT_SCALE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstJpegDec:crop-left
+   *
+   * Number of pixels of the full size picture to crop away on the left.
+   * Cropping happens while decoding; rows below the cropped region are not
+   * decoded at all.
+   *
+   * Since: 1.2
+   **/
+  g_object_class_install_property (gobject_class, PROP_CROP_LEFT,
+      g_param_spec_uint ("crop-left", "Crop Left",
+          "Pixels to crop at the left of the full size picture",
+          0, MAX_WIDTH, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstJpegDec:crop-top
+   *
+   * Number of pixels of the full size picture to crop away at the top.
+   *
+   * Since: 1.2
+   **/
+  g_object_class_install_property (gobject_class, PROP_CROP_TOP,
+      g_param_spec_uint ("crop-top", "Crop Top",
+          "Pixels to crop at the top of the full size picture",
+          0, MAX_HEIGHT, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstJpegDec:crop-right
+   *
+   * Number of pixels of the full size picture to crop away on the right.
+   *
+   * Since: 1.2
+   **/
+  g_object_class_install_property (gobject_class, PROP_CROP_RIGHT,
+      g_param_spec_uint ("crop-right", "Crop Right",
+          "Pixels to crop at the right of the full size picture",
+          0, MAX_WIDTH, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstJpegDec:crop-bottom
+   *
+   * Number of pixels of the full size picture to crop away at the bottom.
+   *
+   * Since: 1.2
+   **/
+  g_object_class_install_property (gobject_class, PROP_CROP_BOTTOM,
+      g_param_spec_uint ("crop-bottom", "Crop Bottom",
+          "Pixels to crop at the bottom of the full size picture",
+          0, MAX_HEIGHT, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&gst_jpeg_dec_src_pad_template));
   gst_element_class_add_pad_template (element_class,
@@ -354,6 +446,11 @@ gst_jpeg_dec_init (GstJpegDec * dec)
   /* init properties */
   dec->idct_method = JPEG_DEFAULT_IDCT_METHOD;
   dec->max_errors = JPEG_DEFAULT_MAX_ERRORS;
+  dec->scale = JPEG_DEFAULT_SCALE;
+  dec->crop_left = JPEG_DEFAULT_CROP;
+  dec->crop_top = JPEG_DEFAULT_CROP;
+  dec->crop_right = JPEG_DEFAULT_CROP;
+  dec->crop_bottom = JPEG_DEFAULT_CROP;
 }
 
 static inline gboolean
@@ -683,6 +780,9 @@ gst_jpeg_dec_set_format (GstVideoDecoder * dec, GstVideoCodecState * state)
     gst_video_codec_state_unref (jpeg->input_state);
   jpeg->input_state = gst_video_codec_state_ref (state);
 
+  /* downstream might have changed too, pick the scale again */
+  jpeg->auto_scale = 0;
+
   return TRUE;
 }
 
@@ -745,7 +845,8 @@ gst_jpeg_dec_ensure_buffers (GstJpegDec * dec, guint maxrowbytes)
 }
 
 static void
-gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame)
+gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame,
+    gint x0, gint y0)
 {
   guchar *rows[16];
   guchar **scanarray[1] = { rows };
@@ -760,7 +861,8 @@ gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame)
   width = GST_VIDEO_FRAME_WIDTH (frame);
   height = GST_VIDEO_FRAME_HEIGHT (frame);
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec,
+              GST_ROUND_UP_32 (dec->cinfo.output_width))))
     return;
 
   base[0] = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
@@ -770,15 +872,18 @@ gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame)
   memcpy (rows, dec->idr_y, 16 * sizeof (gpointer));
 
   i = 0;
-  while (i < height) {
+  while (i < y0 + height) {
     lines = jpeg_read_raw_data (&dec->cinfo, scanarray, DCTSIZE);
     if (G_LIKELY (lines > 0)) {
-      for (j = 0; (j < DCTSIZE) && (i < height); j++, i++) {
+      for (j = 0; (j < lines) && (i < y0 + height); j++, i++) {
         gint p;
 
+        if (i < y0)
+          continue;
+
         p = 0;
         for (k = 0; k < width; k++) {
-          base[0][p] = rows[j][k];
+          base[0][p] = rows[j][x0 + k];
           p += pstride;
         }
         base[0] += rstride;
@@ -790,7 +895,8 @@ gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame)
 }
 
 static void
-gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame)
+gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame,
+    gint x0, gint y0)
 {
   guchar *r_rows[16], *g_rows[16], *b_rows[16];
   guchar **scanarray[3] = { r_rows, g_rows, b_rows };
@@ -805,7 +911,8 @@ gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame)
   width = GST_VIDEO_FRAME_WIDTH (frame);
   height = GST_VIDEO_FRAME_HEIGHT (frame);
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec,
+              GST_ROUND_UP_32 (dec->cinfo.output_width))))
     return;
 
   for (i = 0; i < 3; i++)
@@ -819,17 +926,20 @@ gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame)
   memcpy (b_rows, dec->idr_v, 16 * sizeof (gpointer));
 
   i = 0;
-  while (i < height) {
+  while (i < y0 + height) {
     lines = jpeg_read_raw_data (&dec->cinfo, scanarray, DCTSIZE);
     if (G_LIKELY (lines > 0)) {
-      for (j = 0; (j < DCTSIZE) && (i < height); j++, i++) {
+      for (j = 0; (j < lines) && (i < y0 + height); j++, i++) {
         gint p;
 
+        if (i < y0)
+          continue;
+
         p = 0;
         for (k = 0; k < width; k++) {
-          base[0][p] = r_rows[j][k];
-          base[1][p] = g_rows[j][k];
-          base[2][p] = b_rows[j][k];
+          base[0][p] = r_rows[j][x0 + k];
+          base[1][p] = g_rows[j][x0 + k];
+          base[2][p] = b_rows[j][x0 + k];
           p += pstride;
         }
         base[0] += rstride;
@@ -922,6 +1032,92 @@ gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstVideoFrame * frame, gint r_v,
   }
 }
 
+/* copies one chroma row into I420, @src_size and @luma_size are the
+ * horizontal size of an MCU in the chroma and luma component */
+static void
+gst_jpeg_dec_copy_chroma_row (guint8 * dest, const guint8 * src, gint x0,
+    gint width, gint src_size, gint luma_size)
+{
+  gint i;
+
+  if (src_size * 2 == luma_size) {
+    memcpy (dest, src + x0 / 2, width);
+  } else if (src_size == luma_size) {
+    hresamplecpy1 (dest, src + x0, width);
+  } else {
+    for (i = 0; i < width; i++)
+      dest[i] = src[((x0 + 2 * i) * src_size) / luma_size];
+  }
+}
+
+/* Decoding of scaled or cropped YCbCr pictures. When scaling, libjpeg
+ * upsamples the chroma components in the IDCT where possible, so the raw
+ * output is not necessarily 4:2:0 and is converted here. Rows below the
+ * cropped region are not decoded. */
+static void
+gst_jpeg_dec_decode_scaled (GstJpegDec * dec, GstVideoFrame * frame, gint x0,
+    gint y0)
+{
+  guchar *y_rows[16], *u_rows[16], *v_rows[16];
+  guchar **scanarray[3] = { y_rows, u_rows, v_rows };
+  gint rows[3], hsize[3];
+  gint i, j, y, lines, max_lines;
+  guint8 *base[3];
+  gint stride[3];
+  gint width, height, cwidth;
+
+  GST_DEBUG_OBJECT (dec, "scaled decoding, offset %d,%d", x0, y0);
+
+  width = GST_VIDEO_FRAME_WIDTH (frame);
+  height = GST_VIDEO_FRAME_HEIGHT (frame);
+  cwidth = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1);
+
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec,
+              GST_ROUND_UP_32 (dec->cinfo.output_width + DCTSIZE))))
+    return;
+
+  for (i = 0; i < 3; i++) {
+    jpeg_component_info *comp = &dec->cinfo.comp_info[i];
+
+    base[i] = GST_VIDEO_FRAME_COMP_DATA (frame, i);
+    stride[i] = GST_VIDEO_FRAME_COMP_STRIDE (frame, i);
+    rows[i] = comp->v_samp_factor * DCT_V_SCALED_SIZE (comp);
+    hsize[i] = comp->h_samp_factor * DCT_H_SCALED_SIZE (comp);
+  }
+  max_lines =
+      dec->cinfo.max_v_samp_factor * MIN_DCT_V_SCALED_SIZE (&dec->cinfo);
+
+  memcpy (y_rows, dec->idr_y, 16 * sizeof (gpointer));
+  memcpy (u_rows, dec->idr_u, 16 * sizeof (gpointer));
+  memcpy (v_rows, dec->idr_v, 16 * sizeof (gpointer));
+
+  y = 0;
+  while (y < y0 + height) {
+    lines = jpeg_read_raw_data (&dec->cinfo, scanarray, max_lines);
+    if (G_UNLIKELY (lines <= 0)) {
+      GST_INFO_OBJECT (dec, "jpeg_read_raw_data() returned 0");
+      break;
+    }
+
+    for (j = 0; j < lines && y < y0 + height; j++, y++) {
+      gint out = y - y0;
+
+      if (out < 0)
+        continue;
+
+      memcpy (base[0] + out * stride[0], y_rows[j] + x0, width);
+
+      /* y0 is even, so every even output row starts a chroma row */
+      if ((out & 1) == 0) {
+        for (i = 1; i < 3; i++)
+          gst_jpeg_dec_copy_chroma_row (base[i] + (out / 2) * stride[i],
+              scanarray[i][(j * rows[i]) / rows[0]], x0, cwidth, hsize[i],
+              hsize[0]);
+      }
+    }
+  }
+}
+
 static GstFlowReturn
 gst_jpeg_dec_decode_direct (GstJpegDec * dec, GstVideoFrame * frame)
 {
@@ -1000,6 +1196,62 @@ format_not_supported:
   }
 }
 
+/* picks the smallest downscaling that gives a size downstream accepts */
+static guint
+gst_jpeg_dec_get_auto_scale (GstJpegDec * dec, gint width, gint height)
+{
+  GstCaps *caps;
+  gint max_width = 0, max_height = 0;
+  guint i, scale;
+
+  if (dec->auto_scale != 0 && dec->auto_scale_width == width &&
+      dec->auto_scale_height == height)
+    return dec->auto_scale;
+
+  caps = gst_pad_peer_query_caps (GST_VIDEO_DECODER_SRC_PAD (dec), NULL);
+  if (caps == NULL || gst_caps_is_any (caps) || gst_caps_is_empty (caps)) {
+    max_width = max_height = G_MAXINT;
+  } else {
+    for (i = 0; i < gst_caps_get_size (caps); i++) {
+      GstStructure *s = gst_caps_get_structure (caps, i);
+      const GValue *w, *h;
+
+      w = gst_structure_get_value (s, "width");
+      h = gst_structure_get_value (s, "height");
+
+      if (w && G_VALUE_HOLDS_INT (w))
+        max_width = MAX (max_width, g_value_get_int (w));
+      else if (w && GST_VALUE_HOLDS_INT_RANGE (w))
+        max_width = MAX (max_width, gst_value_get_int_range_max (w));
+      else
+        max_width = G_MAXINT;
+
+      if (h && G_VALUE_HOLDS_INT (h))
+        max_height = MAX (max_height, g_value_get_int (h));
+      else if (h && GST_VALUE_HOLDS_INT_RANGE (h))
+        max_height = MAX (max_height, gst_value_get_int_range_max (h));
+      else
+        max_height = G_MAXINT;
+    }
+  }
+  if (caps)
+    gst_caps_unref (caps);
+
+  scale = 1;
+  while (scale < 8 && ((width + scale - 1) / scale > max_width ||
+          (height + scale - 1) / scale > max_height))
+    scale *= 2;
+
+  GST_DEBUG_OBJECT (dec, "downstream accepts up to %dx%d, decoding %dx%d "
+      "at 1/%u", max_width, max_height, width, height, scale);
+
+  dec->auto_scale = scale;
+  dec->auto_scale_width = width;
+  dec->auto_scale_height = height;
+
+  return scale;
+}
+
 static void
 gst_jpeg_dec_negotiate (GstJpegDec * dec, gint width, gint height, gint clrspc)
 {
@@ -1065,6 +1317,9 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
   GstVideoFrame vframe;
   gint width, height;
   gint r_h, r_v;
+  gint crop_left, crop_top, crop_right, crop_bottom;
+  gint x0, y0;
+  guint scale;
   guint code, hdr_ok;
   gboolean need_unmap = TRUE;
   GstVideoCodecState *state = NULL;
@@ -1129,6 +1384,21 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
   dec->cinfo.dct_method = dec->idct_method;
   dec->cinfo.raw_data_out = TRUE;
 
+  /* crop region and scale; the crop region is given in pixels of the
+   * full size picture */
+  crop_left = MIN (dec->crop_left, dec->cinfo.image_width);
+  crop_top = MIN (dec->crop_top, dec->cinfo.image_height);
+  crop_right = MIN (dec->crop_right, dec->cinfo.image_width);
+  crop_bottom = MIN (dec->crop_bottom, dec->cinfo.image_height);
+
+  scale = dec->scale;
+  if (scale == 0)
+    scale = gst_jpeg_dec_get_auto_scale (dec,
+        dec->cinfo.image_width - crop_left - crop_right,
+        dec->cinfo.image_height - crop_top - crop_bottom);
+  dec->cinfo.scale_num = 1;
+  dec->cinfo.scale_denom = scale;
+
   GST_LOG_OBJECT (dec, "starting decompress");
   guarantee_huff_tables (&dec->cinfo);
   if (!jpeg_start_decompress (&dec->cinfo)) {
@@ -1159,8 +1429,15 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
       break;
   }
 
-  width = dec->cinfo.output_width;
-  height = dec->cinfo.output_height;
+  x0 = crop_left / scale;
+  y0 = crop_top / scale;
+  if (dec->cinfo.jpeg_color_space == JCS_YCbCr) {
+    /* keep the chroma planes aligned */
+    x0 &= ~1;
+    y0 &= ~1;
+  }
+  width = (gint) dec->cinfo.output_width - (gint) (crop_right / scale) - x0;
+  height = (gint) dec->cinfo.output_height - (gint) (crop_bottom / scale) - y0;
 
   if (G_UNLIKELY (width < MIN_WIDTH || width > MAX_WIDTH ||
           height < MIN_HEIGHT || height > MAX_HEIGHT))
@@ -1180,9 +1457,13 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
   GST_LOG_OBJECT (dec, "width %d, height %d", width, height);
 
   if (dec->cinfo.jpeg_color_space == JCS_RGB) {
-    gst_jpeg_dec_decode_rgb (dec, &vframe);
+    gst_jpeg_dec_decode_rgb (dec, &vframe, x0, y0);
   } else if (dec->cinfo.jpeg_color_space == JCS_GRAYSCALE) {
-    gst_jpeg_dec_decode_grayscale (dec, &vframe);
+    gst_jpeg_dec_decode_grayscale (dec, &vframe, x0, y0);
+  } else if (scale != 1 || x0 != 0 || y0 != 0 ||
+      width != (gint) dec->cinfo.output_width ||
+      height != (gint) dec->cinfo.output_height) {
+    gst_jpeg_dec_decode_scaled (dec, &vframe, x0, y0);
   } else {
     GST_LOG_OBJECT (dec, "decompressing (reqired scanline buffer height = %u)",
         dec->cinfo.rec_outbuf_height);
@@ -1211,7 +1492,11 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
   gst_video_frame_unmap (&vframe);
 
   GST_LOG_OBJECT (dec, "decompressing finished");
-  jpeg_finish_decompress (&dec->cinfo);
+  /* the rows below the crop region were not decoded */
+  if (dec->cinfo.output_scanline < dec->cinfo.output_height)
+    jpeg_abort_decompress (&dec->cinfo);
+  else
+    jpeg_finish_decompress (&dec->cinfo);
 
   /* reset error count on successful decode */
   dec->error_count = 0;
@@ -1368,6 +1653,27 @@ gst_jpeg_dec_set_property (GObject * object, guint prop_id,
     case PROP_MAX_ERRORS:
       g_atomic_int_set (&dec->max_errors, g_value_get_int (value));
       break;
+    case PROP_SCALE:{
+      guint scale = g_value_get_uint (value);
+
+      /* libjpeg can only scale by powers of two */
+      while (scale & (scale - 1))
+        scale &= scale - 1;
+      dec->scale = scale;
+      break;
+    }
+    case PROP_CROP_LEFT:
+      dec->crop_left = g_value_get_uint (value);
+      break;
+    case PROP_CROP_TOP:
+      dec->crop_top = g_value_get_uint (value);
+      break;
+    case PROP_CROP_RIGHT:
+      dec->crop_right = g_value_get_uint (value);
+      break;
+    case PROP_CROP_BOTTOM:
+      dec->crop_bottom = g_value_get_uint (value);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1390,6 +1696,21 @@ gst_jpeg_dec_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_MAX_ERRORS:
       g_value_set_int (value, g_atomic_int_get (&dec->max_errors));
       break;
+    case PROP_SCALE:
+      g_value_set_uint (value, dec->scale);
+      break;
+    case PROP_CROP_LEFT:
+      g_value_set_uint (value, dec->crop_left);
+      break;
+    case PROP_CROP_TOP:
+      g_value_set_uint (value, dec->crop_top);
+      break;
+    case PROP_CROP_RIGHT:
+      g_value_set_uint (value, dec->crop_right);
+      break;
+    case PROP_CROP_BOTTOM:
+      g_value_set_uint (value, dec->crop_bottom);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -82,6 +82,12 @@ struct _GstJpegDec {
   /* properties */
   gint     idct_method;
   gint     max_errors;  /* ATOMIC */
+  guint    scale;       /* 1, 2, 4 or 8, 0 = automatic */
+  guint    crop_left, crop_top, crop_right, crop_bottom;
+
+  /* scale picked for the last picture size in automatic mode */
+  guint    auto_scale;
+  gint     auto_scale_width, auto_scale_height;
 
   /* current error (the message is the debug message) */
   gchar       *error_msg;
@@ -32,6 +32,13 @@
  * This example encodes 10 seconds of video and sends it to the HTTP
  * server "server" using HTTP PUT commands.
  * </refsect2>
+ *
+ * By default data is sent in a sequence of PUT requests, each one carrying
+ * the buffers that arrived while the previous one was in progress. If the
+ * #GstSoupHttpClientSink:streaming property is set, a single PUT request
+ * with chunked transfer encoding is used instead and every buffer is
+ * written as soon as it arrives, which keeps the latency low for live
+ * streams.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -64,6 +71,7 @@ static void gst_soup_http_client_sink_get_times (GstBaseSink * sink,
 static gboolean gst_soup_http_client_sink_start (GstBaseSink * sink);
 static gboolean gst_soup_http_client_sink_stop (GstBaseSink * sink);
 static gboolean gst_soup_http_client_sink_unlock (GstBaseSink * sink);
+static gboolean gst_soup_http_client_sink_unlock_stop (GstBaseSink * sink);
 static gboolean gst_soup_http_client_sink_event (GstBaseSink * sink,
     GstEvent * event);
 static GstFlowReturn gst_soup_http_client_sink_preroll (GstBaseSink * sink,
@@ -72,6 +80,11 @@ static GstFlowReturn gst_soup_http_client_sink_render (GstBaseSink * sink,
     GstBuffer * buffer);
 
 static void free_buffer_list (GList * list);
+static GstStructure *gst_soup_http_client_sink_get_stats (GstSoupHttpClientSink
+    * souphttpsink);
+static void schedule_locked (GstSoupHttpClientSink * souphttpsink,
+    GSourceFunc func);
+static gboolean stream_message (GstSoupHttpClientSink * souphttpsink);
 static void gst_soup_http_client_sink_reset (GstSoupHttpClientSink *
     souphttpsink);
 static void authenticate (SoupSession * session, SoupMessage * msg,
@@ -93,10 +106,15 @@ enum
   PROP_PROXY_ID,
   PROP_PROXY_PW,
   PROP_COOKIES,
-  PROP_SESSION
+  PROP_SESSION,
+  PROP_STREAMING,
+  PROP_MAX_BACKLOG,
+  PROP_STATS
 };
 
 #define DEFAULT_USER_AGENT           "GStreamer souphttpclientsink "
+#define DEFAULT_STREAMING            FALSE
+#define DEFAULT_MAX_BACKLOG          (4 * 1024 * 1024)
 
 /* pad templates */
 
@@ -168,6 +186,52 @@ gst_soup_http_client_sink_class_init (GstSoupHttpClientSinkClass * klass)
   g_object_class_install_property (gobject_class, PROP_COOKIES,
       g_param_spec_boxed ("cookies", "Cookies", "HTTP request cookies",
           G_TYPE_STRV, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstSoupHttpClientSink:streaming:
+   *
+   * Send all data in a single PUT request with chunked transfer encoding,
+   * writing every buffer as soon as it arrives.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_STREAMING,
+      g_param_spec_boolean ("streaming", "Streaming",
+          "Stream the data in a single chunked PUT request",
+          DEFAULT_STREAMING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstSoupHttpClientSink:max-backlog:
+   *
+   * Maximum number of bytes that were received but not yet sent to the
+   * server. Rendering blocks while the backlog is bigger.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_BACKLOG,
+      g_param_spec_uint64 ("max-backlog", "Max Backlog",
+          "Maximum number of bytes waiting to be sent (0 = unlimited)",
+          0, G_MAXUINT64, DEFAULT_MAX_BACKLOG,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstSoupHttpClientSink:stats:
+   *
+   * Various statistics. This property returns a GstStructure with name
+   * application/x-soup-http-client-sink-stats with the following fields:
+   *
+   * <itemizedlist>
+   * <listitem><para>#guint64 <classname>&quot;bytes-sent&quot;</classname>:
+   *   bytes written to the server so far</para></listitem>
+   * <listitem><para>#guint64 <classname>&quot;backlog&quot;</classname>:
+   *   bytes waiting to be sent</para></listitem>
+   * <listitem><para>#guint64 <classname>&quot;bitrate&quot;</classname>:
+   *   average throughput in bits per second since the first buffer
+   *   </para></listitem>
+   * </itemizedlist>
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Various statistics",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gst_soup_http_client_sink_sink_template));
@@ -185,6 +249,8 @@ gst_soup_http_client_sink_class_init (GstSoupHttpClientSinkClass * klass)
   base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_soup_http_client_sink_stop);
   base_sink_class->unlock =
       GST_DEBUG_FUNCPTR (gst_soup_http_client_sink_unlock);
+  base_sink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_soup_http_client_sink_unlock_stop);
   base_sink_class->event = GST_DEBUG_FUNCPTR (gst_soup_http_client_sink_event);
   if (0)
     base_sink_class->preroll =
@@ -214,6 +280,8 @@ gst_soup_http_client_sink_init (GstSoupHttpClientSink * souphttpsink)
   souphttpsink->proxy_pw = NULL;
   souphttpsink->prop_session = NULL;
   souphttpsink->timeout = 1;
+  souphttpsink->streaming = DEFAULT_STREAMING;
+  souphttpsink->max_backlog = DEFAULT_MAX_BACKLOG;
   proxy = g_getenv ("http_proxy");
   if (proxy && !gst_soup_http_client_sink_set_proxy (souphttpsink, proxy)) {
     GST_WARNING_OBJECT (souphttpsink,
@@ -231,7 +299,13 @@ gst_soup_http_client_sink_reset (GstSoupHttpClientSink * souphttpsink)
   souphttpsink->reason_phrase = NULL;
   souphttpsink->status_code = 0;
   souphttpsink->offset = 0;
-
+  souphttpsink->stream_started = FALSE;
+  souphttpsink->eos = FALSE;
+  souphttpsink->unlocked = FALSE;
+  souphttpsink->backlog = 0;
+  souphttpsink->message_size = 0;
+  souphttpsink->bytes_sent = 0;
+  souphttpsink->start_time = -1;
 }
 
 static gboolean
@@ -316,6 +390,13 @@ gst_soup_http_client_sink_set_property (GObject * object, guint property_id,
       g_strfreev (souphttpsink->cookies);
       souphttpsink->cookies = g_strdupv (g_value_get_boxed (value));
       break;
+    case PROP_STREAMING:
+      souphttpsink->streaming = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_BACKLOG:
+      souphttpsink->max_backlog = g_value_get_uint64 (value);
+      g_cond_broadcast (&souphttpsink->cond);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -368,6 +449,18 @@ gst_soup_http_client_sink_get_property (GObject * object, guint property_id,
     case PROP_COOKIES:
       g_value_set_boxed (value, g_strdupv (souphttpsink->cookies));
       break;
+    case PROP_STREAMING:
+      g_value_set_boolean (value, souphttpsink->streaming);
+      break;
+    case PROP_MAX_BACKLOG:
+      g_value_set_uint64 (value, souphttpsink->max_backlog);
+      break;
+    case PROP_STATS:
+      g_mutex_lock (&souphttpsink->mutex);
+      g_value_take_boxed (value,
+          gst_soup_http_client_sink_get_stats (souphttpsink));
+      g_mutex_unlock (&souphttpsink->mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -555,8 +648,29 @@ gst_soup_http_client_sink_stop (GstBaseSink * sink)
 static gboolean
 gst_soup_http_client_sink_unlock (GstBaseSink * sink)
 {
+  GstSoupHttpClientSink *souphttpsink = GST_SOUP_HTTP_CLIENT_SINK (sink);
+
   GST_DEBUG ("unlock");
 
+  g_mutex_lock (&souphttpsink->mutex);
+  souphttpsink->unlocked = TRUE;
+  g_cond_broadcast (&souphttpsink->cond);
+  g_mutex_unlock (&souphttpsink->mutex);
+
+  return TRUE;
+}
+
+static gboolean
+gst_soup_http_client_sink_unlock_stop (GstBaseSink * sink)
+{
+  GstSoupHttpClientSink *souphttpsink = GST_SOUP_HTTP_CLIENT_SINK (sink);
+
+  GST_DEBUG ("unlock_stop");
+
+  g_mutex_lock (&souphttpsink->mutex);
+  souphttpsink->unlocked = FALSE;
+  g_mutex_unlock (&souphttpsink->mutex);
+
   return TRUE;
 }
 
@@ -570,7 +684,13 @@ gst_soup_http_client_sink_event (GstBaseSink * sink, GstEvent * event)
   if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
     GST_DEBUG_OBJECT (souphttpsink, "got eos");
     g_mutex_lock (&souphttpsink->mutex);
-    while (souphttpsink->message) {
+    if (souphttpsink->streaming) {
+      /* terminate the chunked request body */
+      souphttpsink->eos = TRUE;
+      schedule_locked (souphttpsink, (GSourceFunc) stream_message);
+    }
+    while (souphttpsink->message || (souphttpsink->streaming &&
+            souphttpsink->queued_buffers)) {
       GST_DEBUG_OBJECT (souphttpsink, "waiting");
       g_cond_wait (&souphttpsink->cond, &souphttpsink->mutex);
     }
@@ -600,6 +720,82 @@ free_buffer_list (GList * list)
   g_list_free (list);
 }
 
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+} MappedBuffer;
+
+static void
+mapped_buffer_free (MappedBuffer * mapped)
+{
+  gst_buffer_unmap (mapped->buffer, &mapped->map);
+  gst_buffer_unref (mapped->buffer);
+  g_slice_free (MappedBuffer, mapped);
+}
+
+/* Appends the memory of @buffer to @body without copying, the buffer stays
+ * mapped until libsoup is done with it. Returns the number of bytes
+ * appended. */
+static gsize
+append_buffer (SoupMessageBody * body, GstBuffer * buffer)
+{
+  MappedBuffer *mapped;
+  SoupBuffer *chunk;
+  gsize size;
+
+  mapped = g_slice_new (MappedBuffer);
+  if (!gst_buffer_map (buffer, &mapped->map, GST_MAP_READ)) {
+    g_slice_free (MappedBuffer, mapped);
+    return 0;
+  }
+  size = mapped->map.size;
+  if (size == 0) {
+    /* an empty chunk would terminate a chunked body */
+    gst_buffer_unmap (buffer, &mapped->map);
+    g_slice_free (MappedBuffer, mapped);
+    return 0;
+  }
+  mapped->buffer = gst_buffer_ref (buffer);
+
+  chunk = soup_buffer_new_with_owner (mapped->map.data, size, mapped,
+      (GDestroyNotify) mapped_buffer_free);
+  soup_message_body_append_buffer (body, chunk);
+  soup_buffer_free (chunk);
+
+  return size;
+}
+
+static GstStructure *
+gst_soup_http_client_sink_get_stats (GstSoupHttpClientSink * souphttpsink)
+{
+  guint64 bitrate = 0;
+
+  if (souphttpsink->start_time != -1) {
+    gint64 elapsed = g_get_monotonic_time () - souphttpsink->start_time;
+
+    if (elapsed > 0)
+      bitrate = gst_util_uint64_scale (souphttpsink->bytes_sent * 8,
+          G_USEC_PER_SEC, elapsed);
+  }
+
+  return gst_structure_new ("application/x-soup-http-client-sink-stats",
+      "bytes-sent", G_TYPE_UINT64, souphttpsink->bytes_sent,
+      "backlog", G_TYPE_UINT64, souphttpsink->backlog,
+      "bitrate", G_TYPE_UINT64, bitrate, NULL);
+}
+
+static void
+schedule_locked (GstSoupHttpClientSink * souphttpsink, GSourceFunc func)
+{
+  GSource *source;
+
+  source = g_idle_source_new ();
+  g_source_set_callback (source, func, souphttpsink, NULL);
+  g_source_attach (source, souphttpsink->context);
+  g_source_unref (source);
+}
+
 static void
 send_message_locked (GstSoupHttpClientSink * souphttpsink)
 {
@@ -614,6 +810,8 @@ send_message_locked (GstSoupHttpClientSink * souphttpsink)
   if (souphttpsink->location == NULL) {
     free_buffer_list (souphttpsink->queued_buffers);
     souphttpsink->queued_buffers = NULL;
+    souphttpsink->backlog = 0;
+    g_cond_broadcast (&souphttpsink->cond);
     return;
   }
 
@@ -623,28 +821,20 @@ send_message_locked (GstSoupHttpClientSink * souphttpsink)
   if (souphttpsink->offset == 0) {
     for (g = souphttpsink->streamheader_buffers; g; g = g_list_next (g)) {
       GstBuffer *buffer = g->data;
-      GstMapInfo map;
-
-      /* FIXME, lifetime of the buffer? */
-      gst_buffer_map (buffer, &map, GST_MAP_READ);
-      soup_message_body_append (souphttpsink->message->request_body,
-          SOUP_MEMORY_STATIC, map.data, map.size);
-      n += map.size;
-      gst_buffer_unmap (buffer, &map);
+      gsize size;
+
+      size = append_buffer (souphttpsink->message->request_body, buffer);
+      souphttpsink->backlog += size;
+      n += size;
     }
   }
 
   for (g = souphttpsink->queued_buffers; g; g = g_list_next (g)) {
     GstBuffer *buffer = g->data;
     if (!GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER)) {
-      GstMapInfo map;
-
-      /* FIXME, lifetime of the buffer? */
-      gst_buffer_map (buffer, &map, GST_MAP_READ);
-      soup_message_body_append (souphttpsink->message->request_body,
-          SOUP_MEMORY_STATIC, map.data, map.size);
-      n += map.size;
-      gst_buffer_unmap (buffer, &map);
+      n += append_buffer (souphttpsink->message->request_body, buffer);
+    } else {
+      souphttpsink->backlog -= gst_buffer_get_size (buffer);
     }
   }
 
@@ -662,11 +852,13 @@ send_message_locked (GstSoupHttpClientSink * souphttpsink)
     souphttpsink->queued_buffers = NULL;
     g_object_unref (souphttpsink->message);
     souphttpsink->message = NULL;
+    g_cond_broadcast (&souphttpsink->cond);
     return;
   }
 
   souphttpsink->sent_buffers = souphttpsink->queued_buffers;
   souphttpsink->queued_buffers = NULL;
+  souphttpsink->message_size = n;
 
   GST_DEBUG_OBJECT (souphttpsink,
       "queue message %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT,
@@ -687,6 +879,99 @@ send_message (GstSoupHttpClientSink * souphttpsink)
   return FALSE;
 }
 
+static void
+stream_wrote_headers (SoupMessage * msg, gpointer user_data)
+{
+  GstSoupHttpClientSink *souphttpsink = GST_SOUP_HTTP_CLIENT_SINK (user_data);
+
+  g_mutex_lock (&souphttpsink->mutex);
+  souphttpsink->stream_started = TRUE;
+  g_mutex_unlock (&souphttpsink->mutex);
+}
+
+static void
+stream_wrote_body_data (SoupMessage * msg, SoupBuffer * chunk,
+    gpointer user_data)
+{
+  GstSoupHttpClientSink *souphttpsink = GST_SOUP_HTTP_CLIENT_SINK (user_data);
+
+  g_mutex_lock (&souphttpsink->mutex);
+  souphttpsink->backlog -= MIN (souphttpsink->backlog, chunk->length);
+  souphttpsink->bytes_sent += chunk->length;
+  g_cond_broadcast (&souphttpsink->cond);
+  g_mutex_unlock (&souphttpsink->mutex);
+}
+
+/* Streaming mode: starts the chunked PUT request if needed and hands all
+ * queued buffers to it. The request body doesn't accumulate, so libsoup
+ * releases every buffer once it is written. */
+static gboolean
+stream_message (GstSoupHttpClientSink * souphttpsink)
+{
+  SoupMessage *msg;
+  GList *g;
+
+  g_mutex_lock (&souphttpsink->mutex);
+
+  /* If the URI went away or the request failed, drop all these buffers */
+  if (souphttpsink->location == NULL || souphttpsink->status_code != 0) {
+    free_buffer_list (souphttpsink->queued_buffers);
+    souphttpsink->queued_buffers = NULL;
+    souphttpsink->backlog = 0;
+    g_cond_broadcast (&souphttpsink->cond);
+    goto done;
+  }
+
+  msg = souphttpsink->message;
+  if (msg == NULL) {
+    if (souphttpsink->queued_buffers == NULL)
+      goto done;
+
+    msg = soup_message_new ("PUT", souphttpsink->location);
+    soup_message_headers_set_encoding (msg->request_headers,
+        SOUP_ENCODING_CHUNKED);
+    soup_message_body_set_accumulate (msg->request_body, FALSE);
+    g_signal_connect (msg, "wrote-headers",
+        G_CALLBACK (stream_wrote_headers), souphttpsink);
+    g_signal_connect (msg, "wrote-body-data",
+        G_CALLBACK (stream_wrote_body_data), souphttpsink);
+
+    for (g = souphttpsink->streamheader_buffers; g; g = g_list_next (g))
+      souphttpsink->backlog += append_buffer (msg->request_body, g->data);
+
+    GST_DEBUG_OBJECT (souphttpsink, "queue streaming message");
+    souphttpsink->message = msg;
+    souphttpsink->stream_started = FALSE;
+    soup_session_queue_message (souphttpsink->session, msg, callback,
+        souphttpsink);
+  }
+
+  for (g = souphttpsink->queued_buffers; g; g = g_list_next (g)) {
+    GstBuffer *buffer = g->data;
+
+    /* in-band headers were already sent from the caps */
+    if (souphttpsink->streamheader_buffers &&
+        GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER))
+      souphttpsink->backlog -= gst_buffer_get_size (buffer);
+    else
+      append_buffer (msg->request_body, buffer);
+  }
+  free_buffer_list (souphttpsink->queued_buffers);
+  souphttpsink->queued_buffers = NULL;
+
+  if (souphttpsink->eos)
+    soup_message_body_complete (msg->request_body);
+
+  /* libsoup pauses the request when it runs out of body data */
+  if (souphttpsink->stream_started)
+    soup_session_unpause_message (souphttpsink->session, msg);
+
+done:
+  g_mutex_unlock (&souphttpsink->mutex);
+
+  return FALSE;
+}
+
 static void
 callback (SoupSession * session, SoupMessage * msg, gpointer user_data)
 {
@@ -696,7 +981,7 @@ callback (SoupSession * session, SoupMessage * msg, gpointer user_data)
       msg->status_code, msg->reason_phrase);
 
   g_mutex_lock (&souphttpsink->mutex);
-  g_cond_signal (&souphttpsink->cond);
+  g_cond_broadcast (&souphttpsink->cond);
   souphttpsink->message = NULL;
 
   if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
@@ -706,6 +991,16 @@ callback (SoupSession * session, SoupMessage * msg, gpointer user_data)
     return;
   }
 
+  if (souphttpsink->streaming) {
+    g_mutex_unlock (&souphttpsink->mutex);
+    return;
+  }
+
+  souphttpsink->backlog -= MIN (souphttpsink->backlog,
+      souphttpsink->message_size);
+  souphttpsink->bytes_sent += souphttpsink->message_size;
+  souphttpsink->message_size = 0;
+
   free_buffer_list (souphttpsink->sent_buffers);
   souphttpsink->sent_buffers = NULL;
 
@@ -717,8 +1012,8 @@ static GstFlowReturn
 gst_soup_http_client_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstSoupHttpClientSink *souphttpsink = GST_SOUP_HTTP_CLIENT_SINK (sink);
-  GSource *source;
   gboolean wake;
+  gsize size;
 
   if (souphttpsink->status_code != 0) {
     /* FIXME we should allow a moderate amount of retries. */
@@ -729,18 +1024,40 @@ gst_soup_http_client_sink_render (GstBaseSink * sink, GstBuffer * buffer)
     return GST_FLOW_ERROR;
   }
 
+  size = gst_buffer_get_size (buffer);
+
   g_mutex_lock (&souphttpsink->mutex);
+  if (souphttpsink->start_time == -1)
+    souphttpsink->start_time = g_get_monotonic_time ();
+
+  /* wait until the server caught up */
+  while (souphttpsink->max_backlog > 0 && souphttpsink->backlog > 0 &&
+      souphttpsink->backlog + size > souphttpsink->max_backlog &&
+      souphttpsink->status_code == 0 && souphttpsink->location != NULL) {
+    if (souphttpsink->unlocked) {
+      GstFlowReturn ret;
+
+      g_mutex_unlock (&souphttpsink->mutex);
+      ret = gst_base_sink_wait_preroll (sink);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      g_mutex_lock (&souphttpsink->mutex);
+      continue;
+    }
+    GST_LOG_OBJECT (souphttpsink, "backlog %" G_GUINT64_FORMAT " full",
+        souphttpsink->backlog);
+    g_cond_wait (&souphttpsink->cond, &souphttpsink->mutex);
+  }
+
   if (souphttpsink->location != NULL) {
     wake = (souphttpsink->queued_buffers == NULL);
     souphttpsink->queued_buffers =
         g_list_append (souphttpsink->queued_buffers, gst_buffer_ref (buffer));
+    souphttpsink->backlog += size;
 
     if (wake) {
-      source = g_idle_source_new ();
-      g_source_set_callback (source, (GSourceFunc) (send_message),
-          souphttpsink, NULL);
-      g_source_attach (source, souphttpsink->context);
-      g_source_unref (source);
+      schedule_locked (souphttpsink, souphttpsink->streaming ?
+          (GSourceFunc) stream_message : (GSourceFunc) send_message);
     }
   }
   g_mutex_unlock (&souphttpsink->mutex);
@@ -55,6 +55,17 @@ struct _GstSoupHttpClientSink
   guint64 offset;
   int timeout;
 
+  /* streaming mode state */
+  gboolean stream_started;
+  gboolean eos;
+
+  /* flow control and statistics */
+  gboolean unlocked;
+  guint64 backlog;
+  gsize message_size;
+  guint64 bytes_sent;
+  gint64 start_time;
+
   /* properties */
   SoupSession *prop_session;
   char *location;
@@ -66,6 +77,8 @@ struct _GstSoupHttpClientSink
   char *user_agent;
   gboolean automatic_redirect;
   gchar **cookies;
+  gboolean streaming;
+  guint64 max_backlog;
 
 };
 
@@ -105,11 +105,33 @@ enum
   PROP_COOKIES,
   PROP_IRADIO_MODE,
   PROP_TIMEOUT,
-  PROP_EXTRA_HEADERS
+  PROP_EXTRA_HEADERS,
+  PROP_CACHE_SIZE,
+  PROP_READAHEAD_BLOCKS
 };
 
 #define DEFAULT_USER_AGENT           "GStreamer souphttpsrc "
 #define DEFAULT_IRADIO_MODE          TRUE
+#define DEFAULT_CACHE_SIZE           0
+#define DEFAULT_READAHEAD_BLOCKS     2
+
+/* Size of the ranges requested and cached when the block cache is enabled */
+#define CACHE_BLOCK_SIZE             (64 * 1024)
+
+typedef struct
+{
+  gchar *key;
+  GstBuffer *buffer;
+  SoupMessageHeaders *headers;  /* of the response with the block */
+  guint64 total;                /* size of the resource, 0 if unknown */
+  GList *link;                  /* in src->cache_lru */
+} GstSoupHTTPSrcCacheBlock;
+
+typedef struct
+{
+  GstSoupHTTPSrc *src;
+  gchar *key;
+} GstSoupHTTPSrcBlockRequest;
 
 static void gst_soup_http_src_uri_handler_init (gpointer g_iface,
     gpointer iface_data);
@@ -162,6 +184,10 @@ static void gst_soup_http_src_finished_cb (SoupMessage * msg,
 static void gst_soup_http_src_authenticate_cb (SoupSession * session,
     SoupMessage * msg, SoupAuth * auth, gboolean retrying,
     GstSoupHTTPSrc * src);
+static GstFlowReturn gst_soup_http_src_create_cached (GstSoupHTTPSrc * src,
+    GstBuffer ** outbuf);
+static void gst_soup_http_src_cache_block_free (GstSoupHTTPSrcCacheBlock *
+    block);
 
 #define gst_soup_http_src_parent_class parent_class
 G_DEFINE_TYPE_WITH_CODE (GstSoupHTTPSrc, gst_soup_http_src, GST_TYPE_PUSH_SRC,
@@ -241,6 +267,34 @@ gst_soup_http_src_class_init (GstSoupHTTPSrcClass * klass)
           "Enable internet radio mode (ask server to send shoutcast/icecast "
           "metadata interleaved with the actual stream data)",
           DEFAULT_IRADIO_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstSoupHTTPSrc:cache-size:
+   *
+   * Maximum number of bytes kept in the in-memory block cache. If non-zero
+   * and the server supports Range requests, the resource is fetched in
+   * blocks that are kept across seeks and restarts of the element, and the
+   * least recently used blocks are dropped once the limit is reached.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_CACHE_SIZE,
+      g_param_spec_uint64 ("cache-size", "Cache Size",
+          "Maximum number of bytes to keep in the block cache "
+          "(0 = disabled)", 0, G_MAXUINT64, DEFAULT_CACHE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstSoupHTTPSrc:readahead-blocks:
+   *
+   * Number of blocks following a missing block that are requested in
+   * parallel with it when the block cache is enabled.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_READAHEAD_BLOCKS,
+      g_param_spec_uint ("readahead-blocks", "Readahead Blocks",
+          "Number of blocks to prefetch when the block cache is enabled", 0,
+          16, DEFAULT_READAHEAD_BLOCKS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&srctemplate));
@@ -277,6 +331,8 @@ gst_soup_http_src_reset (GstSoupHTTPSrc * src)
   src->read_position = 0;
   src->request_position = 0;
   src->content_size = 0;
+  src->cache_usable = TRUE;
+  src->cache_headers_done = FALSE;
 
   gst_caps_replace (&src->src_caps, NULL);
   g_free (src->iradio_name);
@@ -305,6 +361,14 @@ gst_soup_http_src_init (GstSoupHTTPSrc * src)
   src->context = NULL;
   src->session = NULL;
   src->msg = NULL;
+  src->cache_size = DEFAULT_CACHE_SIZE;
+  src->readahead_blocks = DEFAULT_READAHEAD_BLOCKS;
+  src->cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) gst_soup_http_src_cache_block_free);
+  g_queue_init (&src->cache_lru);
+  src->cache_used = 0;
+  src->cache_pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      NULL);
   proxy = g_getenv ("http_proxy");
   if (proxy && !gst_soup_http_src_set_proxy (src, proxy)) {
     GST_WARNING_OBJECT (src,
@@ -332,6 +396,9 @@ gst_soup_http_src_finalize (GObject * gobject)
   g_free (src->proxy_id);
   g_free (src->proxy_pw);
   g_strfreev (src->cookies);
+  g_queue_clear (&src->cache_lru);
+  g_hash_table_destroy (src->cache);
+  g_hash_table_destroy (src->cache_pending);
 
   G_OBJECT_CLASS (parent_class)->finalize (gobject);
 }
@@ -425,6 +492,12 @@ gst_soup_http_src_set_property (GObject * object, guint prop_id,
       src->extra_headers = s ? gst_structure_copy (s) : NULL;
       break;
     }
+    case PROP_CACHE_SIZE:
+      src->cache_size = g_value_get_uint64 (value);
+      break;
+    case PROP_READAHEAD_BLOCKS:
+      src->readahead_blocks = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -486,6 +559,12 @@ gst_soup_http_src_get_property (GObject * object, guint prop_id,
     case PROP_EXTRA_HEADERS:
       gst_value_set_structure (value, src->extra_headers);
       break;
+    case PROP_CACHE_SIZE:
+      g_value_set_uint64 (value, src->cache_size);
+      break;
+    case PROP_READAHEAD_BLOCKS:
+      g_value_set_uint (value, src->readahead_blocks);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -539,10 +618,17 @@ gst_soup_http_src_add_range_header (GstSoupHTTPSrc * src, guint64 offset)
   return TRUE;
 }
 
+typedef struct
+{
+  GstSoupHTTPSrc *src;
+  SoupMessage *msg;
+} GstSoupHTTPSrcHeaderData;
+
 static gboolean
 _append_extra_header (GQuark field_id, const GValue * value, gpointer user_data)
 {
-  GstSoupHTTPSrc *src = GST_SOUP_HTTP_SRC (user_data);
+  GstSoupHTTPSrcHeaderData *data = user_data;
+  GstSoupHTTPSrc *src = data->src;
   const gchar *field_name = g_quark_to_string (field_id);
   gchar *field_content = NULL;
 
@@ -565,7 +651,7 @@ _append_extra_header (GQuark field_id, const GValue * value, gpointer user_data)
 
   GST_DEBUG_OBJECT (src, "Appending extra header: \"%s: %s\"", field_name,
       field_content);
-  soup_message_headers_append (src->msg->request_headers, field_name,
+  soup_message_headers_append (data->msg->request_headers, field_name,
       field_content);
 
   g_free (field_content);
@@ -606,12 +692,17 @@ _append_extra_headers (GQuark field_id, const GValue * value,
 
 
 static gboolean
-gst_soup_http_src_add_extra_headers (GstSoupHTTPSrc * src)
+gst_soup_http_src_add_extra_headers (GstSoupHTTPSrc * src, SoupMessage * msg)
 {
+  GstSoupHTTPSrcHeaderData data;
+
   if (!src->extra_headers)
     return TRUE;
 
-  return gst_structure_foreach (src->extra_headers, _append_extra_headers, src);
+  data.src = src;
+  data.msg = msg;
+  return gst_structure_foreach (src->extra_headers, _append_extra_headers,
+      &data);
 }
 
 
@@ -636,6 +727,7 @@ gst_soup_http_src_session_close (GstSoupHTTPSrc * src)
     src->session = NULL;
     src->msg = NULL;
   }
+  g_hash_table_remove_all (src->cache_pending);
 }
 
 static void
@@ -661,57 +753,20 @@ gst_soup_http_src_headers_foreach (const gchar * name, const gchar * val,
   GST_DEBUG_OBJECT (src, " %s: %s", name, val);
 }
 
+/* Sets the caps from the Content-Type and the Icecast headers in @headers
+ * and pushes the Icecast tags. */
 static void
-gst_soup_http_src_got_headers_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
+gst_soup_http_src_handle_headers (GstSoupHTTPSrc * src,
+    SoupMessageHeaders * headers)
 {
   const char *value;
   GstTagList *tag_list;
-  GstBaseSrc *basesrc;
-  guint64 newsize;
   GHashTable *params = NULL;
 
-  GST_DEBUG_OBJECT (src, "got headers:");
-  soup_message_headers_foreach (msg->response_headers,
-      gst_soup_http_src_headers_foreach, src);
-
-  if (msg->status_code == 407 && src->proxy_id && src->proxy_pw)
-    return;
-
-  if (src->automatic_redirect && SOUP_STATUS_IS_REDIRECTION (msg->status_code)) {
-    GST_DEBUG_OBJECT (src, "%u redirect to \"%s\"", msg->status_code,
-        soup_message_headers_get_one (msg->response_headers, "Location"));
-    return;
-  }
-
-  if (msg->status_code == SOUP_STATUS_UNAUTHORIZED)
-    return;
-
-  src->session_io_status = GST_SOUP_HTTP_SRC_SESSION_IO_STATUS_RUNNING;
-
-  /* Parse Content-Length. */
-  if (soup_message_headers_get_encoding (msg->response_headers) ==
-      SOUP_ENCODING_CONTENT_LENGTH) {
-    newsize = src->request_position +
-        soup_message_headers_get_content_length (msg->response_headers);
-    if (!src->have_size || (src->content_size != newsize)) {
-      src->content_size = newsize;
-      src->have_size = TRUE;
-      src->seekable = TRUE;
-      GST_DEBUG_OBJECT (src, "size = %" G_GUINT64_FORMAT, src->content_size);
-
-      basesrc = GST_BASE_SRC_CAST (src);
-      basesrc->segment.duration = src->content_size;
-      gst_element_post_message (GST_ELEMENT (src),
-          gst_message_new_duration_changed (GST_OBJECT (src)));
-    }
-  }
-
   /* Icecast stuff */
   tag_list = gst_tag_list_new_empty ();
 
-  if ((value =
-          soup_message_headers_get_one (msg->response_headers,
-              "icy-metaint")) != NULL) {
+  if ((value = soup_message_headers_get_one (headers, "icy-metaint")) != NULL) {
     gint icy_metaint = atoi (value);
 
     GST_DEBUG_OBJECT (src, "icy-metaint: %s (parsed: %d)", value, icy_metaint);
@@ -725,8 +780,7 @@ gst_soup_http_src_got_headers_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
       gst_base_src_set_caps (GST_BASE_SRC (src), src->src_caps);
     }
   }
-  if ((value =
-          soup_message_headers_get_content_type (msg->response_headers,
+  if ((value = soup_message_headers_get_content_type (headers,
               &params)) != NULL) {
     GST_DEBUG_OBJECT (src, "Content-Type: %s", value);
     if (g_ascii_strcasecmp (value, "audio/L16") == 0) {
@@ -765,9 +819,7 @@ gst_soup_http_src_got_headers_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
   if (params != NULL)
     g_hash_table_destroy (params);
 
-  if ((value =
-          soup_message_headers_get_one (msg->response_headers,
-              "icy-name")) != NULL) {
+  if ((value = soup_message_headers_get_one (headers, "icy-name")) != NULL) {
     g_free (src->iradio_name);
     src->iradio_name = gst_soup_http_src_unicodify (value);
     if (src->iradio_name) {
@@ -775,9 +827,7 @@ gst_soup_http_src_got_headers_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
           src->iradio_name, NULL);
     }
   }
-  if ((value =
-          soup_message_headers_get_one (msg->response_headers,
-              "icy-genre")) != NULL) {
+  if ((value = soup_message_headers_get_one (headers, "icy-genre")) != NULL) {
     g_free (src->iradio_genre);
     src->iradio_genre = gst_soup_http_src_unicodify (value);
     if (src->iradio_genre) {
@@ -785,8 +835,7 @@ gst_soup_http_src_got_headers_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
           src->iradio_genre, NULL);
     }
   }
-  if ((value = soup_message_headers_get_one (msg->response_headers, "icy-url"))
-      != NULL) {
+  if ((value = soup_message_headers_get_one (headers, "icy-url")) != NULL) {
     g_free (src->iradio_url);
     src->iradio_url = gst_soup_http_src_unicodify (value);
     if (src->iradio_url) {
@@ -801,6 +850,51 @@ gst_soup_http_src_got_headers_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
   } else {
     gst_tag_list_unref (tag_list);
   }
+}
+
+static void
+gst_soup_http_src_got_headers_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
+{
+  GstBaseSrc *basesrc;
+  guint64 newsize;
+
+  GST_DEBUG_OBJECT (src, "got headers:");
+  soup_message_headers_foreach (msg->response_headers,
+      gst_soup_http_src_headers_foreach, src);
+
+  if (msg->status_code == 407 && src->proxy_id && src->proxy_pw)
+    return;
+
+  if (src->automatic_redirect && SOUP_STATUS_IS_REDIRECTION (msg->status_code)) {
+    GST_DEBUG_OBJECT (src, "%u redirect to \"%s\"", msg->status_code,
+        soup_message_headers_get_one (msg->response_headers, "Location"));
+    return;
+  }
+
+  if (msg->status_code == SOUP_STATUS_UNAUTHORIZED)
+    return;
+
+  src->session_io_status = GST_SOUP_HTTP_SRC_SESSION_IO_STATUS_RUNNING;
+
+  /* Parse Content-Length. */
+  if (soup_message_headers_get_encoding (msg->response_headers) ==
+      SOUP_ENCODING_CONTENT_LENGTH) {
+    newsize = src->request_position +
+        soup_message_headers_get_content_length (msg->response_headers);
+    if (!src->have_size || (src->content_size != newsize)) {
+      src->content_size = newsize;
+      src->have_size = TRUE;
+      src->seekable = TRUE;
+      GST_DEBUG_OBJECT (src, "size = %" G_GUINT64_FORMAT, src->content_size);
+
+      basesrc = GST_BASE_SRC_CAST (src);
+      basesrc->segment.duration = src->content_size;
+      gst_element_post_message (GST_ELEMENT (src),
+          gst_message_new_duration_changed (GST_OBJECT (src)));
+    }
+  }
+
+  gst_soup_http_src_handle_headers (src, msg->response_headers);
 
   /* Handle HTTP errors. */
   gst_soup_http_src_parse_status (msg, src);
@@ -1091,6 +1185,18 @@ gst_soup_http_src_parse_status (SoupMessage * msg, GstSoupHTTPSrc * src)
   }
 }
 
+static void
+gst_soup_http_src_add_cookies (GstSoupHTTPSrc * src, SoupMessage * msg)
+{
+  gchar **cookie;
+
+  if (!src->cookies)
+    return;
+
+  for (cookie = src->cookies; *cookie != NULL; cookie++)
+    soup_message_headers_append (msg->request_headers, "Cookie", *cookie);
+}
+
 static gboolean
 gst_soup_http_src_build_message (GstSoupHTTPSrc * src)
 {
@@ -1107,14 +1213,7 @@ gst_soup_http_src_build_message (GstSoupHTTPSrc * src)
     soup_message_headers_append (src->msg->request_headers, "icy-metadata",
         "1");
   }
-  if (src->cookies) {
-    gchar **cookie;
-
-    for (cookie = src->cookies; *cookie != NULL; cookie++) {
-      soup_message_headers_append (src->msg->request_headers, "Cookie",
-          *cookie);
-    }
-  }
+  gst_soup_http_src_add_cookies (src, src->msg);
   src->retry = FALSE;
 
   g_signal_connect (src->msg, "got_headers",
@@ -1131,7 +1230,7 @@ gst_soup_http_src_build_message (GstSoupHTTPSrc * src)
       gst_soup_http_src_chunk_allocator, src, NULL);
   gst_soup_http_src_add_range_header (src, src->request_position);
 
-  gst_soup_http_src_add_extra_headers (src);
+  gst_soup_http_src_add_extra_headers (src, src->msg);
 
   GST_DEBUG_OBJECT (src, "request headers:");
   soup_message_headers_foreach (src->msg->request_headers,
@@ -1140,6 +1239,321 @@ gst_soup_http_src_build_message (GstSoupHTTPSrc * src)
   return TRUE;
 }
 
+static void
+gst_soup_http_src_cache_block_free (GstSoupHTTPSrcCacheBlock * block)
+{
+  gst_buffer_unref (block->buffer);
+  soup_message_headers_free (block->headers);
+  g_free (block->key);
+  g_slice_free (GstSoupHTTPSrcCacheBlock, block);
+}
+
+static gchar *
+gst_soup_http_src_cache_key (GstSoupHTTPSrc * src, guint64 index)
+{
+  return g_strdup_printf ("%s#%" G_GUINT64_FORMAT, src->location, index);
+}
+
+/* Returns the cached block for @key, if any, and marks it as the most
+ * recently used one. */
+static GstSoupHTTPSrcCacheBlock *
+gst_soup_http_src_cache_lookup (GstSoupHTTPSrc * src, const gchar * key)
+{
+  GstSoupHTTPSrcCacheBlock *block;
+
+  block = g_hash_table_lookup (src->cache, key);
+  if (block && block->link != src->cache_lru.head) {
+    g_queue_unlink (&src->cache_lru, block->link);
+    g_queue_push_head_link (&src->cache_lru, block->link);
+  }
+
+  return block;
+}
+
+static void
+gst_soup_http_src_cache_remove (GstSoupHTTPSrc * src,
+    GstSoupHTTPSrcCacheBlock * block)
+{
+  g_queue_delete_link (&src->cache_lru, block->link);
+  src->cache_used -= gst_buffer_get_size (block->buffer);
+  g_hash_table_remove (src->cache, block->key);
+}
+
+/* Takes ownership of @key, @buffer and @headers. Drops the least recently
+ * used blocks until the cache fits into cache-size again, but always keeps
+ * the new block. */
+static void
+gst_soup_http_src_cache_insert (GstSoupHTTPSrc * src, gchar * key,
+    GstBuffer * buffer, SoupMessageHeaders * headers, guint64 total)
+{
+  GstSoupHTTPSrcCacheBlock *block;
+
+  block = g_hash_table_lookup (src->cache, key);
+  if (block)
+    gst_soup_http_src_cache_remove (src, block);
+
+  block = g_slice_new (GstSoupHTTPSrcCacheBlock);
+  block->key = key;
+  block->buffer = buffer;
+  block->headers = headers;
+  block->total = total;
+  g_queue_push_head (&src->cache_lru, block);
+  block->link = src->cache_lru.head;
+  g_hash_table_insert (src->cache, block->key, block);
+  src->cache_used += gst_buffer_get_size (buffer);
+
+  while (src->cache_used > src->cache_size && src->cache_lru.length > 1) {
+    block = g_queue_peek_tail (&src->cache_lru);
+    GST_LOG_OBJECT (src, "Dropping block %s from cache", block->key);
+    gst_soup_http_src_cache_remove (src, block);
+  }
+}
+
+static void
+gst_soup_http_src_cache_set_size (GstSoupHTTPSrc * src, guint64 size)
+{
+  GstBaseSrc *basesrc;
+
+  if (src->have_size && src->content_size == size)
+    return;
+
+  src->content_size = size;
+  src->have_size = TRUE;
+  src->seekable = TRUE;
+  GST_DEBUG_OBJECT (src, "size = %" G_GUINT64_FORMAT, src->content_size);
+
+  basesrc = GST_BASE_SRC_CAST (src);
+  basesrc->segment.duration = src->content_size;
+  gst_element_post_message (GST_ELEMENT (src),
+      gst_message_new_duration_changed (GST_OBJECT (src)));
+}
+
+static void
+gst_soup_http_src_block_got_headers_cb (SoupMessage * msg,
+    GstSoupHTTPSrc * src)
+{
+  /* Don't download the complete resource if the server ignores Range, the
+   * streaming code path takes over in that case. */
+  if (msg->status_code == SOUP_STATUS_OK) {
+    GST_DEBUG_OBJECT (src, "Server ignored Range request");
+    src->cache_usable = FALSE;
+    soup_session_cancel_message (src->session, msg, SOUP_STATUS_CANCELLED);
+  }
+}
+
+static void
+gst_soup_http_src_copy_header (const char *name, const char *value,
+    gpointer headers)
+{
+  soup_message_headers_append (headers, name, value);
+}
+
+static void
+gst_soup_http_src_block_response_cb (SoupSession * session, SoupMessage * msg,
+    gpointer user_data)
+{
+  GstSoupHTTPSrcBlockRequest *req = user_data;
+  GstSoupHTTPSrc *src = req->src;
+  goffset start, end, total;
+
+  g_hash_table_remove (src->cache_pending, req->key);
+
+  if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT &&
+      soup_message_headers_get_content_range (msg->response_headers, &start,
+          &end, &total)) {
+    SoupMessageHeaders *headers;
+    SoupBuffer *chunk;
+    GstBuffer *buffer;
+    goffset offset = 0;
+    gsize length;
+
+    /* the chunks of the body become the memory of the block, without
+     * flattening them into one copy */
+    buffer = gst_buffer_new ();
+    while ((chunk = soup_message_body_get_chunk (msg->response_body,
+                offset)) != NULL) {
+      length = chunk->length;
+      gst_buffer_append_memory (buffer,
+          gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+              (gpointer) chunk->data, length, 0, length, chunk,
+              (GDestroyNotify) soup_buffer_free));
+      offset += length;
+    }
+    length = gst_buffer_get_size (buffer);
+
+    if (total > 0)
+      gst_soup_http_src_cache_set_size (src, total);
+    else if (length < CACHE_BLOCK_SIZE)
+      gst_soup_http_src_cache_set_size (src, start + length);
+
+    /* keep the headers for the caps and tags, see create_cached() */
+    headers = soup_message_headers_new (SOUP_MESSAGE_HEADERS_RESPONSE);
+    soup_message_headers_foreach (msg->response_headers,
+        gst_soup_http_src_copy_header, headers);
+
+    GST_LOG_OBJECT (src, "Got block %s (%" G_GSIZE_FORMAT " bytes)",
+        req->key, length);
+    gst_soup_http_src_cache_insert (src, req->key, buffer, headers,
+        src->have_size ? src->content_size : 0);
+    req->key = NULL;
+  } else if (msg->status_code == SOUP_STATUS_CANCELLED) {
+    /* Aborted or Range ignored, see got_headers */
+  } else if (!src->cache_wanted || strcmp (req->key, src->cache_wanted) != 0) {
+    /* Nobody is waiting for this block yet, drop it. It is requested again
+     * and fails the normal way once it is needed */
+    GST_DEBUG_OBJECT (src, "Dropping prefetched block %s: %d %s", req->key,
+        msg->status_code, msg->reason_phrase);
+  } else if (SOUP_STATUS_IS_SUCCESSFUL (msg->status_code) ||
+      msg->status_code == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE) {
+    GST_DEBUG_OBJECT (src, "Unusable response to Range request: %d %s",
+        msg->status_code, msg->reason_phrase);
+    src->cache_usable = FALSE;
+  } else {
+    gst_soup_http_src_parse_status (msg, src);
+  }
+
+  g_free (req->key);
+  g_slice_free (GstSoupHTTPSrcBlockRequest, req);
+
+  if (src->loop)
+    g_main_loop_quit (src->loop);
+}
+
+/* Queues Range requests for the blocks @first to @last that are neither
+ * cached nor already requested. They are all in flight in parallel and
+ * are stored in the cache by gst_soup_http_src_block_response_cb(). */
+static gboolean
+gst_soup_http_src_cache_request (GstSoupHTTPSrc * src, guint64 first,
+    guint64 last)
+{
+  guint64 index;
+
+  for (index = first; index <= last; index++) {
+    GstSoupHTTPSrcBlockRequest *req;
+    SoupMessage *msg;
+    gchar *key;
+
+    if (src->have_size && index * CACHE_BLOCK_SIZE >= src->content_size)
+      break;
+    /* Only prefetch once we know where the resource ends */
+    if (!src->have_size && index > first)
+      break;
+
+    key = gst_soup_http_src_cache_key (src, index);
+    if (g_hash_table_contains (src->cache, key) ||
+        g_hash_table_contains (src->cache_pending, key)) {
+      g_free (key);
+      continue;
+    }
+
+    msg = soup_message_new (SOUP_METHOD_GET, src->location);
+    if (!msg) {
+      GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ,
+          ("Error parsing URL."), ("URL: %s", src->location));
+      g_free (key);
+      return FALSE;
+    }
+    soup_message_headers_set_range (msg->request_headers,
+        index * CACHE_BLOCK_SIZE, (index + 1) * CACHE_BLOCK_SIZE - 1);
+    gst_soup_http_src_add_cookies (src, msg);
+    gst_soup_http_src_add_extra_headers (src, msg);
+    soup_message_set_flags (msg,
+        src->automatic_redirect ? 0 : SOUP_MESSAGE_NO_REDIRECT);
+    g_signal_connect (msg, "got_headers",
+        G_CALLBACK (gst_soup_http_src_block_got_headers_cb), src);
+
+    GST_LOG_OBJECT (src, "Requesting block %s", key);
+    req = g_slice_new (GstSoupHTTPSrcBlockRequest);
+    req->src = src;
+    req->key = g_strdup (key);
+    g_hash_table_insert (src->cache_pending, key, msg);
+    soup_session_queue_message (src->session, msg,
+        gst_soup_http_src_block_response_cb, req);
+  }
+
+  return TRUE;
+}
+
+/* Serves data from the block cache, fetching the block containing the
+ * requested position and the readahead-blocks following it on a miss.
+ * Returns GST_FLOW_CUSTOM_ERROR if the server does not support Range
+ * requests and the streaming code path has to be used instead. */
+static GstFlowReturn
+gst_soup_http_src_create_cached (GstSoupHTTPSrc * src, GstBuffer ** outbuf)
+{
+  GstSoupHTTPSrcCacheBlock *block;
+  guint64 position = src->request_position;
+  guint64 index = position / CACHE_BLOCK_SIZE;
+  gsize offset = position % CACHE_BLOCK_SIZE;
+  gsize size;
+  gchar *key;
+
+  if (src->have_size && position >= src->content_size) {
+    GST_DEBUG_OBJECT (src, "EOS reached");
+    return GST_FLOW_EOS;
+  }
+
+  src->ret = GST_FLOW_CUSTOM_ERROR;
+  key = gst_soup_http_src_cache_key (src, index);
+  while ((block = gst_soup_http_src_cache_lookup (src, key)) == NULL) {
+    if (src->interrupted) {
+      GST_DEBUG_OBJECT (src, "interrupted");
+      g_free (key);
+      return GST_FLOW_FLUSHING;
+    }
+    if (src->ret == GST_FLOW_ERROR || !src->cache_usable) {
+      g_free (key);
+      return src->ret;
+    }
+    if (!g_hash_table_contains (src->cache_pending, key)) {
+      GST_DEBUG_OBJECT (src, "Cache miss for block %s", key);
+      if (!gst_soup_http_src_cache_request (src, index,
+              index + src->readahead_blocks)) {
+        g_free (key);
+        return GST_FLOW_ERROR;
+      }
+    }
+    src->cache_wanted = key;
+    g_main_loop_run (src->loop);
+    src->cache_wanted = NULL;
+  }
+  g_free (key);
+
+  /* After a restart the size is only known from the cache */
+  if (!src->have_size && block->total > 0)
+    gst_soup_http_src_cache_set_size (src, block->total);
+
+  /* The caps and tags come from the response headers, like for the
+   * streaming code path */
+  if (!src->cache_headers_done) {
+    gst_soup_http_src_handle_headers (src, block->headers);
+    src->cache_headers_done = TRUE;
+  }
+
+  size = gst_buffer_get_size (block->buffer);
+  if (offset >= size) {
+    GST_DEBUG_OBJECT (src, "EOS reached");
+    return GST_FLOW_EOS;
+  }
+
+  *outbuf = gst_buffer_copy_region (block->buffer, GST_BUFFER_COPY_ALL,
+      offset, size - offset);
+  GST_BUFFER_OFFSET (*outbuf) = position;
+  src->read_position = src->request_position = position + size - offset;
+
+  /* Keep the following blocks coming in while the data is consumed */
+  if (src->readahead_blocks > 0 &&
+      !gst_soup_http_src_cache_request (src, index + 1,
+          index + src->readahead_blocks)) {
+    gst_buffer_unref (*outbuf);
+    *outbuf = NULL;
+    return GST_FLOW_ERROR;
+  }
+  while (g_main_context_iteration (src->context, FALSE));
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_soup_http_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
@@ -1147,6 +1561,14 @@ gst_soup_http_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 
   src = GST_SOUP_HTTP_SRC (psrc);
 
+  if (src->cache_size > 0 && src->cache_usable) {
+    GstFlowReturn ret = gst_soup_http_src_create_cached (src, outbuf);
+
+    if (ret != GST_FLOW_CUSTOM_ERROR)
+      return ret;
+    GST_DEBUG_OBJECT (src, "Server does not support ranges, not caching");
+  }
+
   if (src->msg && (src->request_position != src->read_position)) {
     if (src->session_io_status == GST_SOUP_HTTP_SRC_SESSION_IO_STATUS_IDLE) {
       gst_soup_http_src_add_range_header (src, src->request_position);
@@ -1250,6 +1672,11 @@ gst_soup_http_src_start (GstBaseSrc * bsrc)
 
   g_signal_connect (src->session, "authenticate",
       G_CALLBACK (gst_soup_http_src_authenticate_cb), src);
+
+  /* Allow the prefetched blocks to be downloaded in parallel */
+  if (src->cache_size > 0)
+    g_object_set (src->session, SOUP_SESSION_MAX_CONNS_PER_HOST,
+        MAX (2, src->readahead_blocks + 1), NULL);
   return TRUE;
 }
 
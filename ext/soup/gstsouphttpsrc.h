@@ -86,6 +86,21 @@ struct _GstSoupHTTPSrc {
   GstStructure *extra_headers;
 
   guint timeout;
+
+  /* Block cache for ranged reads, kept across stop/start. */
+  guint64 cache_size;          /* Maximum size of cached data in bytes,
+                                  0 disables the cache. */
+  guint readahead_blocks;      /* Blocks to prefetch after a miss. */
+  gboolean cache_usable;       /* FALSE if the server ignored Range. */
+  gboolean cache_headers_done; /* Response headers of the cached blocks
+                                  were handled. */
+  GHashTable *cache;           /* "url#block" -> cached block. */
+  GQueue cache_lru;            /* Cached blocks, most recently used
+                                  first. */
+  guint64 cache_used;          /* Bytes held by the cache. */
+  GHashTable *cache_pending;   /* "url#block" -> SoupMessage in flight. */
+  const gchar *cache_wanted;   /* Key of the block create() waits for, the
+                                  others are prefetched. */
 };
 
 struct _GstSoupHTTPSrcClass {
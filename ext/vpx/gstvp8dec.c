@@ -60,6 +60,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_vp8dec_debug);
 #define DEFAULT_NOISE_LEVEL 0
 #define DEFAULT_THREADS 1
 
+/* libvpx allocates VP8 frames with a border of this many pixels around
+ * the width rounded up to a multiple of 16 */
+#define VP8_BORDER_IN_PIXELS 32
+
 enum
 {
   PROP_0,
@@ -368,6 +372,7 @@ gst_vp8_dec_image_to_buffer (GstVP8Dec * dec, const vpx_image_t * img,
 
   if (!gst_video_frame_map (&frame, info, buffer, GST_MAP_WRITE)) {
     GST_ERROR_OBJECT (dec, "Could not map video buffer");
+    return;
   }
 
   for (comp = 0; comp < 3; comp++) {
@@ -378,8 +383,14 @@ gst_vp8_dec_image_to_buffer (GstVP8Dec * dec, const vpx_image_t * img,
     deststride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, comp);
     srcstride = img->stride[comp];
 
-    /* FIXME (Edward) : Do a plane memcpy is srcstride == deststride instead
-     * of copying line by line */
+    /* The output buffers use the decoder's strides if downstream supports
+     * GstVideoMeta, see decide_allocation(), so the whole plane can be
+     * copied at once */
+    if (srcstride == deststride) {
+      memcpy (dest, src, srcstride * (height - 1) + width);
+      continue;
+    }
+
     for (line = 0; line < height; line++) {
       memcpy (dest, src, width);
       dest += deststride;
@@ -560,6 +571,7 @@ gst_vp8_dec_handle_frame (GstVideoDecoder * decoder, GstVideoCodecFrame * frame)
 static gboolean
 gst_vp8_dec_decide_allocation (GstVideoDecoder * bdec, GstQuery * query)
 {
+  GstVP8Dec *dec = GST_VP8_DEC (bdec);
   GstBufferPool *pool;
   GstStructure *config;
 
@@ -574,6 +586,21 @@ gst_vp8_dec_decide_allocation (GstVideoDecoder * bdec, GstQuery * query)
   if (gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL)) {
     gst_buffer_pool_config_add_option (config,
         GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+    /* Pad the output frames like libvpx pads its frames so that the
+     * strides match and decoded planes can be copied in one go */
+    if (dec->output_state && gst_buffer_pool_has_option (pool,
+            GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)) {
+      GstVideoAlignment align;
+      gint width = GST_VIDEO_INFO_WIDTH (&dec->output_state->info);
+
+      gst_video_alignment_reset (&align);
+      align.padding_right =
+          GST_ROUND_UP_16 (width) + 2 * VP8_BORDER_IN_PIXELS - width;
+      gst_buffer_pool_config_add_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+      gst_buffer_pool_config_set_video_alignment (config, &align);
+    }
   }
   gst_buffer_pool_set_config (pool, config);
   gst_object_unref (pool);
@@ -207,10 +207,11 @@ gst_audio_cheb_band_init (GstAudioChebBand * filter)
   g_mutex_init (&filter->lock);
 }
 
+/* Second order lowpass at frequency 1 for the poles p, i.e.
+ * (x0 + x1 * z^-1 + x2 * z^-2) / (1 - y1 * z^-1 - y2 * z^-2) */
 static void
-generate_biquad_coefficients (GstAudioChebBand * filter,
-    gint p, gint rate, gdouble * b0, gdouble * b1, gdouble * b2, gdouble * b3,
-    gdouble * b4, gdouble * a1, gdouble * a2, gdouble * a3, gdouble * a4)
+generate_lowpass_coefficients (GstAudioChebBand * filter, gint p,
+    gdouble * x0, gdouble * x1, gdouble * x2, gdouble * y1, gdouble * y2)
 {
   gint np = filter->poles / 2;
   gdouble ripple = filter->ripple;
@@ -221,8 +222,6 @@ generate_biquad_coefficients (GstAudioChebBand * filter,
   /* zero location in s-plane */
   gdouble iz = 0.0;
 
-  /* transfer function coefficients for the z-plane */
-  gdouble x0, x1, x2, y1, y2;
   gint type = filter->type;
 
   /* Calculate pole location for lowpass at frequency 1 */
@@ -284,11 +283,11 @@ generate_biquad_coefficients (GstAudioChebBand * filter,
     m = rp * rp + ip * ip;
     d = 4.0 - 4.0 * rp * t + m * t * t;
 
-    x0 = (t * t) / d;
-    x1 = 2.0 * x0;
-    x2 = x0;
-    y1 = (8.0 - 2.0 * m * t * t) / d;
-    y2 = (-4.0 - 4.0 * rp * t - m * t * t) / d;
+    *x0 = (t * t) / d;
+    *x1 = 2.0 * *x0;
+    *x2 = *x0;
+    *y1 = (8.0 - 2.0 * m * t * t) / d;
+    *y2 = (-4.0 - 4.0 * rp * t - m * t * t) / d;
   } else {
     gdouble t, m, d;
 
@@ -296,12 +295,47 @@ generate_biquad_coefficients (GstAudioChebBand * filter,
     m = rp * rp + ip * ip;
     d = 4.0 - 4.0 * rp * t + m * t * t;
 
-    x0 = (t * t * iz * iz + 4.0) / d;
-    x1 = (-8.0 + 2.0 * iz * iz * t * t) / d;
-    x2 = x0;
-    y1 = (8.0 - 2.0 * m * t * t) / d;
-    y2 = (-4.0 - 4.0 * rp * t - m * t * t) / d;
+    *x0 = (t * t * iz * iz + 4.0) / d;
+    *x1 = (-8.0 + 2.0 * iz * iz * t * t) / d;
+    *x2 = *x0;
+    *y1 = (8.0 - 2.0 * m * t * t) / d;
+    *y2 = (-4.0 - 4.0 * rp * t - m * t * t) / d;
+  }
+}
+
+/* alpha and beta of the lowpass to band transformation described in
+ * generate_biquad_coefficients() */
+static void
+generate_band_transform (GstAudioChebBand * filter, gint rate,
+    gdouble * alpha, gdouble * beta)
+{
+  gdouble a, b;
+  gdouble w0 = 2.0 * G_PI * (filter->lower_frequency / rate);
+  gdouble w1 = 2.0 * G_PI * (filter->upper_frequency / rate);
+
+  a = cos ((w1 + w0) / 2.0) / cos ((w1 - w0) / 2.0);
+  if (filter->mode == MODE_BAND_PASS) {
+    b = tan (1.0 / 2.0) / tan ((w1 - w0) / 2.0);
+
+    *alpha = (2.0 * a * b) / (1.0 + b);
+    *beta = (b - 1.0) / (b + 1.0);
+  } else {
+    b = tan (1.0 / 2.0) * tan ((w1 - w0) / 2.0);
+
+    *alpha = (2.0 * a) / (1.0 + b);
+    *beta = (1.0 - b) / (1.0 + b);
   }
+}
+
+static void
+generate_biquad_coefficients (GstAudioChebBand * filter,
+    gint p, gint rate, gdouble * b0, gdouble * b1, gdouble * b2, gdouble * b3,
+    gdouble * b4, gdouble * a1, gdouble * a2, gdouble * a3, gdouble * a4)
+{
+  /* transfer function coefficients for the z-plane */
+  gdouble x0, x1, x2, y1, y2;
+
+  generate_lowpass_coefficients (filter, p, &x0, &x1, &x2, &y1, &y2);
 
   /* Convert from lowpass at frequency 1 to either bandpass
    * or band reject.
@@ -334,18 +368,12 @@ generate_biquad_coefficients (GstAudioChebBand * filter,
    *
    */
   {
-    gdouble a, b, d;
+    gdouble d;
     gdouble alpha, beta;
-    gdouble w0 = 2.0 * G_PI * (filter->lower_frequency / rate);
-    gdouble w1 = 2.0 * G_PI * (filter->upper_frequency / rate);
-
-    if (filter->mode == MODE_BAND_PASS) {
-      a = cos ((w1 + w0) / 2.0) / cos ((w1 - w0) / 2.0);
-      b = tan (1.0 / 2.0) / tan ((w1 - w0) / 2.0);
 
-      alpha = (2.0 * a * b) / (1.0 + b);
-      beta = (b - 1.0) / (b + 1.0);
+    generate_band_transform (filter, rate, &alpha, &beta);
 
+    if (filter->mode == MODE_BAND_PASS) {
       d = 1.0 + beta * (y1 - beta * y2);
 
       *b0 = (x0 + beta * (-x1 + beta * x2)) / d;
@@ -362,12 +390,6 @@ generate_biquad_coefficients (GstAudioChebBand * filter,
       *a3 = (alpha * (y1 + beta * (2.0 + y1) - 2.0 * y2)) / d;
       *a4 = (-beta * beta - beta * y1 + y2) / d;
     } else {
-      a = cos ((w1 + w0) / 2.0) / cos ((w1 - w0) / 2.0);
-      b = tan (1.0 / 2.0) * tan ((w1 - w0) / 2.0);
-
-      alpha = (2.0 * a) / (1.0 + b);
-      beta = (1.0 - b) / (1.0 + b);
-
       d = -1.0 + beta * (beta * y2 + y1);
 
       *b0 = (-x0 - beta * x1 - beta * beta * x2) / d;
@@ -387,6 +409,70 @@ generate_biquad_coefficients (GstAudioChebBand * filter,
   }
 }
 
+/* Splits the band filter made from the second order lowpass polynomial
+ * c0 + c1 * u + c2 * u^2, u = z^-1 of the lowpass, into two second order
+ * polynomials in v = z^-1 of the band filter.
+ *
+ * The transformation substitutes u with P(v) / Q(v), where
+ * P = sign * (v^2 - alpha * v + beta) and Q = beta * v^2 - alpha * v + 1,
+ * so every root r of the polynomial becomes the factor P - r * Q. Real
+ * roots give real factors. The factors of a complex conjugate pair of roots
+ * have conjugate roots, which are paired up into real polynomials instead.
+ * The product of both results is the fourth order polynomial of
+ * generate_biquad_coefficients(), including its scale.
+ */
+static void
+split_band_section (gdouble c0, gdouble c1, gdouble c2, gdouble alpha,
+    gdouble beta, gdouble sign, gdouble * s1, gdouble * s2)
+{
+  gdouble disc = c1 * c1 - 4.0 * c2 * c0;
+
+  if (disc >= 0.0) {
+    gdouble r1 = (-c1 + sqrt (disc)) / (2.0 * c2);
+    gdouble r2 = (-c1 - sqrt (disc)) / (2.0 * c2);
+
+    s1[0] = c2 * (sign * beta - r1);
+    s1[1] = c2 * alpha * (r1 - sign);
+    s1[2] = c2 * (sign - r1 * beta);
+    s2[0] = sign * beta - r2;
+    s2[1] = alpha * (r2 - sign);
+    s2[2] = sign - r2 * beta;
+  } else {
+    /* P - r * Q = A * v^2 + B * v + C for r = rr + i * ri */
+    gdouble rr = -c1 / (2.0 * c2), ri = sqrt (-disc) / (2.0 * c2);
+    gdouble ar = sign - rr * beta, ai = -ri * beta;
+    gdouble br = alpha * (rr - sign), bi = alpha * ri;
+    gdouble cr = sign * beta - rr, ci = -ri;
+    gdouble dr, di, m, sr, si, mag, w1r, w1i, w2r, w2i, g;
+
+    /* square root of B^2 - 4 * A * C */
+    dr = br * br - bi * bi - 4.0 * (ar * cr - ai * ci);
+    di = 2.0 * br * bi - 4.0 * (ar * ci + ai * cr);
+    m = sqrt (dr * dr + di * di);
+    sr = sqrt ((m + dr) / 2.0);
+    si = sqrt ((m - dr) / 2.0);
+    if (di < 0.0)
+      si = -si;
+
+    /* the roots (-B +- sqrt) / (2 * A) */
+    mag = 2.0 * (ar * ar + ai * ai);
+    w1r = ((sr - br) * ar + (si - bi) * ai) / mag;
+    w1i = ((si - bi) * ar - (sr - br) * ai) / mag;
+    w2r = ((-sr - br) * ar + (-si - bi) * ai) / mag;
+    w2i = ((-si - bi) * ar - (-sr - br) * ai) / mag;
+
+    /* (P - r * Q) * (P - conj(r) * Q) = |A|^2 * (v - w1) * (v - conj(w1)) *
+     * (v - w2) * (v - conj(w2)) */
+    g = c2 * (ar * ar + ai * ai);
+    s1[0] = g * (w1r * w1r + w1i * w1i);
+    s1[1] = -2.0 * g * w1r;
+    s1[2] = g;
+    s2[0] = w2r * w2r + w2i * w2i;
+    s2[1] = -2.0 * w2r;
+    s2[2] = 1.0;
+  }
+}
+
 static void
 generate_coefficients (GstAudioChebBand * filter, const GstAudioInfo * info)
 {
@@ -436,24 +522,40 @@ generate_coefficients (GstAudioChebBand * filter, const GstAudioInfo * info)
   /* Calculate coefficients for the chebyshev filter */
   {
     gint np = filter->poles;
-    gdouble *a, *b;
+    gdouble *a, *b, *sa, *sb;
+    gdouble alpha, beta, sign;
     gint i, p;
 
     a = g_new0 (gdouble, np + 5);
     b = g_new0 (gdouble, np + 5);
 
+    /* Coefficients of the second order sections, which are used for
+     * filtering as a cascade. Every fourth order section of the transfer
+     * function is split into two of them */
+    sa = g_new0 (gdouble, (np / 2) * 3);
+    sb = g_new0 (gdouble, (np / 2) * 3);
+    generate_band_transform (filter, rate, &alpha, &beta);
+    sign = (filter->mode == MODE_BAND_PASS) ? -1.0 : 1.0;
+
     /* Calculate transfer function coefficients */
     a[4] = 1.0;
     b[4] = 1.0;
 
     for (p = 1; p <= np / 4; p++) {
       gdouble b0, b1, b2, b3, b4, a1, a2, a3, a4;
+      gdouble x0, x1, x2, y1, y2;
       gdouble *ta = g_new0 (gdouble, np + 5);
       gdouble *tb = g_new0 (gdouble, np + 5);
 
       generate_biquad_coefficients (filter, p, rate,
           &b0, &b1, &b2, &b3, &b4, &a1, &a2, &a3, &a4);
 
+      generate_lowpass_coefficients (filter, p, &x0, &x1, &x2, &y1, &y2);
+      split_band_section (1.0, -y1, -y2, alpha, beta, sign,
+          &sa[(p - 1) * 6], &sa[(p - 1) * 6 + 3]);
+      split_band_section (x0, x1, x2, alpha, beta, sign,
+          &sb[(p - 1) * 6], &sb[(p - 1) * 6 + 3]);
+
       memcpy (ta, a, sizeof (gdouble) * (np + 5));
       memcpy (tb, b, sizeof (gdouble) * (np + 5));
 
@@ -498,6 +600,9 @@ generate_coefficients (GstAudioChebBand * filter, const GstAudioInfo * info)
       for (i = 0; i <= np; i++) {
         b[i] /= gain1;
       }
+      for (i = 0; i < 3; i++) {
+        sb[i] /= gain1;
+      }
     } else {
       /* gain is H(wc), wc = center frequency */
 
@@ -512,10 +617,13 @@ generate_coefficients (GstAudioChebBand * filter, const GstAudioInfo * info)
       for (i = 0; i <= np; i++) {
         b[i] /= gain;
       }
+      for (i = 0; i < 3; i++) {
+        sb[i] /= gain;
+      }
     }
 
-    gst_audio_fx_base_iir_filter_set_coefficients (GST_AUDIO_FX_BASE_IIR_FILTER
-        (filter), a, np + 1, b, np + 1);
+    gst_audio_fx_base_iir_filter_set_sections (GST_AUDIO_FX_BASE_IIR_FILTER
+        (filter), sa, sb, 2, np / 2);
 
     GST_LOG_OBJECT (filter,
         "Generated IIR coefficients for the Chebyshev filter");
@@ -554,6 +662,9 @@ generate_coefficients (GstAudioChebBand * filter, const GstAudioInfo * info)
     GST_LOG_OBJECT (filter, "%.2f dB gain @ %dHz",
         20.0 * log10 (gst_audio_fx_base_iir_filter_calculate_gain (a, np + 1, b,
                 np + 1, -1.0, 0.0)), rate / 2);
+
+    g_free (a);
+    g_free (b);
   }
 }
 
@@ -392,12 +392,17 @@ generate_coefficients (GstAudioChebLimit * filter, const GstAudioInfo * info)
   /* Calculate coefficients for the chebyshev filter */
   {
     gint np = filter->poles;
-    gdouble *a, *b;
+    gdouble *a, *b, *sa, *sb;
     gint i, p;
 
     a = g_new0 (gdouble, np + 3);
     b = g_new0 (gdouble, np + 3);
 
+    /* Coefficients of the single biquads, which are used for
+     * filtering as a cascade of second order sections */
+    sa = g_new0 (gdouble, (np / 2) * 3);
+    sb = g_new0 (gdouble, (np / 2) * 3);
+
     /* Calculate transfer function coefficients */
     a[2] = 1.0;
     b[2] = 1.0;
@@ -409,6 +414,13 @@ generate_coefficients (GstAudioChebLimit * filter, const GstAudioInfo * info)
 
       generate_biquad_coefficients (filter, p, rate, &b0, &b1, &b2, &a1, &a2);
 
+      sa[(p - 1) * 3 + 0] = 1.0;
+      sa[(p - 1) * 3 + 1] = -a1;
+      sa[(p - 1) * 3 + 2] = -a2;
+      sb[(p - 1) * 3 + 0] = b0;
+      sb[(p - 1) * 3 + 1] = b1;
+      sb[(p - 1) * 3 + 2] = b2;
+
       memcpy (ta, a, sizeof (gdouble) * (np + 3));
       memcpy (tb, b, sizeof (gdouble) * (np + 3));
 
@@ -448,10 +460,13 @@ generate_coefficients (GstAudioChebLimit * filter, const GstAudioInfo * info)
       for (i = 0; i <= np; i++) {
         b[i] /= gain;
       }
+      for (i = 0; i < 3; i++) {
+        sb[i] /= gain;
+      }
     }
 
-    gst_audio_fx_base_iir_filter_set_coefficients (GST_AUDIO_FX_BASE_IIR_FILTER
-        (filter), a, np + 1, b, np + 1);
+    gst_audio_fx_base_iir_filter_set_sections (GST_AUDIO_FX_BASE_IIR_FILTER
+        (filter), sa, sb, 2, np / 2);
 
     GST_LOG_OBJECT (filter,
         "Generated IIR coefficients for the Chebyshev filter");
@@ -477,6 +492,9 @@ generate_coefficients (GstAudioChebLimit * filter, const GstAudioInfo * info)
     GST_LOG_OBJECT (filter, "%.2f dB gain @ %d Hz",
         20.0 * log10 (gst_audio_fx_base_iir_filter_calculate_gain (a, np + 1, b,
                 np + 1, -1.0, 0.0)), rate);
+
+    g_free (a);
+    g_free (b);
   }
 }
 
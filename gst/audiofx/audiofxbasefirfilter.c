@@ -50,11 +50,13 @@ enum
 {
   PROP_0 = 0,
   PROP_LOW_LATENCY,
-  PROP_DRAIN_ON_CHANGES
+  PROP_DRAIN_ON_CHANGES,
+  PROP_MAX_LATENCY
 };
 
 #define DEFAULT_LOW_LATENCY FALSE
 #define DEFAULT_DRAIN_ON_CHANGES TRUE
+#define DEFAULT_MAX_LATENCY 0
 
 #define gst_audio_fx_base_fir_filter_parent_class parent_class
 G_DEFINE_TYPE (GstAudioFXBaseFIRFilter, gst_audio_fx_base_fir_filter,
@@ -224,6 +226,27 @@ DEFINE_PROCESS_FUNC_FIXED_CHANNELS (64, 2, double);
  *   (  N log N  )
  * O ( --------- ) compared to O (M) for the direct calculation.
  *   ( N - M + 1 )
+ *
+ * As N - M + 1 samples are collected before a pass is done, this adds
+ * a latency of N - M + 1 samples, which is huge for long kernels. To
+ * limit this the kernel can be split into P partitions of length L
+ * (uniformly partitioned overlap-save). Every pass then consumes and
+ * generates L samples, using N >= 2 * L - 1, and the spectrum of every
+ * input block is kept for P passes. With X_k being the spectrum of the
+ * input block of pass k and H_p the spectrum of the zero padded p-th
+ * kernel partition, pass k calculates
+ *
+ * y = IFFT (\sum_{p=0}^{P-1} X_{k-p} * H_p)
+ *
+ * which gives the same output as the convolution with the complete
+ * kernel, as partition p is delayed by exactly p * L samples. The
+ * latency is L samples and the runtime complexity per sample becomes
+ *
+ *   ( N log N + P N )
+ * O ( --------------- )
+ *   (       L       )
+ *
+ * independent of how many samples are processed at once.
  */
 #define DEFINE_FFT_PROCESS_FUNC(width,ctype) \
 static guint \
@@ -244,16 +267,20 @@ process_fft_##channels##_##width (GstAudioFXBaseFIRFilter * self, const g##ctype
 
 #define FFT_CONVOLUTION_BODY(channels) G_STMT_START { \
   gint i, j; \
-  guint pass; \
-  guint kernel_length = self->kernel_length; \
+  guint p, pass; \
   guint block_length = self->block_length; \
+  guint partition_length = self->partition_length; \
+  guint n_partitions = self->n_partitions; \
+  guint overlap = block_length - partition_length; \
   guint buffer_length = self->buffer_length; \
-  guint real_buffer_length = buffer_length + kernel_length - 1; \
+  guint real_buffer_length = buffer_length + overlap; \
   guint buffer_fill = self->buffer_fill; \
   GstFFTF64 *fft = self->fft; \
   GstFFTF64 *ifft = self->ifft; \
   GstFFTF64Complex *frequency_response = self->frequency_response; \
   GstFFTF64Complex *fft_buffer = self->fft_buffer; \
+  GstFFTF64Complex *fdl = self->fdl; \
+  GstFFTF64Complex *x, *h; \
   guint frequency_response_length = self->frequency_response_length; \
   gdouble *buffer = self->buffer; \
   guint generated = 0; \
@@ -266,19 +293,30 @@ process_fft_##channels##_##width (GstAudioFXBaseFIRFilter * self, const g##ctype
   /* Buffer contains the time domain samples of input data for one chunk \
    * plus some more space for the inverse FFT below. \
    * \
-   * The samples are put at offset kernel_length, the inverse FFT \
-   * overwrites everthing from offset 0 to length-kernel_length+1, keeping \
-   * the last kernel_length-1 samples for copying to the next processing \
+   * The samples are put at offset overlap, the inverse FFT \
+   * overwrites everthing from offset 0 to length-overlap, keeping \
+   * the last overlap samples for copying to the next processing \
    * step. \
    */ \
   if (!buffer) { \
     self->buffer_length = buffer_length = block_length; \
-    real_buffer_length = buffer_length + kernel_length - 1; \
+    real_buffer_length = buffer_length + overlap; \
     \
     self->buffer = buffer = g_new0 (gdouble, real_buffer_length * channels); \
     \
-    /* Beginning has kernel_length-1 zeroes at the beginning */ \
-    self->buffer_fill = buffer_fill = kernel_length - 1; \
+    /* Beginning has overlap zeroes at the beginning */ \
+    self->buffer_fill = buffer_fill = overlap; \
+    \
+    /* and all previous input blocks are zero too */ \
+    g_free (self->fdl); \
+    self->fdl = fdl = NULL; \
+  } \
+  \
+  /* Spectra of the previous n_partitions input blocks of every channel */ \
+  if (!fdl) { \
+    self->fdl = fdl = g_new0 (GstFFTF64Complex, \
+        frequency_response_length * n_partitions * channels); \
+    self->fdl_pos = 0; \
   } \
   \
   g_assert (self->buffer_length == block_length); \
@@ -289,7 +327,7 @@ process_fft_##channels##_##width (GstAudioFXBaseFIRFilter * self, const g##ctype
     /* Deinterleave channels */ \
     for (i = 0; i < pass; i++) { \
       for (j = 0; j < channels; j++) { \
-        buffer[real_buffer_length * j + buffer_fill + kernel_length - 1 + i] = \
+        buffer[real_buffer_length * j + buffer_fill + overlap + i] = \
             src[i * channels + j]; \
       } \
     } \
@@ -302,45 +340,64 @@ process_fft_##channels##_##width (GstAudioFXBaseFIRFilter * self, const g##ctype
       break; \
     \
     for (j = 0; j < channels; j++) { \
-      /* Calculate FFT of input block */ \
+      GstFFTF64Complex *channel_fdl = \
+          fdl + frequency_response_length * n_partitions * j; \
+      \
+      /* Calculate FFT of input block and store it in the delay line */ \
+      x = channel_fdl + frequency_response_length * self->fdl_pos; \
       gst_fft_f64_fft (fft, \
-          buffer + real_buffer_length * j + kernel_length - 1, fft_buffer); \
+          buffer + real_buffer_length * j + overlap, x); \
       \
       /* Complex multiplication of input and filter spectrum */ \
+      h = frequency_response; \
       for (i = 0; i < frequency_response_length; i++) { \
-	re = fft_buffer[i].r; \
-	im = fft_buffer[i].i; \
+        re = x[i].r; \
+        im = x[i].i; \
+        \
+        fft_buffer[i].r = re * h[i].r - im * h[i].i; \
+        fft_buffer[i].i = re * h[i].i + im * h[i].r; \
+      } \
+      \
+      /* and accumulate the older input blocks multiplied with the \
+       * spectrum of the later kernel partitions */ \
+      for (p = 1; p < n_partitions; p++) { \
+        x = channel_fdl + frequency_response_length * \
+            ((self->fdl_pos + n_partitions - p) % n_partitions); \
+        h = frequency_response + frequency_response_length * p; \
         \
-        fft_buffer[i].r = \
-            re * frequency_response[i].r - \
-            im * frequency_response[i].i; \
-        fft_buffer[i].i = \
-            re * frequency_response[i].i + \
-            im * frequency_response[i].r; \
+        for (i = 0; i < frequency_response_length; i++) { \
+          re = x[i].r; \
+          im = x[i].i; \
+          \
+          fft_buffer[i].r += re * h[i].r - im * h[i].i; \
+          fft_buffer[i].i += re * h[i].i + im * h[i].r; \
+        } \
       } \
       \
       /* Calculate inverse FFT of the result */ \
       gst_fft_f64_inverse_fft (ifft, fft_buffer, \
           buffer + real_buffer_length * j); \
       \
-      /* Copy all except the first kernel_length-1 samples to the output */ \
-      for (i = 0; i < buffer_length - kernel_length + 1; i++) { \
+      /* Copy all except the first overlap samples to the output */ \
+      for (i = 0; i < partition_length; i++) { \
         dst[i * channels + j] = \
-            buffer[real_buffer_length * j + kernel_length - 1 + i]; \
+            buffer[real_buffer_length * j + overlap + i]; \
       } \
       \
-      /* Copy the last kernel_length-1 samples to the beginning for the next block */ \
-      for (i = 0; i < kernel_length - 1; i++) { \
-        buffer[real_buffer_length * j + kernel_length - 1 + i] = \
+      /* Copy the last overlap samples to the beginning for the next block */ \
+      for (i = 0; i < overlap; i++) { \
+        buffer[real_buffer_length * j + overlap + i] = \
             buffer[real_buffer_length * j + buffer_length + i]; \
       } \
     } \
     \
-    generated += buffer_length - kernel_length + 1; \
-    dst += channels * (buffer_length - kernel_length + 1); \
+    self->fdl_pos = (self->fdl_pos + 1) % n_partitions; \
     \
-    /* The the first kernel_length-1 samples are there already */ \
-    buffer_fill = kernel_length - 1; \
+    generated += partition_length; \
+    dst += channels * partition_length; \
+    \
+    /* The the first overlap samples are there already */ \
+    buffer_fill = overlap; \
   } \
   \
   /* Write back cached buffer_fill value */ \
@@ -372,36 +429,76 @@ static void
   gst_fft_f64_free (self->ifft);
   self->ifft = NULL;
   g_free (self->frequency_response);
+  self->frequency_response = NULL;
   self->frequency_response_length = 0;
   g_free (self->fft_buffer);
   self->fft_buffer = NULL;
+  g_free (self->fdl);
+  self->fdl = NULL;
 
   if (self->kernel && self->kernel_length >= FFT_THRESHOLD
       && !self->low_latency) {
-    guint block_length, i;
+    guint block_length, partition_length, n_partitions, i, p, len;
     gdouble *kernel_tmp, *kernel = self->kernel;
+    GstFFTF64Complex *frequency_response;
 
     /* We process 4 * kernel_length samples per pass in FFT mode */
-    block_length = 4 * self->kernel_length;
-    block_length = gst_fft_next_fast_length (block_length);
-    self->block_length = block_length;
+    block_length = gst_fft_next_fast_length (4 * self->kernel_length);
+    while (block_length % 2 != 0)
+      block_length = gst_fft_next_fast_length (block_length + 1);
+    partition_length = block_length - self->kernel_length + 1;
+    n_partitions = 1;
+
+    /* If this gives a higher latency than allowed split the kernel into
+     * partitions of the maximum latency */
+    if (self->max_latency > 0 && partition_length > self->max_latency) {
+      partition_length = self->max_latency;
+      n_partitions =
+          (self->kernel_length + partition_length - 1) / partition_length;
+
+      block_length = gst_fft_next_fast_length (2 * partition_length);
+      while (block_length % 2 != 0)
+        block_length = gst_fft_next_fast_length (block_length + 1);
+    }
 
-    kernel_tmp = g_new0 (gdouble, block_length);
-    memcpy (kernel_tmp, kernel, self->kernel_length * sizeof (gdouble));
+    GST_DEBUG_OBJECT (self, "Using %u kernel partitions with block length %u "
+        "and latency %u", n_partitions, block_length, partition_length);
+
+    self->block_length = block_length;
+    self->partition_length = partition_length;
+    self->n_partitions = n_partitions;
 
     self->fft = gst_fft_f64_new (block_length, FALSE);
     self->ifft = gst_fft_f64_new (block_length, TRUE);
     self->frequency_response_length = block_length / 2 + 1;
     self->frequency_response =
-        g_new (GstFFTF64Complex, self->frequency_response_length);
-    gst_fft_f64_fft (self->fft, kernel_tmp, self->frequency_response);
-    g_free (kernel_tmp);
+        g_new (GstFFTF64Complex,
+        self->frequency_response_length * n_partitions);
 
-    /* Normalize to make sure IFFT(FFT(x)) == x */
-    for (i = 0; i < self->frequency_response_length; i++) {
-      self->frequency_response[i].r /= block_length;
-      self->frequency_response[i].i /= block_length;
+    kernel_tmp = g_new (gdouble, block_length);
+    for (p = 0; p < n_partitions; p++) {
+      if (n_partitions == 1) {
+        len = self->kernel_length;
+      } else {
+        len = MIN (partition_length,
+            self->kernel_length - p * partition_length);
+      }
+
+      memset (kernel_tmp, 0, block_length * sizeof (gdouble));
+      memcpy (kernel_tmp, kernel + p * partition_length,
+          len * sizeof (gdouble));
+
+      frequency_response =
+          self->frequency_response + self->frequency_response_length * p;
+      gst_fft_f64_fft (self->fft, kernel_tmp, frequency_response);
+
+      /* Normalize to make sure IFFT(FFT(x)) == x */
+      for (i = 0; i < self->frequency_response_length; i++) {
+        frequency_response[i].r /= block_length;
+        frequency_response[i].i /= block_length;
+      }
     }
+    g_free (kernel_tmp);
   }
 }
 
@@ -462,6 +559,7 @@ gst_audio_fx_base_fir_filter_finalize (GObject * object)
   gst_fft_f64_free (self->ifft);
   g_free (self->frequency_response);
   g_free (self->fft_buffer);
+  g_free (self->fdl);
   g_mutex_clear (&self->lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -502,6 +600,27 @@ gst_audio_fx_base_fir_filter_set_property (GObject * object, guint prop_id,
       g_mutex_unlock (&self->lock);
       break;
     }
+    case PROP_MAX_LATENCY:{
+      guint max_latency;
+
+      if (GST_STATE (self) >= GST_STATE_PAUSED) {
+        g_warning ("Changing the \"max-latency\" property "
+            "is only allowed in states < PAUSED");
+        return;
+      }
+
+      g_mutex_lock (&self->lock);
+      max_latency = g_value_get_uint (value);
+
+      if (self->max_latency != max_latency) {
+        self->max_latency = max_latency;
+        gst_audio_fx_base_fir_filter_calculate_frequency_response (self);
+        gst_audio_fx_base_fir_filter_select_process_function (self,
+            GST_AUDIO_FILTER_FORMAT (self), GST_AUDIO_FILTER_CHANNELS (self));
+      }
+      g_mutex_unlock (&self->lock);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -521,6 +640,9 @@ gst_audio_fx_base_fir_filter_get_property (GObject * object, guint prop_id,
     case PROP_DRAIN_ON_CHANGES:
       g_value_set_boolean (value, self->drain_on_changes);
       break;
+    case PROP_MAX_LATENCY:
+      g_value_set_uint (value, self->max_latency);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -573,6 +695,26 @@ gst_audio_fx_base_fir_filter_class_init (GstAudioFXBaseFIRFilterClass * klass)
           DEFAULT_DRAIN_ON_CHANGES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioFXBaseFIRFilter::max-latency:
+   *
+   * Maximum latency in samples that the FFT convolution of long filter
+   * kernels may add. Longer kernels are split into partitions of this
+   * length, which keeps the processing cost per sample nearly the same
+   * while the latency only depends on the partition length. 0 means
+   * that the latency is not limited.
+   *
+   * This has no effect in low-latency mode.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_LATENCY,
+      g_param_spec_uint ("max-latency", "Maximum latency",
+          "Maximum latency in samples added by FFT convolution, "
+          "0 for unlimited. Can only be changed in states < PAUSED!", 0,
+          G_MAXUINT, DEFAULT_MAX_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   caps = gst_caps_from_string (ALLOWED_CAPS);
   gst_audio_filter_class_add_pad_templates (GST_AUDIO_FILTER_CLASS (klass),
       caps);
@@ -604,6 +746,7 @@ gst_audio_fx_base_fir_filter_init (GstAudioFXBaseFIRFilter * self)
 
   self->low_latency = DEFAULT_LOW_LATENCY;
   self->drain_on_changes = DEFAULT_DRAIN_ON_CHANGES;
+  self->max_latency = DEFAULT_MAX_LATENCY;
 
   g_mutex_init (&self->lock);
 }
@@ -679,8 +822,8 @@ gst_audio_fx_base_fir_filter_push_residue (GstAudioFXBaseFIRFilter * self)
       step_gensamples = self->process (self, zeroes, out, step_insamples);
       g_free (zeroes);
 
-      memcpy (map.data + gensamples * bps, out, MIN (step_gensamples,
-              outsamples - gensamples) * bps);
+      memcpy (map.data + gensamples * channels * bps, out,
+          MIN (step_gensamples, outsamples - gensamples) * channels * bps);
       gensamples += MIN (step_gensamples, outsamples - gensamples);
 
       g_free (out);
@@ -779,7 +922,7 @@ gst_audio_fx_base_fir_filter_transform_size (GstBaseTransform * base,
   bpf = GST_AUDIO_INFO_BPF (&info);
 
   size /= bpf;
-  blocklen = self->block_length - self->kernel_length + 1;
+  blocklen = self->partition_length;
   *othersize = ((size + blocklen - 1) / blocklen) * blocklen;
   *othersize *= bpf;
 
@@ -975,7 +1118,7 @@ gst_audio_fx_base_fir_filter_query (GstBaseTransform * trans,
             GST_TIME_ARGS (min), GST_TIME_ARGS (max));
 
         if (self->fft && !self->low_latency)
-          latency = self->block_length - self->kernel_length + 1;
+          latency = self->partition_length;
         else
           latency = self->latency;
 
@@ -61,6 +61,7 @@ struct _GstAudioFXBaseFIRFilter {
 
   guint64 latency;              /* pre-latency of the filter kernel */
   gboolean low_latency;         /* work in slower low latency mode */
+  guint max_latency;            /* maximum latency of FFT mode in samples */
 
   gboolean drain_on_changes;    /* If the filter should be drained when
                                  * coeficients change */
@@ -75,10 +76,14 @@ struct _GstAudioFXBaseFIRFilter {
   /* FFT convolution specific data */
   GstFFTF64 *fft;
   GstFFTF64 *ifft;
-  GstFFTF64Complex *frequency_response;  /* filter kernel -- frequency domain */
-  guint frequency_response_length;       /* length of filter kernel -- frequency domain */
+  GstFFTF64Complex *frequency_response;  /* filter kernel partitions -- frequency domain */
+  guint frequency_response_length;       /* length of one kernel partition -- frequency domain */
   GstFFTF64Complex *fft_buffer;          /* FFT buffer, has the length of the frequency response */
   guint block_length;                    /* Length of the processing blocks -- time domain */
+  guint partition_length;                /* Number of samples consumed and generated per block */
+  guint n_partitions;                    /* Number of kernel partitions */
+  GstFFTF64Complex *fdl;                 /* Spectra of the last n_partitions input blocks */
+  guint fdl_pos;                         /* Position of the newest block in fdl */
 
   GstClockTime start_ts;        /* start timestamp after a discont */
   guint64 start_off;            /* start offset after a discont */
@@ -76,19 +76,9 @@ gst_audio_fx_base_iir_filter_finalize (GObject * object)
     filter->b = NULL;
   }
 
-  if (filter->channels) {
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
-    guint i;
-
-    for (i = 0; i < filter->nchannels; i++) {
-      ctx = &filter->channels[i];
-      g_free (ctx->x);
-      g_free (ctx->y);
-    }
+  g_free (filter->z);
+  filter->z = NULL;
 
-    g_free (filter->channels);
-    filter->channels = NULL;
-  }
   g_mutex_clear (&filter->lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -126,10 +116,10 @@ gst_audio_fx_base_iir_filter_init (GstAudioFXBaseIIRFilter * filter)
   gst_base_transform_set_in_place (GST_BASE_TRANSFORM (filter), TRUE);
 
   filter->a = NULL;
-  filter->na = 0;
   filter->b = NULL;
-  filter->nb = 0;
-  filter->channels = NULL;
+  filter->order = 0;
+  filter->nsections = 0;
+  filter->z = NULL;
   filter->nchannels = 0;
 
   g_mutex_init (&filter->lock);
@@ -178,63 +168,102 @@ gst_audio_fx_base_iir_filter_calculate_gain (gdouble * a, guint na, gdouble * b,
   return (sqrt (gain_r * gain_r + gain_i * gain_i));
 }
 
+/* Must be called with the filter lock */
+static void
+gst_audio_fx_base_iir_filter_reset_history (GstAudioFXBaseIIRFilter * filter)
+{
+  g_free (filter->z);
+  filter->z = NULL;
+
+  if (filter->nchannels && filter->order)
+    filter->z =
+        g_new0 (gdouble, filter->nsections * filter->order * filter->nchannels);
+}
+
+/* Sets a cascade of nsections IIR filters of the given order, a and b
+ * contain order + 1 coefficients per section and are owned by the filter
+ * afterwards. Running the channels through low order sections instead of
+ * one high order direct form filter is numerically more stable and allows
+ * all channels of a frame to be processed together */
 void
-gst_audio_fx_base_iir_filter_set_coefficients (GstAudioFXBaseIIRFilter * filter,
-    gdouble * a, guint na, gdouble * b, guint nb)
+gst_audio_fx_base_iir_filter_set_sections (GstAudioFXBaseIIRFilter * filter,
+    gdouble * a, gdouble * b, guint order, guint nsections)
 {
-  guint i;
+  guint i, j;
 
   g_return_if_fail (GST_IS_AUDIO_FX_BASE_IIR_FILTER (filter));
+  g_return_if_fail (nsections > 0);
+  g_return_if_fail (a != NULL && b != NULL);
+
+  /* Normalize every section to a[0] == 1.0 */
+  for (i = 0; i < nsections; i++) {
+    gdouble *sa = a + i * (order + 1);
+    gdouble *sb = b + i * (order + 1);
+    gdouble a0 = sa[0];
+
+    if (a0 == 0.0 || a0 == 1.0)
+      continue;
+
+    for (j = 0; j <= order; j++) {
+      sa[j] /= a0;
+      sb[j] /= a0;
+    }
+  }
 
   g_mutex_lock (&filter->lock);
 
   g_free (filter->a);
   g_free (filter->b);
 
-  filter->a = filter->b = NULL;
+  filter->a = a;
+  filter->b = b;
+  filter->order = order;
+  filter->nsections = nsections;
+  filter->have_coeffs = (a[0] != 0.0);
 
-  if (filter->channels) {
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
-    gboolean free = (na != filter->na || nb != filter->nb);
+  gst_audio_fx_base_iir_filter_reset_history (filter);
 
-    for (i = 0; i < filter->nchannels; i++) {
-      ctx = &filter->channels[i];
+  g_mutex_unlock (&filter->lock);
+}
 
-      if (free)
-        g_free (ctx->x);
-      else
-        memset (ctx->x, 0, filter->nb * sizeof (gdouble));
+void
+gst_audio_fx_base_iir_filter_set_coefficients (GstAudioFXBaseIIRFilter * filter,
+    gdouble * a, guint na, gdouble * b, guint nb)
+{
+  guint order;
+  gdouble *sa, *sb;
 
-      if (free)
-        g_free (ctx->y);
-      else
-        memset (ctx->y, 0, filter->na * sizeof (gdouble));
-    }
+  g_return_if_fail (GST_IS_AUDIO_FX_BASE_IIR_FILTER (filter));
 
-    g_free (filter->channels);
-    filter->channels = NULL;
+  if (a == NULL || na == 0) {
+    g_mutex_lock (&filter->lock);
+    g_free (filter->a);
+    g_free (filter->b);
+    filter->a = filter->b = NULL;
+    filter->order = filter->nsections = 0;
+    filter->have_coeffs = FALSE;
+    gst_audio_fx_base_iir_filter_reset_history (filter);
+    g_mutex_unlock (&filter->lock);
+
+    g_free (a);
+    g_free (b);
+    return;
   }
 
-  filter->na = na;
-  filter->nb = nb;
-
-  filter->a = a;
-  filter->b = b;
-
-  if (filter->nchannels && !filter->channels) {
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
+  /* A direct form filter is a single section of the higher of both
+   * orders with the missing coefficients set to zero */
+  order = MAX (na, nb) - 1;
 
-    filter->channels =
-        g_new0 (GstAudioFXBaseIIRFilterChannelCtx, filter->nchannels);
-    for (i = 0; i < filter->nchannels; i++) {
-      ctx = &filter->channels[i];
+  sa = g_new0 (gdouble, order + 1);
+  sb = g_new0 (gdouble, order + 1);
+  memcpy (sa, a, na * sizeof (gdouble));
+  if (b)
+    memcpy (sb, b, nb * sizeof (gdouble));
 
-      ctx->x = g_new0 (gdouble, filter->nb);
-      ctx->y = g_new0 (gdouble, filter->na);
-    }
-  }
+  g_free (a);
+  g_free (b);
 
-  g_mutex_unlock (&filter->lock);
+  gst_audio_fx_base_iir_filter_set_sections (filter, sa, sb, order, 1);
 }
 
 /* GstAudioFilter vmethod implementations */
@@ -265,85 +294,92 @@ gst_audio_fx_base_iir_filter_setup (GstAudioFilter * base,
   channels = GST_AUDIO_INFO_CHANNELS (info);
 
   if (channels != filter->nchannels) {
-    guint i;
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
-
-    if (filter->channels) {
-      for (i = 0; i < filter->nchannels; i++) {
-        ctx = &filter->channels[i];
-
-        g_free (ctx->x);
-        g_free (ctx->y);
-      }
-      g_free (filter->channels);
-    }
-
-    filter->channels = g_new0 (GstAudioFXBaseIIRFilterChannelCtx, channels);
-    for (i = 0; i < channels; i++) {
-      ctx = &filter->channels[i];
-
-      ctx->x = g_new0 (gdouble, filter->nb);
-      ctx->y = g_new0 (gdouble, filter->na);
-    }
     filter->nchannels = channels;
+    gst_audio_fx_base_iir_filter_reset_history (filter);
   }
   g_mutex_unlock (&filter->lock);
 
   return ret;
 }
 
-static inline gdouble
-process (GstAudioFXBaseIIRFilter * filter,
-    GstAudioFXBaseIIRFilterChannelCtx * ctx, gdouble x0)
-{
-  gdouble val = filter->b[0] * x0;
-  gint i, j;
-
-  for (i = 1, j = ctx->x_pos; i < filter->nb; i++) {
-    val += filter->b[i] * ctx->x[j];
-    j--;
-    if (j < 0)
-      j = filter->nb - 1;
-  }
-
-  for (i = 1, j = ctx->y_pos; i < filter->na; i++) {
-    val -= filter->a[i] * ctx->y[j];
-    j--;
-    if (j < 0)
-      j = filter->na - 1;
-  }
-  val /= filter->a[0];
-
-  if (ctx->x) {
-    ctx->x_pos++;
-    if (ctx->x_pos >= filter->nb)
-      ctx->x_pos = 0;
-    ctx->x[ctx->x_pos] = x0;
-  }
-  if (ctx->y) {
-    ctx->y_pos++;
-    if (ctx->y_pos >= filter->na)
-      ctx->y_pos = 0;
-
-    ctx->y[ctx->y_pos] = val;
-  }
-
-  return val;
-}
+/* Adding and subtracting a small offset flushes values that would become
+ * denormals to zero while decaying in the feedback path, without a branch
+ * in the inner loop */
+#define DENORMAL_OFFSET (1e-18)
 
+/* Runs one section over all frames of the buffer. For every frame the
+ * inner loop goes over all channels, which have no dependencies between
+ * each other, and accesses the samples and the state linearly so that the
+ * compiler can process multiple channels per vector register */
 #define DEFINE_PROCESS_FUNC(width,ctype) \
 static void \
+process_biquad_##width (g##ctype * data, guint num_frames, guint channels, \
+    const gdouble * a, const gdouble * b, gdouble * z) \
+{ \
+  const gdouble b0 = b[0], b1 = b[1], b2 = b[2], a1 = a[1], a2 = a[2]; \
+  gdouble *z1 = z, *z2 = z + channels; \
+  guint i, c; \
+  \
+  for (i = 0; i < num_frames; i++) { \
+    for (c = 0; c < channels; c++) { \
+      gdouble x = data[c]; \
+      gdouble y = b0 * x + z1[c]; \
+      \
+      y += DENORMAL_OFFSET; \
+      y -= DENORMAL_OFFSET; \
+      z1[c] = b1 * x - a1 * y + z2[c]; \
+      z2[c] = b2 * x - a2 * y; \
+      data[c] = y; \
+    } \
+    data += channels; \
+  } \
+} \
+\
+static void \
+process_section_##width (g##ctype * data, guint num_frames, guint channels, \
+    guint order, const gdouble * a, const gdouble * b, gdouble * z) \
+{ \
+  guint i, c, k; \
+  \
+  if (order == 0) { \
+    for (i = 0; i < num_frames * channels; i++) \
+      data[i] *= b[0]; \
+    return; \
+  } \
+  \
+  for (i = 0; i < num_frames; i++) { \
+    for (c = 0; c < channels; c++) { \
+      gdouble x = data[c]; \
+      gdouble y = b[0] * x + z[c]; \
+      \
+      y += DENORMAL_OFFSET; \
+      y -= DENORMAL_OFFSET; \
+      for (k = 0; k < order - 1; k++) \
+        z[k * channels + c] = \
+            b[k + 1] * x - a[k + 1] * y + z[(k + 1) * channels + c]; \
+      z[(order - 1) * channels + c] = b[order] * x - a[order] * y; \
+      data[c] = y; \
+    } \
+    data += channels; \
+  } \
+} \
+\
+static void \
 process_##width (GstAudioFXBaseIIRFilter * filter, \
     g##ctype * data, guint num_samples) \
 { \
-  gint i, j, channels = filter->nchannels; \
-  gdouble val; \
+  guint s, channels = filter->nchannels, order = filter->order; \
+  guint num_frames = num_samples / channels; \
   \
-  for (i = 0; i < num_samples / channels; i++) { \
-    for (j = 0; j < channels; j++) { \
-      val = process (filter, &filter->channels[j], *data); \
-      *data++ = val; \
-    } \
+  for (s = 0; s < filter->nsections; s++) { \
+    const gdouble *a = filter->a + s * (order + 1); \
+    const gdouble *b = filter->b + s * (order + 1); \
+    gdouble *z = filter->z + s * order * channels; \
+    \
+    if (order == 2) \
+      process_biquad_##width (data, num_frames, channels, a, b, z); \
+    else \
+      process_section_##width (data, num_frames, channels, order, a, b, z); \
   } \
 }
 
@@ -372,7 +408,7 @@ gst_audio_fx_base_iir_filter_transform_ip (GstBaseTransform * base,
   if (GST_CLOCK_TIME_IS_VALID (stream_time))
     gst_object_sync_values (GST_OBJECT (filter), stream_time);
 
-  g_return_val_if_fail (filter->a != NULL, GST_FLOW_ERROR);
+  g_return_val_if_fail (filter->have_coeffs, GST_FLOW_ERROR);
 
   gst_buffer_map (buf, &map, GST_MAP_READWRITE);
   num_samples = map.size / GST_AUDIO_FILTER_BPS (filter);
@@ -391,22 +427,14 @@ static gboolean
 gst_audio_fx_base_iir_filter_stop (GstBaseTransform * base)
 {
   GstAudioFXBaseIIRFilter *filter = GST_AUDIO_FX_BASE_IIR_FILTER (base);
-  guint channels = filter->nchannels;
-  GstAudioFXBaseIIRFilterChannelCtx *ctx;
-  guint i;
 
   /* Reset the history of input and output values if
    * already existing */
-  if (channels && filter->channels) {
-    for (i = 0; i < channels; i++) {
-      ctx = &filter->channels[i];
-      g_free (ctx->x);
-      g_free (ctx->y);
-    }
-    g_free (filter->channels);
-  }
-  filter->channels = NULL;
+  g_mutex_lock (&filter->lock);
+  g_free (filter->z);
+  filter->z = NULL;
   filter->nchannels = 0;
+  g_mutex_unlock (&filter->lock);
 
   return TRUE;
 }
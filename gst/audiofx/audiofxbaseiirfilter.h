@@ -39,14 +39,6 @@ typedef struct _GstAudioFXBaseIIRFilterClass GstAudioFXBaseIIRFilterClass;
 
 typedef void (*GstAudioFXBaseIIRFilterProcessFunc) (GstAudioFXBaseIIRFilter *, guint8 *, guint);
 
-typedef struct
-{
-  gdouble *x;
-  gint x_pos;
-  gdouble *y;
-  gint y_pos;
-} GstAudioFXBaseIIRFilterChannelCtx;
-
 struct _GstAudioFXBaseIIRFilter
 {
   GstAudioFilter audiofilter;
@@ -55,11 +47,19 @@ struct _GstAudioFXBaseIIRFilter
   GstAudioFXBaseIIRFilterProcessFunc process;
 
   gboolean have_coeffs;
+
+  /* Cascade of nsections sections of the given order, each one
+   * with order + 1 a and b coefficients. a[0] of every section
+   * is normalized to 1.0 */
   gdouble *a;
-  guint na;
   gdouble *b;
-  guint nb;
-  GstAudioFXBaseIIRFilterChannelCtx *channels;
+  guint order;
+  guint nsections;
+
+  /* Transposed direct form II state, order values per section
+   * and channel. The values of all channels for one state are
+   * stored next to each other so they can be processed together */
+  gdouble *z;
   guint nchannels;
 
   GMutex lock;
@@ -72,6 +72,7 @@ struct _GstAudioFXBaseIIRFilterClass
 
 GType gst_audio_fx_base_iir_filter_get_type (void);
 void gst_audio_fx_base_iir_filter_set_coefficients (GstAudioFXBaseIIRFilter *filter, gdouble *a, guint na, gdouble *b, guint nb);
+void gst_audio_fx_base_iir_filter_set_sections (GstAudioFXBaseIIRFilter *filter, gdouble *a, gdouble *b, guint order, guint nsections);
 gdouble gst_audio_fx_base_iir_filter_calculate_gain (gdouble *a, guint na, gdouble *b, guint nb, gdouble zr, gdouble zi);
 
 G_END_DECLS
@@ -70,6 +70,8 @@
 #include <gst/base/gstbasetransform.h>
 #include <gst/audio/audio.h>
 #include <string.h>             /* for memset */
+#include <math.h>
+#include <float.h>
 
 #include "gstscaletempo.h"
 
@@ -113,6 +115,19 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
 G_DEFINE_TYPE_WITH_CODE (GstScaletempo, gst_scaletempo,
     GST_TYPE_BASE_TRANSFORM, DEBUG_INIT (0));
 
+static inline gfloat
+corr_float (GstScaletempo * st, const gfloat * ppc, const gfloat * ps)
+{
+  gfloat corr = 0;
+  gint i;
+
+  for (i = st->samples_per_frame; i < st->samples_overlap; i++) {
+    corr += *ppc++ * *ps++;
+  }
+
+  return corr;
+}
+
 static guint
 best_overlap_offset_float (GstScaletempo * st)
 {
@@ -131,12 +146,7 @@ best_overlap_offset_float (GstScaletempo * st)
 
   search_start = (gfloat *) st->buf_queue + st->samples_per_frame;
   for (off = 0; off < st->frames_search; off++) {
-    gfloat corr = 0;
-    gfloat *ps = search_start;
-    ppc = st->buf_pre_corr;
-    for (i = st->samples_per_frame; i < st->samples_overlap; i++) {
-      corr += *ppc++ * *ps++;
-    }
+    gfloat corr = corr_float (st, st->buf_pre_corr, search_start);
     if (corr > best_corr) {
       best_corr = corr;
       best_off = off;
@@ -149,6 +159,26 @@ best_overlap_offset_float (GstScaletempo * st)
 
 /* buffer padding for loop optimization: sizeof(gint32) * (loop_size - 1) */
 #define UNROLL_PADDING (4*3)
+static inline gint64
+corr_s16 (GstScaletempo * st, const gint32 * ppc, const gint16 * ps)
+{
+  gint64 corr = 0;
+  glong i;
+
+  ppc += st->samples_overlap - st->samples_per_frame;
+  ps += st->samples_overlap - st->samples_per_frame;
+  i = -((glong) st->samples_overlap - (glong) st->samples_per_frame);
+  do {
+    corr += ppc[i + 0] * ps[i + 0];
+    corr += ppc[i + 1] * ps[i + 1];
+    corr += ppc[i + 2] * ps[i + 2];
+    corr += ppc[i + 3] * ps[i + 3];
+    i += 4;
+  } while (i < 0);
+
+  return corr;
+}
+
 static guint
 best_overlap_offset_s16 (GstScaletempo * st)
 {
@@ -169,19 +199,7 @@ best_overlap_offset_s16 (GstScaletempo * st)
 
   search_start = (gint16 *) st->buf_queue + st->samples_per_frame;
   for (off = 0; off < st->frames_search; off++) {
-    gint64 corr = 0;
-    gint16 *ps = search_start;
-    ppc = st->buf_pre_corr;
-    ppc += st->samples_overlap - st->samples_per_frame;
-    ps += st->samples_overlap - st->samples_per_frame;
-    i = -((glong) st->samples_overlap - (glong) st->samples_per_frame);
-    do {
-      corr += ppc[i + 0] * ps[i + 0];
-      corr += ppc[i + 1] * ps[i + 1];
-      corr += ppc[i + 2] * ps[i + 2];
-      corr += ppc[i + 3] * ps[i + 3];
-      i += 4;
-    } while (i < 0);
+    gint64 corr = corr_s16 (st, st->buf_pre_corr, search_start);
     if (corr > best_corr) {
       best_corr = corr;
       best_off = off;
@@ -192,6 +210,228 @@ best_overlap_offset_s16 (GstScaletempo * st)
   return best_off * st->bytes_per_frame;
 }
 
+/* FFT based search for large search windows
+ *
+ * The correlations of the windowed overlap with the queue at all offsets
+ * are the cross-correlation of both, which is calculated as
+ * IFFT (conj (FFT (pre_corr)) * FFT (search)) in O(n log n) instead of
+ * O(search * overlap). As the interleaved samples of all channels are
+ * correlated together, only every samples_per_frame-th value of the result
+ * is an offset to consider.
+ *
+ * The FFT result has a different rounding error than the direct sums, so
+ * all offsets whose FFT correlation is within the error bound of the
+ * maximum are recalculated directly. This chooses the same offset as the
+ * direct search.
+ */
+
+/* Error bound of the FFT correlation, relative to
+ * FLT_EPSILON * norm (pre_corr) * norm (search) */
+#define FFT_CORR_ERROR (8.0)
+
+/* Approximate cost of one sample of a real FFT per log2 (length), relative
+ * to one multiply-add of the direct search */
+#define FFT_CORR_COST (2)
+
+/* Calculates the correlation of fft_pre_corr and fft_search into fft_corr
+ * and returns the value above which a correlation might be the maximum */
+static gfloat
+fft_correlate (GstScaletempo * st, gdouble norm)
+{
+  GstFFTF32Complex *fp = st->fft_freq_pre_corr;
+  GstFFTF32Complex *fs = st->fft_freq_search;
+  gfloat *pc = st->fft_corr;
+  gfloat best_corr = -G_MAXFLOAT;
+  gfloat scale = 1.0 / st->fft_len;
+  guint i, off;
+
+  gst_fft_f32_fft (st->fft_ctx, st->fft_pre_corr, fp);
+  gst_fft_f32_fft (st->fft_ctx, st->fft_search, fs);
+
+  for (i = 0; i < st->fft_len / 2 + 1; i++) {
+    gfloat r = fp[i].r * fs[i].r + fp[i].i * fs[i].i;
+    gfloat im = fp[i].r * fs[i].i - fp[i].i * fs[i].r;
+
+    fs[i].r = r * scale;
+    fs[i].i = im * scale;
+  }
+
+  gst_fft_f32_inverse_fft (st->fft_ctx, fs, pc);
+
+  for (off = 0; off < st->frames_search; off++) {
+    if (pc[off * st->samples_per_frame] > best_corr)
+      best_corr = pc[off * st->samples_per_frame];
+  }
+
+  return best_corr - 2.0 * st->fft_error * norm;
+}
+
+static guint
+best_overlap_offset_float_fft (GstScaletempo * st)
+{
+  gfloat *pw, *po, *ppc, *search_start;
+  gfloat best_corr = G_MININT, threshold;
+  guint best_off = 0;
+  guint len = st->samples_overlap - st->samples_per_frame;
+  guint search_len = (st->frames_search - 1) * st->samples_per_frame + len;
+  gdouble norm_pre_corr = 0.0, norm_search = 0.0;
+  guint i, off;
+
+  pw = st->table_window;
+  po = st->buf_overlap;
+  po += st->samples_per_frame;
+  ppc = st->buf_pre_corr;
+  for (i = 0; i < len; i++) {
+    ppc[i] = pw[i] * po[i];
+    st->fft_pre_corr[i] = ppc[i];
+    norm_pre_corr += (gdouble) ppc[i] * ppc[i];
+  }
+
+  search_start = (gfloat *) st->buf_queue + st->samples_per_frame;
+  for (i = 0; i < search_len; i++) {
+    st->fft_search[i] = search_start[i];
+    norm_search += (gdouble) search_start[i] * search_start[i];
+  }
+
+  /* all correlations are zero, the first offset wins */
+  if (norm_pre_corr == 0.0 || norm_search == 0.0)
+    return 0;
+
+  threshold = fft_correlate (st, sqrt (norm_pre_corr * norm_search));
+
+  for (off = 0; off < st->frames_search; off++) {
+    if (st->fft_corr[off * st->samples_per_frame] >= threshold) {
+      gfloat corr = corr_float (st, ppc,
+          search_start + off * st->samples_per_frame);
+      if (corr > best_corr) {
+        best_corr = corr;
+        best_off = off;
+      }
+    }
+  }
+
+  return best_off * st->bytes_per_frame;
+}
+
+static guint
+best_overlap_offset_s16_fft (GstScaletempo * st)
+{
+  gint32 *pw, *ppc;
+  gint16 *po, *search_start;
+  gint64 best_corr = G_MININT64;
+  gfloat threshold;
+  guint best_off = 0;
+  guint len = st->samples_overlap - st->samples_per_frame;
+  guint search_len = (st->frames_search - 1) * st->samples_per_frame + len;
+  gdouble norm_pre_corr = 0.0, norm_search = 0.0;
+  guint i, off;
+
+  pw = st->table_window;
+  po = st->buf_overlap;
+  po += st->samples_per_frame;
+  ppc = st->buf_pre_corr;
+  for (i = 0; i < len; i++) {
+    ppc[i] = (pw[i] * po[i]) >> 15;
+    st->fft_pre_corr[i] = ppc[i];
+    norm_pre_corr += (gdouble) ppc[i] * ppc[i];
+  }
+
+  search_start = (gint16 *) st->buf_queue + st->samples_per_frame;
+  for (i = 0; i < search_len; i++) {
+    st->fft_search[i] = search_start[i];
+    norm_search += (gdouble) search_start[i] * search_start[i];
+  }
+
+  /* all correlations are zero, the first offset wins */
+  if (norm_pre_corr == 0.0 || norm_search == 0.0)
+    return 0;
+
+  threshold = fft_correlate (st, sqrt (norm_pre_corr * norm_search));
+
+  for (off = 0; off < st->frames_search; off++) {
+    if (st->fft_corr[off * st->samples_per_frame] >= threshold) {
+      gint64 corr = corr_s16 (st, ppc,
+          search_start + off * st->samples_per_frame);
+      if (corr > best_corr) {
+        best_corr = corr;
+        best_off = off;
+      }
+    }
+  }
+
+  return best_off * st->bytes_per_frame;
+}
+
+static void
+free_fft (GstScaletempo * st)
+{
+  if (st->fft_ctx)
+    gst_fft_f32_free (st->fft_ctx);
+  st->fft_ctx = NULL;
+  st->fft_len = 0;
+
+  g_free (st->fft_pre_corr);
+  st->fft_pre_corr = NULL;
+  g_free (st->fft_search);
+  st->fft_search = NULL;
+  g_free (st->fft_corr);
+  st->fft_corr = NULL;
+  g_free (st->fft_freq_pre_corr);
+  st->fft_freq_pre_corr = NULL;
+  g_free (st->fft_freq_search);
+  st->fft_freq_search = NULL;
+}
+
+/* Sets up the FFT based search if it is cheaper than the direct one */
+static void
+reinit_fft (GstScaletempo * st)
+{
+  guint len = st->samples_overlap - st->samples_per_frame;
+  guint search_len = (st->frames_search - 1) * st->samples_per_frame + len;
+  guint64 direct_cost, fft_cost;
+  guint fft_len;
+
+  fft_len = gst_fft_next_fast_length (GST_ROUND_UP_2 (search_len));
+  while (fft_len % 2 != 0)
+    fft_len = gst_fft_next_fast_length (fft_len + 1);
+
+  /* one FFT of each input and one inverse FFT per stride */
+  direct_cost = (guint64) st->frames_search * len;
+  fft_cost = (guint64) 3 * FFT_CORR_COST * fft_len * g_bit_storage (fft_len);
+
+  if (fft_cost >= direct_cost) {
+    free_fft (st);
+    return;
+  }
+
+  if (fft_len != st->fft_len) {
+    free_fft (st);
+
+    st->fft_len = fft_len;
+    st->fft_ctx = gst_fft_f32_new (fft_len, FALSE);
+    st->fft_pre_corr = g_new (gfloat, fft_len);
+    st->fft_search = g_new (gfloat, fft_len);
+    st->fft_corr = g_new (gfloat, fft_len);
+    st->fft_freq_pre_corr = g_new (GstFFTF32Complex, fft_len / 2 + 1);
+    st->fft_freq_search = g_new (GstFFTF32Complex, fft_len / 2 + 1);
+  }
+
+  /* zero padding, the beginning is overwritten for every stride */
+  memset (st->fft_pre_corr, 0, fft_len * sizeof (gfloat));
+  memset (st->fft_search, 0, fft_len * sizeof (gfloat));
+
+  st->fft_error = FFT_CORR_ERROR * FLT_EPSILON *
+      (g_bit_storage (fft_len) + sqrt (len));
+
+  if (st->use_int)
+    st->best_overlap_offset = best_overlap_offset_s16_fft;
+  else
+    st->best_overlap_offset = best_overlap_offset_float_fft;
+
+  GST_DEBUG ("using FFT of length %u for a search of %u frames", fft_len,
+      st->frames_search);
+}
+
 static void
 output_overlap_float (GstScaletempo * st, gpointer buf_out, guint bytes_off)
 {
@@ -317,6 +557,7 @@ reinit_buffers (GstScaletempo * st)
       (frames_overlap <= 1) ? 0 : st->ms_search * st->sample_rate / 1000.0;
   if (st->frames_search < 1) {  /* if no search */
     st->best_overlap_offset = NULL;
+    free_fft (st);
   } else {
     guint bytes_pre_corr = (st->samples_overlap - st->samples_per_frame) * 4;   /* sizeof (gint32|gfloat) */
     st->buf_pre_corr =
@@ -346,6 +587,7 @@ reinit_buffers (GstScaletempo * st)
       }
       st->best_overlap_offset = best_overlap_offset_float;
     }
+    reinit_fft (st);
   }
 
   new_size =
@@ -681,6 +923,21 @@ gst_scaletempo_set_property (GObject * object,
   }
 }
 
+static void
+gst_scaletempo_finalize (GObject * object)
+{
+  GstScaletempo *scaletempo = GST_SCALETEMPO (object);
+
+  g_free (scaletempo->buf_queue);
+  g_free (scaletempo->buf_overlap);
+  g_free (scaletempo->table_blend);
+  g_free (scaletempo->buf_pre_corr);
+  g_free (scaletempo->table_window);
+  free_fft (scaletempo);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_scaletempo_class_init (GstScaletempoClass * klass)
 {
@@ -688,6 +945,7 @@ gst_scaletempo_class_init (GstScaletempoClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseTransformClass *basetransform_class = GST_BASE_TRANSFORM_CLASS (klass);
 
+  gobject_class->finalize = gst_scaletempo_finalize;
   gobject_class->get_property = GST_DEBUG_FUNCPTR (gst_scaletempo_get_property);
   gobject_class->set_property = GST_DEBUG_FUNCPTR (gst_scaletempo_set_property);
 
@@ -23,6 +23,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
+#include <gst/fft/gstfftf32.h>
 
 G_BEGIN_DECLS
 
@@ -79,6 +80,16 @@ struct _GstScaletempo
   gpointer table_window;
   guint (*best_overlap_offset) (GstScaletempo * scaletempo);
 
+  /* FFT based correlation, used for large search windows */
+  GstFFTF32 *fft_ctx;
+  guint fft_len;
+  gdouble fft_error;
+  gfloat *fft_pre_corr;
+  gfloat *fft_search;
+  gfloat *fft_corr;
+  GstFFTF32Complex *fft_freq_pre_corr;
+  GstFFTF32Complex *fft_freq_search;
+
   /* gstreamer */
   gint64 segment_start;
   GstClockTime latency;
@@ -70,6 +70,19 @@ GST_DEBUG_CATEGORY_STATIC (mpeg_audio_parse_debug);
 
 #define MIN_FRAME_SIZE       6
 
+/* amount of data the index task pulls and scans per iteration */
+#define INDEX_CHUNK_SIZE     (64 * 1024)
+
+enum
+{
+  PROP_0,
+  PROP_BUILD_INDEX,
+  PROP_INDEX_INTERVAL
+};
+
+#define DEFAULT_BUILD_INDEX     FALSE
+#define DEFAULT_INDEX_INTERVAL  10
+
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -88,6 +101,10 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     );
 
 static void gst_mpeg_audio_parse_finalize (GObject * object);
+static void gst_mpeg_audio_parse_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_mpeg_audio_parse_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
 
 static gboolean gst_mpeg_audio_parse_start (GstBaseParse * parse);
 static gboolean gst_mpeg_audio_parse_stop (GstBaseParse * parse);
@@ -100,9 +117,13 @@ static gboolean gst_mpeg_audio_parse_convert (GstBaseParse * parse,
     GstFormat dest_format, gint64 * dest_value);
 static GstCaps *gst_mpeg_audio_parse_get_sink_caps (GstBaseParse * parse,
     GstCaps * filter);
+static gboolean gst_mpeg_audio_parse_src_event (GstBaseParse * parse,
+    GstEvent * event);
 
 static void gst_mpeg_audio_parse_handle_first_frame (GstMpegAudioParse *
     mp3parse, GstBuffer * buf);
+static void gst_mpeg_audio_parse_stop_index (GstMpegAudioParse * mp3parse);
+static void gst_mpeg_audio_parse_resume_index (GstMpegAudioParse * mp3parse);
 
 #define gst_mpeg_audio_parse_parent_class parent_class
 G_DEFINE_TYPE (GstMpegAudioParse, gst_mpeg_audio_parse, GST_TYPE_BASE_PARSE);
@@ -154,6 +175,36 @@ gst_mpeg_audio_parse_class_init (GstMpegAudioParseClass * klass)
       "MPEG1 audio stream parser");
 
   object_class->finalize = gst_mpeg_audio_parse_finalize;
+  object_class->set_property = gst_mpeg_audio_parse_set_property;
+  object_class->get_property = gst_mpeg_audio_parse_get_property;
+
+  /**
+   * GstMpegAudioParse:build-index:
+   *
+   * In pull mode, scan the headers of all frames of the file in a
+   * background task and build a frame index from them. Seeks into the
+   * part of the file that is already indexed are then exact.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (object_class, PROP_BUILD_INDEX,
+      g_param_spec_boolean ("build-index", "Build index",
+          "Build a frame index in the background in pull mode",
+          DEFAULT_BUILD_INDEX, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMpegAudioParse:index-interval:
+   *
+   * Only put every index-interval-th frame into the frame index. Bounds
+   * the memory used by the index at the cost of seek accuracy.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (object_class, PROP_INDEX_INTERVAL,
+      g_param_spec_uint ("index-interval", "Index interval",
+          "Number of frames between two entries of the frame index",
+          1, G_MAXUINT, DEFAULT_INDEX_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   parse_class->start = GST_DEBUG_FUNCPTR (gst_mpeg_audio_parse_start);
   parse_class->stop = GST_DEBUG_FUNCPTR (gst_mpeg_audio_parse_stop);
@@ -164,6 +215,7 @@ gst_mpeg_audio_parse_class_init (GstMpegAudioParseClass * klass)
   parse_class->convert = GST_DEBUG_FUNCPTR (gst_mpeg_audio_parse_convert);
   parse_class->get_sink_caps =
       GST_DEBUG_FUNCPTR (gst_mpeg_audio_parse_get_sink_caps);
+  parse_class->src_event = GST_DEBUG_FUNCPTR (gst_mpeg_audio_parse_src_event);
 
   /* register tags */
 #define GST_TAG_CRC      "has-crc"
@@ -219,20 +271,85 @@ gst_mpeg_audio_parse_reset (GstMpegAudioParse * mp3parse)
 
   mp3parse->encoder_delay = 0;
   mp3parse->encoder_padding = 0;
+
+  mp3parse->index_started = FALSE;
+  mp3parse->index_header = 0;
+  mp3parse->index_rate = 0;
+  mp3parse->index_spf = 0;
+  mp3parse->index_step = 1;
+  g_mutex_lock (&mp3parse->index_lock);
+  g_array_set_size (mp3parse->index, 0);
+  mp3parse->index_pos = 0;
+  mp3parse->index_frames = 0;
+  mp3parse->index_complete = FALSE;
+  mp3parse->index_duration_set = FALSE;
+  mp3parse->index_flushing = FALSE;
+  g_mutex_unlock (&mp3parse->index_lock);
 }
 
 static void
 gst_mpeg_audio_parse_init (GstMpegAudioParse * mp3parse)
 {
+  mp3parse->build_index = DEFAULT_BUILD_INDEX;
+  mp3parse->index_interval = DEFAULT_INDEX_INTERVAL;
+
+  g_rec_mutex_init (&mp3parse->index_task_lock);
+  g_mutex_init (&mp3parse->index_lock);
+  mp3parse->index = g_array_new (FALSE, FALSE, sizeof (guint64));
+
   gst_mpeg_audio_parse_reset (mp3parse);
 }
 
 static void
 gst_mpeg_audio_parse_finalize (GObject * object)
 {
+  GstMpegAudioParse *mp3parse = GST_MPEG_AUDIO_PARSE (object);
+
+  g_array_free (mp3parse->index, TRUE);
+  g_mutex_clear (&mp3parse->index_lock);
+  g_rec_mutex_clear (&mp3parse->index_task_lock);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_mpeg_audio_parse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstMpegAudioParse *mp3parse = GST_MPEG_AUDIO_PARSE (object);
+
+  switch (prop_id) {
+    case PROP_BUILD_INDEX:
+      mp3parse->build_index = g_value_get_boolean (value);
+      break;
+    case PROP_INDEX_INTERVAL:
+      mp3parse->index_interval = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_mpeg_audio_parse_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstMpegAudioParse *mp3parse = GST_MPEG_AUDIO_PARSE (object);
+
+  switch (prop_id) {
+    case PROP_BUILD_INDEX:
+      g_value_set_boolean (value, mp3parse->build_index);
+      break;
+    case PROP_INDEX_INTERVAL:
+      g_value_set_uint (value, mp3parse->index_interval);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static gboolean
 gst_mpeg_audio_parse_start (GstBaseParse * parse)
 {
@@ -253,6 +370,7 @@ gst_mpeg_audio_parse_stop (GstBaseParse * parse)
 
   GST_DEBUG_OBJECT (parse, "stopping");
 
+  gst_mpeg_audio_parse_stop_index (mp3parse);
   gst_mpeg_audio_parse_reset (mp3parse);
 
   return TRUE;
@@ -597,6 +715,254 @@ gst_mp3parse_find_freerate (GstMpegAudioParse * mp3parse, GstMapInfo * map,
   return TRUE;
 }
 
+/* Scans the frame headers of one chunk of the file and adds every
+ * index_step-th frame to our index and to the base class' index. The scan
+ * stops at the end of the file or at the first header that doesn't match
+ * the first frame of the stream. */
+static void
+gst_mpeg_audio_parse_index_loop (GstMpegAudioParse * mp3parse)
+{
+  GstBaseParse *parse = GST_BASE_PARSE (mp3parse);
+  GstFlowReturn ret;
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  GstClockTime ts;
+  guint64 pos, frames;
+  guint32 header;
+  guint off = 0, bpf;
+  gsize size;
+  gboolean done = FALSE;
+
+  g_mutex_lock (&mp3parse->index_lock);
+  pos = mp3parse->index_pos;
+  frames = mp3parse->index_frames;
+  g_mutex_unlock (&mp3parse->index_lock);
+
+  ret = gst_pad_pull_range (GST_BASE_PARSE_SINK_PAD (parse), pos,
+      INDEX_CHUNK_SIZE, &buf);
+  if (ret == GST_FLOW_EOS)
+    goto complete;
+  else if (ret == GST_FLOW_FLUSHING)
+    goto flushing;
+  else if (ret != GST_FLOW_OK)
+    goto pause;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  size = map.size;
+  while (off + 4 <= size) {
+    header = GST_READ_UINT32_BE (map.data + off);
+
+    if ((header & 0xffe00000) != 0xffe00000 ||
+        (header & HDRMASK) != (mp3parse->index_header & HDRMASK) ||
+        ((header >> 12) & 0xf) == 0xf) {
+      /* a trailing ID3v1 tag is the expected end of the stream */
+      if (size - off >= 3 && memcmp (map.data + off, "TAG", 3) == 0) {
+        done = TRUE;
+      } else {
+        GST_DEBUG_OBJECT (mp3parse, "lost sync at offset %" G_GUINT64_FORMAT
+            ", index ends here", pos + off);
+      }
+      break;
+    }
+
+    bpf = mp3_type_frame_length_from_header (mp3parse, header,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    if (G_UNLIKELY (bpf == 0))
+      break;
+
+    if (frames % mp3parse->index_step == 0) {
+      ts = gst_util_uint64_scale (frames, mp3parse->index_spf * GST_SECOND,
+          mp3parse->index_rate);
+
+      g_mutex_lock (&mp3parse->index_lock);
+      g_array_append_val (mp3parse->index, pos + off);
+      g_mutex_unlock (&mp3parse->index_lock);
+
+      gst_base_parse_add_index_entry (parse, pos + off, ts, TRUE, TRUE);
+    }
+
+    /* only the header needs to be in this chunk, the next scan continues
+     * with the first header after it */
+    off += bpf;
+    frames++;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  g_mutex_lock (&mp3parse->index_lock);
+  mp3parse->index_pos = pos + off;
+  mp3parse->index_frames = frames;
+  g_mutex_unlock (&mp3parse->index_lock);
+
+  gst_buffer_unref (buf);
+
+  /* stopped before the end of the chunk on a bad header */
+  if (off + 4 <= size) {
+    if (done)
+      goto complete;
+    goto pause;
+  }
+
+  /* a short chunk is the end of the file */
+  if (size < INDEX_CHUNK_SIZE)
+    goto complete;
+
+  /* leave the upstream element to the streaming thread for a bit */
+  g_thread_yield ();
+  return;
+
+complete:
+  {
+    g_mutex_lock (&mp3parse->index_lock);
+    mp3parse->index_complete = TRUE;
+    g_mutex_unlock (&mp3parse->index_lock);
+    GST_DEBUG_OBJECT (mp3parse, "indexed all %" G_GUINT64_FORMAT " frames",
+        frames);
+    gst_task_pause (mp3parse->index_task);
+    return;
+  }
+flushing:
+  {
+    /* the base class is seeking, continue at the same offset once it is
+     * done, see gst_mpeg_audio_parse_resume_index() */
+    GST_DEBUG_OBJECT (mp3parse, "flushing, pausing index task");
+    g_mutex_lock (&mp3parse->index_lock);
+    mp3parse->index_flushing = TRUE;
+    gst_task_pause (mp3parse->index_task);
+    g_mutex_unlock (&mp3parse->index_lock);
+    return;
+  }
+pause:
+  {
+    GST_DEBUG_OBJECT (mp3parse, "pausing index task, reason %s",
+        gst_flow_get_name (ret));
+    gst_task_pause (mp3parse->index_task);
+    return;
+  }
+}
+
+static void
+gst_mpeg_audio_parse_start_index (GstMpegAudioParse * mp3parse,
+    guint64 offset, guint32 header)
+{
+  GstPad *sinkpad = GST_BASE_PARSE_SINK_PAD (mp3parse);
+
+  mp3parse->index_started = TRUE;
+
+  if (GST_PAD_MODE (sinkpad) != GST_PAD_MODE_PULL) {
+    GST_DEBUG_OBJECT (mp3parse, "not in pull mode, not building an index");
+    return;
+  }
+
+  GST_DEBUG_OBJECT (mp3parse, "starting index task at offset %"
+      G_GUINT64_FORMAT, offset);
+
+  mp3parse->index_header = header;
+  mp3parse->index_rate = mp3parse->rate;
+  mp3parse->index_spf = mp3parse->spf;
+  mp3parse->index_step = mp3parse->index_interval;
+
+  g_mutex_lock (&mp3parse->index_lock);
+  mp3parse->index_pos = offset;
+  mp3parse->index_frames = 0;
+  g_mutex_unlock (&mp3parse->index_lock);
+
+  mp3parse->index_task = gst_task_new ((GstTaskFunction)
+      gst_mpeg_audio_parse_index_loop, mp3parse, NULL);
+  gst_task_set_lock (mp3parse->index_task, &mp3parse->index_task_lock);
+  gst_task_start (mp3parse->index_task);
+}
+
+/* Restart the index task when it was paused by a flushing seek. Called after
+ * a seek and for every frame, the task might only see the flush after the
+ * seek has finished. */
+static void
+gst_mpeg_audio_parse_resume_index (GstMpegAudioParse * mp3parse)
+{
+  g_mutex_lock (&mp3parse->index_lock);
+  if (mp3parse->index_flushing) {
+    GST_DEBUG_OBJECT (mp3parse, "resuming index task at offset %"
+        G_GUINT64_FORMAT, mp3parse->index_pos);
+    mp3parse->index_flushing = FALSE;
+    gst_task_start (mp3parse->index_task);
+  }
+  g_mutex_unlock (&mp3parse->index_lock);
+}
+
+static void
+gst_mpeg_audio_parse_stop_index (GstMpegAudioParse * mp3parse)
+{
+  if (mp3parse->index_task == NULL)
+    return;
+
+  gst_task_stop (mp3parse->index_task);
+  gst_task_join (mp3parse->index_task);
+  gst_object_unref (mp3parse->index_task);
+  mp3parse->index_task = NULL;
+}
+
+/* Offset of the last indexed frame at or before @ts */
+static gboolean
+gst_mpeg_audio_parse_index_time_to_bytepos (GstMpegAudioParse * mp3parse,
+    GstClockTime ts, gint64 * bytepos)
+{
+  guint64 frame, idx;
+  gboolean res = FALSE;
+
+  g_mutex_lock (&mp3parse->index_lock);
+  if (mp3parse->index->len > 0) {
+    frame = gst_util_uint64_scale (ts, mp3parse->index_rate,
+        mp3parse->index_spf * GST_SECOND);
+    idx = frame / mp3parse->index_step;
+    if (idx < mp3parse->index->len) {
+      *bytepos = g_array_index (mp3parse->index, guint64, idx);
+      res = TRUE;
+    }
+  }
+  g_mutex_unlock (&mp3parse->index_lock);
+
+  return res;
+}
+
+static gint
+gst_mpeg_audio_parse_index_compare (guint64 * entry, guint64 * bytepos,
+    gpointer user_data)
+{
+  if (*entry < *bytepos)
+    return -1;
+  else if (*entry > *bytepos)
+    return 1;
+  return 0;
+}
+
+/* Time of the last indexed frame at or before @bytepos */
+static gboolean
+gst_mpeg_audio_parse_index_bytepos_to_time (GstMpegAudioParse * mp3parse,
+    gint64 bytepos, GstClockTime * ts)
+{
+  guint64 *entry;
+  guint64 pos = bytepos;
+  gboolean res = FALSE;
+
+  g_mutex_lock (&mp3parse->index_lock);
+  if (mp3parse->index->len > 0 && pos < mp3parse->index_pos) {
+    entry = gst_util_array_binary_search (mp3parse->index->data,
+        mp3parse->index->len, sizeof (guint64),
+        (GCompareDataFunc) gst_mpeg_audio_parse_index_compare,
+        GST_SEARCH_MODE_BEFORE, &pos, NULL);
+    if (entry) {
+      guint64 frame = (entry - (guint64 *) mp3parse->index->data) *
+          (guint64) mp3parse->index_step;
+
+      *ts = gst_util_uint64_scale (frame, mp3parse->index_spf * GST_SECOND,
+          mp3parse->index_rate);
+      res = TRUE;
+    }
+  }
+  g_mutex_unlock (&mp3parse->index_lock);
+
+  return res;
+}
+
 static GstFlowReturn
 gst_mpeg_audio_parse_handle_frame (GstBaseParse * parse,
     GstBaseParseFrame * frame, gint * skipsize)
@@ -761,6 +1127,11 @@ gst_mpeg_audio_parse_handle_frame (GstBaseParse * parse,
   mp3parse->last_crc = crc;
   mp3parse->last_mode = mode;
 
+  if (G_UNLIKELY (mp3parse->build_index && !mp3parse->index_started))
+    gst_mpeg_audio_parse_start_index (mp3parse, frame->offset, header);
+  else if (mp3parse->index_task)
+    gst_mpeg_audio_parse_resume_index (mp3parse);
+
 cleanup:
   gst_buffer_unmap (buf, &map);
 
@@ -1305,11 +1676,18 @@ gst_mpeg_audio_parse_convert (GstBaseParse * parse, GstFormat src_format,
   GstMpegAudioParse *mp3parse = GST_MPEG_AUDIO_PARSE (parse);
   gboolean res = FALSE;
 
+  /* the frame index is exact, so prefer it over the seek tables */
   if (src_format == GST_FORMAT_TIME && dest_format == GST_FORMAT_BYTES)
     res =
-        gst_mpeg_audio_parse_time_to_bytepos (mp3parse, src_value, dest_value);
+        gst_mpeg_audio_parse_index_time_to_bytepos (mp3parse, src_value,
+        dest_value)
+        || gst_mpeg_audio_parse_time_to_bytepos (mp3parse, src_value,
+        dest_value);
   else if (src_format == GST_FORMAT_BYTES && dest_format == GST_FORMAT_TIME)
-    res = gst_mpeg_audio_parse_bytepos_to_time (mp3parse, src_value,
+    res =
+        gst_mpeg_audio_parse_index_bytepos_to_time (mp3parse, src_value,
+        (GstClockTime *) dest_value)
+        || gst_mpeg_audio_parse_bytepos_to_time (mp3parse, src_value,
         (GstClockTime *) dest_value);
 
   /* if no tables, fall back to default estimated rate based conversion */
@@ -1392,6 +1770,25 @@ gst_mpeg_audio_parse_pre_push_frame (GstBaseParse * parse,
         gst_event_new_tag (taglist));
   }
 
+  /* the index task counted all frames, so we know the exact duration */
+  if (G_UNLIKELY (mp3parse->index_task && !mp3parse->index_duration_set)) {
+    GstClockTime duration = GST_CLOCK_TIME_NONE;
+
+    g_mutex_lock (&mp3parse->index_lock);
+    if (mp3parse->index_complete) {
+      duration = gst_util_uint64_scale (mp3parse->index_frames,
+          mp3parse->index_spf * GST_SECOND, mp3parse->index_rate);
+      mp3parse->index_duration_set = TRUE;
+    }
+    g_mutex_unlock (&mp3parse->index_lock);
+
+    if (GST_CLOCK_TIME_IS_VALID (duration)) {
+      GST_DEBUG_OBJECT (mp3parse, "duration from index %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (duration));
+      gst_base_parse_set_duration (parse, GST_FORMAT_TIME, duration, 0);
+    }
+  }
+
   /* usual clipping applies */
   frame->flags |= GST_BASE_PARSE_FRAME_FLAG_CLIP;
 
@@ -1443,3 +1840,20 @@ gst_mpeg_audio_parse_get_sink_caps (GstBaseParse * parse, GstCaps * filter)
 
   return res;
 }
+
+static gboolean
+gst_mpeg_audio_parse_src_event (GstBaseParse * parse, GstEvent * event)
+{
+  GstMpegAudioParse *mp3parse = GST_MPEG_AUDIO_PARSE (parse);
+  gboolean is_seek, res;
+
+  is_seek = GST_EVENT_TYPE (event) == GST_EVENT_SEEK;
+
+  res = GST_BASE_PARSE_CLASS (parent_class)->src_event (parse, event);
+
+  /* the seek flushed upstream, which made the index task pause */
+  if (is_seek && mp3parse->index_task)
+    gst_mpeg_audio_parse_resume_index (mp3parse);
+
+  return res;
+}
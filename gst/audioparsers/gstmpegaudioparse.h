@@ -94,6 +94,31 @@ struct _GstMpegAudioParse {
   /* LAME info */
   guint32      encoder_delay;
   guint32      encoder_padding;
+
+  /* frame index built by a background task in pull mode */
+  gboolean     build_index;
+  guint        index_interval;
+
+  GstTask     *index_task;
+  GRecMutex    index_task_lock;
+  gboolean     index_started;
+  /* header all frames of the stream have to match */
+  guint32      index_header;
+  gint         index_rate;
+  gint         index_spf;
+  guint        index_step;
+
+  /* protects the fields below */
+  GMutex       index_lock;
+  /* byte offset of every index_step-th frame */
+  GArray      *index;
+  /* offset of the next frame to scan and number of frames before it */
+  guint64      index_pos;
+  guint64      index_frames;
+  gboolean     index_complete;
+  gboolean     index_duration_set;
+  /* paused because upstream was flushing for a seek */
+  gboolean     index_flushing;
 };
 
 /**
@@ -711,105 +711,110 @@ gst_iir_equalizer_compute_frequencies (GstIirEqualizer * equ, guint new_count)
 
 /* start of code that is type specific */
 
-#define CREATE_OPTIMIZED_FUNCTIONS_INT(TYPE,BIG_TYPE,MIN_VAL,MAX_VAL)   \
-typedef struct {                                                        \
-  BIG_TYPE x1, x2;          /* history of input values for a filter */  \
-  BIG_TYPE y1, y2;          /* history of output values for a filter */ \
-} SecondOrderHistory ## TYPE;                                           \
-                                                                        \
-static inline BIG_TYPE                                                  \
-one_step_ ## TYPE (GstIirEqualizerBand *filter,                         \
-    SecondOrderHistory ## TYPE *history, BIG_TYPE input)                \
+/* Adding and subtracting a small offset flushes values that would become
+ * denormals to zero while decaying in the feedback path, without a branch
+ * in the inner loop */
+#define DENORMAL_OFFSET (1e-18)
+
+/* Number of samples that are converted to the intermediate type at once
+ * for integer formats */
+#define BLOCK_SAMPLES (1024)
+
+/* The history contains x1, x2, y1 and y2 for every band, each of them
+ * with the values of all channels next to each other. Every band is run
+ * over all frames of the buffer before the next one, and for every frame
+ * all channels are processed in one loop without dependencies between
+ * them, which allows the compiler to handle multiple channels per vector
+ * register and keeps the coefficients of a band in registers */
+#define CREATE_BAND_FUNCTIONS(TYPE)                                     \
+static void                                                             \
+process_bands_ ## TYPE (GstIirEqualizer *equ, TYPE *data,               \
+    guint frames, guint channels)                                       \
 {                                                                       \
-  /* calculate output */                                                \
-  BIG_TYPE output = filter->a0 * input +                                \
-      filter->a1 * history->x1 + filter->a2 * history->x2 +             \
-      filter->b1 * history->y1 + filter->b2 * history->y2;              \
-  /* update history */                                                  \
-  history->y2 = history->y1;                                            \
-  history->y1 = output;                                                 \
-  history->x2 = history->x1;                                            \
-  history->x1 = input;                                                  \
+  guint i, c, f, nf = equ->freq_band_count;                             \
+  GstIirEqualizerBand **filters = equ->bands;                           \
+  TYPE *history = equ->history;                                         \
+                                                                        \
+  for (f = 0; f < nf; f++) {                                            \
+    const gdouble a0 = filters[f]->a0, a1 = filters[f]->a1;             \
+    const gdouble a2 = filters[f]->a2;                                  \
+    const gdouble b1 = filters[f]->b1, b2 = filters[f]->b2;             \
+    TYPE *x1 = history, *x2 = x1 + channels;                            \
+    TYPE *y1 = x2 + channels, *y2 = y1 + channels;                      \
+    TYPE *cur = data;                                                   \
                                                                         \
-  return output;                                                        \
-}                                                                       \
+    for (i = 0; i < frames; i++) {                                      \
+      for (c = 0; c < channels; c++) {                                  \
+        TYPE input = cur[c];                                            \
+        /* calculate output */                                          \
+        gdouble output = a0 * input + a1 * x1[c] + a2 * x2[c] +         \
+            b1 * y1[c] + b2 * y2[c];                                    \
                                                                         \
+        output += DENORMAL_OFFSET;                                      \
+        output -= DENORMAL_OFFSET;                                      \
+        /* update history */                                            \
+        y2[c] = y1[c];                                                  \
+        y1[c] = output;                                                 \
+        x2[c] = x1[c];                                                  \
+        x1[c] = input;                                                  \
+        cur[c] = output;                                                \
+      }                                                                 \
+      cur += channels;                                                  \
+    }                                                                   \
+    history += 4 * channels;                                            \
+  }                                                                     \
+}
+
+#define CREATE_OPTIMIZED_FUNCTIONS_INT(TYPE,BIG_TYPE,MIN_VAL,MAX_VAL)   \
 static const guint                                                      \
-history_size_ ## TYPE = sizeof (SecondOrderHistory ## TYPE);            \
+history_size_ ## TYPE = 4 * sizeof (BIG_TYPE);                          \
                                                                         \
 static void                                                             \
 gst_iir_equ_process_ ## TYPE (GstIirEqualizer *equ, guint8 *data,       \
 guint size, guint channels)                                             \
 {                                                                       \
   guint frames = size / channels / sizeof (TYPE);                       \
-  guint i, c, f, nf = equ->freq_band_count;                             \
+  guint block_frames = MAX (BLOCK_SAMPLES / channels, 1);               \
+  BIG_TYPE stack_block[BLOCK_SAMPLES], *block = stack_block;            \
+  TYPE *samples = (TYPE *) data;                                        \
+  guint i, j, n;                                                        \
   BIG_TYPE cur;                                                         \
-  GstIirEqualizerBand **filters = equ->bands;                           \
                                                                         \
-  for (i = 0; i < frames; i++) {                                        \
-    SecondOrderHistory ## TYPE *history = equ->history;                 \
-    for (c = 0; c < channels; c++) {                                    \
-      cur = *((TYPE *) data);                                           \
-      for (f = 0; f < nf; f++) {                                        \
-        cur = one_step_ ## TYPE (filters[f], history, cur);             \
-        history++;                                                      \
-      }                                                                 \
-      cur = CLAMP (cur, MIN_VAL, MAX_VAL);                              \
-      *((TYPE *) data) = (TYPE) floor (cur);                            \
-      data += sizeof (TYPE);                                            \
+  if (G_UNLIKELY (channels > BLOCK_SAMPLES))                            \
+    block = g_new (BIG_TYPE, channels);                                 \
+                                                                        \
+  for (i = 0; i < frames; i += n) {                                     \
+    n = MIN (block_frames, frames - i);                                 \
+    for (j = 0; j < n * channels; j++)                                  \
+      block[j] = samples[j];                                            \
+    process_bands_ ## BIG_TYPE (equ, block, n, channels);               \
+    for (j = 0; j < n * channels; j++) {                                \
+      cur = CLAMP (block[j], MIN_VAL, MAX_VAL);                         \
+      samples[j] = (TYPE) floor (cur);                                  \
     }                                                                   \
+    samples += n * channels;                                            \
   }                                                                     \
+                                                                        \
+  if (block != stack_block)                                             \
+    g_free (block);                                                     \
 }
 
 #define CREATE_OPTIMIZED_FUNCTIONS(TYPE)                                \
-typedef struct {                                                        \
-  TYPE x1, x2;          /* history of input values for a filter */  \
-  TYPE y1, y2;          /* history of output values for a filter */ \
-} SecondOrderHistory ## TYPE;                                           \
-                                                                        \
-static inline TYPE                                                      \
-one_step_ ## TYPE (GstIirEqualizerBand *filter,                         \
-    SecondOrderHistory ## TYPE *history, TYPE input)                    \
-{                                                                       \
-  /* calculate output */                                                \
-  TYPE output = filter->a0 * input + filter->a1 * history->x1 +         \
-      filter->a2 * history->x2 + filter->b1 * history->y1 +             \
-      filter->b2 * history->y2;                                         \
-  /* update history */                                                  \
-  history->y2 = history->y1;                                            \
-  history->y1 = output;                                                 \
-  history->x2 = history->x1;                                            \
-  history->x1 = input;                                                  \
-                                                                        \
-  return output;                                                        \
-}                                                                       \
-                                                                        \
 static const guint                                                      \
-history_size_ ## TYPE = sizeof (SecondOrderHistory ## TYPE);            \
+history_size_ ## TYPE = 4 * sizeof (TYPE);                              \
                                                                         \
 static void                                                             \
 gst_iir_equ_process_ ## TYPE (GstIirEqualizer *equ, guint8 *data,       \
 guint size, guint channels)                                             \
 {                                                                       \
   guint frames = size / channels / sizeof (TYPE);                       \
-  guint i, c, f, nf = equ->freq_band_count;                             \
-  TYPE cur;                                                             \
-  GstIirEqualizerBand **filters = equ->bands;                           \
                                                                         \
-  for (i = 0; i < frames; i++) {                                        \
-    SecondOrderHistory ## TYPE *history = equ->history;                 \
-    for (c = 0; c < channels; c++) {                                    \
-      cur = *((TYPE *) data);                                           \
-      for (f = 0; f < nf; f++) {                                        \
-        cur = one_step_ ## TYPE (filters[f], history, cur);             \
-        history++;                                                      \
-      }                                                                 \
-      *((TYPE *) data) = (TYPE) cur;                                    \
-      data += sizeof (TYPE);                                            \
-    }                                                                   \
-  }                                                                     \
+  process_bands_ ## TYPE (equ, (TYPE *) data, frames, channels);        \
 }
 
+CREATE_BAND_FUNCTIONS (gfloat);
+CREATE_BAND_FUNCTIONS (gdouble);
+
 CREATE_OPTIMIZED_FUNCTIONS_INT (gint16, gfloat, -32768.0, 32767.0);
 CREATE_OPTIMIZED_FUNCTIONS (gfloat);
 CREATE_OPTIMIZED_FUNCTIONS (gdouble);
@@ -44,13 +44,6 @@
 #include <gst/pbutils/pbutils.h>
 #include <gst/audio/audio.h>
 
-/* FIXME: don't rely on own GstIndex */
-#include "gstindex.c"
-#include "gstmemindex.c"
-#define GST_ASSOCIATION_FLAG_NONE GST_INDEX_ASSOCIATION_FLAG_NONE
-#define GST_ASSOCIATION_FLAG_KEY_UNIT GST_INDEX_ASSOCIATION_FLAG_KEY_UNIT
-#define GST_ASSOCIATION_FLAG_DELTA_UNIT GST_INDEX_ASSOCIATION_FLAG_DELTA_UNIT
-
 static GstStaticPadTemplate flv_sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -96,6 +89,23 @@ G_DEFINE_TYPE (GstFlvDemux, gst_flv_demux, GST_TYPE_ELEMENT);
 /* two seconds - consider pts are resynced to another base if this different */
 #define RESYNC_THRESHOLD 2000
 
+/* no known keyframes in the tags parsed since the last discontinuity */
+#define INDEX_RUN_NONE G_MAXUINT64
+
+/* seeking to a keyframe this much before the target is considered good
+ * enough, and index scans start this much before the target. The window
+ * doubles until a keyframe is found. */
+#define INDEX_SCAN_WINDOW (10 * GST_SECOND)
+
+/* stop bisecting and scan linearly below this number of bytes */
+#define INDEX_BISECT_THRESHOLD (64 * 1024)
+
+/* bytes pulled at once when looking for the next tag while bisecting */
+#define INDEX_RESYNC_CHUNK_SIZE (16 * 1024)
+
+#define INDEX_ENTRY(demux,i) \
+    (g_array_index ((demux)->index, GstFlvDemuxIndexEntry, (i)))
+
 static gboolean flv_demux_handle_seek_push (GstFlvDemux * demux,
     GstEvent * event);
 static gboolean gst_flv_demux_handle_seek_pull (GstFlvDemux * demux,
@@ -106,15 +116,65 @@ static gboolean gst_flv_demux_query (GstPad * pad, GstObject * parent,
 static gboolean gst_flv_demux_src_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 
-static GstIndex *gst_flv_demux_get_index (GstElement * element);
+static gint
+gst_flv_demux_index_compare_pos (GstFlvDemuxIndexEntry * entry,
+    guint64 * pos, gpointer user_data)
+{
+  if (entry->pos < *pos)
+    return -1;
+  else if (entry->pos > *pos)
+    return 1;
+  return 0;
+}
+
+static gint
+gst_flv_demux_index_compare_time (GstFlvDemuxIndexEntry * entry,
+    GstClockTime * time, gpointer user_data)
+{
+  if (entry->time < *time)
+    return -1;
+  else if (entry->time > *time)
+    return 1;
+  return 0;
+}
+
+/* Returns the last keyframe at or before @pos, or if @after is TRUE the
+ * first one at or after it */
+static GstFlvDemuxIndexEntry *
+gst_flv_demux_index_find_pos (GstFlvDemux * demux, guint64 pos,
+    gboolean after)
+{
+  if (demux->index->len == 0)
+    return NULL;
+
+  return gst_util_array_binary_search (demux->index->data, demux->index->len,
+      sizeof (GstFlvDemuxIndexEntry),
+      (GCompareDataFunc) gst_flv_demux_index_compare_pos,
+      after ? GST_SEARCH_MODE_AFTER : GST_SEARCH_MODE_BEFORE, &pos, NULL);
+}
+
+/* Returns the last keyframe at or before @time, or if @after is TRUE the
+ * first one at or after it */
+static GstFlvDemuxIndexEntry *
+gst_flv_demux_index_find_time (GstFlvDemux * demux, GstClockTime time,
+    gboolean after)
+{
+  if (demux->index->len == 0)
+    return NULL;
+
+  return gst_util_array_binary_search (demux->index->data, demux->index->len,
+      sizeof (GstFlvDemuxIndexEntry),
+      (GCompareDataFunc) gst_flv_demux_index_compare_time,
+      after ? GST_SEARCH_MODE_AFTER : GST_SEARCH_MODE_BEFORE, &time, NULL);
+}
 
 static void
 gst_flv_demux_parse_and_add_index_entry (GstFlvDemux * demux, GstClockTime ts,
     guint64 pos, gboolean keyframe)
 {
-  GstIndexAssociation associations[2];
-  GstIndex *index;
-  GstIndexEntry *entry;
+  GstFlvDemuxIndexEntry *entry, new_entry;
+  guint idx, len;
+  gboolean contiguous;
 
   GST_LOG_OBJECT (demux,
       "adding key=%d association %" GST_TIME_FORMAT "-> %" G_GUINT64_FORMAT,
@@ -124,48 +184,80 @@ gst_flv_demux_parse_and_add_index_entry (GstFlvDemux * demux, GstClockTime ts,
   if (!demux->upstream_seekable)
     return;
 
-  index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
-  if (!index)
+  /* only keyframes are seek targets */
+  if (!keyframe)
     return;
 
+  /* entries are usually added in order while playing or scanning */
+  len = demux->index->len;
+  if (len == 0 || INDEX_ENTRY (demux, len - 1).pos < pos) {
+    idx = len;
+  } else {
+    entry = gst_flv_demux_index_find_pos (demux, pos, TRUE);
+    idx = entry - (GstFlvDemuxIndexEntry *) demux->index->data;
+  }
+
+  /* nothing can be missing between the previous entry and this one if we
+   * parsed all tags since the previous entry */
+  if (idx == 0)
+    contiguous = (demux->index_run_pos == 0);
+  else
+    contiguous = (demux->index_run_pos == INDEX_ENTRY (demux, idx - 1).pos);
+
+  demux->index_run_pos = pos;
+
   /* entry may already have been added before, avoid adding indefinitely */
-  entry = gst_index_get_assoc_entry (index, demux->index_id,
-      GST_INDEX_LOOKUP_EXACT, GST_ASSOCIATION_FLAG_NONE, GST_FORMAT_BYTES, pos);
+  if (idx < len && INDEX_ENTRY (demux, idx).pos == pos) {
+    entry = &INDEX_ENTRY (demux, idx);
 
-  if (entry) {
-#ifndef GST_DISABLE_GST_DEBUG
-    gint64 time = 0;
-    gboolean key;
-
-    gst_index_entry_assoc_map (entry, GST_FORMAT_TIME, &time);
-    key = ! !(GST_INDEX_ASSOC_FLAGS (entry) & GST_ASSOCIATION_FLAG_KEY_UNIT);
-    GST_LOG_OBJECT (demux, "position already mapped to time %" GST_TIME_FORMAT
-        ", keyframe %d", GST_TIME_ARGS (time), key);
-    /* there is not really a way to delete the existing one */
-    if (time != ts || key != ! !keyframe)
+    GST_LOG_OBJECT (demux, "position already mapped to time %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (entry->time));
+    if (entry->time != ts)
       GST_DEBUG_OBJECT (demux, "metadata mismatch");
-#endif
-    gst_object_unref (index);
+
+    entry->contiguous |= contiguous;
     return;
   }
 
-  associations[0].format = GST_FORMAT_TIME;
-  associations[0].value = ts;
-  associations[1].format = GST_FORMAT_BYTES;
-  associations[1].value = pos;
+  /* keep the index sorted by time as well, so that it can be searched by
+   * time. Keyframes after a timestamp reset can't be seek targets. */
+  if ((idx > 0 && INDEX_ENTRY (demux, idx - 1).time > ts) ||
+      (idx < len && INDEX_ENTRY (demux, idx).time < ts)) {
+    GST_DEBUG_OBJECT (demux, "keyframe at %" G_GUINT64_FORMAT " is out of "
+        "time order, not adding it", pos);
+    return;
+  }
+
+  new_entry.time = ts;
+  new_entry.pos = pos;
+  new_entry.contiguous = contiguous;
+  g_array_insert_val (demux->index, idx, new_entry);
+}
+
+/* Whether seeking to the keyframe found by gst_flv_demux_find_offset() for
+ * @time will not decode much more data than necessary */
+static gboolean
+gst_flv_demux_index_is_reliable (GstFlvDemux * demux, GstClockTime time)
+{
+  GstFlvDemuxIndexEntry *entry;
+  guint idx;
 
-  gst_index_add_associationv (index, demux->index_id,
-      (keyframe) ? GST_ASSOCIATION_FLAG_KEY_UNIT :
-      GST_ASSOCIATION_FLAG_DELTA_UNIT, 2,
-      (const GstIndexAssociation *) &associations);
+  if (demux->indexed)
+    return TRUE;
+
+  entry = gst_flv_demux_index_find_time (demux, time, FALSE);
+  if (entry == NULL) {
+    return time <= INDEX_SCAN_WINDOW || (demux->index->len > 0
+        && INDEX_ENTRY (demux, 0).contiguous);
+  }
 
-  if (pos > demux->index_max_pos)
-    demux->index_max_pos = pos;
-  if (ts > demux->index_max_time)
-    demux->index_max_time = ts;
+  if (time <= entry->time + INDEX_SCAN_WINDOW)
+    return TRUE;
 
-  gst_object_unref (index);
+  /* or no keyframe between the one we found and the next one */
+  idx = entry - (GstFlvDemuxIndexEntry *) demux->index->data;
+  return (idx + 1 < demux->index->len
+      && INDEX_ENTRY (demux, idx + 1).contiguous);
 }
 
 static gchar *
@@ -614,8 +706,11 @@ gst_flv_demux_parse_tag_script (GstFlvDemux * demux, GstBuffer * buffer)
 
     if (demux->times && demux->filepositions) {
       guint num;
+      guint64 run_pos = demux->index_run_pos;
 
-      /* If an index was found, insert associations */
+      /* If an index was found, insert associations. It lists all keyframes
+       * from the start of the file */
+      demux->index_run_pos = 0;
       num = MIN (demux->times->len, demux->filepositions->len);
       for (i = 0; i < num; i++) {
         guint64 time, fileposition;
@@ -625,6 +720,7 @@ gst_flv_demux_parse_tag_script (GstFlvDemux * demux, GstBuffer * buffer)
         gst_flv_demux_parse_and_add_index_entry (demux, time, fileposition,
             TRUE);
       }
+      demux->index_run_pos = run_pos;
       demux->indexed = TRUE;
     }
   }
@@ -1718,6 +1814,9 @@ gst_flv_demux_parse_header (GstFlvDemux * demux, GstBuffer * buffer)
   /* do a one-time seekability check */
   gst_flv_demux_check_seekability (demux);
 
+  /* The first tag follows, so no keyframe is missed from here on */
+  demux->index_run_pos = 0;
+
   /* We don't care about the rest */
   demux->need_header = FALSE;
 
@@ -1745,6 +1844,7 @@ gst_flv_demux_flush (GstFlvDemux * demux, gboolean discont)
     demux->state = FLV_STATE_TAG_TYPE;
     /* We reset the offset and will get one from first push */
     demux->offset = 0;
+    demux->index_run_pos = INDEX_RUN_NONE;
   }
 }
 
@@ -1775,8 +1875,9 @@ gst_flv_demux_cleanup (GstFlvDemux * demux)
   demux->upstream_seekable = FALSE;
   demux->file_size = 0;
 
-  demux->index_max_pos = 0;
-  demux->index_max_time = 0;
+  if (demux->index)
+    g_array_set_size (demux->index, 0);
+  demux->index_run_pos = INDEX_RUN_NONE;
 
   demux->audio_start = demux->video_start = GST_CLOCK_TIME_NONE;
   demux->last_audio_pts = demux->last_video_pts = 0;
@@ -2223,8 +2324,18 @@ static void
 gst_flv_demux_move_to_offset (GstFlvDemux * demux, gint64 offset,
     gboolean reset)
 {
+  GstFlvDemuxIndexEntry *entry;
+
   demux->offset = offset;
 
+  /* Keyframes following a known keyframe extend the contiguous part of
+   * the index */
+  entry = gst_flv_demux_index_find_pos (demux, offset, FALSE);
+  if (entry && entry->pos == offset)
+    demux->index_run_pos = offset;
+  else
+    demux->index_run_pos = INDEX_RUN_NONE;
+
   /* Tell all the stream we moved to a different position (discont) */
   demux->audio_need_discont = TRUE;
   demux->video_need_discont = TRUE;
@@ -2251,8 +2362,7 @@ static GstFlowReturn
 gst_flv_demux_seek_to_prev_keyframe (GstFlvDemux * demux)
 {
   GstFlowReturn ret = GST_FLOW_EOS;
-  GstIndex *index;
-  GstIndexEntry *entry = NULL;
+  GstFlvDemuxIndexEntry *entry;
 
   GST_DEBUG_OBJECT (demux,
       "terminated section started at offset %" G_GINT64_FORMAT,
@@ -2270,59 +2380,114 @@ gst_flv_demux_seek_to_prev_keyframe (GstFlvDemux * demux)
 
   GST_DEBUG_OBJECT (demux, "locating previous position");
 
-  index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
   /* locate index entry before previous start position */
-  if (index) {
-    entry = gst_index_get_assoc_entry (index, demux->index_id,
-        GST_INDEX_LOOKUP_BEFORE, GST_ASSOCIATION_FLAG_KEY_UNIT,
-        GST_FORMAT_BYTES, demux->from_offset - 1);
+  entry = gst_flv_demux_index_find_pos (demux, demux->from_offset - 1, FALSE);
 
-    if (entry) {
-      gint64 bytes = 0, time = 0;
+  if (entry) {
+    GST_DEBUG_OBJECT (demux, "found index entry for %" G_GINT64_FORMAT
+        " at %" GST_TIME_FORMAT ", seeking to %" G_GUINT64_FORMAT,
+        demux->offset - 1, GST_TIME_ARGS (entry->time), entry->pos);
 
-      gst_index_entry_assoc_map (entry, GST_FORMAT_BYTES, &bytes);
-      gst_index_entry_assoc_map (entry, GST_FORMAT_TIME, &time);
+    /* setup for next section */
+    demux->to_offset = demux->from_offset;
+    gst_flv_demux_move_to_offset (demux, entry->pos, FALSE);
+    ret = GST_FLOW_OK;
+  }
 
-      GST_DEBUG_OBJECT (demux, "found index entry for %" G_GINT64_FORMAT
-          " at %" GST_TIME_FORMAT ", seeking to %" G_GINT64_FORMAT,
-          demux->offset - 1, GST_TIME_ARGS (time), bytes);
+done:
+  return ret;
+}
 
-      /* setup for next section */
-      demux->to_offset = demux->from_offset;
-      gst_flv_demux_move_to_offset (demux, bytes, FALSE);
-      ret = GST_FLOW_OK;
+/* Looks for the first tag header in [@pos, @end) by checking that the
+ * previous tag size after a possible tag matches its data size */
+static GstFlowReturn
+gst_flv_demux_resync (GstFlvDemux * demux, guint64 pos, guint64 end,
+    guint64 * tag_pos, GstClockTime * tag_time)
+{
+  GstBuffer *buffer = NULL, *size_buffer = NULL;
+  GstFlowReturn ret;
+  GstMapInfo map;
+  guint8 *data;
+  guint32 data_size, prev_size;
+  gsize i;
+
+  while (pos + 11 <= end) {
+    ret = gst_flv_demux_pull_range (demux, demux->sinkpad, pos,
+        MIN (INDEX_RESYNC_CHUNK_SIZE, end - pos), &buffer);
+    if (ret != GST_FLOW_OK)
+      return ret;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    data = map.data;
+
+    for (i = 0; i + 11 <= map.size; i++) {
+      /* tag type and a stream id of 0 */
+      if ((data[i] != 8 && data[i] != 9 && data[i] != 18) ||
+          GST_READ_UINT24_BE (data + i + 8) != 0)
+        continue;
+
+      data_size = GST_READ_UINT24_BE (data + i + 1);
+
+      if (i + 11 + data_size + 4 <= map.size) {
+        prev_size = GST_READ_UINT32_BE (data + i + 11 + data_size);
+      } else {
+        if (gst_flv_demux_pull_range (demux, demux->sinkpad,
+                pos + i + 11 + data_size, 4, &size_buffer) != GST_FLOW_OK)
+          continue;
+        gst_buffer_extract (size_buffer, 0, &prev_size, 4);
+        prev_size = GUINT32_FROM_BE (prev_size);
+        gst_buffer_unref (size_buffer);
+      }
+
+      if (prev_size != data_size + 11)
+        continue;
+
+      *tag_pos = pos + i;
+      *tag_time = (GST_READ_UINT24_BE (data + i + 4) |
+          ((guint32) data[i + 7] << 24)) * GST_MSECOND;
+
+      gst_buffer_unmap (buffer, &map);
+      gst_buffer_unref (buffer);
+      return GST_FLOW_OK;
     }
 
-    gst_object_unref (index);
-  }
+    /* the last 10 bytes can be the start of a tag header that continues
+     * in the next chunk */
+    pos += map.size - 10;
 
+    gst_buffer_unmap (buffer, &map);
+    gst_buffer_unref (buffer);
+  }
 
-done:
-  return ret;
+  return GST_FLOW_EOS;
 }
 
+/* Parses the tags from @pos on and adds their keyframes to the index, until
+ * the first tag after @ts or until @stop. @complete is set when the end of
+ * the file was reached and all tags since the last keyframe were parsed. */
 static GstFlowReturn
-gst_flv_demux_create_index (GstFlvDemux * demux, gint64 pos, GstClockTime ts)
+gst_flv_demux_scan_index (GstFlvDemux * demux, guint64 pos, guint64 stop,
+    GstClockTime ts, gboolean * complete)
 {
-  gint64 size;
-  size_t tag_size;
-  guint64 old_offset;
-  GstBuffer *buffer;
-  GstClockTime tag_time;
   GstFlowReturn ret = GST_FLOW_OK;
+  GstFlvDemuxIndexEntry *entry;
+  GstBuffer *buffer = NULL;
+  GstClockTime tag_time;
+  size_t tag_size;
+  guint idx;
 
-  if (!gst_pad_peer_query_duration (demux->sinkpad, GST_FORMAT_BYTES, &size))
-    return GST_FLOW_OK;
-
-  GST_DEBUG_OBJECT (demux, "building index at %" G_GINT64_FORMAT
-      " looking for time %" GST_TIME_FORMAT, pos, GST_TIME_ARGS (ts));
-
-  old_offset = demux->offset;
+  /* If we start at a keyframe of the index nothing is missed after it */
   demux->offset = pos;
-
-  buffer = NULL;
-  while ((ret = gst_flv_demux_pull_range (demux, demux->sinkpad, demux->offset,
+  entry = gst_flv_demux_index_find_pos (demux, pos, FALSE);
+  if (pos == FLV_HEADER_SIZE)
+    demux->index_run_pos = 0;
+  else if (entry && entry->pos == pos)
+    demux->index_run_pos = pos;
+  else
+    demux->index_run_pos = INDEX_RUN_NONE;
+
+  while (demux->offset < stop &&
+      (ret = gst_flv_demux_pull_range (demux, demux->sinkpad, demux->offset,
               12, &buffer)) == GST_FLOW_OK) {
     tag_time =
         gst_flv_demux_parse_tag_timestamp (demux, TRUE, buffer, &tag_size);
@@ -2331,19 +2496,124 @@ gst_flv_demux_create_index (GstFlvDemux * demux, gint64 pos, GstClockTime ts)
     buffer = NULL;
 
     if (G_UNLIKELY (tag_time == GST_CLOCK_TIME_NONE || tag_time > ts))
-      goto exit;
+      return GST_FLOW_OK;
 
     demux->offset += tag_size;
   }
 
   if (ret == GST_FLOW_EOS) {
-    /* file ran out, so mark we have complete index */
-    demux->indexed = TRUE;
-    ret = GST_FLOW_OK;
+    *complete = (demux->index_run_pos != INDEX_RUN_NONE);
+    return GST_FLOW_OK;
+  } else if (ret != GST_FLOW_OK) {
+    return ret;
+  }
+
+  /* we reached the tags scanned before, so nothing is missing before the
+   * first keyframe found there either */
+  entry = gst_flv_demux_index_find_pos (demux, stop, TRUE);
+  if (entry && demux->index_run_pos != INDEX_RUN_NONE) {
+    idx = entry - (GstFlvDemuxIndexEntry *) demux->index->data;
+    if (idx == 0)
+      entry->contiguous |= (demux->index_run_pos == 0);
+    else
+      entry->contiguous |=
+          (demux->index_run_pos == INDEX_ENTRY (demux, idx - 1).pos);
+  }
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_flv_demux_create_index (GstFlvDemux * demux, GstClockTime ts)
+{
+  gint64 size;
+  guint64 old_offset, old_run_pos, low, high, mid, pos, stop;
+  GstClockTime tag_time, target, window;
+  GstFlvDemuxIndexEntry *entry;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean complete = FALSE;
+  guint i;
+
+  if (!gst_pad_peer_query_duration (demux->sinkpad, GST_FORMAT_BYTES, &size))
+    return GST_FLOW_OK;
+
+  old_offset = demux->offset;
+  old_run_pos = demux->index_run_pos;
+
+  /* Start scanning a bit before the target to find the keyframe before it.
+   * With long GOPs there might be none, then go back further and scan up to
+   * where the previous scan started. */
+  window = INDEX_SCAN_WINDOW;
+  stop = G_MAXUINT64;
+  do {
+    target = (ts > window) ? ts - window : 0;
+
+    /* Bisect the byte range between the known keyframes around the target
+     * until we are close to the target */
+    low = FLV_HEADER_SIZE;
+    high = MIN (stop, (guint64) size);
+    entry = gst_flv_demux_index_find_time (demux, target, FALSE);
+    if (entry)
+      low = entry->pos;
+    entry = gst_flv_demux_index_find_time (demux, ts, TRUE);
+    if (entry && entry->pos > low && entry->pos < high)
+      high = entry->pos;
+
+    GST_DEBUG_OBJECT (demux, "building index between %" G_GUINT64_FORMAT
+        " and %" G_GUINT64_FORMAT " looking for time %" GST_TIME_FORMAT, low,
+        high, GST_TIME_ARGS (ts));
+
+    while (target > 0 && high - low > INDEX_BISECT_THRESHOLD) {
+      mid = low + (high - low) / 2;
+
+      ret = gst_flv_demux_resync (demux, mid, high, &pos, &tag_time);
+      if (ret == GST_FLOW_EOS) {
+        high = mid;
+        continue;
+      } else if (ret != GST_FLOW_OK) {
+        goto exit;
+      }
+
+      GST_LOG_OBJECT (demux, "tag at %" G_GUINT64_FORMAT " has time %"
+          GST_TIME_FORMAT, pos, GST_TIME_ARGS (tag_time));
+
+      if (tag_time <= target)
+        low = pos;
+      else
+        high = mid;
+    }
+
+    GST_DEBUG_OBJECT (demux, "scanning from %" G_GUINT64_FORMAT " to %"
+        G_GUINT64_FORMAT, low, stop);
+
+    ret = gst_flv_demux_scan_index (demux, low, stop, ts, &complete);
+    if (ret != GST_FLOW_OK)
+      goto exit;
+
+    /* done when a keyframe before the target was found in what we scanned */
+    entry = gst_flv_demux_index_find_time (demux, ts, FALSE);
+    if (entry && entry->pos >= low)
+      break;
+
+    window *= 2;
+    stop = low;
+  } while (low > FLV_HEADER_SIZE && target > 0);
+
+  /* mark we have a complete index if the file ran out and nothing was
+   * skipped anywhere */
+  if (complete) {
+    for (i = 0; i < demux->index->len; i++)
+      if (!INDEX_ENTRY (demux, i).contiguous)
+        break;
+    if (i == demux->index->len) {
+      GST_DEBUG_OBJECT (demux, "index is complete");
+      demux->indexed = TRUE;
+    }
   }
 
 exit:
   demux->offset = old_offset;
+  demux->index_run_pos = old_run_pos;
 
   return ret;
 }
@@ -2445,8 +2715,7 @@ gst_flv_demux_loop (GstPad * pad)
        * scan for index in task thread from current maximum offset to
        * desired time and then perform seek */
       /* TODO maybe some buffering message or so to indicate scan progress */
-      ret = gst_flv_demux_create_index (demux, demux->index_max_pos,
-          demux->seek_time);
+      ret = gst_flv_demux_create_index (demux, demux->seek_time);
       if (ret != GST_FLOW_OK)
         goto pause;
       /* position and state arranged by seek,
@@ -2456,8 +2725,6 @@ gst_flv_demux_loop (GstPad * pad)
       break;
     default:
       ret = gst_flv_demux_pull_header (pad, demux);
-      /* index scans start after header */
-      demux->index_max_pos = demux->offset;
       break;
   }
 
@@ -2559,48 +2826,35 @@ pause:
 static guint64
 gst_flv_demux_find_offset (GstFlvDemux * demux, GstSegment * segment)
 {
-  gint64 bytes = 0;
-  gint64 time = 0;
-  GstIndex *index;
-  GstIndexEntry *entry;
+  GstFlvDemuxIndexEntry *entry;
 
   g_return_val_if_fail (segment != NULL, 0);
 
-  time = segment->position;
-
-  index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
-  if (index) {
-    /* Let's check if we have an index entry for that seek time */
-    entry = gst_index_get_assoc_entry (index, demux->index_id,
-        GST_INDEX_LOOKUP_BEFORE, GST_ASSOCIATION_FLAG_KEY_UNIT,
-        GST_FORMAT_TIME, time);
-
-    if (entry) {
-      gst_index_entry_assoc_map (entry, GST_FORMAT_BYTES, &bytes);
-      gst_index_entry_assoc_map (entry, GST_FORMAT_TIME, &time);
-
-      GST_DEBUG_OBJECT (demux, "found index entry for %" GST_TIME_FORMAT
-          " at %" GST_TIME_FORMAT ", seeking to %" G_GINT64_FORMAT,
-          GST_TIME_ARGS (segment->position), GST_TIME_ARGS (time), bytes);
+  /* Let's check if we have an index entry for that seek time */
+  entry = gst_flv_demux_index_find_time (demux, segment->position, FALSE);
 
-      /* Key frame seeking */
-      if (segment->flags & GST_SEEK_FLAG_KEY_UNIT) {
-        /* Adjust the segment so that the keyframe fits in */
-        if (time < segment->start) {
-          segment->start = segment->time = time;
-        }
-        segment->position = time;
+  if (entry) {
+    GST_DEBUG_OBJECT (demux, "found index entry for %" GST_TIME_FORMAT
+        " at %" GST_TIME_FORMAT ", seeking to %" G_GUINT64_FORMAT,
+        GST_TIME_ARGS (segment->position), GST_TIME_ARGS (entry->time),
+        entry->pos);
+
+    /* Key frame seeking */
+    if (segment->flags & GST_SEEK_FLAG_KEY_UNIT) {
+      /* Adjust the segment so that the keyframe fits in */
+      if (entry->time < segment->start) {
+        segment->start = segment->time = entry->time;
       }
-    } else {
-      GST_DEBUG_OBJECT (demux, "no index entry found for %" GST_TIME_FORMAT,
-          GST_TIME_ARGS (segment->start));
+      segment->position = entry->time;
     }
 
-    gst_object_unref (index);
+    return entry->pos;
   }
 
-  return bytes;
+  GST_DEBUG_OBJECT (demux, "no index entry found for %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (segment->start));
+
+  return 0;
 }
 
 static gboolean
@@ -2817,12 +3071,13 @@ gst_flv_demux_handle_seek_pull (GstFlvDemux * demux, GstEvent * event,
 
   if (flush || seeksegment.position != demux->segment.position) {
     /* Do the actual seeking */
-    /* index is reliable if it is complete or we do not go to far ahead */
-    if (seeking && !demux->indexed &&
-        seeksegment.position > demux->index_max_time + 10 * GST_SECOND) {
+    /* index is reliable if it is complete or has a keyframe close enough
+     * before the target */
+    if (seeking && !gst_flv_demux_index_is_reliable (demux,
+            seeksegment.position)) {
       GST_DEBUG_OBJECT (demux, "delaying seek to post-scan; "
-          " index only up to %" GST_TIME_FORMAT,
-          GST_TIME_ARGS (demux->index_max_time));
+          " no keyframe known before %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (seeksegment.position));
       /* stop flushing for now */
       if (flush)
         gst_flv_demux_push_src_event (demux, gst_event_new_flush_stop (TRUE));
@@ -2996,18 +3251,8 @@ gst_flv_demux_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       break;
     case GST_EVENT_EOS:
     {
-      GstIndex *index;
-
       GST_DEBUG_OBJECT (demux, "received EOS");
 
-      index = gst_flv_demux_get_index (GST_ELEMENT (demux));
-
-      if (index) {
-        GST_DEBUG_OBJECT (demux, "committing index");
-        gst_index_commit (index, demux->index_id);
-        gst_object_unref (index);
-      }
-
       if (!demux->audio_pad && !demux->video_pad)
         GST_ELEMENT_ERROR (demux, STREAM, FAILED,
             ("Internal data stream error."), ("Got EOS before any data"));
@@ -3155,8 +3400,7 @@ gst_flv_demux_query (GstPad * pad, GstObject * parent, GstQuery * query)
         }
       }
       res = TRUE;
-      /* FIXME, check index this way is not thread safe */
-      if (fmt != GST_FORMAT_TIME || !demux->index) {
+      if (fmt != GST_FORMAT_TIME) {
         gst_query_set_seeking (query, fmt, FALSE, -1, -1);
       } else if (demux->random_access) {
         gst_query_set_seeking (query, GST_FORMAT_TIME, TRUE, 0,
@@ -3198,24 +3442,6 @@ gst_flv_demux_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
-      /* If this is our own index destroy it as the
-       * old entries might be wrong for the new stream */
-      if (demux->own_index) {
-        gst_object_unref (demux->index);
-        demux->index = NULL;
-        demux->own_index = FALSE;
-      }
-
-      /* If no index was created, generate one */
-      if (G_UNLIKELY (!demux->index)) {
-        GST_DEBUG_OBJECT (demux, "no index provided creating our own");
-
-        demux->index = g_object_new (gst_mem_index_get_type (), NULL);
-
-        gst_index_get_writer_id (demux->index, GST_OBJECT (demux),
-            &demux->index_id);
-        demux->own_index = TRUE;
-      }
       gst_flv_demux_cleanup (demux);
       break;
     default:
@@ -3237,55 +3463,6 @@ gst_flv_demux_change_state (GstElement * element, GstStateChange transition)
   return ret;
 }
 
-#if 0
-static void
-gst_flv_demux_set_index (GstElement * element, GstIndex * index)
-{
-  GstFlvDemux *demux = GST_FLV_DEMUX (element);
-  GstIndex *old_index;
-
-  GST_OBJECT_LOCK (demux);
-
-  old_index = demux->index;
-
-  if (index) {
-    demux->index = gst_object_ref (index);
-    demux->own_index = FALSE;
-  } else
-    demux->index = NULL;
-
-  if (old_index)
-    gst_object_unref (demux->index);
-
-  gst_object_ref (index);
-
-  GST_OBJECT_UNLOCK (demux);
-
-  /* object lock might be taken again */
-  if (index)
-    gst_index_get_writer_id (index, GST_OBJECT (element), &demux->index_id);
-
-  GST_DEBUG_OBJECT (demux, "Set index %" GST_PTR_FORMAT, demux->index);
-
-  gst_object_unref (index);
-}
-#endif
-
-static GstIndex *
-gst_flv_demux_get_index (GstElement * element)
-{
-  GstIndex *result = NULL;
-
-  GstFlvDemux *demux = GST_FLV_DEMUX (element);
-
-  GST_OBJECT_LOCK (demux);
-  if (demux->index)
-    result = gst_object_ref (demux->index);
-  GST_OBJECT_UNLOCK (demux);
-
-  return result;
-}
-
 static void
 gst_flv_demux_dispose (GObject * object)
 {
@@ -3330,7 +3507,7 @@ gst_flv_demux_dispose (GObject * object)
   }
 
   if (demux->index) {
-    gst_object_unref (demux->index);
+    g_array_free (demux->index, TRUE);
     demux->index = NULL;
   }
 
@@ -3358,11 +3535,6 @@ gst_flv_demux_class_init (GstFlvDemuxClass * klass)
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_flv_demux_change_state);
 
-#if 0
-  gstelement_class->set_index = GST_DEBUG_FUNCPTR (gst_flv_demux_set_index);
-  gstelement_class->get_index = GST_DEBUG_FUNCPTR (gst_flv_demux_get_index);
-#endif
-
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&flv_sink_template));
   gst_element_class_add_pad_template (gstelement_class,
@@ -3396,9 +3568,7 @@ gst_flv_demux_init (GstFlvDemux * demux)
   demux->taglist = gst_tag_list_new_empty ();
   gst_segment_init (&demux->segment, GST_FORMAT_TIME);
 
-  demux->own_index = FALSE;
-
-  GST_OBJECT_FLAG_SET (demux, GST_ELEMENT_FLAG_INDEXABLE);
+  demux->index = g_array_new (FALSE, FALSE, sizeof (GstFlvDemuxIndexEntry));
 
   gst_flv_demux_cleanup (demux);
 }
@@ -22,7 +22,6 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
-#include "gstindex.h"
 
 G_BEGIN_DECLS
 #define GST_TYPE_FLV_DEMUX \
@@ -37,6 +36,7 @@ G_BEGIN_DECLS
   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_FLV_DEMUX))
 typedef struct _GstFlvDemux GstFlvDemux;
 typedef struct _GstFlvDemuxClass GstFlvDemuxClass;
+typedef struct _GstFlvDemuxIndexEntry GstFlvDemuxIndexEntry;
 
 typedef enum
 {
@@ -50,6 +50,15 @@ typedef enum
   FLV_STATE_NONE
 } GstFlvDemuxState;
 
+struct _GstFlvDemuxIndexEntry
+{
+  GstClockTime time;
+  guint64 pos;
+  /* TRUE if there is no keyframe between the previous entry and this one,
+   * or the start of the file if this is the first entry */
+  gboolean contiguous;
+};
+
 struct _GstFlvDemux
 {
   GstElement element;
@@ -60,11 +69,13 @@ struct _GstFlvDemux
   GstPad *video_pad;
 
   /* <private> */
-  
-  GstIndex *index;
-  gint index_id;
-  gboolean own_index;
-  
+
+  /* keyframes sorted by offset */
+  GArray * index;
+  /* offset of the last keyframe of the tags that were parsed without gaps
+   * since then, 0 for the start of the file */
+  guint64 index_run_pos;
+
   GArray * times;
   GArray * filepositions;
 
@@ -133,9 +144,6 @@ struct _GstFlvDemux
   GstEvent *seek_event;
   gint64 seek_time;
 
-  GstClockTime index_max_time;
-  gint64 index_max_pos;
-
   /* reverse playback */
   GstClockTime video_first_ts;
   GstClockTime audio_first_ts;
@@ -85,15 +85,50 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
         "rate = (int) [ 1, MAX ], "
         "channels = (int) [ 1, MAX ], layout = (string) interleaved"));
 
+/* The kernels work on blocks of DEINTERLEAVE_BLOCK_FRAMES frames so that
+ * the input of a block stays in the cache while it is read for all
+ * channels. Groups of four channels are handled together, which reads
+ * four neighbouring samples per frame and lets the compiler vectorize the
+ * transpose. Channels without output (NULL) are skipped. */
+#define DEINTERLEAVE_BLOCK_FRAMES 64
+
 #define MAKE_FUNC(type) \
-static void deinterleave_##type (guint##type *out, guint##type *in, \
-    guint stride, guint nframes) \
+static void deinterleave_##type (guint##type **out, guint##type *in, \
+    guint channels, guint nframes) \
 { \
-  gint i; \
+  guint b, c, i, n; \
   \
-  for (i = 0; i < nframes; i++) { \
-    out[i] = *in; \
-    in += stride; \
+  for (b = 0; b < nframes; b += DEINTERLEAVE_BLOCK_FRAMES) { \
+    n = MIN (DEINTERLEAVE_BLOCK_FRAMES, nframes - b); \
+    c = 0; \
+    while (c < channels) { \
+      const guint##type *s = in + b * channels + c; \
+      \
+      if (c + 4 <= channels && out[c] && out[c + 1] && out[c + 2] && \
+          out[c + 3]) { \
+        guint##type *o0 = out[c] + b, *o1 = out[c + 1] + b; \
+        guint##type *o2 = out[c + 2] + b, *o3 = out[c + 3] + b; \
+        \
+        for (i = 0; i < n; i++) { \
+          o0[i] = s[0]; \
+          o1[i] = s[1]; \
+          o2[i] = s[2]; \
+          o3[i] = s[3]; \
+          s += channels; \
+        } \
+        c += 4; \
+      } else { \
+        if (out[c]) { \
+          guint##type *o0 = out[c] + b; \
+          \
+          for (i = 0; i < n; i++) { \
+            o0[i] = *s; \
+            s += channels; \
+          } \
+        } \
+        c++; \
+      } \
+    } \
   } \
 }
 
@@ -103,14 +138,25 @@ MAKE_FUNC (32);
 MAKE_FUNC (64);
 
 static void
-deinterleave_24 (guint8 * out, guint8 * in, guint stride, guint nframes)
+deinterleave_24 (guint8 ** out, guint8 * in, guint channels, guint nframes)
 {
-  gint i;
-
-  for (i = 0; i < nframes; i++) {
-    memcpy (out, in, 3);
-    out += 3;
-    in += stride * 3;
+  guint b, c, i, n;
+
+  for (b = 0; b < nframes; b += DEINTERLEAVE_BLOCK_FRAMES) {
+    n = MIN (DEINTERLEAVE_BLOCK_FRAMES, nframes - b);
+    for (c = 0; c < channels; c++) {
+      const guint8 *s = in + (b * channels + c) * 3;
+      guint8 *o0 = out[c];
+
+      if (o0 == NULL)
+        continue;
+      o0 += b * 3;
+      for (i = 0; i < n; i++) {
+        memcpy (o0, s, 3);
+        o0 += 3;
+        s += channels * 3;
+      }
+    }
   }
 }
 
@@ -683,7 +729,8 @@ gst_deinterleave_process (GstDeinterleave * self, GstBuffer * buf)
   guint i;
   GList *srcs;
   GstBuffer **buffers_out = g_new0 (GstBuffer *, channels);
-  guint8 *in, *out;
+  GstMapInfo *write_info = g_new0 (GstMapInfo, channels);
+  gpointer *out = g_new0 (gpointer, channels);
   GstMapInfo read_info;
 
   gst_buffer_map (buf, &read_info, GST_MAP_READ);
@@ -735,19 +782,23 @@ gst_deinterleave_process (GstDeinterleave * self, GstBuffer * buf)
     goto done;
   }
 
-  /* deinterleave */
+  /* deinterleave all channels in one pass over the input */
+  for (i = 0; i < channels; i++) {
+    if (buffers_out[i]) {
+      gst_buffer_map (buffers_out[i], &write_info[i], GST_MAP_WRITE);
+      out[i] = write_info[i].data;
+    }
+  }
+  self->func (out, read_info.data, channels, nframes);
+  for (i = 0; i < channels; i++) {
+    if (buffers_out[i])
+      gst_buffer_unmap (buffers_out[i], &write_info[i]);
+  }
+
   for (srcs = self->srcpads, i = 0; srcs; srcs = srcs->next, i++) {
     GstPad *pad = (GstPad *) srcs->data;
-    GstMapInfo write_info;
 
-    in = (guint8 *) read_info.data;
-    in += i * (GST_AUDIO_INFO_WIDTH (&self->audio_info) / 8);
     if (buffers_out[i]) {
-      gst_buffer_map (buffers_out[i], &write_info, GST_MAP_WRITE);
-      out = (guint8 *) write_info.data;
-      self->func (out, in, channels, nframes);
-      gst_buffer_unmap (buffers_out[i], &write_info);
-
       ret = gst_pad_push (pad, buffers_out[i]);
       buffers_out[i] = NULL;
       if (ret == GST_FLOW_OK)
@@ -769,6 +820,8 @@ done:
   gst_buffer_unmap (buf, &read_info);
   gst_buffer_unref (buf);
   g_free (buffers_out);
+  g_free (write_info);
+  g_free (out);
   return ret;
 
 alloc_buffer_failed:
@@ -797,6 +850,8 @@ clean_buffers:
     }
     gst_buffer_unref (buf);
     g_free (buffers_out);
+    g_free (write_info);
+    g_free (out);
     return ret;
   }
 }
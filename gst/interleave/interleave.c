@@ -95,15 +95,50 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
         "layout = (string) interleaved")
     );
 
+/* The kernels work on blocks of INTERLEAVE_BLOCK_FRAMES frames so that the
+ * output of a block stays in the cache while all channels are written to
+ * it. Groups of four present channels are handled together, which writes
+ * four neighbouring samples per frame and lets the compiler vectorize the
+ * transpose. Channels without input (NULL) are skipped. */
+#define INTERLEAVE_BLOCK_FRAMES 64
+
 #define MAKE_FUNC(type) \
-static void interleave_##type (guint##type *out, guint##type *in, \
-    guint stride, guint nframes) \
+static void interleave_##type (guint##type *out, guint##type **in, \
+    guint channels, guint nframes) \
 { \
-  gint i; \
+  guint b, c, i, n; \
   \
-  for (i = 0; i < nframes; i++) { \
-    *out = in[i]; \
-    out += stride; \
+  for (b = 0; b < nframes; b += INTERLEAVE_BLOCK_FRAMES) { \
+    n = MIN (INTERLEAVE_BLOCK_FRAMES, nframes - b); \
+    c = 0; \
+    while (c < channels) { \
+      guint##type *o = out + b * channels + c; \
+      \
+      if (c + 4 <= channels && in[c] && in[c + 1] && in[c + 2] && \
+          in[c + 3]) { \
+        const guint##type *i0 = in[c] + b, *i1 = in[c + 1] + b; \
+        const guint##type *i2 = in[c + 2] + b, *i3 = in[c + 3] + b; \
+        \
+        for (i = 0; i < n; i++) { \
+          o[0] = i0[i]; \
+          o[1] = i1[i]; \
+          o[2] = i2[i]; \
+          o[3] = i3[i]; \
+          o += channels; \
+        } \
+        c += 4; \
+      } else { \
+        if (in[c]) { \
+          const guint##type *i0 = in[c] + b; \
+          \
+          for (i = 0; i < n; i++) { \
+            *o = i0[i]; \
+            o += channels; \
+          } \
+        } \
+        c++; \
+      } \
+    } \
   } \
 }
 
@@ -113,14 +148,25 @@ MAKE_FUNC (32);
 MAKE_FUNC (64);
 
 static void
-interleave_24 (guint8 * out, guint8 * in, guint stride, guint nframes)
+interleave_24 (guint8 * out, guint8 ** in, guint channels, guint nframes)
 {
-  gint i;
-
-  for (i = 0; i < nframes; i++) {
-    memcpy (out, in, 3);
-    out += stride * 3;
-    in += 3;
+  guint b, c, i, n;
+
+  for (b = 0; b < nframes; b += INTERLEAVE_BLOCK_FRAMES) {
+    n = MIN (INTERLEAVE_BLOCK_FRAMES, nframes - b);
+    for (c = 0; c < channels; c++) {
+      guint8 *o = out + (b * channels + c) * 3;
+      const guint8 *i0 = in[c];
+
+      if (i0 == NULL)
+        continue;
+      i0 += b * 3;
+      for (i = 0; i < n; i++) {
+        memcpy (o, i0, 3);
+        o += channels * 3;
+        i0 += 3;
+      }
+    }
   }
 }
 
@@ -1200,10 +1246,14 @@ gst_interleave_collected (GstCollectPads * pads, GstInterleave * self)
   GSList *collected;
   guint nsamples;
   guint ncollected = 0;
-  gboolean empty = TRUE;
+  guint nfilled = 0;
   gint width = self->width / 8;
   GstMapInfo write_info;
   GstClockTime timestamp = -1;
+  GstBuffer **inbufs;
+  GstMapInfo *input_info;
+  gpointer *indata;
+  guint i;
 
   size = gst_collect_pads_available (pads);
   if (size == 0)
@@ -1228,46 +1278,59 @@ gst_interleave_collected (GstCollectPads * pads, GstInterleave * self)
     return GST_FLOW_NOT_NEGOTIATED;
   }
 
-  gst_buffer_map (outbuf, &write_info, GST_MAP_WRITE);
-  memset (write_info.data, 0, size * self->channels);
+  inbufs = g_newa (GstBuffer *, self->channels);
+  input_info = g_newa (GstMapInfo, self->channels);
+  indata = g_newa (gpointer, self->channels);
+  memset (inbufs, 0, sizeof (GstBuffer *) * self->channels);
+  memset (indata, 0, sizeof (gpointer) * self->channels);
 
   for (collected = pads->data; collected != NULL; collected = collected->next) {
     GstCollectData *cdata;
     GstBuffer *inbuf;
-    guint8 *outdata;
-    GstMapInfo input_info;
+    guint channel;
 
     cdata = (GstCollectData *) collected->data;
 
     inbuf = gst_collect_pads_take_buffer (pads, cdata, size);
     if (inbuf == NULL) {
       GST_DEBUG_OBJECT (cdata->pad, "No buffer available");
-      goto next;
+      continue;
     }
     ncollected++;
-    gst_buffer_map (inbuf, &input_info, GST_MAP_READ);
 
     if (timestamp == -1)
       timestamp = GST_BUFFER_TIMESTAMP (inbuf);
 
-    if (GST_BUFFER_FLAG_IS_SET (inbuf, GST_BUFFER_FLAG_GAP))
-      goto next;
-
-    empty = FALSE;
-    outdata =
-        write_info.data + width * GST_INTERLEAVE_PAD_CAST (cdata->pad)->channel;
-
-    self->func (outdata, input_info.data, self->channels, nsamples);
-    gst_buffer_unmap (inbuf, &input_info);
-
-  next:
-    if (inbuf)
+    channel = GST_INTERLEAVE_PAD_CAST (cdata->pad)->channel;
+    if (GST_BUFFER_FLAG_IS_SET (inbuf, GST_BUFFER_FLAG_GAP) ||
+        channel >= self->channels || inbufs[channel] != NULL) {
       gst_buffer_unref (inbuf);
+      continue;
+    }
+
+    gst_buffer_map (inbuf, &input_info[channel], GST_MAP_READ);
+    inbufs[channel] = inbuf;
+    indata[channel] = input_info[channel].data;
+    nfilled++;
   }
 
-  if (ncollected == 0) {
-    gst_buffer_unmap (outbuf, &write_info);
+  if (ncollected == 0)
     goto eos;
+
+  gst_buffer_map (outbuf, &write_info, GST_MAP_WRITE);
+
+  /* Only silence has to be written for missing channels, and nothing
+   * needs to be cleared if all channels have data */
+  if (nfilled < self->channels)
+    memset (write_info.data, 0, size * self->channels);
+  if (nfilled > 0)
+    self->func (write_info.data, indata, self->channels, nsamples);
+
+  for (i = 0; i < self->channels; i++) {
+    if (inbufs[i]) {
+      gst_buffer_unmap (inbufs[i], &input_info[i]);
+      gst_buffer_unref (inbufs[i]);
+    }
   }
 
   GST_OBJECT_LOCK (self);
@@ -1337,7 +1400,7 @@ gst_interleave_collected (GstCollectPads * pads, GstInterleave * self)
   GST_BUFFER_DURATION (outbuf) =
       self->timestamp - GST_BUFFER_TIMESTAMP (outbuf);
 
-  if (empty)
+  if (nfilled == 0)
     GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_GAP);
 
   gst_buffer_unmap (outbuf, &write_info);
@@ -42,7 +42,7 @@ G_BEGIN_DECLS
 typedef struct _GstInterleave GstInterleave;
 typedef struct _GstInterleaveClass GstInterleaveClass;
 
-typedef void (*GstInterleaveFunc) (gpointer out, gpointer in, guint stride, guint nframes);
+typedef void (*GstInterleaveFunc) (gpointer out, gpointer *in, guint channels, guint nframes);
 
 struct _GstInterleave
 {
@@ -538,7 +538,7 @@ atom_ctts_init (AtomCTTS * ctts)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&ctts->header, FOURCC_ctts, 0, 0, 0, flags);
-  atom_array_init (&ctts->entries, 128);
+  atom_array_init (&ctts->entries);
   ctts->do_pts = FALSE;
 }
 
@@ -565,7 +565,7 @@ atom_stts_init (AtomSTTS * stts)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&stts->header, FOURCC_stts, 0, 0, 0, flags);
-  atom_array_init (&stts->entries, 512);
+  atom_array_init (&stts->entries);
 }
 
 static void
@@ -581,7 +581,7 @@ atom_stsz_init (AtomSTSZ * stsz)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&stsz->header, FOURCC_stsz, 0, 0, 0, flags);
-  atom_array_init (&stsz->entries, 1024);
+  atom_array_init (&stsz->entries);
   stsz->sample_size = 0;
   stsz->table_size = 0;
 }
@@ -600,7 +600,7 @@ atom_stsc_init (AtomSTSC * stsc)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&stsc->header, FOURCC_stsc, 0, 0, 0, flags);
-  atom_array_init (&stsc->entries, 128);
+  atom_array_init (&stsc->entries);
 }
 
 static void
@@ -616,7 +616,7 @@ atom_co64_init (AtomSTCO64 * co64)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&co64->header, FOURCC_stco, 0, 0, 0, flags);
-  atom_array_init (&co64->entries, 256);
+  atom_array_init (&co64->entries);
 }
 
 static void
@@ -632,7 +632,7 @@ atom_stss_init (AtomSTSS * stss)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&stss->header, FOURCC_stss, 0, 0, 0, flags);
-  atom_array_init (&stss->entries, 128);
+  atom_array_init (&stss->entries);
 }
 
 static void
@@ -2474,7 +2474,7 @@ atom_stsc_add_new_entry (AtomSTSC * stsc, guint32 first_chunk, guint32 nsamples)
   nentry.first_chunk = first_chunk;
   nentry.samples_per_chunk = nsamples;
   nentry.sample_description_index = 1;
-  atom_array_append (&stsc->entries, nentry, 128);
+  atom_array_append (&stsc->entries, nentry);
 }
 
 static void
@@ -2493,7 +2493,7 @@ atom_stts_add_entry (AtomSTTS * stts, guint32 sample_count, gint32 sample_delta)
 
     nentry.sample_count = sample_count;
     nentry.sample_delta = sample_delta;
-    atom_array_append (&stts->entries, nentry, 256);
+    atom_array_append (&stts->entries, nentry);
   }
 }
 
@@ -2508,7 +2508,7 @@ atom_stsz_add_entry (AtomSTSZ * stsz, guint32 nsamples, guint32 size)
     return;
   }
   for (i = 0; i < nsamples; i++) {
-    atom_array_append (&stsz->entries, size, 1024);
+    atom_array_append (&stsz->entries, size);
   }
 }
 
@@ -2521,7 +2521,7 @@ atom_stco64_get_entry_count (AtomSTCO64 * stco64)
 static void
 atom_stco64_add_entry (AtomSTCO64 * stco64, guint64 entry)
 {
-  atom_array_append (&stco64->entries, entry, 256);
+  atom_array_append (&stco64->entries, entry);
   if (entry > G_MAXUINT32)
     stco64->header.header.type = FOURCC_co64;
 }
@@ -2529,7 +2529,7 @@ atom_stco64_add_entry (AtomSTCO64 * stco64, guint64 entry)
 static void
 atom_stss_add_entry (AtomSTSS * stss, guint32 sample)
 {
-  atom_array_append (&stss->entries, sample, 512);
+  atom_array_append (&stss->entries, sample);
 }
 
 static void
@@ -2554,7 +2554,7 @@ atom_ctts_add_entry (AtomCTTS * ctts, guint32 nsamples, guint32 offset)
 
     nentry.samplecount = nsamples;
     nentry.sampleoffset = offset;
-    atom_array_append (&ctts->entries, nentry, 256);
+    atom_array_append (&ctts->entries, nentry);
     if (offset != 0)
       ctts->do_pts = TRUE;
   } else {
@@ -3523,14 +3523,18 @@ atom_sdtp_copy_data (AtomSDTP * sdtp, guint8 ** buffer, guint64 * size,
     guint64 * offset)
 {
   guint64 original_offset = *offset;
+  guint i, len;
 
   if (!atom_full_copy_data (&sdtp->header, buffer, size, offset)) {
     return 0;
   }
 
-  /* all entries at once */
-  prop_copy_fixed_size_string (&atom_array_index (&sdtp->entries, 0),
-      atom_array_get_len (&sdtp->entries), buffer, size, offset);
+  /* all entries of a chunk at once */
+  len = atom_array_get_len (&sdtp->entries);
+  for (i = 0; i < len; i += ATOM_ARRAY_CHUNK_SIZE) {
+    prop_copy_fixed_size_string (&atom_array_index (&sdtp->entries, i),
+        MIN (len - i, ATOM_ARRAY_CHUNK_SIZE), buffer, size, offset);
+  }
 
   atom_write_size (buffer, size, offset, original_offset);
   return *offset - original_offset;
@@ -3630,7 +3634,7 @@ atom_trun_init (AtomTRUN * trun)
   trun->sample_count = 0;
   trun->data_offset = 0;
   trun->first_sample_flags = 0;
-  atom_array_init (&trun->entries, 512);
+  atom_array_init (&trun->entries);
 }
 
 static AtomTRUN *
@@ -3648,7 +3652,7 @@ atom_sdtp_init (AtomSDTP * sdtp)
   guint8 flags[3] = { 0, 0, 0 };
 
   atom_full_init (&sdtp->header, FOURCC_sdtp, 0, 0, 0, flags);
-  atom_array_init (&sdtp->entries, 512);
+  atom_array_init (&sdtp->entries);
 }
 
 static AtomSDTP *
@@ -3671,7 +3675,7 @@ atom_sdtp_add_samples (AtomSDTP * sdtp, guint8 val)
 {
   /* it does not make much/any sense according to specs,
    * but that's how MS isml samples seem to do it */
-  atom_array_append (&sdtp->entries, val, 256);
+  atom_array_append (&sdtp->entries, val);
 }
 
 static void
@@ -3687,7 +3691,7 @@ atom_trun_add_samples (AtomTRUN * trun, guint32 delta, guint32 size,
   nentry.sample_size = size;
   nentry.sample_flags = flags;
   nentry.sample_composition_time_offset = pts_offset;
-  atom_array_append (&trun->entries, nentry, 256);
+  atom_array_append (&trun->entries, nentry);
   trun->sample_count++;
 }
 
@@ -3836,7 +3840,7 @@ atom_tfra_init (AtomTFRA * tfra, guint32 track_ID)
 
   atom_full_init (&tfra->header, FOURCC_tfra, 0, 0, 0, flags);
   tfra->track_ID = track_ID;
-  atom_array_init (&tfra->entries, 512);
+  atom_array_init (&tfra->entries);
 }
 
 AtomTFRA *
@@ -3882,7 +3886,7 @@ atom_tfra_add_entry (AtomTFRA * tfra, guint64 dts, guint32 sample_num)
   tfra->lengths = (tfra->lengths & 0xfc) ||
       MAX (tfra->lengths, need_bytes (sample_num));
 
-  atom_array_append (&tfra->entries, entry, 256);
+  atom_array_append (&tfra->entries, entry);
 }
 
 void
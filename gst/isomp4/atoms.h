@@ -51,44 +51,55 @@
 #include "fourcc.h"
 #include "ftypcc.h"
 
-/* helper storage struct */
+/* helper storage struct, the entries are kept in chunks of
+ * ATOM_ARRAY_CHUNK_SIZE entries that never move once allocated, so that
+ * appending to large sample tables does not copy the existing entries */
+#define ATOM_ARRAY_CHUNK_SHIFT    10
+#define ATOM_ARRAY_CHUNK_SIZE     (1 << ATOM_ARRAY_CHUNK_SHIFT)
+#define ATOM_ARRAY_CHUNK_MASK     (ATOM_ARRAY_CHUNK_SIZE - 1)
+
 #define ATOM_ARRAY(struct_type) \
 struct { \
-  guint size; \
+  guint n_chunks; \
   guint len; \
-  struct_type *data; \
+  struct_type **chunks; \
 }
 
 /* storage helpers */
 
-#define atom_array_init(array, reserve)                                       \
+#define atom_array_init(array)                                                \
 G_STMT_START {                                                                \
   (array)->len = 0;                                                           \
-  (array)->size = reserve;                                                    \
-  (array)->data = g_malloc (sizeof (*(array)->data) * reserve);               \
+  (array)->n_chunks = 0;                                                      \
+  (array)->chunks = NULL;                                                     \
 } G_STMT_END
 
-#define atom_array_append(array, elmt, inc)                                   \
+#define atom_array_append(array, elmt)                                        \
 G_STMT_START {                                                                \
-  g_assert ((array)->data);                                                   \
-  g_assert (inc > 0);                                                         \
-  if (G_UNLIKELY ((array)->len == (array)->size)) {                           \
-    (array)->size += inc;                                                     \
-    (array)->data =                                                           \
-        g_realloc ((array)->data, sizeof (*((array)->data)) * (array)->size); \
+  if (G_UNLIKELY (((array)->len >> ATOM_ARRAY_CHUNK_SHIFT) ==                 \
+          (array)->n_chunks)) {                                               \
+    (array)->chunks = g_realloc ((array)->chunks,                             \
+        sizeof (*(array)->chunks) * ((array)->n_chunks + 1));                 \
+    (array)->chunks[(array)->n_chunks] =                                      \
+        g_malloc (sizeof (**(array)->chunks) * ATOM_ARRAY_CHUNK_SIZE);        \
+    (array)->n_chunks++;                                                      \
   }                                                                           \
-  (array)->data[(array)->len] = elmt;                                         \
+  atom_array_index (array, (array)->len) = elmt;                              \
   (array)->len++;                                                             \
 } G_STMT_END
 
 #define atom_array_get_len(array)                  ((array)->len)
-#define atom_array_index(array, index)             ((array)->data[index])
+#define atom_array_index(array, index)                                        \
+    ((array)->chunks[(index) >> ATOM_ARRAY_CHUNK_SHIFT]                       \
+        [(index) & ATOM_ARRAY_CHUNK_MASK])
 
 #define atom_array_clear(array)                                               \
 G_STMT_START {                                                                \
-  (array)->size = (array)->len = 0;                                           \
-  g_free ((array)->data);                                                     \
-  (array)->data = NULL;                                                       \
+  while ((array)->n_chunks > 0)                                               \
+    g_free ((array)->chunks[--(array)->n_chunks]);                            \
+  g_free ((array)->chunks);                                                   \
+  (array)->chunks = NULL;                                                     \
+  (array)->len = 0;                                                           \
 } G_STMT_END
 
 /* light-weight context that may influence header atom tree construction */
@@ -82,6 +82,20 @@
  * <link linkend="GstQTMux--streamable">streamable</link> allows foregoing to add
  * index metadata (at the end of file).
  *
+ * Making a faststart file normally requires all media data to be stored in a
+ * temporary file and copied after the moov at the end.  When the maximum
+ * duration of the recording is known in advance, setting
+ * <link linkend="GstQTMux--reserved-max-duration">reserved-max-duration</link>
+ * makes qtmux reserve space for the moov at the start of the file instead
+ * and write the media data directly.  The moov is written into that space at
+ * the end if downstream is seekable, otherwise the temporary file is used.
+ * If the moov turns out not to fit in the reserved space, it is written at
+ * the end of the file with a warning and the file is not faststart: the
+ * media data has already been written after the reserved space by then and
+ * is not copied again.
+ * <link linkend="GstQTMux--reserved-bytes-per-sec">reserved-bytes-per-sec</link>
+ * tunes the estimate of the needed space.
+ *
  * <refsect2>
  * <title>Example pipelines</title>
  * |[
@@ -180,6 +194,8 @@ enum
   PROP_MOOV_RECOV_FILE,
   PROP_FRAGMENT_DURATION,
   PROP_STREAMABLE,
+  PROP_RESERVED_MAX_DURATION,
+  PROP_RESERVED_BYTES_PER_SEC,
 #ifndef GST_REMOVE_DEPRECATED
   PROP_DTS_METHOD,
 #endif
@@ -198,6 +214,16 @@ enum
 #define DEFAULT_MOOV_RECOV_FILE         NULL
 #define DEFAULT_FRAGMENT_DURATION       0
 #define DEFAULT_STREAMABLE              FALSE
+#define DEFAULT_RESERVED_MAX_DURATION   GST_CLOCK_TIME_NONE
+#define DEFAULT_RESERVED_BYTES_PER_SEC  400
+
+/* space reserved for the parts of the moov that don't grow with the duration,
+ * for the movie and for each track */
+#define RESERVED_MOOV_BASE_SIZE         1024
+#define RESERVED_MOOV_TRAK_SIZE         2048
+
+/* size of the blocks the faststart temporary file is copied in */
+#define BUFFERED_DATA_BLOCK_SIZE        (1024 * 1024)
 #ifndef GST_REMOVE_DEPRECATED
 #define DEFAULT_DTS_METHOD              DTS_METHOD_REORDER
 #endif
@@ -343,6 +369,23 @@ gst_qt_mux_class_init (GstQTMuxClass * klass)
           "and hence no indexes written or duration written.",
           DEFAULT_STREAMABLE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_RESERVED_MAX_DURATION,
+      g_param_spec_uint64 ("reserved-max-duration",
+          "Reserved maximum file duration",
+          "When faststart is enabled and downstream is seekable, reserve space "
+          "for the moov at the start of the file for this maximum duration "
+          "instead of using a temporary file. If the moov doesn't fit, it is "
+          "written at the end and the file is not faststart (in nanoseconds, "
+          "GST_CLOCK_TIME_NONE to disable)", 0, GST_CLOCK_TIME_NONE,
+          DEFAULT_RESERVED_MAX_DURATION,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_RESERVED_BYTES_PER_SEC,
+      g_param_spec_uint ("reserved-bytes-per-sec",
+          "Reserved moov bytes per second, per track",
+          "Estimated growth of the moov in bytes per second of media and track, "
+          "used to reserve space with reserved-max-duration",
+          0, 10000, DEFAULT_RESERVED_BYTES_PER_SEC,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_qt_mux_request_new_pad);
@@ -397,6 +440,8 @@ gst_qt_mux_reset (GstQTMux * qtmux, gboolean alloc)
   qtmux->header_size = 0;
   qtmux->mdat_size = 0;
   qtmux->mdat_pos = 0;
+  qtmux->moov_pos = 0;
+  qtmux->reserved_moov_size = 0;
   qtmux->longest_chunk = GST_CLOCK_TIME_NONE;
   qtmux->video_pads = 0;
   qtmux->audio_pads = 0;
@@ -1180,6 +1225,32 @@ _gst_buffer_new_take_data (guint8 * data, guint size)
   return buf;
 }
 
+/*
+ * Serializes @atom into a new buffer. A first pass without buffer calculates
+ * the size so that the data can be written into one allocation of the exact
+ * size instead of growing it while walking the atom tree.
+ */
+static GstBuffer *
+gst_qt_mux_serialize_atom (gpointer atom, AtomCopyDataFunc copy_func)
+{
+  guint8 *data;
+  guint64 size = 0, offset = 0;
+
+  if (!copy_func (atom, NULL, &size, &offset))
+    return NULL;
+
+  size = offset;
+  offset = 0;
+  data = g_malloc (size);
+  if (!copy_func (atom, &data, &size, &offset)) {
+    g_free (data);
+    return NULL;
+  }
+  g_assert (offset == size);
+
+  return _gst_buffer_new_take_data (data, offset);
+}
+
 static GstFlowReturn
 gst_qt_mux_send_buffer (GstQTMux * qtmux, GstBuffer * buf, guint64 * offset,
     gboolean mind_fast)
@@ -1257,7 +1328,7 @@ gst_qt_mux_send_buffered_data (GstQTMux * qtmux, guint64 * offset)
    * (somehow optimize copy?) */
   GST_DEBUG_OBJECT (qtmux, "Sending buffered data");
   while (ret == GST_FLOW_OK) {
-    const int bufsize = 4096;
+    const int bufsize = BUFFERED_DATA_BLOCK_SIZE;
     GstMapInfo map;
     gsize size;
 
@@ -1400,6 +1471,28 @@ gst_qt_mux_update_mdat_size (GstQTMux * qtmux, guint64 mdat_pos,
   return gst_qt_mux_send_buffer (qtmux, buf, offset, FALSE);
 }
 
+/*
+ * Sends a free atom of @size bytes (including its header), used to reserve
+ * space that is overwritten later on or to pad what was reserved.
+ */
+static GstFlowReturn
+gst_qt_mux_send_free_atom (GstQTMux * qtmux, guint64 * off, guint32 size)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  GST_DEBUG_OBJECT (qtmux, "Sending free atom, size %u", size);
+
+  buf = gst_buffer_new_and_alloc (size);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, 0, size);
+  GST_WRITE_UINT32_BE (map.data, size);
+  GST_WRITE_UINT32_LE (map.data + 4, FOURCC_free);
+  gst_buffer_unmap (buf, &map);
+
+  return gst_qt_mux_send_buffer (qtmux, buf, off, FALSE);
+}
+
 static GstFlowReturn
 gst_qt_mux_send_ftyp (GstQTMux * qtmux, guint64 * off)
 {
@@ -1532,19 +1625,16 @@ gst_qt_mux_configure_moov (GstQTMux * qtmux, guint32 * _timescale)
 static GstFlowReturn
 gst_qt_mux_send_moov (GstQTMux * qtmux, guint64 * _offset, gboolean mind_fast)
 {
-  guint64 offset = 0, size = 0;
-  guint8 *data;
   GstBuffer *buf;
   GstFlowReturn ret = GST_FLOW_OK;
 
   /* serialize moov */
-  offset = size = 0;
-  data = NULL;
   GST_LOG_OBJECT (qtmux, "Copying movie header into buffer");
-  if (!atom_moov_copy_data (qtmux->moov, &data, &size, &offset))
+  buf = gst_qt_mux_serialize_atom (qtmux->moov,
+      (AtomCopyDataFunc) atom_moov_copy_data);
+  if (buf == NULL)
     goto serialize_error;
 
-  buf = _gst_buffer_new_take_data (data, offset);
   GST_DEBUG_OBJECT (qtmux, "Pushing moov atoms");
   gst_qt_mux_set_header_on_caps (qtmux, buf);
   ret = gst_qt_mux_send_buffer (qtmux, buf, _offset, mind_fast);
@@ -1553,7 +1643,6 @@ gst_qt_mux_send_moov (GstQTMux * qtmux, guint64 * _offset, gboolean mind_fast)
 
 serialize_error:
   {
-    g_free (data);
     return GST_FLOW_ERROR;
   }
 }
@@ -1602,6 +1691,23 @@ serialize_error:
   }
 }
 
+/*
+ * Estimates the size of the moov for a file of reserved-max-duration
+ */
+static guint32
+gst_qt_mux_estimate_moov_size (GstQTMux * qtmux)
+{
+  guint64 size;
+  guint n_traks;
+
+  n_traks = g_slist_length (qtmux->sinkpads);
+  size = RESERVED_MOOV_BASE_SIZE + n_traks * (RESERVED_MOOV_TRAK_SIZE +
+      gst_util_uint64_scale_ceil (qtmux->reserved_max_duration,
+          qtmux->reserved_bytes_per_sec, GST_SECOND));
+
+  return MIN (size, G_MAXUINT32);
+}
+
 static GstFlowReturn
 gst_qt_mux_start_file (GstQTMux * qtmux)
 {
@@ -1609,6 +1715,7 @@ gst_qt_mux_start_file (GstQTMux * qtmux)
   GstCaps *caps;
   GstSegment segment;
   gchar s_id[32];
+  gboolean seekable = FALSE, reserve_moov;
 
   GST_DEBUG_OBJECT (qtmux, "starting file");
 
@@ -1625,7 +1732,6 @@ gst_qt_mux_start_file (GstQTMux * qtmux)
 
   /* if not streaming, check if downstream is seekable */
   if (!qtmux->streamable) {
-    gboolean seekable;
     GstQuery *query;
 
     query = gst_query_new_seeking (GST_FORMAT_BYTES);
@@ -1706,9 +1812,19 @@ gst_qt_mux_start_file (GstQTMux * qtmux)
    * send mdat header if already needed, and mark position for later update.
    * We don't send ftyp now if we are on fast start mode, because we can
    * better fine tune using the information we gather to create the whole moov
-   * atom.
+   * atom. That is unless space for the moov can be reserved at the start of
+   * the file and the moov written into it at the end, which needs downstream
+   * to be seekable. Otherwise we fall back to the temporary file.
    */
-  if (qtmux->fast_start) {
+  reserve_moov = qtmux->fast_start && !qtmux->fragment_duration &&
+      GST_CLOCK_TIME_IS_VALID (qtmux->reserved_max_duration);
+  if (reserve_moov && (!seekable || qtmux->streamable)) {
+    GST_DEBUG_OBJECT (qtmux, "downstream is not seekable, can't reserve "
+        "space for the moov, using a temporary file");
+    reserve_moov = FALSE;
+  }
+
+  if (qtmux->fast_start && !reserve_moov) {
     GST_OBJECT_LOCK (qtmux);
     qtmux->fast_start_file = g_fopen (qtmux->fast_start_file_path, "wb+");
     if (!qtmux->fast_start_file)
@@ -1726,6 +1842,17 @@ gst_qt_mux_start_file (GstQTMux * qtmux)
       goto exit;
     }
 
+    if (reserve_moov) {
+      qtmux->moov_pos = qtmux->header_size;
+      qtmux->reserved_moov_size = gst_qt_mux_estimate_moov_size (qtmux);
+      GST_DEBUG_OBJECT (qtmux, "reserving %u bytes for the moov",
+          qtmux->reserved_moov_size);
+      ret = gst_qt_mux_send_free_atom (qtmux, &qtmux->header_size,
+          qtmux->reserved_moov_size);
+      if (ret != GST_FLOW_OK)
+        goto exit;
+    }
+
     /* well, it's moov pos if fragmented ... */
     qtmux->mdat_pos = qtmux->header_size;
 
@@ -1836,14 +1963,13 @@ gst_qt_mux_stop_file (GstQTMux * qtmux)
     GstSegment segment;
 
     if (qtmux->mfra) {
-      guint8 *data = NULL;
       GstBuffer *buf;
 
-      size = offset = 0;
       GST_DEBUG_OBJECT (qtmux, "adding mfra");
-      if (!atom_mfra_copy_data (qtmux->mfra, &data, &size, &offset))
+      buf = gst_qt_mux_serialize_atom (qtmux->mfra,
+          (AtomCopyDataFunc) atom_mfra_copy_data);
+      if (buf == NULL)
         goto serialize_error;
-      buf = _gst_buffer_new_take_data (data, offset);
       ret = gst_qt_mux_send_buffer (qtmux, buf, NULL, FALSE);
       if (ret != GST_FLOW_OK)
         return ret;
@@ -1941,6 +2067,48 @@ gst_qt_mux_stop_file (GstQTMux * qtmux)
   }
   atom_moov_chunks_add_offset (qtmux->moov, offset);
 
+  if (qtmux->reserved_moov_size > 0) {
+    GstSegment segment;
+
+    /* calculate the size of moov and extra atoms */
+    offset = size = 0;
+    if (!atom_moov_copy_data (qtmux->moov, NULL, &size, &offset))
+      goto serialize_error;
+    ret = gst_qt_mux_send_extra_atoms (qtmux, FALSE, &offset, FALSE);
+    if (ret != GST_FLOW_OK)
+      return ret;
+
+    /* what is left of the reserved space must fit a free atom */
+    if (offset != qtmux->reserved_moov_size &&
+        offset + 8 > qtmux->reserved_moov_size)
+      goto reserved_too_small;
+
+    GST_DEBUG_OBJECT (qtmux, "writing moov of size %" G_GUINT64_FORMAT
+        " into the reserved space", offset);
+
+    /* seek to the reserved space and fill it */
+    gst_segment_init (&segment, GST_FORMAT_BYTES);
+    segment.start = qtmux->moov_pos;
+    gst_pad_push_event (qtmux->srcpad, gst_event_new_segment (&segment));
+
+    ret = gst_qt_mux_send_moov (qtmux, NULL, FALSE);
+    if (ret != GST_FLOW_OK)
+      return ret;
+    ret = gst_qt_mux_send_extra_atoms (qtmux, TRUE, NULL, FALSE);
+    if (ret != GST_FLOW_OK)
+      return ret;
+    if (offset < qtmux->reserved_moov_size) {
+      ret = gst_qt_mux_send_free_atom (qtmux, NULL,
+          qtmux->reserved_moov_size - offset);
+      if (ret != GST_FLOW_OK)
+        return ret;
+    }
+
+    return gst_qt_mux_update_mdat_size (qtmux, qtmux->mdat_pos,
+        qtmux->mdat_size, NULL);
+  }
+
+write_moov:
   /* moov */
   /* note: as of this point, we no longer care about tracking written data size,
    * since there is no more use for it anyway */
@@ -1986,6 +2154,19 @@ ftyp_error:
     GST_ELEMENT_ERROR (qtmux, STREAM, MUX, (NULL), ("Failed to send ftyp"));
     return GST_FLOW_ERROR;
   }
+reserved_too_small:
+  {
+    /* the reserved space stays a free atom, the moov goes to the end. The
+     * media data was written after the reserved space already, so unlike
+     * with the temporary file the result is not faststart */
+    GST_ELEMENT_WARNING (qtmux, STREAM, MUX, (NULL),
+        ("Not enough space reserved for the moov (%u bytes, need %"
+            G_GUINT64_FORMAT "), writing it at the end of the file instead. "
+            "Increase reserved-max-duration or reserved-bytes-per-sec.",
+            qtmux->reserved_moov_size, offset));
+    qtmux->reserved_moov_size = 0;
+    goto write_moov;
+  }
 }
 
 static GstFlowReturn
@@ -2055,7 +2236,7 @@ init:
   if (G_UNLIKELY (!pad->traf)) {
     GST_LOG_OBJECT (qtmux, "setting up new fragment");
     pad->traf = atom_traf_new (qtmux->context, atom_trak_get_id (pad->trak));
-    atom_array_init (&pad->fragment_buffers, 512);
+    atom_array_init (&pad->fragment_buffers);
     pad->fragment_duration = gst_util_uint64_scale (qtmux->fragment_duration,
         atom_trak_get_timescale (pad->trak), 1000);
 
@@ -2068,7 +2249,7 @@ init:
   /* add buffer and metadata */
   atom_traf_add_samples (pad->traf, delta, size, sync, pts_offset,
       pad->sync && sync);
-  atom_array_append (&pad->fragment_buffers, buf, 256);
+  atom_array_append (&pad->fragment_buffers, buf);
   pad->fragment_duration -= delta;
 
   if (pad->tfra) {
@@ -3306,6 +3487,12 @@ gst_qt_mux_get_property (GObject * object,
     case PROP_STREAMABLE:
       g_value_set_boolean (value, qtmux->streamable);
       break;
+    case PROP_RESERVED_MAX_DURATION:
+      g_value_set_uint64 (value, qtmux->reserved_max_duration);
+      break;
+    case PROP_RESERVED_BYTES_PER_SEC:
+      g_value_set_uint (value, qtmux->reserved_bytes_per_sec);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3369,6 +3556,12 @@ gst_qt_mux_set_property (GObject * object,
     case PROP_STREAMABLE:
       qtmux->streamable = g_value_get_boolean (value);
       break;
+    case PROP_RESERVED_MAX_DURATION:
+      qtmux->reserved_max_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_RESERVED_BYTES_PER_SEC:
+      qtmux->reserved_bytes_per_sec = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -154,6 +154,10 @@ struct _GstQTMux
   guint64 mdat_size;
   /* position of mdat atom (for later updating) */
   guint64 mdat_pos;
+  /* position and size of the space reserved for the moov atom at the start
+   * of the file, 0 size if none */
+  guint64 moov_pos;
+  guint32 reserved_moov_size;
 
   /* keep track of the largest chunk to fine-tune brands */
   GstClockTime longest_chunk;
@@ -190,6 +194,8 @@ struct _GstQTMux
   gchar *moov_recov_file_path;
   guint32 fragment_duration;
   gboolean streamable;
+  GstClockTime reserved_max_duration;
+  guint32 reserved_bytes_per_sec;
 
   /* for request pad naming */
   guint video_pads, audio_pads;
@@ -243,6 +243,7 @@ static void
 gst_level_init (GstLevel * filter)
 {
   filter->CS = NULL;
+  filter->block_CS = NULL;
   filter->peak = NULL;
   filter->last_peak = NULL;
   filter->decay_peak = NULL;
@@ -268,6 +269,7 @@ gst_level_finalize (GObject * obj)
   GstLevel *filter = GST_LEVEL (obj);
 
   g_free (filter->CS);
+  g_free (filter->block_CS);
   g_free (filter->peak);
   g_free (filter->last_peak);
   g_free (filter->decay_peak);
@@ -275,6 +277,7 @@ gst_level_finalize (GObject * obj)
   g_free (filter->decay_peak_age);
 
   filter->CS = NULL;
+  filter->block_CS = NULL;
   filter->peak = NULL;
   filter->last_peak = NULL;
   filter->decay_peak = NULL;
@@ -345,91 +348,86 @@ gst_level_get_property (GObject * object, guint prop_id,
 }
 
 
-/* process one (interleaved) channel of incoming samples
- * calculate square sum of samples
+/* process a block of interleaved frames for all channels at once
+ * calculate square sum of samples per channel
  * normalize and average over number of samples
- * returns a normalized cumulative square value, which can be averaged
+ * returns normalized cumulative square values, which can be averaged
  * to return the average power as a double between 0 and 1
  * also returns the normalized peak power (square of the highest amplitude)
  *
- * caller must assure num is a multiple of channels
  * samples for multiple channels are interleaved
- * input sample data enters in *in_data as 8 or 16 bit data
+ * input sample data enters in *in_data as 8, 16 or 32 bit data
  * this filter only accepts signed audio data, so mid level is always 0
  *
+ * all channels of a frame are accumulated in the same inner loop, the
+ * per-channel sums do not depend on each other so the loop over the
+ * channels is vectorized by the compiler while the order of the additions
+ * for each channel stays the same as when processing them one by one
+ *
  * for 16 bit, this code considers the non-existant 32768 value to be
  * full-scale; so 32767 will not map to 1.0
  */
 
 #define DEFINE_INT_LEVEL_CALCULATOR(TYPE, RESOLUTION)                         \
 static void inline                                                            \
-gst_level_calculate_##TYPE (gpointer data, guint num, guint channels,         \
+gst_level_calculate_##TYPE (gpointer data, guint num_frames, guint channels,  \
                             gdouble *NCS, gdouble *NPS)                       \
 {                                                                             \
   TYPE * in = (TYPE *)data;                                                   \
-  register guint j;                                                           \
-  gdouble squaresum = 0.0;           /* square sum of the integer samples */  \
-  register gdouble square = 0.0;     /* Square */                             \
-  register gdouble peaksquare = 0.0; /* Peak Square Sample */                 \
+  guint i, c;                                                                 \
   gdouble normalizer;                /* divisor to get a [-1.0, 1.0] range */ \
                                                                               \
-  /* *NCS = 0.0; Normalized Cumulative Square */                              \
-  /* *NPS = 0.0; Normalized Peask Square */                                   \
+  for (c = 0; c < channels; c++) {                                            \
+    NCS[c] = 0.0;                    /* Normalized Cumulative Square */       \
+    NPS[c] = 0.0;                    /* Normalized Peak Square */             \
+  }                                                                           \
                                                                               \
-  for (j = 0; j < num; j += channels) {                                       \
-    square = ((gdouble) in[j]) * in[j];                                       \
-    if (square > peaksquare) peaksquare = square;                             \
-    squaresum += square;                                                      \
+  for (i = 0; i < num_frames; i++) {                                          \
+    for (c = 0; c < channels; c++) {                                          \
+      gdouble square = ((gdouble) in[c]) * in[c];                             \
+      NPS[c] = MAX (NPS[c], square);                                          \
+      NCS[c] += square;                                                       \
+    }                                                                         \
+    in += channels;                                                           \
   }                                                                           \
                                                                               \
   normalizer = (gdouble) (G_GINT64_CONSTANT(1) << (RESOLUTION * 2));          \
-  *NCS = squaresum / normalizer;                                              \
-  *NPS = peaksquare / normalizer;                                             \
+  for (c = 0; c < channels; c++) {                                            \
+    NCS[c] /= normalizer;                                                     \
+    NPS[c] /= normalizer;                                                     \
+  }                                                                           \
 }
 
 DEFINE_INT_LEVEL_CALCULATOR (gint32, 31);
 DEFINE_INT_LEVEL_CALCULATOR (gint16, 15);
 DEFINE_INT_LEVEL_CALCULATOR (gint8, 7);
 
-/* FIXME: use orc to calculate squaresums? */
 #define DEFINE_FLOAT_LEVEL_CALCULATOR(TYPE)                                   \
 static void inline                                                            \
-gst_level_calculate_##TYPE (gpointer data, guint num, guint channels,         \
+gst_level_calculate_##TYPE (gpointer data, guint num_frames, guint channels,  \
                             gdouble *NCS, gdouble *NPS)                       \
 {                                                                             \
   TYPE * in = (TYPE *)data;                                                   \
-  register guint j;                                                           \
-  gdouble squaresum = 0.0;           /* square sum of the integer samples */  \
-  register gdouble square = 0.0;     /* Square */                             \
-  register gdouble peaksquare = 0.0; /* Peak Square Sample */                 \
+  guint i, c;                                                                 \
                                                                               \
-  /* *NCS = 0.0; Normalized Cumulative Square */                              \
-  /* *NPS = 0.0; Normalized Peask Square */                                   \
-                                                                              \
-  /* orc_level_squaresum_f64(&squaresum,in,num); */                           \
-  for (j = 0; j < num; j += channels) {                                       \
-    square = ((gdouble) in[j]) * in[j];                                       \
-    if (square > peaksquare) peaksquare = square;                             \
-    squaresum += square;                                                      \
+  for (c = 0; c < channels; c++) {                                            \
+    NCS[c] = 0.0;                    /* Normalized Cumulative Square */       \
+    NPS[c] = 0.0;                    /* Normalized Peak Square */             \
   }                                                                           \
                                                                               \
-  *NCS = squaresum;                                                           \
-  *NPS = peaksquare;                                                          \
+  for (i = 0; i < num_frames; i++) {                                          \
+    for (c = 0; c < channels; c++) {                                          \
+      gdouble square = ((gdouble) in[c]) * in[c];                             \
+      NPS[c] = MAX (NPS[c], square);                                          \
+      NCS[c] += square;                                                       \
+    }                                                                         \
+    in += channels;                                                           \
+  }                                                                           \
 }
 
 DEFINE_FLOAT_LEVEL_CALCULATOR (gfloat);
 DEFINE_FLOAT_LEVEL_CALCULATOR (gdouble);
 
-/* we would need stride to deinterleave also
-static void inline
-gst_level_calculate_gdouble (gpointer data, guint num, guint channels,
-                            gdouble *NCS, gdouble *NPS)
-{
-  orc_level_squaresum_f64(NCS,(gdouble *)data,num);
-  *NPS = 0.0;
-}
-*/
-
 
 static gboolean
 gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
@@ -469,12 +467,14 @@ gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
 
   /* allocate channel variable arrays */
   g_free (filter->CS);
+  g_free (filter->block_CS);
   g_free (filter->peak);
   g_free (filter->last_peak);
   g_free (filter->decay_peak);
   g_free (filter->decay_peak_base);
   g_free (filter->decay_peak_age);
   filter->CS = g_new (gdouble, channels);
+  filter->block_CS = g_new (gdouble, channels);
   filter->peak = g_new (gdouble, channels);
   filter->last_peak = g_new (gdouble, channels);
   filter->decay_peak = g_new (gdouble, channels);
@@ -580,7 +580,6 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
   GstMapInfo map;
   guint8 *in_data;
   gsize in_size;
-  gdouble CS;
   guint i;
   guint num_frames;
   guint num_int_samples = 0;    /* number of interleaved samples
@@ -624,18 +623,19 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
     GST_LOG_OBJECT (filter, "run inner loop for %u sample frames",
         block_int_size);
 
+    if (!GST_BUFFER_FLAG_IS_SET (in, GST_BUFFER_FLAG_GAP))
+      filter->process (in_data, block_size, channels, filter->block_CS,
+          filter->peak);
+
     for (i = 0; i < channels; ++i) {
       if (!GST_BUFFER_FLAG_IS_SET (in, GST_BUFFER_FLAG_GAP)) {
-        filter->process (in_data, block_int_size, channels, &CS,
-            &filter->peak[i]);
         GST_LOG_OBJECT (filter,
-            "channel %d, cumulative sum %f, over %d samples/%d channels", i, CS,
-            block_int_size, channels);
-        filter->CS[i] += CS;
+            "channel %d, cumulative sum %f, over %d samples/%d channels", i,
+            filter->block_CS[i], block_int_size, channels);
+        filter->CS[i] += filter->block_CS[i];
       } else {
         filter->peak[i] = 0.0;
       }
-      in_data += bps;
 
       filter->decay_peak_age[i] += GST_FRAMES_TO_CLOCK_TIME (num_frames, rate);
       GST_LOG_OBJECT (filter,
@@ -682,7 +682,7 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
         filter->decay_peak_age[i] = G_GINT64_CONSTANT (0);
       }
     }
-    in_data += ((block_int_size * bps) - bps);
+    in_data += block_int_size * bps;
 
     filter->num_frames += block_size;
     num_frames -= block_size;
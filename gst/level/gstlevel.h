@@ -70,6 +70,7 @@ struct _GstLevel {
 
   /* per-channel arrays for intermediate values */
   gdouble *CS;                  /* normalized Cumulative Square */
+  gdouble *block_CS;            /* normalized Cumulative Square of block */
   gdouble *peak;                /* normalized Peak value over buffer */
   gdouble *last_peak;           /* last normalized Peak value over interval */
   gdouble *decay_peak;          /* running decaying normalized Peak */
@@ -68,13 +68,22 @@ enum
   ARG_WRITING_APP,
   ARG_DOCTYPE_VERSION,
   ARG_MIN_INDEX_INTERVAL,
-  ARG_STREAMABLE
+  ARG_STREAMABLE,
+  ARG_MAX_CUES_ENTRIES,
+  ARG_CUES_UPDATE_INTERVAL
 };
 
 #define  DEFAULT_DOCTYPE_VERSION         2
 #define  DEFAULT_WRITING_APP             "GStreamer Matroska muxer"
 #define  DEFAULT_MIN_INDEX_INTERVAL      0
 #define  DEFAULT_STREAMABLE              FALSE
+#define  DEFAULT_MAX_CUES_ENTRIES        0
+#define  DEFAULT_CUES_UPDATE_INTERVAL    0
+
+/* upper bound for the size of a CuePoint as we write it: two masters with
+ * 8 byte sizes, time and cluster position of up to 8 bytes and a track
+ * number of one byte, all with 1 byte IDs and sizes */
+#define  MAX_CUE_POINT_SIZE              41
 
 /* WAVEFORMATEX is gst_riff_strf_auds + an extra guint16 extension size */
 #define WAVEFORMATEX_SIZE  (2 + sizeof (gst_riff_strf_auds))
@@ -229,6 +238,10 @@ static void gst_matroska_mux_get_property (GObject * object,
 /* reset muxer */
 static void gst_matroska_mux_reset (GstElement * element);
 
+/* index */
+static gboolean gst_matroska_mux_write_reserved_cues (GstMatroskaMux * mux);
+static void gst_matroska_mux_thin_index (GstMatroskaMux * mux);
+
 /* uid generation */
 static guint64 gst_matroska_mux_create_uid ();
 
@@ -328,6 +341,41 @@ gst_matroska_mux_class_init (GstMatroskaMuxClass * klass)
           "to be streamed and hence no indexes written or duration written.",
           DEFAULT_STREAMABLE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstMatroskaMux:max-cues-entries:
+   *
+   * Maximum number of index entries to keep. When the index is full every
+   * second entry is dropped and the minimum time between entries doubles,
+   * so the memory used stays constant for arbitrarily long recordings.
+   *
+   * If the output is not streamable, space for that many entries is
+   * reserved right after the SeekHead and the Cues are written there
+   * instead of at the end of the file.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, ARG_MAX_CUES_ENTRIES,
+      g_param_spec_uint ("max-cues-entries", "Maximum number of Cues entries",
+          "Maximum number of index entries to keep and to reserve space for "
+          "at the start of the file (0 = unlimited, Cues at the end)",
+          0, G_MAXUINT16, DEFAULT_MAX_CUES_ENTRIES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstMatroskaMux:cues-update-interval:
+   *
+   * When Cues are reserved at the start of the file (see
+   * #GstMatroskaMux:max-cues-entries), rewrite them every so many
+   * nanoseconds of stream time, so that a recording that is interrupted
+   * is still seekable up to the last update.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, ARG_CUES_UPDATE_INTERVAL,
+      g_param_spec_uint64 ("cues-update-interval", "Cues update interval",
+          "Interval in nanoseconds at which reserved Cues are rewritten "
+          "(0 = only at the end)", 0, G_MAXUINT64,
+          DEFAULT_CUES_UPDATE_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_matroska_mux_change_state);
@@ -466,6 +514,8 @@ gst_matroska_mux_init (GstMatroskaMux * mux, gpointer g_class)
   mux->writing_app = g_strdup (DEFAULT_WRITING_APP);
   mux->min_index_interval = DEFAULT_MIN_INDEX_INTERVAL;
   mux->streamable = DEFAULT_STREAMABLE;
+  mux->max_cues_entries = DEFAULT_MAX_CUES_ENTRIES;
+  mux->cues_update_interval = DEFAULT_CUES_UPDATE_INTERVAL;
 
   /* initialize internal variables */
   mux->index = NULL;
@@ -652,6 +702,10 @@ gst_matroska_mux_reset (GstElement * element)
   mux->num_indexes = 0;
   g_free (mux->index);
   mux->index = NULL;
+  mux->index_interval = 0;
+  mux->cues_reserved_pos = 0;
+  mux->cues_reserved_size = 0;
+  mux->cues_last_update = 0;
 
   /* reset timers */
   mux->time_scale = GST_MSECOND;
@@ -2463,6 +2517,25 @@ gst_matroska_mux_write_chapter_edition (GstMatroskaMux * mux,
 }
 #endif
 
+/**
+ * gst_matroska_mux_write_void_header:
+ * @ebml: #GstEbmlWrite
+ * @size: Total size of the Void element, at least 9 bytes.
+ *
+ * Write the header of a Void element that covers exactly @size bytes
+ * including the header. The size is always coded with 8 bytes, unlike
+ * gst_ebml_write_buffer_header() which uses as few bytes as possible.
+ */
+static void
+gst_matroska_mux_write_void_header (GstEbmlWrite * ebml, guint64 size)
+{
+  guint8 *data = g_malloc (9);
+
+  data[0] = GST_EBML_ID_VOID;
+  GST_WRITE_UINT64_BE (data + 1, (G_GINT64_CONSTANT (1) << 56) | (size - 9));
+  gst_ebml_write_buffer (ebml, gst_buffer_new_wrapped (data, 9));
+}
+
 /**
  * gst_matroska_mux_start:
  * @mux: #GstMatroskaMux
@@ -2557,7 +2630,23 @@ gst_matroska_mux_start (GstMatroskaMux * mux)
       gst_ebml_write_master_finish (ebml, child);
     }
     gst_ebml_write_master_finish (ebml, master);
+
+    /* reserve space for the Cues, they are written into it later */
+    if (mux->max_cues_entries > 0) {
+      guint64 size;
+
+      mux->cues_reserved_pos = ebml->pos;
+      mux->cues_reserved_size =
+          12 + MAX_CUE_POINT_SIZE * mux->max_cues_entries + 9;
+      GST_DEBUG_OBJECT (mux, "reserving %" G_GUINT64_FORMAT " bytes for "
+          "Cues", mux->cues_reserved_size);
+      size = mux->cues_reserved_size - 9;
+      gst_matroska_mux_write_void_header (ebml, mux->cues_reserved_size);
+      gst_ebml_write_buffer (ebml, gst_buffer_new_wrapped (g_malloc0 (size),
+              size));
+    }
   }
+  mux->index_interval = mux->min_index_interval;
 
   if (mux->streamable) {
     const GstTagList *tags;
@@ -2823,6 +2912,118 @@ gst_matroska_mux_write_toc_entry_tags (GstMatroskaMux * mux,
 }
 #endif
 
+/**
+ * gst_matroska_mux_write_cues:
+ * @mux: #GstMatroskaMux
+ *
+ * Write the Cues for all index entries at the current position.
+ */
+static void
+gst_matroska_mux_write_cues (GstMatroskaMux * mux)
+{
+  GstEbmlWrite *ebml = mux->ebml_write;
+  guint n;
+  guint64 master, pointentry_master, trackpos_master;
+
+  gst_ebml_write_set_cache (ebml, 12 + MAX_CUE_POINT_SIZE * mux->num_indexes);
+  master = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_CUES);
+
+  for (n = 0; n < mux->num_indexes; n++) {
+    GstMatroskaIndex *idx = &mux->index[n];
+
+    pointentry_master = gst_ebml_write_master_start (ebml,
+        GST_MATROSKA_ID_POINTENTRY);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETIME,
+        idx->time / mux->time_scale);
+    trackpos_master = gst_ebml_write_master_start (ebml,
+        GST_MATROSKA_ID_CUETRACKPOSITIONS);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETRACK, idx->track);
+    gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUECLUSTERPOSITION,
+        idx->pos - mux->segment_master);
+    gst_ebml_write_master_finish (ebml, trackpos_master);
+    gst_ebml_write_master_finish (ebml, pointentry_master);
+  }
+
+  gst_ebml_write_master_finish (ebml, master);
+  gst_ebml_write_flush_cache (ebml, FALSE, GST_CLOCK_TIME_NONE);
+}
+
+/**
+ * gst_matroska_mux_write_reserved_cues:
+ * @mux: #GstMatroskaMux
+ *
+ * Overwrite the space reserved after the SeekHead with the current Cues,
+ * followed by a Void element filling the rest of it, and point the
+ * SeekHead at them.
+ *
+ * Returns: %FALSE if the Cues don't fit into the reserved space.
+ */
+static gboolean
+gst_matroska_mux_write_reserved_cues (GstMatroskaMux * mux)
+{
+  GstEbmlWrite *ebml = mux->ebml_write;
+  guint64 my_pos = ebml->pos;
+
+  if (mux->num_indexes == 0)
+    return TRUE;
+
+  /* the index can outgrow the space when max-cues-entries is raised after
+   * the start */
+  if (12 + MAX_CUE_POINT_SIZE * mux->num_indexes + 9 >
+      mux->cues_reserved_size) {
+    GST_WARNING_OBJECT (mux, "%u index entries don't fit into the reserved "
+        "space", mux->num_indexes);
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (mux, "updating reserved Cues with %u entries",
+      mux->num_indexes);
+
+  gst_ebml_write_seek (ebml, mux->cues_reserved_pos);
+  gst_matroska_mux_write_cues (mux);
+  gst_matroska_mux_write_void_header (ebml,
+      mux->cues_reserved_pos + mux->cues_reserved_size - ebml->pos);
+
+  /* see gst_matroska_mux_finish() for the SeekHead layout. Info and Tracks
+   * are written already, point at them too so that the SeekHead is usable
+   * when the file ends before gst_matroska_mux_finish() */
+  mux->cues_pos = mux->cues_reserved_pos;
+  gst_ebml_replace_uint (ebml, mux->seekhead_pos + 32,
+      mux->info_pos - mux->segment_master);
+  gst_ebml_replace_uint (ebml, mux->seekhead_pos + 60,
+      mux->tracks_pos - mux->segment_master);
+  gst_ebml_replace_uint (ebml, mux->seekhead_pos + 116,
+      mux->cues_pos - mux->segment_master);
+
+  gst_ebml_write_seek (ebml, my_pos);
+
+  return TRUE;
+}
+
+/**
+ * gst_matroska_mux_thin_index:
+ * @mux: #GstMatroskaMux
+ *
+ * Drop every second index entry and double the minimum time between
+ * entries to make room for new ones.
+ */
+static void
+gst_matroska_mux_thin_index (GstMatroskaMux * mux)
+{
+  GstClockTimeDiff span;
+  guint n;
+
+  for (n = 0; 2 * n < mux->num_indexes; n++)
+    mux->index[n] = mux->index[2 * n];
+
+  span = GST_CLOCK_DIFF (mux->index[0].time, mux->index[n - 1].time);
+  mux->index_interval = MAX (2 * mux->index_interval, span / n);
+  mux->num_indexes = n;
+
+  GST_DEBUG_OBJECT (mux, "thinned index to %u entries, interval now %"
+      GST_TIME_FORMAT, n, GST_TIME_ARGS (mux->index_interval));
+}
+
 /**
  * gst_matroska_mux_finish:
  * @mux: #GstMatroskaMux
@@ -2845,31 +3046,20 @@ gst_matroska_mux_finish (GstMatroskaMux * mux)
 
   /* cues */
   if (mux->index != NULL) {
-    guint n;
-    guint64 master, pointentry_master, trackpos_master;
-
-    mux->cues_pos = ebml->pos;
-    gst_ebml_write_set_cache (ebml, 12 + 41 * mux->num_indexes);
-    master = gst_ebml_write_master_start (ebml, GST_MATROSKA_ID_CUES);
-
-    for (n = 0; n < mux->num_indexes; n++) {
-      GstMatroskaIndex *idx = &mux->index[n];
+    if (!mux->cues_reserved_pos) {
+      mux->cues_pos = ebml->pos;
+      gst_matroska_mux_write_cues (mux);
+    } else if (!gst_matroska_mux_write_reserved_cues (mux)) {
+      /* void the reserved space, it might hold Cues of an earlier update,
+       * and write the Cues at the end instead */
+      pos = ebml->pos;
+      gst_ebml_write_seek (ebml, mux->cues_reserved_pos);
+      gst_matroska_mux_write_void_header (ebml, mux->cues_reserved_size);
+      gst_ebml_write_seek (ebml, pos);
 
-      pointentry_master = gst_ebml_write_master_start (ebml,
-          GST_MATROSKA_ID_POINTENTRY);
-      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETIME,
-          idx->time / mux->time_scale);
-      trackpos_master = gst_ebml_write_master_start (ebml,
-          GST_MATROSKA_ID_CUETRACKPOSITIONS);
-      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUETRACK, idx->track);
-      gst_ebml_write_uint (ebml, GST_MATROSKA_ID_CUECLUSTERPOSITION,
-          idx->pos - mux->segment_master);
-      gst_ebml_write_master_finish (ebml, trackpos_master);
-      gst_ebml_write_master_finish (ebml, pointentry_master);
+      mux->cues_pos = ebml->pos;
+      gst_matroska_mux_write_cues (mux);
     }
-
-    gst_ebml_write_master_finish (ebml, master);
-    gst_ebml_write_flush_cache (ebml, FALSE, GST_CLOCK_TIME_NONE);
   }
 
   /* tags */
@@ -3280,6 +3470,14 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
       if (!mux->streamable)
         gst_ebml_write_master_finish (ebml, mux->cluster);
 
+      /* between clusters is a good time to update the reserved Cues */
+      if (mux->cues_reserved_pos && mux->cues_update_interval > 0 &&
+          GST_BUFFER_TIMESTAMP (buf) >=
+          mux->cues_last_update + mux->cues_update_interval) {
+        gst_matroska_mux_write_reserved_cues (mux);
+        mux->cues_last_update = GST_BUFFER_TIMESTAMP (buf);
+      }
+
       /* Forward the GstForceKeyUnit event after finishing the cluster */
       if (mux->force_key_unit_event) {
         gst_pad_push_event (mux->srcpad, mux->force_key_unit_event);
@@ -3332,18 +3530,22 @@ gst_matroska_mux_write_data (GstMatroskaMux * mux, GstMatroskaPad * collect_pad,
               (mux->num_streams == 1)))) {
     gint last_idx = -1;
 
-    if (mux->min_index_interval != 0) {
+    if (mux->index_interval != 0) {
       for (last_idx = mux->num_indexes - 1; last_idx >= 0; last_idx--) {
         if (mux->index[last_idx].track == collect_pad->track->num)
           break;
       }
     }
 
-    if (last_idx < 0 || mux->min_index_interval == 0 ||
+    if (last_idx < 0 || mux->index_interval == 0 ||
         (GST_CLOCK_DIFF (mux->index[last_idx].time, GST_BUFFER_TIMESTAMP (buf))
-            >= mux->min_index_interval)) {
+            >= mux->index_interval)) {
       GstMatroskaIndex *idx;
 
+      if (mux->max_cues_entries > 0 &&
+          mux->num_indexes >= mux->max_cues_entries)
+        gst_matroska_mux_thin_index (mux);
+
       if (mux->num_indexes % 32 == 0) {
         mux->index = g_renew (GstMatroskaIndex, mux->index,
             mux->num_indexes + 32);
@@ -3583,6 +3785,12 @@ gst_matroska_mux_set_property (GObject * object,
     case ARG_STREAMABLE:
       mux->streamable = g_value_get_boolean (value);
       break;
+    case ARG_MAX_CUES_ENTRIES:
+      mux->max_cues_entries = g_value_get_uint (value);
+      break;
+    case ARG_CUES_UPDATE_INTERVAL:
+      mux->cues_update_interval = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3611,6 +3819,12 @@ gst_matroska_mux_get_property (GObject * object,
     case ARG_STREAMABLE:
       g_value_set_boolean (value, mux->streamable);
       break;
+    case ARG_MAX_CUES_ENTRIES:
+      g_value_set_uint (value, mux->max_cues_entries);
+      break;
+    case ARG_CUES_UPDATE_INTERVAL:
+      g_value_set_uint64 (value, mux->cues_update_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
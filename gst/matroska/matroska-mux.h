@@ -100,6 +100,17 @@ typedef struct _GstMatroskaMux {
   guint          num_indexes;
   GstClockTimeDiff min_index_interval;
   gboolean       streamable;
+  guint          max_cues_entries;
+  GstClockTime   cues_update_interval;
+
+  /* current minimum time between index entries, grows when the
+   * index has to be thinned to stay within max_cues_entries */
+  GstClockTimeDiff index_interval;
+
+  /* space reserved for the Cues after the SeekHead, if any */
+  guint64        cues_reserved_pos,
+                 cues_reserved_size;
+  GstClockTime   cues_last_update;
  
   /* timescale in the file */
   guint64        time_scale;
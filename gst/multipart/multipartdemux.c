@@ -471,28 +471,49 @@ eos:
   }
 }
 
+/* compares @len bytes of the adapter at @offset with @str without mapping the
+ * adapter, which would merge its buffers */
+static gboolean
+multipart_match (GstAdapter * adapter, gsize offset, const gchar * str,
+    gsize len)
+{
+  guint8 tmp[64];
+
+  while (len > 0) {
+    gsize n = MIN (len, sizeof (tmp));
+
+    gst_adapter_copy (adapter, tmp, offset, n);
+    if (memcmp (tmp, str, n))
+      return FALSE;
+    offset += n;
+    str += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
 static gint
 multipart_find_boundary (GstMultipartDemux * multipart, gint * datalen)
 {
   /* Adaptor is positioned at the start of the data */
-  const guint8 *data, *pos;
-  const guint8 *dataend;
-  gint len;
+  GstAdapter *adapter = multipart->adapter;
+  guint8 nl[2] = { 0, 0 };
+  guint32 pattern, mask;
+  gint len, blen, off, i;
 
   if (multipart->content_length >= 0) {
     /* fast path, known content length :) */
     len = multipart->content_length;
-    if (gst_adapter_available (multipart->adapter) >= len + 2) {
+    if (gst_adapter_available (adapter) >= len + 2) {
       *datalen = len;
-      data = gst_adapter_map (multipart->adapter, len + 1);
+      gst_adapter_copy (adapter, nl, len, 1);
 
       /* If data[len] contains \r then assume a newline is \r\n */
-      if (data[len] == '\r')
+      if (nl[0] == '\r')
         len += 2;
-      else if (data[len] == '\n')
+      else if (nl[0] == '\n')
         len += 1;
 
-      gst_adapter_unmap (multipart->adapter);
       /* Don't check if boundary is actually there, but let the header parsing
        * bail out if it isn't */
       return len;
@@ -502,35 +523,103 @@ multipart_find_boundary (GstMultipartDemux * multipart, gint * datalen)
     }
   }
 
-  len = gst_adapter_available (multipart->adapter);
-  if (len == 0)
+  len = gst_adapter_available (adapter);
+  /* the boundary with its leading "--" */
+  blen = multipart->boundary_len + 2;
+  if (len < MAX (blen, 4) || multipart->scanpos > len - 4)
     return MULTIPART_NEED_MORE_DATA;
-  data = gst_adapter_map (multipart->adapter, len);
-  dataend = data + len;
-
-  for (pos = data + multipart->scanpos;
-      pos <= dataend - multipart->boundary_len - 2; pos++) {
-    if (*pos == '-' && pos[1] == '-' &&
-        !strncmp ((gchar *) pos + 2,
-            multipart->boundary, multipart->boundary_len)) {
+
+  /* scan for "--" and the start of the boundary, scanpos remembers where the
+   * previous call stopped so that every byte is only looked at once */
+  pattern = mask = 0;
+  for (i = 0; i < 4; i++) {
+    pattern <<= 8;
+    mask <<= 8;
+    if (i < blen) {
+      pattern |= (i < 2 ? '-' : (guint8) multipart->boundary[i - 2]);
+      mask |= 0xff;
+    }
+  }
+
+  while (multipart->scanpos <= len - 4) {
+    off = gst_adapter_masked_scan_uint32_peek (adapter, mask, pattern,
+        multipart->scanpos, len - multipart->scanpos, NULL);
+    if (off < 0) {
+      /* the last 3 bytes could still be the start of the boundary */
+      multipart->scanpos = len - 3;
+      break;
+    }
+    if (off + blen > len) {
+      /* check the rest of the boundary when we have it */
+      multipart->scanpos = off;
+      break;
+    }
+    if (multipart_match (adapter, off + 2, multipart->boundary,
+            multipart->boundary_len)) {
       /* Found the boundary! Check if there was a newline before the boundary */
-      len = pos - data;
-      if (pos - 2 > data && pos[-2] == '\r')
-        len -= 2;
-      else if (pos - 1 > data && pos[-1] == '\n')
-        len -= 1;
+      len = off;
+      if (off > 2) {
+        gst_adapter_copy (adapter, nl, off - 2, 2);
+        if (nl[0] == '\r')
+          len -= 2;
+        else if (nl[1] == '\n')
+          len -= 1;
+      } else if (off > 1) {
+        gst_adapter_copy (adapter, nl + 1, off - 1, 1);
+        if (nl[1] == '\n')
+          len -= 1;
+      }
       *datalen = len;
 
-      gst_adapter_unmap (multipart->adapter);
       multipart->scanpos = 0;
-      return pos - data;
+      return off;
     }
+    multipart->scanpos = off + 1;
   }
-  gst_adapter_unmap (multipart->adapter);
-  multipart->scanpos = pos - data;
   return MULTIPART_NEED_MORE_DATA;
 }
 
+/* a GstBuffer merges its memory blocks when it gets more than this many */
+#define MULTIPART_MAX_MEMORIES 16
+
+/* takes @len bytes from the adapter as one buffer that shares the memory of
+ * the input buffers instead of copying it. When the part consists of too
+ * many input buffers, it is copied into one buffer at once instead of being
+ * merged over and over while appending. */
+static GstBuffer *
+multipart_take_buffer (GstAdapter * adapter, gsize len)
+{
+  GstBuffer *outbuf = NULL;
+  GList *list, *walk;
+  GstMapInfo map;
+  gsize offset = 0;
+
+  list = gst_adapter_take_list (adapter, len);
+  if (g_list_length (list) > MULTIPART_MAX_MEMORIES) {
+    outbuf = gst_buffer_new_allocate (NULL, len, NULL);
+    gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+    for (walk = list; walk; walk = g_list_next (walk)) {
+      GstBuffer *buf = walk->data;
+
+      offset += gst_buffer_extract (buf, 0, map.data + offset, len - offset);
+      gst_buffer_unref (buf);
+    }
+    gst_buffer_unmap (outbuf, &map);
+  } else {
+    for (walk = list; walk; walk = g_list_next (walk)) {
+      GstBuffer *buf = walk->data;
+
+      if (outbuf == NULL)
+        outbuf = buf;
+      else
+        outbuf = gst_buffer_append (outbuf, buf);
+    }
+  }
+  g_list_free (list);
+
+  return outbuf;
+}
+
 static GstFlowReturn
 gst_multipart_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -549,6 +638,7 @@ gst_multipart_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DISCONT)) {
     gst_adapter_clear (adapter);
+    multipart->scanpos = 0;
   }
   gst_adapter_push (adapter, buf);
 
@@ -581,7 +671,7 @@ gst_multipart_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       srcpad =
           gst_multipart_find_pad_by_mime (multipart,
           multipart->mime_type, &created);
-      outbuf = gst_adapter_take_buffer (adapter, datalen);
+      outbuf = multipart_take_buffer (adapter, datalen);
       gst_adapter_flush (adapter, size - datalen);
 
       if (created) {
@@ -643,6 +733,7 @@ gst_multipart_demux_change_state (GstElement * element,
       g_free (multipart->mime_type);
       multipart->mime_type = NULL;
       gst_adapter_clear (multipart->adapter);
+      multipart->scanpos = 0;
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
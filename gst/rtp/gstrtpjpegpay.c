@@ -27,7 +27,10 @@
  *
  * The payloader takes a JPEG picture, scans the header for quantization
  * tables (if needed) and constructs the RTP packet header followed by
- * the actual JPEG entropy scan.
+ * the actual JPEG entropy scan. The header is only parsed again when it differs
+ * from the one of the previous picture. Quantization tables that are scaled
+ * versions of the tables in RFC 2435 appendix A are signalled with their Q
+ * value instead of being sent with every picture.
  *
  * The payloader assumes that correct width and height is found in the caps.
  */
@@ -233,8 +236,50 @@ typedef struct
   guint8 qt;
 } CompInfo;
 
+/* zigzag order of the quantizers in the tables */
+static const int zigzag[] = {
+  0, 1, 8, 16, 9, 2, 3, 10,
+  17, 24, 32, 25, 18, 11, 4, 5,
+  12, 19, 26, 33, 40, 48, 41, 34,
+  27, 20, 13, 6, 7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36,
+  29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46,
+  53, 60, 61, 54, 47, 55, 62, 63
+};
+
+/*
+ * Table K.1 from JPEG spec.
+ */
+static const int jpeg_luma_quantizer[64] = {
+  16, 11, 10, 16, 24, 40, 51, 61,
+  12, 12, 14, 19, 26, 58, 60, 55,
+  14, 13, 16, 24, 40, 57, 69, 56,
+  14, 17, 22, 29, 51, 87, 80, 62,
+  18, 22, 37, 56, 68, 109, 103, 77,
+  24, 35, 55, 64, 81, 104, 113, 92,
+  49, 64, 78, 87, 103, 121, 120, 101,
+  72, 92, 95, 98, 112, 100, 103, 99
+};
+
+/*
+ * Table K.2 from JPEG spec.
+ */
+static const int jpeg_chroma_quantizer[64] = {
+  17, 18, 24, 47, 99, 99, 99, 99,
+  18, 21, 26, 66, 99, 99, 99, 99,
+  24, 26, 56, 99, 99, 99, 99, 99,
+  47, 66, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99
+};
+
 /* FIXME: restart marker header currently unsupported */
 
+static void gst_rtp_jpeg_pay_finalize (GObject * object);
+
 static void gst_rtp_jpeg_pay_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 
@@ -247,6 +292,8 @@ static gboolean gst_rtp_jpeg_pay_setcaps (GstRTPBasePayload * basepayload,
 static GstFlowReturn gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * pad,
     GstBuffer * buffer);
 
+static void gst_rtp_jpeg_pay_clear_header (GstRtpJPEGPay * pay);
+
 #define gst_rtp_jpeg_pay_parent_class parent_class
 G_DEFINE_TYPE (GstRtpJPEGPay, gst_rtp_jpeg_pay, GST_TYPE_RTP_BASE_PAYLOAD);
 
@@ -261,6 +308,7 @@ gst_rtp_jpeg_pay_class_init (GstRtpJPEGPayClass * klass)
   gstelement_class = (GstElementClass *) klass;
   gstrtpbasepayload_class = (GstRTPBasePayloadClass *) klass;
 
+  gobject_class->finalize = gst_rtp_jpeg_pay_finalize;
   gobject_class->set_property = gst_rtp_jpeg_pay_set_property;
   gobject_class->get_property = gst_rtp_jpeg_pay_get_property;
 
@@ -301,6 +349,18 @@ gst_rtp_jpeg_pay_init (GstRtpJPEGPay * pay)
   pay->height = -1;
 }
 
+static void
+gst_rtp_jpeg_pay_finalize (GObject * object)
+{
+  GstRtpJPEGPay *pay;
+
+  pay = GST_RTP_JPEG_PAY (object);
+
+  gst_rtp_jpeg_pay_clear_header (pay);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gst_rtp_jpeg_pay_setcaps (GstRTPBasePayload * basepayload, GstCaps * caps)
 {
@@ -337,6 +397,9 @@ gst_rtp_jpeg_pay_setcaps (GstRTPBasePayload * basepayload, GstCaps * caps)
     pay->width = GST_ROUND_UP_8 (width) / 8;
   }
 
+  /* the cached RTP headers contain the old dimensions */
+  gst_rtp_jpeg_pay_clear_header (pay);
+
   gst_rtp_base_payload_set_options (basepayload, "video", TRUE, "JPEG", 90000);
 
   if (num > 0) {
@@ -650,44 +713,72 @@ gst_rtp_jpeg_pay_scan_marker (const guint8 * data, guint size, guint * offset)
   }
 }
 
+/* find the Q in the range 1-99 that makes the tables of RFC 2435 appendix A
+ * match @luma and @chroma so that they don't need to be sent in-band.
+ * Returns 0 when there is no such Q */
+static guint8
+gst_rtp_jpeg_pay_find_q (const RtpQuantTable * luma,
+    const RtpQuantTable * chroma)
+{
+  gint q, i;
+
+  /* the standard tables only have 8 bit quantizers */
+  if (luma->size != 64 || chroma->size != 64)
+    return 0;
+
+  for (q = 1; q < 100; q++) {
+    gint factor = (q < 50 ? 5000 / q : 200 - q * 2);
+
+    for (i = 0; i < 64; i++) {
+      gint lq = (jpeg_luma_quantizer[zigzag[i]] * factor + 50) / 100;
+      gint cq = (jpeg_chroma_quantizer[zigzag[i]] * factor + 50) / 100;
+
+      if (luma->data[i] != CLAMP (lq, 1, 255) ||
+          chroma->data[i] != CLAMP (cq, 1, 255))
+        break;
+    }
+    if (i == 64)
+      return q;
+  }
+  return 0;
+}
+
+static void
+gst_rtp_jpeg_pay_clear_header (GstRtpJPEGPay * pay)
+{
+  g_free (pay->header);
+  pay->header = NULL;
+  pay->header_size = 0;
+  g_free (pay->rtp_header);
+  pay->rtp_header = NULL;
+  pay->rtp_header_size = 0;
+  pay->quant_data_size = 0;
+}
+
+/* parse the JPEG header in @data and make the RTP payload headers for it. The
+ * result is kept in @pay and reused for the next frames with the same JPEG
+ * header */
 static GstFlowReturn
-gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
-    GstBuffer * buffer)
+gst_rtp_jpeg_pay_parse_header (GstRtpJPEGPay * pay, const guint8 * data,
+    guint size)
 {
-  GstRtpJPEGPay *pay;
-  GstClockTime timestamp;
-  GstFlowReturn ret = GST_FLOW_ERROR;
   RtpJpegHeader jpeg_header;
   RtpQuantHeader quant_header;
   RtpRestartMarkerHeader restart_marker_header;
   RtpQuantTable tables[15] = { {0, NULL}, };
   CompInfo info[3] = { {0,}, };
   guint quant_data_size;
-  GstMapInfo map;
-  guint8 *data;
-  gsize size;
-  guint mtu;
-  guint bytes_left;
   guint jpeg_header_size = 0;
   guint offset;
-  gboolean frame_done;
   gboolean sos_found, sof_found, dqt_found, dri_found;
+  guint8 *payload;
+  guint8 q;
   gint i;
-  GstBufferList *list = NULL;
 
-  pay = GST_RTP_JPEG_PAY (basepayload);
-  mtu = GST_RTP_BASE_PAYLOAD_MTU (pay);
+  gst_rtp_jpeg_pay_clear_header (pay);
 
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  data = map.data;
-  size = map.size;
-  timestamp = GST_BUFFER_TIMESTAMP (buffer);
+  /* parse the jpeg header for 'start of scan' and read quant tables */
   offset = 0;
-
-  GST_LOG_OBJECT (pay, "got buffer size %" G_GSIZE_FORMAT
-      " , timestamp %" GST_TIME_FORMAT, size, GST_TIME_ARGS (timestamp));
-
-  /* parse the jpeg header for 'start of scan' and read quant tables if needed */
   sos_found = FALSE;
   dqt_found = FALSE;
   sof_found = FALSE;
@@ -735,7 +826,7 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
         break;
     }
   }
-  if (!dqt_found || !sof_found)
+  if (!dqt_found || !sof_found || jpeg_header_size > size)
     goto unsupported_jpeg;
 
   /* by now we should either have negotiated the width/height or the SOF header
@@ -746,17 +837,36 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
   GST_LOG_OBJECT (pay, "header size %u", jpeg_header_size);
 
-  size -= jpeg_header_size;
-  data += jpeg_header_size;
-  offset = 0;
+  /* for the Y and U component, look up the quant table and its size. quant
+   * tables for U and V should be the same */
+  for (i = 0; i < 2; i++) {
+    guint qt;
+
+    qt = info[i].qt;
+    if (qt >= G_N_ELEMENTS (tables) || tables[qt].size == 0)
+      goto invalid_quant;
+  }
+
+  q = pay->quant;
+  if (q > 127) {
+    guint8 std_q;
+
+    /* only use the dynamic tables when they are not the standard ones */
+    std_q = gst_rtp_jpeg_pay_find_q (&tables[info[0].qt], &tables[info[1].qt]);
+    if (std_q > 0) {
+      GST_DEBUG_OBJECT (pay, "quant tables match Q %u", std_q);
+      q = std_q;
+    }
+  }
 
   if (dri_found)
     pay->type += 64;
 
   /* prepare stuff for the jpeg header */
   jpeg_header.type_spec = 0;
+  jpeg_header.offset = 0;
   jpeg_header.type = pay->type;
-  jpeg_header.q = pay->quant;
+  jpeg_header.q = q;
   jpeg_header.width = pay->width;
   jpeg_header.height = pay->height;
 
@@ -766,21 +876,11 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
   quant_header.length = 0;
   quant_data_size = 0;
 
-  if (pay->quant > 127) {
-    /* for the Y and U component, look up the quant table and its size. quant
-     * tables for U and V should be the same */
+  if (q > 127) {
     for (i = 0; i < 2; i++) {
       guint qsize;
-      guint qt;
-
-      qt = info[i].qt;
-      if (qt >= G_N_ELEMENTS (tables))
-        goto invalid_quant;
-
-      qsize = tables[qt].size;
-      if (qsize == 0)
-        goto invalid_quant;
 
+      qsize = tables[info[i].qt].size;
       quant_header.precision |= (qsize == 64 ? 0 : (1 << i));
       quant_data_size += qsize;
     }
@@ -790,27 +890,135 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
   GST_LOG_OBJECT (pay, "quant_data size %u", quant_data_size);
 
-  list = gst_buffer_list_new ();
+  pay->rtp_header_size = sizeof (jpeg_header);
+  if (dri_found)
+    pay->rtp_header_size += sizeof (restart_marker_header);
+  pay->quant_data_size = quant_data_size;
 
-  bytes_left = sizeof (jpeg_header) + quant_data_size + size;
+  pay->rtp_header = g_malloc (pay->rtp_header_size + quant_data_size);
+  payload = pay->rtp_header;
 
-  if (dri_found)
-    bytes_left += sizeof (restart_marker_header);
+  memcpy (payload, &jpeg_header, sizeof (jpeg_header));
+  payload += sizeof (jpeg_header);
+
+  if (dri_found) {
+    memcpy (payload, &restart_marker_header, sizeof (restart_marker_header));
+    payload += sizeof (restart_marker_header);
+  }
+
+  if (quant_data_size > 0) {
+    memcpy (payload, &quant_header, sizeof (quant_header));
+    payload += sizeof (quant_header);
+
+    /* copy the quant tables for luma and chrominance */
+    for (i = 0; i < 2; i++) {
+      guint qsize;
+      guint qt;
+
+      qt = info[i].qt;
+      qsize = tables[qt].size;
+      memcpy (payload, tables[qt].data, qsize);
+
+      GST_LOG_OBJECT (pay, "component %d using quant %d, size %d", i, qt,
+          qsize);
+
+      payload += qsize;
+    }
+  }
+
+  /* without a SOS there is nothing to compare the next frames with */
+  if (sos_found) {
+    pay->header = g_memdup (data, jpeg_header_size);
+    pay->header_size = jpeg_header_size;
+    pay->header_type = pay->type;
+  }
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+unsupported_jpeg:
+  {
+    GST_ELEMENT_ERROR (pay, STREAM, FORMAT, ("Unsupported JPEG"), (NULL));
+    return GST_FLOW_NOT_SUPPORTED;
+  }
+no_dimension:
+  {
+    GST_ELEMENT_ERROR (pay, STREAM, FORMAT, ("No size given"), (NULL));
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+invalid_format:
+  {
+    /* error was posted */
+    return GST_FLOW_ERROR;
+  }
+invalid_quant:
+  {
+    GST_ELEMENT_ERROR (pay, STREAM, FORMAT, ("Invalid quant tables"), (NULL));
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
+    GstBuffer * buffer)
+{
+  GstRtpJPEGPay *pay;
+  GstClockTime timestamp;
+  GstFlowReturn ret = GST_FLOW_ERROR;
+  GstMapInfo map;
+  gsize size;
+  guint mtu;
+  guint bytes_left;
+  guint jpeg_header_size;
+  guint header_size;
+  guint quant_data_size;
+  guint offset;
+  gboolean frame_done;
+  GstBufferList *list = NULL;
+
+  pay = GST_RTP_JPEG_PAY (basepayload);
+  mtu = GST_RTP_BASE_PAYLOAD_MTU (pay);
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  size = map.size;
+  timestamp = GST_BUFFER_TIMESTAMP (buffer);
+
+  GST_LOG_OBJECT (pay, "got buffer size %" G_GSIZE_FORMAT
+      " , timestamp %" GST_TIME_FORMAT, size, GST_TIME_ARGS (timestamp));
+
+  /* cameras usually send the same header for every frame, only parse it and
+   * make new RTP headers when it or the type property changed */
+  if (pay->header_size > 0 && size >= pay->header_size &&
+      pay->type == pay->header_type &&
+      memcmp (map.data, pay->header, pay->header_size) == 0) {
+    GST_LOG_OBJECT (pay, "reusing headers of previous frame");
+  } else {
+    ret = gst_rtp_jpeg_pay_parse_header (pay, map.data, size);
+    if (ret != GST_FLOW_OK)
+      goto parse_failed;
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  jpeg_header_size = pay->header_size;
+  header_size = pay->rtp_header_size;
+  quant_data_size = pay->quant_data_size;
+
+  size -= jpeg_header_size;
+  offset = 0;
+
+  list = gst_buffer_list_new ();
+
+  bytes_left = header_size + quant_data_size + size;
 
   frame_done = FALSE;
   do {
     GstBuffer *outbuf;
     guint8 *payload;
     guint payload_size = (bytes_left < mtu ? bytes_left : mtu);
-    guint header_size;
     GstBuffer *paybuf;
     GstRTPBuffer rtp = { NULL };
 
-    header_size = sizeof (jpeg_header) + quant_data_size;
-    if (dri_found)
-      header_size += sizeof (restart_marker_header);
-
-    outbuf = gst_rtp_buffer_new_allocate (header_size, 0, 0);
+    outbuf = gst_rtp_buffer_new_allocate (header_size + quant_data_size, 0, 0);
 
     gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
 
@@ -822,46 +1030,17 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
     payload = gst_rtp_buffer_get_payload (&rtp);
 
-    /* update offset */
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-    jpeg_header.offset = ((offset & 0x0000FF) << 16) |
-        ((offset & 0xFF0000) >> 16) | (offset & 0x00FF00);
-#else
-    jpeg_header.offset = offset;
-#endif
-    memcpy (payload, &jpeg_header, sizeof (jpeg_header));
-    payload += sizeof (jpeg_header);
-    payload_size -= sizeof (jpeg_header);
-
-    if (dri_found) {
-      memcpy (payload, &restart_marker_header, sizeof (restart_marker_header));
-      payload += sizeof (restart_marker_header);
-      payload_size -= sizeof (restart_marker_header);
-    }
-
-    /* only send quant table with first packet */
-    if (G_UNLIKELY (quant_data_size > 0)) {
-      memcpy (payload, &quant_header, sizeof (quant_header));
-      payload += sizeof (quant_header);
+    /* the cached headers, quant tables are only sent with the first packet */
+    memcpy (payload, pay->rtp_header, header_size + quant_data_size);
 
-      /* copy the quant tables for luma and chrominance */
-      for (i = 0; i < 2; i++) {
-        guint qsize;
-        guint qt;
+    /* update the 24 bits fragment offset */
+    GST_WRITE_UINT8 (payload + 1, offset >> 16);
+    GST_WRITE_UINT16_BE (payload + 2, offset & 0xFFFF);
 
-        qt = info[i].qt;
-        qsize = tables[qt].size;
-        memcpy (payload, tables[qt].data, qsize);
+    payload_size -= header_size + quant_data_size;
+    bytes_left -= quant_data_size;
+    quant_data_size = 0;
 
-        GST_LOG_OBJECT (pay, "component %d using quant %d, size %d", i, qt,
-            qsize);
-
-        payload += qsize;
-      }
-      payload_size -= quant_data_size;
-      bytes_left -= quant_data_size;
-      quant_data_size = 0;
-    }
     GST_LOG_OBJECT (pay, "sending payload size %d", payload_size);
     gst_rtp_buffer_unmap (&rtp);
 
@@ -879,46 +1058,22 @@ gst_rtp_jpeg_pay_handle_buffer (GstRTPBasePayload * basepayload,
 
     bytes_left -= payload_size;
     offset += payload_size;
-    data += payload_size;
   }
   while (!frame_done);
 
   /* push the whole buffer list at once */
   ret = gst_rtp_base_payload_push_list (basepayload, list);
 
-  gst_buffer_unmap (buffer, &map);
   gst_buffer_unref (buffer);
 
   return ret;
 
   /* ERRORS */
-unsupported_jpeg:
+parse_failed:
   {
-    GST_ELEMENT_ERROR (pay, STREAM, FORMAT, ("Unsupported JPEG"), (NULL));
     gst_buffer_unmap (buffer, &map);
     gst_buffer_unref (buffer);
-    return GST_FLOW_NOT_SUPPORTED;
-  }
-no_dimension:
-  {
-    GST_ELEMENT_ERROR (pay, STREAM, FORMAT, ("No size given"), (NULL));
-    gst_buffer_unmap (buffer, &map);
-    gst_buffer_unref (buffer);
-    return GST_FLOW_NOT_NEGOTIATED;
-  }
-invalid_format:
-  {
-    /* error was posted */
-    gst_buffer_unmap (buffer, &map);
-    gst_buffer_unref (buffer);
-    return GST_FLOW_ERROR;
-  }
-invalid_quant:
-  {
-    GST_ELEMENT_ERROR (pay, STREAM, FORMAT, ("Invalid quant tables"), (NULL));
-    gst_buffer_unmap (buffer, &map);
-    gst_buffer_unref (buffer);
-    return GST_FLOW_ERROR;
+    return ret;
   }
 }
 
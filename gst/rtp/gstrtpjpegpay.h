@@ -48,6 +48,16 @@ struct _GstRtpJPEGPay
   gint width;
 
   guint8 quant;
+
+  /* JPEG header of the last frame and the RTP payload headers made from it,
+   * the quant tables follow the rtp_header_size bytes of main and restart
+   * marker header. header_type is the type they were made with */
+  guint8 *header;
+  guint header_size;
+  guint8 header_type;
+  guint8 *rtp_header;
+  guint rtp_header_size;
+  guint quant_data_size;
 };
 
 struct _GstRtpJPEGPayClass
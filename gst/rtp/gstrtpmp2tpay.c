@@ -45,12 +45,24 @@ GST_STATIC_PAD_TEMPLATE ("src",
         "clock-rate = (int) 90000, " "encoding-name = (string) \"MP2T\"")
     );
 
+#define DEFAULT_ALIGN FALSE
+
+enum
+{
+  PROP_0,
+  PROP_ALIGN
+};
+
 static gboolean gst_rtp_mp2t_pay_setcaps (GstRTPBasePayload * payload,
     GstCaps * caps);
 static GstFlowReturn gst_rtp_mp2t_pay_handle_buffer (GstRTPBasePayload *
     payload, GstBuffer * buffer);
 static GstFlowReturn gst_rtp_mp2t_pay_flush (GstRTPMP2TPay * rtpmp2tpay);
 static void gst_rtp_mp2t_pay_finalize (GObject * object);
+static void gst_rtp_mp2t_pay_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_rtp_mp2t_pay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 #define gst_rtp_mp2t_pay_parent_class parent_class
 G_DEFINE_TYPE (GstRTPMP2TPay, gst_rtp_mp2t_pay, GST_TYPE_RTP_BASE_PAYLOAD);
@@ -67,6 +79,22 @@ gst_rtp_mp2t_pay_class_init (GstRTPMP2TPayClass * klass)
   gstrtpbasepayload_class = (GstRTPBasePayloadClass *) klass;
 
   gobject_class->finalize = gst_rtp_mp2t_pay_finalize;
+  gobject_class->set_property = gst_rtp_mp2t_pay_set_property;
+  gobject_class->get_property = gst_rtp_mp2t_pay_get_property;
+
+  /**
+   * GstRTPMP2TPay:align:
+   *
+   * Start a new RTP packet at every TS packet that starts a PES packet or
+   * carries a PCR, so that receivers can resume decoding and clock recovery
+   * from the first TS packet after a lost RTP packet.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_ALIGN,
+      g_param_spec_boolean ("align", "Align",
+          "Start a new packet at PES packet starts and PCRs", DEFAULT_ALIGN,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstrtpbasepayload_class->set_caps = gst_rtp_mp2t_pay_setcaps;
   gstrtpbasepayload_class->handle_buffer = gst_rtp_mp2t_pay_handle_buffer;
@@ -88,6 +116,7 @@ gst_rtp_mp2t_pay_init (GstRTPMP2TPay * rtpmp2tpay)
   GST_RTP_BASE_PAYLOAD_PT (rtpmp2tpay) = GST_RTP_PAYLOAD_MP2T;
 
   rtpmp2tpay->adapter = gst_adapter_new ();
+  rtpmp2tpay->align = DEFAULT_ALIGN;
 }
 
 static void
@@ -114,23 +143,50 @@ gst_rtp_mp2t_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
   return res;
 }
 
+/* check if the TS packet at @offset in the adapter starts a PES packet or
+ * carries a PCR */
+static gboolean
+gst_rtp_mp2t_pay_is_boundary (GstRTPMP2TPay * rtpmp2tpay, guint offset)
+{
+  guint8 header[6];
+
+  gst_adapter_copy (rtpmp2tpay->adapter, header, offset, 6);
+
+  /* not in sync, don't split */
+  if (header[0] != 0x47)
+    return FALSE;
+
+  /* payload_unit_start_indicator */
+  if (header[1] & 0x40)
+    return TRUE;
+
+  /* adaptation field with the PCR_flag set */
+  if ((header[3] & 0x20) && header[4] > 0 && (header[5] & 0x10))
+    return TRUE;
+
+  return FALSE;
+}
+
+/* make packets of all complete TS packets in the adapter and push them in
+ * one list. All of them get the timestamp of the first TS packet. */
 static GstFlowReturn
 gst_rtp_mp2t_pay_flush (GstRTPMP2TPay * rtpmp2tpay)
 {
   guint avail, mtu;
-  GstFlowReturn ret = GST_FLOW_OK;
   GstBuffer *outbuf;
+  GstBufferList *list;
+
+  list = gst_buffer_list_new ();
 
   avail = gst_adapter_available (rtpmp2tpay->adapter);
 
   mtu = GST_RTP_BASE_PAYLOAD_MTU (rtpmp2tpay);
 
-  while (avail > 0 && (ret == GST_FLOW_OK)) {
+  while (avail > 0) {
     guint towrite;
-    guint8 *payload;
     guint payload_len;
     guint packet_len;
-    GstRTPBuffer rtp = { NULL };
+    GList *packets, *walk;
 
     /* this will be the total length of the packet */
     packet_len = gst_rtp_buffer_calc_packet_len (avail, 0, 0);
@@ -146,29 +202,44 @@ gst_rtp_mp2t_pay_flush (GstRTPMP2TPay * rtpmp2tpay)
     if (!payload_len)
       break;
 
-    /* create buffer to hold the payload */
-    outbuf = gst_rtp_buffer_new_allocate (payload_len, 0, 0);
-
-    /* get payload */
-    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
-    payload = gst_rtp_buffer_get_payload (&rtp);
-
-    /* copy stuff from adapter to payload */
-    gst_adapter_copy (rtpmp2tpay->adapter, payload, 0, payload_len);
-    gst_rtp_buffer_unmap (&rtp);
-    gst_adapter_flush (rtpmp2tpay->adapter, payload_len);
+    /* end the packet before the next PES start or PCR */
+    if (rtpmp2tpay->align) {
+      guint offset;
+
+      for (offset = 188; offset < payload_len; offset += 188) {
+        if (gst_rtp_mp2t_pay_is_boundary (rtpmp2tpay, offset)) {
+          payload_len = offset;
+          break;
+        }
+      }
+    }
+
+    /* the RTP header gets its own memory, the payload is made of the memory
+     * of the TS buffers we received */
+    outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+
+    packets = gst_adapter_take_list (rtpmp2tpay->adapter, payload_len);
+    for (walk = packets; walk; walk = g_list_next (walk))
+      outbuf = gst_buffer_append (outbuf, walk->data);
+    g_list_free (packets);
     avail -= payload_len;
 
     GST_BUFFER_TIMESTAMP (outbuf) = rtpmp2tpay->first_ts;
     GST_BUFFER_DURATION (outbuf) = rtpmp2tpay->duration;
 
-    GST_DEBUG_OBJECT (rtpmp2tpay, "pushing buffer of size %u",
+    GST_DEBUG_OBJECT (rtpmp2tpay, "adding buffer of size %u",
         (guint) gst_buffer_get_size (outbuf));
 
-    ret = gst_rtp_base_payload_push (GST_RTP_BASE_PAYLOAD (rtpmp2tpay), outbuf);
+    gst_buffer_list_add (list, outbuf);
   }
 
-  return ret;
+  if (gst_buffer_list_length (list) == 0) {
+    gst_buffer_list_unref (list);
+    return GST_FLOW_OK;
+  }
+
+  return gst_rtp_base_payload_push_list (GST_RTP_BASE_PAYLOAD (rtpmp2tpay),
+      list);
 }
 
 static GstFlowReturn
@@ -178,7 +249,7 @@ gst_rtp_mp2t_pay_handle_buffer (GstRTPBasePayload * basepayload,
   GstRTPMP2TPay *rtpmp2tpay;
   guint size, avail, packet_len;
   GstClockTime timestamp, duration;
-  GstFlowReturn ret;
+  GstFlowReturn ret = GST_FLOW_OK;
 
   rtpmp2tpay = GST_RTP_MP2T_PAY (basepayload);
 
@@ -187,7 +258,6 @@ gst_rtp_mp2t_pay_handle_buffer (GstRTPBasePayload * basepayload,
   duration = GST_BUFFER_DURATION (buffer);
 
 again:
-  ret = GST_FLOW_OK;
   avail = gst_adapter_available (rtpmp2tpay->adapter);
 
   /* Initialize new RTP payload */
@@ -219,7 +289,7 @@ again:
     buffer = NULL;
   }
 
-  if (size >= (188 * 2)) {
+  if (size >= (188 * 2) && ret == GST_FLOW_OK) {
     size = 0;
     goto again;
   }
@@ -228,6 +298,42 @@ again:
 
 }
 
+static void
+gst_rtp_mp2t_pay_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRTPMP2TPay *rtpmp2tpay;
+
+  rtpmp2tpay = GST_RTP_MP2T_PAY (object);
+
+  switch (prop_id) {
+    case PROP_ALIGN:
+      rtpmp2tpay->align = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_mp2t_pay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRTPMP2TPay *rtpmp2tpay;
+
+  rtpmp2tpay = GST_RTP_MP2T_PAY (object);
+
+  switch (prop_id) {
+    case PROP_ALIGN:
+      g_value_set_boolean (value, rtpmp2tpay->align);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 gboolean
 gst_rtp_mp2t_pay_plugin_init (GstPlugin * plugin)
 {
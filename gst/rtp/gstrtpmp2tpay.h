@@ -48,6 +48,8 @@ struct _GstRTPMP2TPay
   GstAdapter  *adapter;
   GstClockTime first_ts;
   GstClockTime duration;
+
+  gboolean     align;
 };
 
 struct _GstRTPMP2TPayClass
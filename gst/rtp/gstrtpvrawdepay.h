@@ -49,7 +49,9 @@ struct _GstRtpVRawDepay
   GstBufferPool *pool;
   GstVideoInfo vinfo;
 
+  /* the frame we are filling, mapped as long as we have it */
   GstBuffer *outbuf;
+  GstVideoFrame frame;
   guint32 timestamp;
   guint outsize;
 
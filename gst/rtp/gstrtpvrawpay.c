@@ -21,8 +21,6 @@
 #  include "config.h"
 #endif
 
-#include <string.h>
-
 #include <gst/rtp/gstrtpbuffer.h>
 
 #include "gstrtpvrawpay.h"
@@ -152,6 +150,7 @@ gst_rtp_vraw_pay_setcaps (GstRTPBasePayload * payload, GstCaps * caps)
     case GST_VIDEO_FORMAT_RGB:
       samplingstr = "RGB";
       pgroup = 3;
+      break;
     case GST_VIDEO_FORMAT_BGR:
       samplingstr = "BGR";
       pgroup = 3;
@@ -247,6 +246,10 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   gint field;
   GstVideoFrame frame;
   gint interlaced;
+  gboolean packed;
+  gsize poffset;
+  guint linelen;
+  GstBufferList *list;
   GstRTPBuffer rtp = { NULL, };
 
   rtpvrawpay = GST_RTP_VRAW_PAY (payload);
@@ -273,22 +276,55 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 
   interlaced = GST_VIDEO_INFO_IS_INTERLACED (&rtpvrawpay->vinfo);
 
+  /* packed formats are sent in the same layout as we have them in memory, the
+   * packets refer to the lines of the input buffer instead of copying them */
+  switch (GST_VIDEO_INFO_FORMAT (&rtpvrawpay->vinfo)) {
+    case GST_VIDEO_FORMAT_RGB:
+    case GST_VIDEO_FORMAT_RGBA:
+    case GST_VIDEO_FORMAT_BGR:
+    case GST_VIDEO_FORMAT_BGRA:
+    case GST_VIDEO_FORMAT_UYVY:
+      packed = TRUE;
+      break;
+    default:
+      packed = FALSE;
+      break;
+  }
+  poffset = GST_VIDEO_FRAME_PLANE_OFFSET (&frame, 0);
+  linelen = (width * pgroup) / rtpvrawpay->xinc;
+
   /* start with line 0, offset 0 */
   for (field = 0; field < 1 + interlaced; field++) {
     line = field;
     offset = 0;
 
+    /* all packets of a field are pushed in one list, the fields have their
+     * own timestamp */
+    list = gst_buffer_list_new ();
+
     /* write all lines */
     while (line < height) {
-      guint left;
-      GstBuffer *out;
+      guint left, maxhdrs, nhdrs;
+      GstBuffer *out, *paybuf = NULL;
       guint8 *outdata, *headers;
       gboolean next_line;
       guint length, cont, pixels;
 
       /* get the max allowed payload length size, we try to fill the complete MTU */
       left = gst_rtp_buffer_calc_payload_len (mtu, 0, 0);
-      out = gst_rtp_buffer_new_allocate (left, 0, 0);
+
+      /* every segment but the first and the last one is a complete line */
+      maxhdrs = MIN (left / (6 + pgroup), 2 + left / (6 + linelen));
+      nhdrs = 0;
+
+      if (packed) {
+        /* only allocate the headers, the data is added as memory of the
+         * input buffer */
+        out = gst_rtp_buffer_new_allocate (2 + 6 * maxhdrs, 0, 0);
+        paybuf = gst_buffer_new ();
+      } else {
+        out = gst_rtp_buffer_new_allocate (left, 0, 0);
+      }
 
       if (field == 0) {
         GST_BUFFER_TIMESTAMP (out) = GST_BUFFER_TIMESTAMP (buffer);
@@ -333,6 +369,7 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
       while (left > (6 + pgroup)) {
         /* we need a 6 bytes header */
         left -= 6;
+        nhdrs++;
 
         /* get how may bytes we need for the remaining pixels */
         pixels = width - offset;
@@ -366,7 +403,8 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
         }
 
         /* calculate continuation marker */
-        cont = (left > (6 + pgroup) && line < height) ? 0x80 : 0x00;
+        cont = (left > (6 + pgroup) && line < height &&
+            nhdrs < maxhdrs) ? 0x80 : 0x00;
 
         /* write offset and continuation marker */
         *outdata++ = ((offset >> 8) & 0x7f) | cont;
@@ -410,8 +448,9 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
           case GST_VIDEO_FORMAT_BGRA:
           case GST_VIDEO_FORMAT_UYVY:
             offs /= rtpvrawpay->xinc;
-            memcpy (outdata, yp + (lin * ystride) + (offs * pgroup), length);
-            outdata += length;
+            paybuf = gst_buffer_append (paybuf,
+                gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+                    poffset + (lin * ystride) + (offs * pgroup), length));
             break;
           case GST_VIDEO_FORMAT_AYUV:
           {
@@ -476,6 +515,8 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
           default:
             gst_rtp_buffer_unmap (&rtp);
             gst_buffer_unref (out);
+            if (paybuf)
+              gst_buffer_unref (paybuf);
             goto unknown_sampling;
         }
 
@@ -488,17 +529,28 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
         gst_rtp_buffer_set_marker (&rtp, TRUE);
       }
       gst_rtp_buffer_unmap (&rtp);
-      if (left > 0) {
+      if (packed) {
+        /* drop the unused headers and add the data after them */
+        gst_buffer_resize (out, 0,
+            gst_rtp_buffer_calc_packet_len (2 + 6 * nhdrs, 0, 0));
+        out = gst_buffer_append (out, paybuf);
+      } else if (left > 0) {
         GST_LOG_OBJECT (rtpvrawpay, "we have %u bytes left", left);
         gst_buffer_resize (out, 0, gst_buffer_get_size (out) - left);
       }
 
-      /* push buffer */
-      ret = gst_rtp_base_payload_push (payload, out);
+      gst_buffer_list_add (list, out);
     }
 
+    GST_LOG_OBJECT (rtpvrawpay, "pushing list of %u packets",
+        gst_buffer_list_length (list));
+
+    ret = gst_rtp_base_payload_push_list (payload, list);
+    if (ret != GST_FLOW_OK)
+      break;
   }
 
+  /* the packets keep the memory of the input buffer alive */
   gst_video_frame_unmap (&frame);
   gst_buffer_unref (buffer);
 
@@ -509,6 +561,7 @@ unknown_sampling:
   {
     GST_ELEMENT_ERROR (payload, STREAM, FORMAT,
         (NULL), ("unimplemented sampling"));
+    gst_buffer_list_unref (list);
     gst_video_frame_unmap (&frame);
     gst_buffer_unref (buffer);
     return GST_FLOW_NOT_SUPPORTED;
@@ -253,6 +253,8 @@ enum
 #define DEFAULT_USE_PIPELINE_CLOCK   FALSE
 #define DEFAULT_RTCP_SYNC            GST_RTP_BIN_RTCP_SYNC_ALWAYS
 #define DEFAULT_RTCP_SYNC_INTERVAL   0
+#define DEFAULT_SHARED_THREADS       FALSE
+#define DEFAULT_DO_RETRANSMISSION    FALSE
 
 enum
 {
@@ -268,6 +270,8 @@ enum
   PROP_AUTOREMOVE,
   PROP_BUFFER_MODE,
   PROP_USE_PIPELINE_CLOCK,
+  PROP_SHARED_THREADS,
+  PROP_DO_RETRANSMISSION,
   PROP_LAST
 };
 
@@ -1407,6 +1411,8 @@ create_stream (GstRtpBinSession * session, guint32 ssrc)
   g_object_set (buffer, "drop-on-latency", rtpbin->drop_on_latency, NULL);
   g_object_set (buffer, "do-lost", rtpbin->do_lost, NULL);
   g_object_set (buffer, "mode", rtpbin->buffer_mode, NULL);
+  g_object_set (buffer, "shared-threads", rtpbin->shared_threads, NULL);
+  g_object_set (buffer, "do-retransmission", rtpbin->do_retransmission, NULL);
 
   if (!rtpbin->ignore_pt)
     gst_bin_add (GST_BIN_CAST (rtpbin), demux);
@@ -1798,6 +1804,33 @@ gst_rtp_bin_class_init (GstRtpBinClass * klass)
       g_param_spec_enum ("buffer-mode", "Buffer Mode",
           "Control the buffering algorithm in use", RTP_TYPE_JITTER_BUFFER_MODE,
           DEFAULT_BUFFER_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstRtpBin::shared-threads:
+   *
+   * Let the jitterbuffers push out buffers from a pool of threads that is
+   * shared by the whole process instead of from one thread per stream.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_THREADS,
+      g_param_spec_boolean ("shared-threads", "Shared Threads",
+          "Push out buffers from threads shared with other jitterbuffers",
+          DEFAULT_SHARED_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstRtpBin::do-retransmission:
+   *
+   * Let the jitterbuffers request the retransmission of missing packets. The
+   * sessions send the requests as Generic NACK feedback for the payload types
+   * that have "rtcp-fb-nack" in their caps. Put rtprtxreceive in front of the
+   * recv_rtp_sink pads to receive the retransmissions of an rtprtxsend.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_DO_RETRANSMISSION,
+      g_param_spec_boolean ("do-retransmission", "Do Retransmission",
+          "Request the retransmission of missing packets",
+          DEFAULT_DO_RETRANSMISSION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   /**
    * GstRtpBin::ntp-sync:
    *
@@ -1889,6 +1922,8 @@ gst_rtp_bin_init (GstRtpBin * rtpbin)
   rtpbin->latency_ns = DEFAULT_LATENCY_MS * GST_MSECOND;
   rtpbin->drop_on_latency = DEFAULT_DROP_ON_LATENCY;
   rtpbin->do_lost = DEFAULT_DO_LOST;
+  rtpbin->shared_threads = DEFAULT_SHARED_THREADS;
+  rtpbin->do_retransmission = DEFAULT_DO_RETRANSMISSION;
   rtpbin->ignore_pt = DEFAULT_IGNORE_PT;
   rtpbin->ntp_sync = DEFAULT_NTP_SYNC;
   rtpbin->rtcp_sync = DEFAULT_RTCP_SYNC;
@@ -2046,6 +2081,20 @@ gst_rtp_bin_set_property (GObject * object, guint prop_id,
       /* propagate the property down to the jitterbuffer */
       gst_rtp_bin_propagate_property_to_jitterbuffer (rtpbin, "mode", value);
       break;
+    case PROP_SHARED_THREADS:
+      GST_RTP_BIN_LOCK (rtpbin);
+      rtpbin->shared_threads = g_value_get_boolean (value);
+      GST_RTP_BIN_UNLOCK (rtpbin);
+      gst_rtp_bin_propagate_property_to_jitterbuffer (rtpbin,
+          "shared-threads", value);
+      break;
+    case PROP_DO_RETRANSMISSION:
+      GST_RTP_BIN_LOCK (rtpbin);
+      rtpbin->do_retransmission = g_value_get_boolean (value);
+      GST_RTP_BIN_UNLOCK (rtpbin);
+      gst_rtp_bin_propagate_property_to_jitterbuffer (rtpbin,
+          "do-retransmission", value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2100,6 +2149,16 @@ gst_rtp_bin_get_property (GObject * object, guint prop_id,
     case PROP_USE_PIPELINE_CLOCK:
       g_value_set_boolean (value, rtpbin->use_pipeline_clock);
       break;
+    case PROP_SHARED_THREADS:
+      GST_RTP_BIN_LOCK (rtpbin);
+      g_value_set_boolean (value, rtpbin->shared_threads);
+      GST_RTP_BIN_UNLOCK (rtpbin);
+      break;
+    case PROP_DO_RETRANSMISSION:
+      GST_RTP_BIN_LOCK (rtpbin);
+      g_value_set_boolean (value, rtpbin->do_retransmission);
+      GST_RTP_BIN_UNLOCK (rtpbin);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
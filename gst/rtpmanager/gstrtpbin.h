@@ -56,6 +56,8 @@ struct _GstRtpBin {
   RTPJitterBufferMode buffer_mode;
   gboolean        buffering;
   gboolean        use_pipeline_clock;
+  gboolean        shared_threads;
+  gboolean        do_retransmission;
   GstClockTime    buffer_start;
   /* a list of session */
   GSList         *sessions;
@@ -65,6 +65,7 @@
 
 #include "gstrtpjitterbuffer.h"
 #include "rtpjitterbuffer.h"
+#include "rtpscheduler.h"
 #include "rtpstats.h"
 
 #include <gst/glib-compat-private.h>
@@ -89,6 +90,15 @@ enum
 #define DEFAULT_DO_LOST         FALSE
 #define DEFAULT_MODE            RTP_JITTER_BUFFER_MODE_SLAVE
 #define DEFAULT_PERCENT         0
+#define DEFAULT_SHARED_THREADS  FALSE
+#define DEFAULT_DO_RETRANSMISSION FALSE
+
+/* max number of buffers pushed in one run on the shared scheduler */
+#define SHARED_MAX_PUSH         16
+
+/* max number of packets of a gap we request a retransmission for, bigger gaps
+ * are a burst loss or a restart of the sender */
+#define MAX_RTX_REQUESTS        32
 
 enum
 {
@@ -99,6 +109,8 @@ enum
   PROP_DO_LOST,
   PROP_MODE,
   PROP_PERCENT,
+  PROP_SHARED_THREADS,
+  PROP_DO_RETRANSMISSION,
   PROP_LAST
 };
 
@@ -119,7 +131,11 @@ enum
     goto label;                                       \
 } G_STMT_END
 
-#define JBUF_SIGNAL(priv) (g_cond_signal (&(priv)->jbuf_cond))
+#define JBUF_SIGNAL(priv) G_STMT_START {                           \
+  g_cond_signal (&(priv)->jbuf_cond);                              \
+  if ((priv)->scheduler)                                           \
+    rtp_scheduler_wakeup ((priv)->scheduler, &(priv)->sched_entry); \
+} G_STMT_END
 
 struct _GstRtpJitterBufferPrivate
 {
@@ -140,6 +156,17 @@ struct _GstRtpJitterBufferPrivate
   gboolean drop_on_latency;
   gint64 ts_offset;
   gboolean do_lost;
+  gboolean shared_threads;
+  gboolean do_retransmission;
+
+  /* the scheduler when running on the shared threads instead of a task */
+  RTPScheduler *scheduler;
+  RTPSchedulerEntry sched_entry;
+  /* the loop gave its thread back */
+  gboolean yielded;
+  /* a timer is set for the NPT stop or a sync deadline */
+  gboolean npt_timer;
+  gboolean timer_pending;
 
   /* the last seqnum we pushed out */
   guint32 last_popped_seqnum;
@@ -149,6 +176,8 @@ struct _GstRtpJitterBufferPrivate
   GstClockTime last_out_time;
   /* the next expected seqnum we receive */
   guint32 next_in_seqnum;
+  /* retransmission requests to send upstream after releasing the lock */
+  GList *rtx_events;
 
   /* start and stop ranges */
   GstClockTime npt_start;
@@ -251,6 +280,8 @@ static gboolean gst_rtp_jitter_buffer_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
 static GstFlowReturn gst_rtp_jitter_buffer_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
+static GstFlowReturn gst_rtp_jitter_buffer_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 
 static gboolean gst_rtp_jitter_buffer_sink_rtcp_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
@@ -266,6 +297,8 @@ static gboolean gst_rtp_jitter_buffer_src_event (GstPad * pad,
 static gboolean gst_rtp_jitter_buffer_src_activate_mode (GstPad * pad,
     GstObject * parent, GstPadMode mode, gboolean active);
 static void gst_rtp_jitter_buffer_loop (GstRtpJitterBuffer * jitterbuffer);
+static void gst_rtp_jitter_buffer_shared_run (RTPSchedulerEntry * entry,
+    gboolean timeout, GstRtpJitterBuffer * jitterbuffer);
 static gboolean gst_rtp_jitter_buffer_src_query (GstPad * pad,
     GstObject * parent, GstQuery * query);
 
@@ -354,6 +387,37 @@ gst_rtp_jitter_buffer_class_init (GstRtpJitterBufferClass * klass)
       g_param_spec_int ("percent", "percent",
           "The buffer filled percent", 0, 100,
           0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstRtpJitterBuffer::shared-threads:
+   *
+   * Push out buffers from a small pool of threads that is shared by all
+   * jitterbuffers in the process instead of from a thread of our own. This
+   * scales better when receiving many streams. The pool has one thread per
+   * processor, the GST_RTP_SCHEDULER_THREADS environment variable overrides
+   * that. Changes take effect the next time the element is activated.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_THREADS,
+      g_param_spec_boolean ("shared-threads", "Shared Threads",
+          "Push out buffers from threads shared with other jitterbuffers",
+          DEFAULT_SHARED_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstRtpJitterBuffer::do-retransmission:
+   *
+   * Send an upstream GstRTPRetransmissionRequest event for every packet that
+   * is missing when a gap in the seqnums is detected. An #RTPSession
+   * upstream turns them into Generic NACK feedback for the sender, where
+   * rtprtxsend answers them with RFC 4588 retransmissions that rtprtxreceive
+   * turns back into the missing packets.
+   *
+   * Since: 1.2
+   */
+  g_object_class_install_property (gobject_class, PROP_DO_RETRANSMISSION,
+      g_param_spec_boolean ("do-retransmission", "Do Retransmission",
+          "Request the retransmission of missing packets",
+          DEFAULT_DO_RETRANSMISSION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   /**
    * GstRtpJitterBuffer::request-pt-map:
    * @buffer: the object which received the signal
@@ -464,10 +528,14 @@ gst_rtp_jitter_buffer_init (GstRtpJitterBuffer * jitterbuffer)
   priv->latency_ns = priv->latency_ms * GST_MSECOND;
   priv->drop_on_latency = DEFAULT_DROP_ON_LATENCY;
   priv->do_lost = DEFAULT_DO_LOST;
+  priv->shared_threads = DEFAULT_SHARED_THREADS;
+  priv->do_retransmission = DEFAULT_DO_RETRANSMISSION;
 
   priv->jbuf = rtp_jitter_buffer_new ();
   g_mutex_init (&priv->jbuf_lock);
   g_cond_init (&priv->jbuf_cond);
+  rtp_scheduler_entry_init (&priv->sched_entry,
+      (RTPSchedulerFunc) gst_rtp_jitter_buffer_shared_run, jitterbuffer);
 
   /* reset skew detection initialy */
   rtp_jitter_buffer_reset_skew (priv->jbuf);
@@ -492,6 +560,8 @@ gst_rtp_jitter_buffer_init (GstRtpJitterBuffer * jitterbuffer)
 
   gst_pad_set_chain_function (priv->sinkpad,
       GST_DEBUG_FUNCPTR (gst_rtp_jitter_buffer_chain));
+  gst_pad_set_chain_list_function (priv->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_jitter_buffer_chain_list));
   gst_pad_set_event_function (priv->sinkpad,
       GST_DEBUG_FUNCPTR (gst_rtp_jitter_buffer_sink_event));
   gst_pad_set_query_function (priv->sinkpad,
@@ -894,8 +964,11 @@ gst_rtp_jitter_buffer_src_activate_mode (GstPad * pad, GstObject * parent,
 {
   gboolean result;
   GstRtpJitterBuffer *jitterbuffer = NULL;
+  GstRtpJitterBufferPrivate *priv;
+  gboolean shared;
 
   jitterbuffer = GST_RTP_JITTER_BUFFER (parent);
+  priv = jitterbuffer->priv;
 
   switch (mode) {
     case GST_PAD_MODE_PUSH:
@@ -903,18 +976,45 @@ gst_rtp_jitter_buffer_src_activate_mode (GstPad * pad, GstObject * parent,
         /* allow data processing */
         gst_rtp_jitter_buffer_flush_stop (jitterbuffer);
 
-        /* start pushing out buffers */
-        GST_DEBUG_OBJECT (jitterbuffer, "Starting task on srcpad");
-        result = gst_pad_start_task (jitterbuffer->priv->srcpad,
-            (GstTaskFunction) gst_rtp_jitter_buffer_loop, jitterbuffer, NULL);
+        /* we are also called on FLUSH_STOP, only switch between the shared
+         * scheduler and our own task when neither is running */
+        JBUF_LOCK (priv);
+        if (priv->shared_threads && GST_PAD_TASK (priv->srcpad) == NULL)
+          priv->scheduler = rtp_scheduler_get_default ();
+        shared = priv->scheduler != NULL;
+        JBUF_UNLOCK (priv);
+
+        if (shared) {
+          GST_DEBUG_OBJECT (jitterbuffer, "Starting on shared scheduler");
+          rtp_scheduler_add (priv->scheduler, &priv->sched_entry);
+          rtp_scheduler_wakeup (priv->scheduler, &priv->sched_entry);
+          result = TRUE;
+        } else {
+          /* start pushing out buffers */
+          GST_DEBUG_OBJECT (jitterbuffer, "Starting task on srcpad");
+          result = gst_pad_start_task (priv->srcpad,
+              (GstTaskFunction) gst_rtp_jitter_buffer_loop, jitterbuffer, NULL);
+        }
       } else {
         /* make sure all data processing stops ASAP */
         gst_rtp_jitter_buffer_flush_start (jitterbuffer);
 
-        /* NOTE this will hardlock if the state change is called from the src pad
-         * task thread because we will _join() the thread. */
-        GST_DEBUG_OBJECT (jitterbuffer, "Stopping task on srcpad");
-        result = gst_pad_stop_task (pad);
+        if (priv->scheduler) {
+          /* waits until a running loop has finished */
+          GST_DEBUG_OBJECT (jitterbuffer, "Stopping on shared scheduler");
+          rtp_scheduler_remove (priv->scheduler, &priv->sched_entry);
+          JBUF_LOCK (priv);
+          priv->scheduler = NULL;
+          priv->timer_pending = FALSE;
+          priv->npt_timer = FALSE;
+          JBUF_UNLOCK (priv);
+          result = TRUE;
+        } else {
+          /* NOTE this will hardlock if the state change is called from the src
+           * pad task thread because we will _join() the thread. */
+          GST_DEBUG_OBJECT (jitterbuffer, "Stopping task on srcpad");
+          result = gst_pad_stop_task (pad);
+        }
       }
       break;
     default:
@@ -1037,6 +1137,7 @@ gst_rtp_jitter_buffer_sink_event (GstPad * pad, GstObject * parent,
   gboolean ret = TRUE;
   GstRtpJitterBuffer *jitterbuffer;
   GstRtpJitterBufferPrivate *priv;
+  RTPScheduler *sched;
 
   jitterbuffer = GST_RTP_JITTER_BUFFER (parent);
   priv = jitterbuffer->priv;
@@ -1079,6 +1180,14 @@ gst_rtp_jitter_buffer_sink_event (GstPad * pad, GstObject * parent,
     case GST_EVENT_FLUSH_START:
       gst_rtp_jitter_buffer_flush_start (jitterbuffer);
       ret = gst_pad_push_event (priv->srcpad, event);
+      /* on the shared scheduler there is no task to pause, wait for a
+       * running loop to finish before the FLUSH_STOP resets the state. It is
+       * added again on FLUSH_STOP. */
+      JBUF_LOCK (priv);
+      sched = priv->scheduler;
+      JBUF_UNLOCK (priv);
+      if (sched)
+        rtp_scheduler_remove (sched, &priv->sched_entry);
       break;
     case GST_EVENT_FLUSH_STOP:
       ret = gst_pad_push_event (priv->srcpad, event);
@@ -1241,31 +1350,88 @@ post_buffering_percent (GstRtpJitterBuffer * jitterbuffer, gint percent)
   gst_element_post_message (GST_ELEMENT_CAST (jitterbuffer), message);
 }
 
+/* queue a retransmission request for the @gap packets starting from @seqnum
+ * that are missing before @buffer. Must be called with the LOCK */
+static void
+request_retransmission (GstRtpJitterBuffer * jitterbuffer, GstBuffer * buffer,
+    guint8 pt, guint16 seqnum, gint gap)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint32 ssrc;
+  gint i;
+
+  if (gap > MAX_RTX_REQUESTS) {
+    GST_DEBUG_OBJECT (jitterbuffer, "gap of %d too big for retransmission",
+        gap);
+    return;
+  }
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp))
+    return;
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  for (i = 0; i < gap; i++) {
+    guint16 missing = seqnum + i;
+    GstEvent *event;
+
+    GST_DEBUG_OBJECT (jitterbuffer, "request retransmission of #%d", missing);
+
+    /* the packet is not useful anymore when it arrives after the latency */
+    event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+        gst_structure_new ("GstRTPRetransmissionRequest",
+            "seqnum", G_TYPE_UINT, (guint) missing,
+            "ssrc", G_TYPE_UINT, (guint) ssrc,
+            "payload", G_TYPE_UINT, (guint) pt,
+            "deadline", G_TYPE_UINT64, priv->latency_ns, NULL));
+    priv->rtx_events = g_list_prepend (priv->rtx_events, event);
+  }
+}
+
+/* take the queued retransmission requests. Must be called with the LOCK */
+static GList *
+take_rtx_events (GstRtpJitterBuffer * jitterbuffer)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+  GList *events;
+
+  events = g_list_reverse (priv->rtx_events);
+  priv->rtx_events = NULL;
+
+  return events;
+}
+
+/* send the retransmission requests upstream, must be called without the LOCK */
+static void
+send_rtx_events (GstRtpJitterBuffer * jitterbuffer, GList * events)
+{
+  GList *walk;
+
+  for (walk = events; walk; walk = g_list_next (walk))
+    gst_pad_push_event (jitterbuffer->priv->sinkpad, walk->data);
+  g_list_free (events);
+}
+
+/* insert @buffer with @pt and @seqnum in the jitterbuffer, takes ownership of
+ * @buffer. @inserted is set when the buffer was queued and @tail when it became
+ * the new tail or is the packet the loop is waiting for. Must be called with
+ * the LOCK */
 static GstFlowReturn
-gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
-    GstBuffer * buffer)
+gst_rtp_jitter_buffer_insert (GstRtpJitterBuffer * jitterbuffer, GstPad * pad,
+    GstBuffer * buffer, guint8 pt, guint16 seqnum, gboolean * inserted,
+    gboolean * tail, gint * percent)
 {
-  GstRtpJitterBuffer *jitterbuffer;
   GstRtpJitterBufferPrivate *priv;
-  guint16 seqnum;
   GstFlowReturn ret = GST_FLOW_OK;
   GstClockTime timestamp;
   guint64 latency_ts;
-  gboolean tail;
-  gint percent = -1;
-  guint8 pt;
-  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
-
-  jitterbuffer = GST_RTP_JITTER_BUFFER (parent);
+  gboolean is_tail;
 
   priv = jitterbuffer->priv;
 
-  if (G_UNLIKELY (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)))
-    goto invalid_buffer;
-
-  pt = gst_rtp_buffer_get_payload_type (&rtp);
-  seqnum = gst_rtp_buffer_get_seq (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
+  if (G_UNLIKELY (priv->srcresult != GST_FLOW_OK))
+    goto out_flushing;
 
   /* take the timestamp of the buffer. This is the time when the packet was
    * received and is used to calculate jitter and clock skew. We will adjust
@@ -1280,8 +1446,6 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
       "Received packet #%d at time %" GST_TIME_FORMAT, seqnum,
       GST_TIME_ARGS (timestamp));
 
-  JBUF_LOCK_CHECK (priv, out_flushing);
-
   if (G_UNLIKELY (priv->last_pt != pt)) {
     GstCaps *caps;
 
@@ -1344,9 +1508,17 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
       rtp_jitter_buffer_reset_skew (priv->jbuf);
       priv->last_popped_seqnum = -1;
       priv->next_seqnum = seqnum;
+    } else if (G_UNLIKELY (gap > 0 && priv->do_retransmission)) {
+      request_retransmission (jitterbuffer, buffer, pt, priv->next_in_seqnum,
+          gap);
     }
+    /* late and retransmitted packets don't move the expected seqnum back,
+     * we would request the packets after them again */
+    if (gap >= 0 || reset)
+      priv->next_in_seqnum = (seqnum + 1) & 0xffff;
+  } else {
+    priv->next_in_seqnum = (seqnum + 1) & 0xffff;
   }
-  priv->next_in_seqnum = (seqnum + 1) & 0xffff;
 
   /* let's check if this buffer is too late, we can only accept packets with
    * bigger seqnum than the one we last pushed. */
@@ -1371,7 +1543,7 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
     if (G_UNLIKELY (rtp_jitter_buffer_get_ts_diff (priv->jbuf) >= latency_ts)) {
       GstBuffer *old_buf;
 
-      old_buf = rtp_jitter_buffer_pop (priv->jbuf, &percent);
+      old_buf = rtp_jitter_buffer_pop (priv->jbuf, percent);
 
       GST_DEBUG_OBJECT (jitterbuffer, "Queue full, dropping old packet %p",
           old_buf);
@@ -1388,64 +1560,40 @@ gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
    * FALSE if a packet with the same seqnum was already in the queue, meaning we
    * have a duplicate. */
   if (G_UNLIKELY (!rtp_jitter_buffer_insert (priv->jbuf, buffer, timestamp,
-              priv->clock_rate, &tail, &percent)))
+              priv->clock_rate, &is_tail, percent)))
     goto duplicate;
 
-  /* signal addition of new buffer when the _loop is waiting. */
-  if (priv->waiting)
-    JBUF_SIGNAL (priv);
-
-  /* let's unschedule and unblock any waiting buffers. We only want to do this
-   * when the tail buffer changed */
-  if (G_UNLIKELY (priv->clock_id && tail)) {
-    GST_DEBUG_OBJECT (jitterbuffer,
-        "Unscheduling waiting buffer, new tail buffer");
-    gst_clock_id_unschedule (priv->clock_id);
-    priv->unscheduled = TRUE;
-  }
+  *inserted = TRUE;
+  /* a waiting loop also has to look again when the missing packet it waits
+   * for arrives, e.g. a retransmission that fills a gap */
+  *tail |= is_tail || seqnum == priv->next_seqnum;
 
   GST_DEBUG_OBJECT (jitterbuffer, "Pushed packet #%d, now %d packets, tail: %d",
-      seqnum, rtp_jitter_buffer_num_packets (priv->jbuf), tail);
-
-  check_buffering_percent (jitterbuffer, &percent);
-
-finished:
-  JBUF_UNLOCK (priv);
-
-  if (percent != -1)
-    post_buffering_percent (jitterbuffer, percent);
+      seqnum, rtp_jitter_buffer_num_packets (priv->jbuf), is_tail);
 
   return ret;
 
   /* ERRORS */
-invalid_buffer:
-  {
-    /* this is not fatal but should be filtered earlier */
-    GST_ELEMENT_WARNING (jitterbuffer, STREAM, DECODE, (NULL),
-        ("Received invalid RTP payload, dropping"));
-    gst_buffer_unref (buffer);
-    return GST_FLOW_OK;
-  }
 no_clock_rate:
   {
     GST_WARNING_OBJECT (jitterbuffer,
         "No clock-rate in caps!, dropping buffer");
     gst_buffer_unref (buffer);
-    goto finished;
+    return ret;
   }
 out_flushing:
   {
     ret = priv->srcresult;
     GST_DEBUG_OBJECT (jitterbuffer, "flushing %s", gst_flow_get_name (ret));
     gst_buffer_unref (buffer);
-    goto finished;
+    return ret;
   }
 have_eos:
   {
     ret = GST_FLOW_EOS;
     GST_WARNING_OBJECT (jitterbuffer, "we are EOS, refusing buffer");
     gst_buffer_unref (buffer);
-    goto finished;
+    return ret;
   }
 too_late:
   {
@@ -1453,7 +1601,7 @@ too_late:
         " popped, dropping", seqnum, priv->last_popped_seqnum);
     priv->num_late++;
     gst_buffer_unref (buffer);
-    goto finished;
+    return ret;
   }
 duplicate:
   {
@@ -1461,8 +1609,185 @@ duplicate:
         seqnum);
     priv->num_duplicates++;
     gst_buffer_unref (buffer);
-    goto finished;
+    return ret;
+  }
+}
+
+/* wake up the loop after packets were inserted, @tail is set when the tail
+ * buffer changed or the expected packet arrived. Must be called with the LOCK */
+static void
+gst_rtp_jitter_buffer_inserted (GstRtpJitterBuffer * jitterbuffer,
+    gboolean tail, gint * percent)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
+  /* signal addition of new buffer when the _loop is waiting. */
+  if (priv->waiting)
+    JBUF_SIGNAL (priv);
+
+  /* let's unschedule and unblock any waiting buffers. We only want to do this
+   * when the tail buffer changed or the missing packet arrived */
+  if (G_UNLIKELY (priv->clock_id && tail)) {
+    GST_DEBUG_OBJECT (jitterbuffer,
+        "Unscheduling waiting buffer, new tail or expected buffer");
+    gst_clock_id_unschedule (priv->clock_id);
+    priv->unscheduled = TRUE;
+  }
+  /* same for the timer on the shared scheduler */
+  if (G_UNLIKELY (priv->timer_pending && tail)) {
+    GST_DEBUG_OBJECT (jitterbuffer,
+        "Waking up waiting loop, new tail or expected buffer");
+    priv->timer_pending = FALSE;
+    rtp_scheduler_wakeup (priv->scheduler, &priv->sched_entry);
+  }
+
+  check_buffering_percent (jitterbuffer, percent);
+}
+
+static GstFlowReturn
+gst_rtp_jitter_buffer_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstRtpJitterBuffer *jitterbuffer;
+  GstRtpJitterBufferPrivate *priv;
+  guint16 seqnum;
+  GstFlowReturn ret;
+  gboolean inserted = FALSE, tail = FALSE;
+  gint percent = -1;
+  guint8 pt;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GList *rtx_events;
+
+  jitterbuffer = GST_RTP_JITTER_BUFFER (parent);
+
+  priv = jitterbuffer->priv;
+
+  if (G_UNLIKELY (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)))
+    goto invalid_buffer;
+
+  pt = gst_rtp_buffer_get_payload_type (&rtp);
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  JBUF_LOCK (priv);
+  ret = gst_rtp_jitter_buffer_insert (jitterbuffer, pad, buffer, pt, seqnum,
+      &inserted, &tail, &percent);
+  if (inserted)
+    gst_rtp_jitter_buffer_inserted (jitterbuffer, tail, &percent);
+  rtx_events = take_rtx_events (jitterbuffer);
+  JBUF_UNLOCK (priv);
+
+  if (G_UNLIKELY (rtx_events))
+    send_rtx_events (jitterbuffer, rtx_events);
+
+  if (percent != -1)
+    post_buffering_percent (jitterbuffer, percent);
+
+  return ret;
+
+  /* ERRORS */
+invalid_buffer:
+  {
+    /* this is not fatal but should be filtered earlier */
+    GST_ELEMENT_WARNING (jitterbuffer, STREAM, DECODE, (NULL),
+        ("Received invalid RTP payload, dropping"));
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+}
+
+typedef struct
+{
+  GstRtpJitterBuffer *jitterbuffer;
+  GstPad *pad;
+  GstFlowReturn ret;
+  gboolean inserted;
+  gboolean tail;
+  gint percent;
+  guint invalid;
+} InsertListData;
+
+static gboolean
+insert_list_item (GstBuffer ** buffer, guint idx, InsertListData * data)
+{
+  GstBuffer *buf;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seqnum;
+  guint8 pt;
+  gint percent = -1;
+
+  /* take the buffer out of the list, so that we own the only reference */
+  buf = *buffer;
+  *buffer = NULL;
+
+  if (G_UNLIKELY (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))) {
+    data->invalid++;
+    gst_buffer_unref (buf);
+    return TRUE;
+  }
+
+  pt = gst_rtp_buffer_get_payload_type (&rtp);
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  data->ret = gst_rtp_jitter_buffer_insert (data->jitterbuffer, data->pad, buf,
+      pt, seqnum, &data->inserted, &data->tail, &percent);
+  if (percent != -1)
+    data->percent = percent;
+
+  return data->ret == GST_FLOW_OK;
+}
+
+/* insert all packets of @list while holding the lock once and wake up the loop
+ * only once */
+static GstFlowReturn
+gst_rtp_jitter_buffer_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstRtpJitterBuffer *jitterbuffer;
+  GstRtpJitterBufferPrivate *priv;
+  InsertListData data;
+  GList *rtx_events;
+
+  jitterbuffer = GST_RTP_JITTER_BUFFER (parent);
+  priv = jitterbuffer->priv;
+
+  data.jitterbuffer = jitterbuffer;
+  data.pad = pad;
+  data.ret = GST_FLOW_OK;
+  data.inserted = FALSE;
+  data.tail = FALSE;
+  data.percent = -1;
+  data.invalid = 0;
+
+  GST_LOG_OBJECT (jitterbuffer, "received list of %u packets",
+      gst_buffer_list_length (list));
+
+  list = gst_buffer_list_make_writable (list);
+
+  JBUF_LOCK (priv);
+  gst_buffer_list_foreach (list, (GstBufferListFunc) insert_list_item, &data);
+  if (data.inserted)
+    gst_rtp_jitter_buffer_inserted (jitterbuffer, data.tail, &data.percent);
+  rtx_events = take_rtx_events (jitterbuffer);
+  JBUF_UNLOCK (priv);
+
+  if (G_UNLIKELY (rtx_events))
+    send_rtx_events (jitterbuffer, rtx_events);
+
+  /* the packets we did not get to */
+  gst_buffer_list_unref (list);
+
+  if (data.percent != -1)
+    post_buffering_percent (jitterbuffer, data.percent);
+
+  if (G_UNLIKELY (data.invalid > 0)) {
+    /* this is not fatal but should be filtered earlier */
+    GST_ELEMENT_WARNING (jitterbuffer, STREAM, DECODE, (NULL),
+        ("Received %u invalid RTP payloads, dropping", data.invalid));
   }
+
+  return data.ret;
 }
 
 static GstClockTime
@@ -1556,6 +1881,18 @@ compute_elapsed (GstRtpJitterBuffer * jitterbuffer, GstBuffer * outbuf)
   return elapsed;
 }
 
+/* stop running the loop until we are activated again. Must be called with the
+ * LOCK */
+static void
+pause_loop (GstRtpJitterBuffer * jitterbuffer)
+{
+  GstRtpJitterBufferPrivate *priv = jitterbuffer->priv;
+
+  priv->yielded = TRUE;
+  if (priv->scheduler == NULL)
+    gst_pad_pause_task (priv->srcpad);
+}
+
 /*
  * This funcion will push out buffers on the source pad.
  *
@@ -1635,7 +1972,12 @@ again:
 
         GST_OBJECT_LOCK (jitterbuffer);
         clock = GST_ELEMENT_CLOCK (jitterbuffer);
-        if (clock) {
+        if (clock && priv->scheduler) {
+          GST_INFO_OBJECT (jitterbuffer, "scheduling shared timeout");
+          rtp_scheduler_schedule (priv->scheduler, &priv->sched_entry, clock,
+              sync_time);
+          priv->npt_timer = TRUE;
+        } else if (clock) {
           GST_INFO_OBJECT (jitterbuffer, "scheduling timeout");
           id = gst_clock_new_single_shot_id (clock, sync_time);
           gst_clock_id_wait_async (id, (GstClockCallback) eos_reached,
@@ -1648,6 +1990,12 @@ again:
     /* now we wait */
     GST_DEBUG_OBJECT (jitterbuffer, "waiting");
     priv->waiting = TRUE;
+    if (priv->scheduler) {
+      /* give the thread back, JBUF_SIGNAL wakes us up again */
+      priv->yielded = TRUE;
+      JBUF_UNLOCK (priv);
+      return;
+    }
     JBUF_WAIT (priv);
     priv->waiting = FALSE;
     GST_DEBUG_OBJECT (jitterbuffer, "waiting done");
@@ -1772,15 +2120,56 @@ again:
         " with sync time %" GST_TIME_FORMAT,
         GST_TIME_ARGS (out_time), GST_TIME_ARGS (sync_time));
 
-    /* create an entry for the clock */
-    id = priv->clock_id = gst_clock_new_single_shot_id (clock, sync_time);
-    priv->unscheduled = FALSE;
-    GST_OBJECT_UNLOCK (jitterbuffer);
+    if (priv->scheduler) {
+      GstClockTime now = gst_clock_get_time (clock);
 
-    /* release the lock so that the other end can push stuff or unlock */
-    JBUF_UNLOCK (priv);
+      if (now < sync_time) {
+        /* come back when the timer expires or a new tail buffer arrives */
+        rtp_scheduler_schedule (priv->scheduler, &priv->sched_entry, clock,
+            sync_time);
+        GST_OBJECT_UNLOCK (jitterbuffer);
+        priv->timer_pending = TRUE;
+        priv->yielded = TRUE;
+        JBUF_UNLOCK (priv);
+        return;
+      }
+      GST_OBJECT_UNLOCK (jitterbuffer);
+
+      /* the deadline passed, same result as a clock wait */
+      clock_jitter = GST_CLOCK_DIFF (sync_time, now);
+      ret = clock_jitter > 0 ? GST_CLOCK_EARLY : GST_CLOCK_OK;
+    } else {
+      /* create an entry for the clock */
+      id = priv->clock_id = gst_clock_new_single_shot_id (clock, sync_time);
+      priv->unscheduled = FALSE;
+      GST_OBJECT_UNLOCK (jitterbuffer);
+
+      /* release the lock so that the other end can push stuff or unlock */
+      JBUF_UNLOCK (priv);
+
+      ret = gst_clock_id_wait (id, &clock_jitter);
 
-    ret = gst_clock_id_wait (id, &clock_jitter);
+      JBUF_LOCK (priv);
+      /* and free the entry */
+      gst_clock_id_unref (id);
+      priv->clock_id = NULL;
+
+      /* at this point, the clock could have been unlocked by a timeout, a new
+       * tail element was added to the queue or because we are shutting down.
+       * Check for shutdown first. */
+      if G_UNLIKELY
+        ((priv->srcresult != GST_FLOW_OK))
+            goto flushing;
+
+      /* if we got unscheduled and we are not flushing, it's because a new tail
+       * element became available in the queue or we flushed the queue.
+       * Grab it and try to push or sync. */
+      if (ret == GST_CLOCK_UNSCHEDULED || priv->unscheduled) {
+        GST_DEBUG_OBJECT (jitterbuffer,
+            "Wait got unscheduled, will retry to push with new buffer");
+        goto again;
+      }
+    }
 
     if (ret == GST_CLOCK_EARLY && gap > 0
         && clock_jitter > (priv->latency_ns + priv->peer_latency)) {
@@ -1806,27 +2195,6 @@ again:
       lost_packets_late = TRUE;
     }
 
-    JBUF_LOCK (priv);
-    /* and free the entry */
-    gst_clock_id_unref (id);
-    priv->clock_id = NULL;
-
-    /* at this point, the clock could have been unlocked by a timeout, a new
-     * tail element was added to the queue or because we are shutting down. Check
-     * for shutdown first. */
-    if G_UNLIKELY
-      ((priv->srcresult != GST_FLOW_OK))
-          goto flushing;
-
-    /* if we got unscheduled and we are not flushing, it's because a new tail
-     * element became available in the queue or we flushed the queue.
-     * Grab it and try to push or sync. */
-    if (ret == GST_CLOCK_UNSCHEDULED || priv->unscheduled) {
-      GST_DEBUG_OBJECT (jitterbuffer,
-          "Wait got unscheduled, will retry to push with new buffer");
-      goto again;
-    }
-
   lost:
     /* we now timed out, this means we lost a packet or finished synchronizing
      * on the first buffer. */
@@ -1948,7 +2316,7 @@ do_eos:
     /* store result, we are flushing now */
     GST_DEBUG_OBJECT (jitterbuffer, "We are EOS, pushing EOS downstream");
     priv->srcresult = GST_FLOW_EOS;
-    gst_pad_pause_task (priv->srcpad);
+    pause_loop (jitterbuffer);
     JBUF_UNLOCK (priv);
     gst_pad_push_event (priv->srcpad, gst_event_new_eos ());
     return;
@@ -1966,7 +2334,7 @@ do_npt_stop:
 flushing:
   {
     GST_DEBUG_OBJECT (jitterbuffer, "we are flushing");
-    gst_pad_pause_task (priv->srcpad);
+    pause_loop (jitterbuffer);
     JBUF_UNLOCK (priv);
     return;
   }
@@ -1980,12 +2348,57 @@ pause:
     priv->srcresult = result;
     /* we don't post errors or anything because upstream will do that for us
      * when we pass the return value upstream. */
-    gst_pad_pause_task (priv->srcpad);
+    pause_loop (jitterbuffer);
     JBUF_UNLOCK (priv);
     return;
   }
 }
 
+/*
+ * Runs the loop from a thread of the shared scheduler until it has to wait. We
+ * are woken up again by JBUF_SIGNAL or when the timer of the entry expires.
+ */
+static void
+gst_rtp_jitter_buffer_shared_run (RTPSchedulerEntry * entry, gboolean timeout,
+    GstRtpJitterBuffer * jitterbuffer)
+{
+  GstRtpJitterBufferPrivate *priv;
+  gboolean npt_stop;
+  gint i;
+
+  priv = jitterbuffer->priv;
+
+  JBUF_LOCK (priv);
+  /* the NPT timer expired while we were still waiting, like eos_reached() */
+  npt_stop = timeout && priv->npt_timer && priv->waiting
+      && priv->srcresult == GST_FLOW_OK;
+  if (npt_stop) {
+    GST_INFO_OBJECT (jitterbuffer, "got the NPT timeout");
+    priv->reached_npt_stop = TRUE;
+  }
+  priv->npt_timer = FALSE;
+  priv->timer_pending = FALSE;
+  priv->waiting = FALSE;
+  JBUF_UNLOCK (priv);
+
+  if (npt_stop) {
+    GST_DEBUG_OBJECT (jitterbuffer, "We reached the NPT stop");
+    g_signal_emit (jitterbuffer,
+        gst_rtp_jitter_buffer_signals[SIGNAL_ON_NPT_STOP], 0, NULL);
+    return;
+  }
+
+  for (i = 0; i < SHARED_MAX_PUSH; i++) {
+    priv->yielded = FALSE;
+    gst_rtp_jitter_buffer_loop (jitterbuffer);
+    if (priv->yielded)
+      return;
+  }
+
+  /* more buffers are ready, let the other entries run first */
+  rtp_scheduler_wakeup (rtp_scheduler_get_default (), entry);
+}
+
 /* collect the info form the lastest RTCP packet and the jittebuffer sync, do
  * some sanity checks and then emit the handle-sync signal with the parameters.
  * This function must be called with the LOCK */
@@ -2335,6 +2748,16 @@ gst_rtp_jitter_buffer_set_property (GObject * object,
       rtp_jitter_buffer_set_mode (priv->jbuf, g_value_get_enum (value));
       JBUF_UNLOCK (priv);
       break;
+    case PROP_SHARED_THREADS:
+      JBUF_LOCK (priv);
+      priv->shared_threads = g_value_get_boolean (value);
+      JBUF_UNLOCK (priv);
+      break;
+    case PROP_DO_RETRANSMISSION:
+      JBUF_LOCK (priv);
+      priv->do_retransmission = g_value_get_boolean (value);
+      JBUF_UNLOCK (priv);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2377,6 +2800,16 @@ gst_rtp_jitter_buffer_get_property (GObject * object,
       g_value_set_enum (value, rtp_jitter_buffer_get_mode (priv->jbuf));
       JBUF_UNLOCK (priv);
       break;
+    case PROP_SHARED_THREADS:
+      JBUF_LOCK (priv);
+      g_value_set_boolean (value, priv->shared_threads);
+      JBUF_UNLOCK (priv);
+      break;
+    case PROP_DO_RETRANSMISSION:
+      JBUF_LOCK (priv);
+      g_value_set_boolean (value, priv->do_retransmission);
+      JBUF_UNLOCK (priv);
+      break;
     case PROP_PERCENT:
     {
       gint percent;
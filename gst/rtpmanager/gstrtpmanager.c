@@ -24,6 +24,8 @@
 #include "gstrtpbin.h"
 #include "gstrtpjitterbuffer.h"
 #include "gstrtpptdemux.h"
+#include "gstrtprtxreceive.h"
+#include "gstrtprtxsend.h"
 #include "gstrtpsession.h"
 #include "gstrtpssrcdemux.h"
 #include "gstrtpdtmfmux.h"
@@ -51,6 +53,14 @@ plugin_init (GstPlugin * plugin)
           GST_TYPE_RTP_SSRC_DEMUX))
     return FALSE;
 
+  if (!gst_element_register (plugin, "rtprtxsend", GST_RANK_NONE,
+          GST_TYPE_RTP_RTX_SEND))
+    return FALSE;
+
+  if (!gst_element_register (plugin, "rtprtxreceive", GST_RANK_NONE,
+          GST_TYPE_RTP_RTX_RECEIVE))
+    return FALSE;
+
   if (!gst_rtp_mux_plugin_init (plugin))
     return FALSE;
 
@@ -129,6 +129,8 @@ static gboolean gst_rtp_pt_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 static GstFlowReturn gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
+static GstFlowReturn gst_rtp_pt_demux_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 static GstStateChangeReturn gst_rtp_pt_demux_change_state (GstElement * element,
     GstStateChange transition);
 static void gst_rtp_pt_demux_clear_pt_map (GstRtpPtDemux * rtpdemux);
@@ -235,6 +237,8 @@ gst_rtp_pt_demux_init (GstRtpPtDemux * ptdemux)
   g_assert (ptdemux->sink != NULL);
 
   gst_pad_set_chain_function (ptdemux->sink, gst_rtp_pt_demux_chain);
+  gst_pad_set_chain_list_function (ptdemux->sink,
+      gst_rtp_pt_demux_chain_list);
   gst_pad_set_event_function (ptdemux->sink, gst_rtp_pt_demux_sink_event);
 
   gst_element_add_pad (GST_ELEMENT (ptdemux), ptdemux->sink);
@@ -342,25 +346,14 @@ forward_sticky_events (GstPad * pad, GstEvent ** event, gpointer user_data)
   return TRUE;
 }
 
-static GstFlowReturn
-gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+/* get the pad for @pt, creating it when needed and making sure it has the
+ * latest caps. Returns NULL after posting an error when there are no caps for
+ * @pt */
+static GstPad *
+gst_rtp_pt_demux_get_pad (GstRtpPtDemux * rtpdemux, guint8 pt)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstRtpPtDemux *rtpdemux;
-  guint8 pt;
   GstPad *srcpad;
   GstCaps *caps;
-  GstRTPBuffer rtp = { NULL };
-
-  rtpdemux = GST_RTP_PT_DEMUX (parent);
-
-  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
-    goto invalid_buffer;
-
-  pt = gst_rtp_buffer_get_payload_type (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
-
-  GST_DEBUG_OBJECT (rtpdemux, "received buffer for pt %d", pt);
 
   srcpad = find_pad_for_pt (rtpdemux, pt);
   if (srcpad == NULL) {
@@ -435,6 +428,42 @@ gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     gst_caps_unref (caps);
   }
 
+  return srcpad;
+
+  /* ERRORS */
+no_caps:
+  {
+    GST_ELEMENT_ERROR (rtpdemux, STREAM, DECODE, (NULL),
+        ("Could not get caps for payload"));
+    if (srcpad)
+      gst_object_unref (srcpad);
+    return NULL;
+  }
+}
+
+static GstFlowReturn
+gst_rtp_pt_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstRtpPtDemux *rtpdemux;
+  guint8 pt;
+  GstPad *srcpad;
+  GstRTPBuffer rtp = { NULL };
+
+  rtpdemux = GST_RTP_PT_DEMUX (parent);
+
+  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
+    goto invalid_buffer;
+
+  pt = gst_rtp_buffer_get_payload_type (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  GST_DEBUG_OBJECT (rtpdemux, "received buffer for pt %d", pt);
+
+  srcpad = gst_rtp_pt_demux_get_pad (rtpdemux, pt);
+  if (srcpad == NULL)
+    goto no_pad;
+
   /* push to srcpad */
   ret = gst_pad_push (srcpad, buf);
 
@@ -451,17 +480,118 @@ invalid_buffer:
     gst_buffer_unref (buf);
     return GST_FLOW_ERROR;
   }
-no_caps:
+no_pad:
   {
-    GST_ELEMENT_ERROR (rtpdemux, STREAM, DECODE, (NULL),
-        ("Could not get caps for payload"));
     gst_buffer_unref (buf);
-    if (srcpad)
-      gst_object_unref (srcpad);
     return GST_FLOW_ERROR;
   }
 }
 
+typedef struct
+{
+  GstRtpPtDemux *rtpdemux;
+  /* consecutive packets with the same payload type */
+  GstBufferList *run;
+  guint8 pt;
+  GstFlowReturn ret;
+} SplitListData;
+
+/* push the collected packets to the pad of their payload type */
+static GstFlowReturn
+gst_rtp_pt_demux_push_run (SplitListData * data)
+{
+  GstFlowReturn ret;
+  GstPad *srcpad;
+  GstBufferList *run = data->run;
+
+  data->run = NULL;
+
+  srcpad = gst_rtp_pt_demux_get_pad (data->rtpdemux, data->pt);
+  if (srcpad == NULL) {
+    gst_buffer_list_unref (run);
+    return GST_FLOW_ERROR;
+  }
+
+  ret = gst_pad_push_list (srcpad, run);
+  gst_object_unref (srcpad);
+
+  return ret;
+}
+
+static gboolean
+split_list_item (GstBuffer ** buffer, guint idx, SplitListData * data)
+{
+  GstBuffer *buf;
+  guint8 pt;
+  GstRTPBuffer rtp = { NULL };
+
+  /* take the buffer out of the list, we keep the only reference */
+  buf = *buffer;
+  *buffer = NULL;
+
+  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
+    goto invalid_buffer;
+
+  pt = gst_rtp_buffer_get_payload_type (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (data->run && pt != data->pt) {
+    data->ret = gst_rtp_pt_demux_push_run (data);
+    if (data->ret != GST_FLOW_OK) {
+      gst_buffer_unref (buf);
+      return FALSE;
+    }
+  }
+  if (data->run == NULL) {
+    data->run = gst_buffer_list_new ();
+    data->pt = pt;
+  }
+  gst_buffer_list_add (data->run, buf);
+
+  return TRUE;
+
+  /* ERRORS */
+invalid_buffer:
+  {
+    /* this is fatal and should be filtered earlier */
+    GST_ELEMENT_ERROR (data->rtpdemux, STREAM, DECODE, (NULL),
+        ("Dropping invalid RTP payload"));
+    gst_buffer_unref (buf);
+    data->ret = GST_FLOW_ERROR;
+    return FALSE;
+  }
+}
+
+/* split the list in runs of packets with the same payload type and push each
+ * run as a list */
+static GstFlowReturn
+gst_rtp_pt_demux_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  SplitListData data;
+
+  data.rtpdemux = GST_RTP_PT_DEMUX (parent);
+  data.run = NULL;
+  data.pt = 0;
+  data.ret = GST_FLOW_OK;
+
+  GST_DEBUG_OBJECT (data.rtpdemux, "received list of %u buffers",
+      gst_buffer_list_length (list));
+
+  list = gst_buffer_list_make_writable (list);
+  gst_buffer_list_foreach (list, (GstBufferListFunc) split_list_item, &data);
+  gst_buffer_list_unref (list);
+
+  if (data.run) {
+    if (data.ret == GST_FLOW_OK)
+      data.ret = gst_rtp_pt_demux_push_run (&data);
+    else
+      gst_buffer_list_unref (data.run);
+  }
+
+  return data.ret;
+}
+
 static GstPad *
 find_pad_for_pt (GstRtpPtDemux * rtpdemux, guint8 pt)
 {
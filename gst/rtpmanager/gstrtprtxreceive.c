@@ -0,0 +1,420 @@
+/* GStreamer
+ *
+ * RTP retransmission receiver
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-rtprtxreceive
+ * @see_also: rtprtxsend, rtpsession, rtpjitterbuffer
+ *
+ * rtprtxreceive restores the original packets from the RFC 4588
+ * retransmissions that rtprtxsend sends, and passes all other packets on
+ * unchanged. Put it in front of the rtpsession that receives the stream.
+ *
+ * The retransmissions are recognized by their payload type. Their SSRC is
+ * mapped to the SSRC of the original stream like RFC 4588 section 5.3
+ * describes: by matching the original seqnum (OSN) of the first
+ * retransmission with a GstRTPRetransmissionRequest event that went
+ * upstream. rtpjitterbuffer sends these events when "do-retransmission" is
+ * set and #GstRtpSession passes them on after it sent the Generic NACK.
+ * Retransmissions that can't be mapped are dropped.
+ *
+ * The restored packet has the SSRC, payload type and seqnum of the original
+ * and the arrival time of the retransmission.
+ *
+ * <refsect2>
+ * <title>Example pipeline</title>
+ * |[
+ * gst-launch-1.0 rtpbin name=rtpbin do-retransmission=true \
+ *     udpsrc port=5000 caps="application/x-rtp,media=video,\
+ *       clock-rate=90000,encoding-name=VP8,payload=96,\
+ *       rtcp-fb-nack=(boolean)true" ! \
+ *       rtprtxreceive rtx-payload-type=97 ! rtpbin.recv_rtp_sink_0 \
+ *     rtpbin. ! rtpvp8depay ! vp8dec ! xvimagesink \
+ *     udpsrc port=5001 ! rtpbin.recv_rtcp_sink_0 \
+ *     rtpbin.send_rtcp_src_0 ! udpsink port=5005 sync=false async=false
+ * ]| Receive the VP8 stream of the rtprtxsend example and recover the lost
+ * packets from its retransmissions with payload type 97.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "gstrtprtxreceive.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_rtp_rtx_receive_debug);
+#define GST_CAT_DEFAULT gst_rtp_rtx_receive_debug
+
+#define DEFAULT_RTX_PAYLOAD_TYPE        97
+
+enum
+{
+  PROP_0,
+  PROP_RTX_PAYLOAD_TYPE,
+  PROP_NUM_RTX_REQUESTS,
+  PROP_NUM_RTX_PACKETS,
+  PROP_NUM_RTX_ASSOC_PACKETS,
+  PROP_LAST
+};
+
+static GstStaticPadTemplate rtp_rtx_receive_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+static GstStaticPadTemplate rtp_rtx_receive_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+#define gst_rtp_rtx_receive_parent_class parent_class
+G_DEFINE_TYPE (GstRtpRtxReceive, gst_rtp_rtx_receive, GST_TYPE_ELEMENT);
+
+static void gst_rtp_rtx_receive_finalize (GObject * object);
+static void gst_rtp_rtx_receive_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_rtp_rtx_receive_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static GstStateChangeReturn gst_rtp_rtx_receive_change_state (GstElement *
+    element, GstStateChange transition);
+
+static GstFlowReturn gst_rtp_rtx_receive_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * buffer);
+static gboolean gst_rtp_rtx_receive_src_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+
+static void
+gst_rtp_rtx_receive_class_init (GstRtpRtxReceiveClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstelement_class = (GstElementClass *) klass;
+
+  gobject_class->finalize = gst_rtp_rtx_receive_finalize;
+  gobject_class->set_property = gst_rtp_rtx_receive_set_property;
+  gobject_class->get_property = gst_rtp_rtx_receive_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_RTX_PAYLOAD_TYPE,
+      g_param_spec_uint ("rtx-payload-type", "RTX Payload Type",
+          "The payload type of the retransmission stream", 0, 127,
+          DEFAULT_RTX_PAYLOAD_TYPE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_NUM_RTX_REQUESTS,
+      g_param_spec_uint ("num-rtx-requests", "Num RTX Requests",
+          "The number of retransmission requests seen", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_NUM_RTX_PACKETS,
+      g_param_spec_uint ("num-rtx-packets", "Num RTX Packets",
+          "The number of retransmission packets received", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_NUM_RTX_ASSOC_PACKETS,
+      g_param_spec_uint ("num-rtx-assoc-packets", "Num RTX Assoc Packets",
+          "The number of retransmission packets restored to their stream", 0,
+          G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_receive_change_state);
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtp_rtx_receive_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtp_rtx_receive_src_template));
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "RTP Retransmission Receiver", "Codec/Network/RTP",
+      "Restores the RTP packets of RFC 4588 RTX retransmissions",
+      "The GStreamer developers");
+
+  GST_DEBUG_CATEGORY_INIT (gst_rtp_rtx_receive_debug, "rtprtxreceive", 0,
+      "RTP retransmission receiver");
+}
+
+static void
+gst_rtp_rtx_receive_init (GstRtpRtxReceive * rtx)
+{
+  GstElementClass *klass = GST_ELEMENT_GET_CLASS (rtx);
+
+  rtx->sinkpad =
+      gst_pad_new_from_template (gst_element_class_get_pad_template (klass,
+          "sink"), "sink");
+  gst_pad_set_chain_function (rtx->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_receive_chain));
+  GST_PAD_SET_PROXY_CAPS (rtx->sinkpad);
+  GST_PAD_SET_PROXY_ALLOCATION (rtx->sinkpad);
+  gst_element_add_pad (GST_ELEMENT_CAST (rtx), rtx->sinkpad);
+
+  rtx->srcpad =
+      gst_pad_new_from_template (gst_element_class_get_pad_template (klass,
+          "src"), "src");
+  gst_pad_set_event_function (rtx->srcpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_receive_src_event));
+  GST_PAD_SET_PROXY_CAPS (rtx->srcpad);
+  GST_PAD_SET_PROXY_ALLOCATION (rtx->srcpad);
+  gst_element_add_pad (GST_ELEMENT_CAST (rtx), rtx->srcpad);
+
+  rtx->rtx_payload_type = DEFAULT_RTX_PAYLOAD_TYPE;
+
+  rtx->ssrc_map = g_hash_table_new (NULL, NULL);
+  rtx->requests = g_hash_table_new (NULL, NULL);
+  rtx->payloads = g_hash_table_new (NULL, NULL);
+}
+
+static void
+gst_rtp_rtx_receive_finalize (GObject * object)
+{
+  GstRtpRtxReceive *rtx = GST_RTP_RTX_RECEIVE (object);
+
+  g_hash_table_destroy (rtx->ssrc_map);
+  g_hash_table_destroy (rtx->requests);
+  g_hash_table_destroy (rtx->payloads);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gboolean
+gst_rtp_rtx_receive_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstRtpRtxReceive *rtx = GST_RTP_RTX_RECEIVE (parent);
+  const GstStructure *s;
+  guint seqnum, ssrc, pt;
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CUSTOM_UPSTREAM) {
+    s = gst_event_get_structure (event);
+
+    if (gst_structure_has_name (s, "GstRTPRetransmissionRequest") &&
+        gst_structure_get_uint (s, "seqnum", &seqnum) &&
+        gst_structure_get_uint (s, "ssrc", &ssrc) &&
+        gst_structure_get_uint (s, "payload", &pt)) {
+      GST_DEBUG_OBJECT (rtx, "request for #%u of %08x", seqnum, ssrc);
+
+      GST_OBJECT_LOCK (rtx);
+      rtx->num_rtx_requests++;
+      g_hash_table_insert (rtx->requests, GUINT_TO_POINTER (seqnum),
+          GUINT_TO_POINTER (ssrc));
+      g_hash_table_insert (rtx->payloads, GUINT_TO_POINTER (ssrc),
+          GUINT_TO_POINTER (pt));
+      GST_OBJECT_UNLOCK (rtx);
+    }
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+/* the original packet of the retransmission @rtp of @buffer: its header with
+ * the @ssrc, @pt and @seqnum of the original, followed by the payload after
+ * the OSN */
+static GstBuffer *
+gst_rtp_rtx_receive_restore_packet (GstRtpRtxReceive * rtx,
+    GstRTPBuffer * rtp, GstBuffer * buffer, guint32 ssrc, guint8 pt,
+    guint16 seqnum)
+{
+  GstRTPBuffer new_rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *new_buffer;
+  guint header_len, payload_len;
+  guint8 *data;
+
+  header_len = gst_rtp_buffer_get_header_len (rtp);
+  payload_len = gst_rtp_buffer_get_payload_len (rtp) - 2;
+
+  data = g_malloc (header_len + payload_len);
+  gst_buffer_extract (buffer, 0, data, header_len);
+  data[0] &= ~0x20;
+  memcpy (data + header_len, (guint8 *) gst_rtp_buffer_get_payload (rtp) + 2,
+      payload_len);
+
+  new_buffer = gst_buffer_new_wrapped (data, header_len + payload_len);
+
+  gst_rtp_buffer_map (new_buffer, GST_MAP_WRITE, &new_rtp);
+  gst_rtp_buffer_set_ssrc (&new_rtp, ssrc);
+  gst_rtp_buffer_set_payload_type (&new_rtp, pt);
+  gst_rtp_buffer_set_seq (&new_rtp, seqnum);
+  gst_rtp_buffer_unmap (&new_rtp);
+
+  /* the jitterbuffer handles it like a packet that arrived late */
+  gst_buffer_copy_into (new_buffer, buffer, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+
+  return new_buffer;
+}
+
+static GstFlowReturn
+gst_rtp_rtx_receive_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstRtpRtxReceive *rtx = GST_RTP_RTX_RECEIVE (parent);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *new_buffer = NULL;
+  gpointer ssrc, pt;
+  guint32 rtx_ssrc;
+  guint16 osn;
+
+  /* rtpsession drops the invalid packets */
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp))
+    return gst_pad_push (rtx->srcpad, buffer);
+
+  GST_OBJECT_LOCK (rtx);
+  if (gst_rtp_buffer_get_payload_type (&rtp) != rtx->rtx_payload_type) {
+    GST_OBJECT_UNLOCK (rtx);
+    gst_rtp_buffer_unmap (&rtp);
+    return gst_pad_push (rtx->srcpad, buffer);
+  }
+
+  rtx->num_rtx_packets++;
+
+  if (gst_rtp_buffer_get_payload_len (&rtp) < 2)
+    goto invalid_packet;
+
+  osn = GST_READ_UINT16_BE (gst_rtp_buffer_get_payload (&rtp));
+  rtx_ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+
+  if (!g_hash_table_lookup_extended (rtx->ssrc_map,
+          GUINT_TO_POINTER (rtx_ssrc), NULL, &ssrc)) {
+    /* the first packet of a retransmission stream belongs to the stream we
+     * requested its OSN from */
+    if (!g_hash_table_lookup_extended (rtx->requests, GUINT_TO_POINTER (osn),
+            NULL, &ssrc))
+      goto no_association;
+
+    GST_DEBUG_OBJECT (rtx, "RTX SSRC %08x retransmits %08x", rtx_ssrc,
+        GPOINTER_TO_UINT (ssrc));
+    g_hash_table_insert (rtx->ssrc_map, GUINT_TO_POINTER (rtx_ssrc), ssrc);
+  }
+  g_hash_table_remove (rtx->requests, GUINT_TO_POINTER (osn));
+
+  if (!g_hash_table_lookup_extended (rtx->payloads, ssrc, NULL, &pt))
+    goto no_association;
+
+  GST_LOG_OBJECT (rtx, "restoring #%u of %08x", osn, GPOINTER_TO_UINT (ssrc));
+  new_buffer = gst_rtp_rtx_receive_restore_packet (rtx, &rtp, buffer,
+      GPOINTER_TO_UINT (ssrc), GPOINTER_TO_UINT (pt), osn);
+  rtx->num_rtx_assoc_packets++;
+  GST_OBJECT_UNLOCK (rtx);
+
+  gst_rtp_buffer_unmap (&rtp);
+  gst_buffer_unref (buffer);
+
+  return gst_pad_push (rtx->srcpad, new_buffer);
+
+  /* ERRORS */
+invalid_packet:
+  {
+    GST_OBJECT_UNLOCK (rtx);
+    GST_WARNING_OBJECT (rtx, "RTX packet without OSN, dropping");
+    gst_rtp_buffer_unmap (&rtp);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+no_association:
+  {
+    GST_OBJECT_UNLOCK (rtx);
+    GST_DEBUG_OBJECT (rtx, "no stream for RTX packet #%u, dropping", osn);
+    gst_rtp_buffer_unmap (&rtp);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+}
+
+static void
+gst_rtp_rtx_receive_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRtpRtxReceive *rtx = GST_RTP_RTX_RECEIVE (object);
+
+  switch (prop_id) {
+    case PROP_RTX_PAYLOAD_TYPE:
+      GST_OBJECT_LOCK (rtx);
+      rtx->rtx_payload_type = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_rtx_receive_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRtpRtxReceive *rtx = GST_RTP_RTX_RECEIVE (object);
+
+  switch (prop_id) {
+    case PROP_RTX_PAYLOAD_TYPE:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->rtx_payload_type);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_NUM_RTX_REQUESTS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_rtx_requests);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_NUM_RTX_PACKETS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_rtx_packets);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_NUM_RTX_ASSOC_PACKETS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_rtx_assoc_packets);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstStateChangeReturn
+gst_rtp_rtx_receive_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstRtpRtxReceive *rtx = GST_RTP_RTX_RECEIVE (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      GST_OBJECT_LOCK (rtx);
+      g_hash_table_remove_all (rtx->ssrc_map);
+      g_hash_table_remove_all (rtx->requests);
+      g_hash_table_remove_all (rtx->payloads);
+      rtx->num_rtx_requests = 0;
+      rtx->num_rtx_packets = 0;
+      rtx->num_rtx_assoc_packets = 0;
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
@@ -0,0 +1,514 @@
+/* GStreamer
+ *
+ * RTP retransmission sender
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-rtprtxsend
+ * @see_also: rtprtxreceive, rtpsession, rtpjitterbuffer
+ *
+ * rtprtxsend keeps the last packets of an RTP stream and retransmits them
+ * when downstream sends a GstRTPRetransmissionRequest event for their seqnum.
+ * #GstRtpSession sends these events upstream on its send_rtp_sink pad for the
+ * packets of a Generic NACK it received.
+ *
+ * The retransmissions use the RTX payload format of RFC 4588: they are sent
+ * with their own SSRC, payload type and seqnums, with the original seqnum
+ * (OSN) in front of the original payload. The SSRC is added as the
+ * "rtx-ssrc" field to the caps so that #GstRtpSession sends these packets
+ * unchanged next to its own. Put rtprtxreceive in front of the receiving
+ * rtpsession to restore the original packets.
+ *
+ * <refsect2>
+ * <title>Example pipeline</title>
+ * |[
+ * gst-launch-1.0 rtpbin name=rtpbin \
+ *     videotestsrc ! vp8enc ! rtpvp8pay ! \
+ *       rtprtxsend rtx-payload-type=97 ! rtpbin.send_rtp_sink_0 \
+ *     rtpbin.send_rtp_src_0 ! udpsink port=5000 \
+ *     rtpbin.send_rtcp_src_0 ! udpsink port=5001 sync=false async=false \
+ *     udpsrc port=5005 ! rtpbin.recv_rtcp_sink_0
+ * ]| Send a VP8 stream and retransmit the packets the receiver reports as
+ * lost with payload type 97.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "gstrtprtxsend.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_rtp_rtx_send_debug);
+#define GST_CAT_DEFAULT gst_rtp_rtx_send_debug
+
+#define DEFAULT_RTX_PAYLOAD_TYPE        97
+#define DEFAULT_MAX_SIZE_PACKETS        100
+
+enum
+{
+  PROP_0,
+  PROP_RTX_SSRC,
+  PROP_RTX_PAYLOAD_TYPE,
+  PROP_MAX_SIZE_PACKETS,
+  PROP_NUM_RTX_REQUESTS,
+  PROP_NUM_RTX_PACKETS,
+  PROP_LAST
+};
+
+static GstStaticPadTemplate rtp_rtx_send_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+static GstStaticPadTemplate rtp_rtx_send_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+#define gst_rtp_rtx_send_parent_class parent_class
+G_DEFINE_TYPE (GstRtpRtxSend, gst_rtp_rtx_send, GST_TYPE_ELEMENT);
+
+static void gst_rtp_rtx_send_finalize (GObject * object);
+static void gst_rtp_rtx_send_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_rtp_rtx_send_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static GstStateChangeReturn gst_rtp_rtx_send_change_state (GstElement *
+    element, GstStateChange transition);
+
+static GstFlowReturn gst_rtp_rtx_send_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer);
+static GstFlowReturn gst_rtp_rtx_send_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
+static gboolean gst_rtp_rtx_send_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static gboolean gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+
+static void
+gst_rtp_rtx_send_class_init (GstRtpRtxSendClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstelement_class = (GstElementClass *) klass;
+
+  gobject_class->finalize = gst_rtp_rtx_send_finalize;
+  gobject_class->set_property = gst_rtp_rtx_send_set_property;
+  gobject_class->get_property = gst_rtp_rtx_send_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_RTX_SSRC,
+      g_param_spec_uint ("rtx-ssrc", "RTX SSRC",
+          "The SSRC of the retransmission stream, set before the caps are "
+          "negotiated (default = random)", 0, G_MAXUINT, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_RTX_PAYLOAD_TYPE,
+      g_param_spec_uint ("rtx-payload-type", "RTX Payload Type",
+          "The payload type of the retransmission stream", 0, 127,
+          DEFAULT_RTX_PAYLOAD_TYPE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_PACKETS,
+      g_param_spec_uint ("max-size-packets", "Max Size Packets",
+          "The number of packets kept for retransmission", 1, G_MAXINT16,
+          DEFAULT_MAX_SIZE_PACKETS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_NUM_RTX_REQUESTS,
+      g_param_spec_uint ("num-rtx-requests", "Num RTX Requests",
+          "The number of retransmission requests received", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_NUM_RTX_PACKETS,
+      g_param_spec_uint ("num-rtx-packets", "Num RTX Packets",
+          "The number of retransmission packets sent", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_send_change_state);
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtp_rtx_send_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtp_rtx_send_src_template));
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "RTP Retransmission Sender", "Codec/Network/RTP",
+      "Retransmits RTP packets on request in the RFC 4588 RTX format",
+      "The GStreamer developers");
+
+  GST_DEBUG_CATEGORY_INIT (gst_rtp_rtx_send_debug, "rtprtxsend", 0,
+      "RTP retransmission sender");
+}
+
+static void
+gst_rtp_rtx_send_init (GstRtpRtxSend * rtx)
+{
+  GstElementClass *klass = GST_ELEMENT_GET_CLASS (rtx);
+
+  rtx->sinkpad =
+      gst_pad_new_from_template (gst_element_class_get_pad_template (klass,
+          "sink"), "sink");
+  gst_pad_set_chain_function (rtx->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_send_chain));
+  gst_pad_set_chain_list_function (rtx->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_send_chain_list));
+  gst_pad_set_event_function (rtx->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_send_sink_event));
+  GST_PAD_SET_PROXY_CAPS (rtx->sinkpad);
+  GST_PAD_SET_PROXY_ALLOCATION (rtx->sinkpad);
+  gst_element_add_pad (GST_ELEMENT_CAST (rtx), rtx->sinkpad);
+
+  rtx->srcpad =
+      gst_pad_new_from_template (gst_element_class_get_pad_template (klass,
+          "src"), "src");
+  gst_pad_set_event_function (rtx->srcpad,
+      GST_DEBUG_FUNCPTR (gst_rtp_rtx_send_src_event));
+  GST_PAD_SET_PROXY_CAPS (rtx->srcpad);
+  GST_PAD_SET_PROXY_ALLOCATION (rtx->srcpad);
+  gst_element_add_pad (GST_ELEMENT_CAST (rtx), rtx->srcpad);
+
+  rtx->rtx_payload_type = DEFAULT_RTX_PAYLOAD_TYPE;
+  rtx->max_size_packets = DEFAULT_MAX_SIZE_PACKETS;
+
+  rtx->history = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) gst_buffer_unref);
+  g_queue_init (&rtx->history_seqnums);
+
+  rtx->rtx_ssrc = g_random_int ();
+  rtx->next_rtx_seqnum = g_random_int_range (0, G_MAXUINT16);
+}
+
+static void
+gst_rtp_rtx_send_finalize (GObject * object)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (object);
+
+  g_hash_table_destroy (rtx->history);
+  g_queue_clear (&rtx->history_seqnums);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/* forget all packets. Must be called with the object lock */
+static void
+gst_rtp_rtx_send_clear_history (GstRtpRtxSend * rtx)
+{
+  g_hash_table_remove_all (rtx->history);
+  g_queue_clear (&rtx->history_seqnums);
+}
+
+/* drop the oldest packets until at most @max_size are left. Must be called
+ * with the object lock */
+static void
+gst_rtp_rtx_send_trim_history (GstRtpRtxSend * rtx, guint max_size)
+{
+  while (g_queue_get_length (&rtx->history_seqnums) > max_size)
+    g_hash_table_remove (rtx->history,
+        g_queue_pop_head (&rtx->history_seqnums));
+}
+
+/* keep a ref to @buffer for retransmission. Must be called with the object
+ * lock */
+static void
+gst_rtp_rtx_send_add_history (GstRtpRtxSend * rtx, GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  gpointer seqnum;
+  guint32 ssrc;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    GST_WARNING_OBJECT (rtx, "not keeping invalid RTP packet");
+    return;
+  }
+  seqnum = GUINT_TO_POINTER (gst_rtp_buffer_get_seq (&rtp));
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  /* the seqnums of a new SSRC have nothing to do with the old ones */
+  if (ssrc != rtx->media_ssrc) {
+    GST_DEBUG_OBJECT (rtx, "SSRC changed to %08x", ssrc);
+    gst_rtp_rtx_send_clear_history (rtx);
+    rtx->media_ssrc = ssrc;
+  }
+
+  if (!g_hash_table_lookup_extended (rtx->history, seqnum, NULL, NULL))
+    g_queue_push_tail (&rtx->history_seqnums, seqnum);
+  g_hash_table_insert (rtx->history, seqnum, gst_buffer_ref (buffer));
+
+  gst_rtp_rtx_send_trim_history (rtx, rtx->max_size_packets);
+}
+
+/* make an RFC 4588 retransmission of @buffer: the header of the original
+ * packet, with its CSRCs and extension, but with the SSRC, payload type and
+ * seqnum of the retransmission stream, followed by the original seqnum and
+ * payload. Must be called with the object lock */
+static GstBuffer *
+gst_rtp_rtx_send_make_packet (GstRtpRtxSend * rtx, GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstRTPBuffer rtx_rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *rtx_buffer;
+  guint header_len, payload_len;
+  guint16 seqnum;
+  guint8 *data;
+
+  gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp);
+  header_len = gst_rtp_buffer_get_header_len (&rtp);
+  payload_len = gst_rtp_buffer_get_payload_len (&rtp);
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+
+  data = g_malloc (header_len + 2 + payload_len);
+  gst_buffer_extract (buffer, 0, data, header_len);
+  /* the padding is not retransmitted */
+  data[0] &= ~0x20;
+  GST_WRITE_UINT16_BE (data + header_len, seqnum);
+  memcpy (data + header_len + 2, gst_rtp_buffer_get_payload (&rtp),
+      payload_len);
+  gst_rtp_buffer_unmap (&rtp);
+
+  rtx_buffer = gst_buffer_new_wrapped (data, header_len + 2 + payload_len);
+
+  gst_rtp_buffer_map (rtx_buffer, GST_MAP_WRITE, &rtx_rtp);
+  gst_rtp_buffer_set_ssrc (&rtx_rtp, rtx->rtx_ssrc);
+  gst_rtp_buffer_set_payload_type (&rtx_rtp, rtx->rtx_payload_type);
+  gst_rtp_buffer_set_seq (&rtx_rtp, rtx->next_rtx_seqnum++);
+  gst_rtp_buffer_unmap (&rtx_rtp);
+
+  GST_LOG_OBJECT (rtx, "retransmitting #%u as #%u", seqnum,
+      (guint16) (rtx->next_rtx_seqnum - 1));
+
+  return rtx_buffer;
+}
+
+static gboolean
+gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (parent);
+  const GstStructure *s;
+  GstBuffer *buffer, *rtx_buffer = NULL;
+  guint seqnum, ssrc;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM)
+    return gst_pad_event_default (pad, parent, event);
+
+  s = gst_event_get_structure (event);
+  if (!gst_structure_has_name (s, "GstRTPRetransmissionRequest"))
+    return gst_pad_event_default (pad, parent, event);
+
+  /* rtpsession only asks for the packets of the SSRC it sends, which is the
+   * SSRC of our packets or the one it replaces it with */
+  if (gst_structure_get_uint (s, "seqnum", &seqnum) &&
+      gst_structure_get_uint (s, "ssrc", &ssrc)) {
+    GST_OBJECT_LOCK (rtx);
+    rtx->num_rtx_requests++;
+    buffer = g_hash_table_lookup (rtx->history, GUINT_TO_POINTER (seqnum));
+    if (buffer) {
+      rtx_buffer = gst_rtp_rtx_send_make_packet (rtx, buffer);
+      rtx->num_rtx_packets++;
+    } else {
+      GST_DEBUG_OBJECT (rtx, "#%u of %08x is not in the history", seqnum,
+          ssrc);
+    }
+    GST_OBJECT_UNLOCK (rtx);
+  }
+  gst_event_unref (event);
+
+  /* send it right away instead of after the next packet, the retransmission
+   * is only useful when it arrives within the latency of the receiver. The
+   * stream lock keeps it from being pushed in the middle of the streaming
+   * thread. */
+  if (rtx_buffer) {
+    GST_PAD_STREAM_LOCK (rtx->sinkpad);
+    gst_pad_push (rtx->srcpad, rtx_buffer);
+    GST_PAD_STREAM_UNLOCK (rtx->sinkpad);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_rtp_rtx_send_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (parent);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+    {
+      GstCaps *caps;
+      GstStructure *s;
+      guint ssrc;
+
+      gst_event_parse_caps (event, &caps);
+      caps = gst_caps_copy (caps);
+      gst_event_unref (event);
+
+      /* let rtpsession know which packets not to give its own SSRC */
+      s = gst_caps_get_structure (caps, 0);
+      GST_OBJECT_LOCK (rtx);
+      if (gst_structure_get_uint (s, "ssrc", &ssrc)) {
+        while (rtx->rtx_ssrc == ssrc)
+          rtx->rtx_ssrc = g_random_int ();
+      }
+      gst_structure_set (s, "rtx-ssrc", G_TYPE_UINT, rtx->rtx_ssrc, NULL);
+      GST_OBJECT_UNLOCK (rtx);
+
+      event = gst_event_new_caps (caps);
+      gst_caps_unref (caps);
+      break;
+    }
+    case GST_EVENT_FLUSH_STOP:
+      GST_OBJECT_LOCK (rtx);
+      gst_rtp_rtx_send_clear_history (rtx);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    default:
+      break;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static GstFlowReturn
+gst_rtp_rtx_send_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (parent);
+
+  GST_OBJECT_LOCK (rtx);
+  gst_rtp_rtx_send_add_history (rtx, buffer);
+  GST_OBJECT_UNLOCK (rtx);
+
+  return gst_pad_push (rtx->srcpad, buffer);
+}
+
+static GstFlowReturn
+gst_rtp_rtx_send_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (parent);
+  guint i, len;
+
+  len = gst_buffer_list_length (list);
+
+  GST_OBJECT_LOCK (rtx);
+  for (i = 0; i < len; i++)
+    gst_rtp_rtx_send_add_history (rtx, gst_buffer_list_get (list, i));
+  GST_OBJECT_UNLOCK (rtx);
+
+  return gst_pad_push_list (rtx->srcpad, list);
+}
+
+static void
+gst_rtp_rtx_send_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (object);
+
+  switch (prop_id) {
+    case PROP_RTX_SSRC:
+      GST_OBJECT_LOCK (rtx);
+      rtx->rtx_ssrc = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_RTX_PAYLOAD_TYPE:
+      GST_OBJECT_LOCK (rtx);
+      rtx->rtx_payload_type = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_MAX_SIZE_PACKETS:
+      GST_OBJECT_LOCK (rtx);
+      rtx->max_size_packets = g_value_get_uint (value);
+      gst_rtp_rtx_send_trim_history (rtx, rtx->max_size_packets);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_rtx_send_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (object);
+
+  switch (prop_id) {
+    case PROP_RTX_SSRC:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->rtx_ssrc);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_RTX_PAYLOAD_TYPE:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->rtx_payload_type);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_MAX_SIZE_PACKETS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->max_size_packets);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_NUM_RTX_REQUESTS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_rtx_requests);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    case PROP_NUM_RTX_PACKETS:
+      GST_OBJECT_LOCK (rtx);
+      g_value_set_uint (value, rtx->num_rtx_packets);
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstStateChangeReturn
+gst_rtp_rtx_send_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstRtpRtxSend *rtx = GST_RTP_RTX_SEND (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      GST_OBJECT_LOCK (rtx);
+      gst_rtp_rtx_send_clear_history (rtx);
+      rtx->media_ssrc = 0;
+      rtx->num_rtx_requests = 0;
+      rtx->num_rtx_packets = 0;
+      GST_OBJECT_UNLOCK (rtx);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
@@ -254,7 +254,7 @@ struct _GstRtpSessionPrivate
 
 /* callbacks to handle actions from the session manager */
 static GstFlowReturn gst_rtp_session_process_rtp (RTPSession * sess,
-    RTPSource * src, GstBuffer * buffer, gpointer user_data);
+    RTPSource * src, gpointer data, gpointer user_data);
 static GstFlowReturn gst_rtp_session_send_rtp (RTPSession * sess,
     RTPSource * src, gpointer data, gpointer user_data);
 static GstFlowReturn gst_rtp_session_send_rtcp (RTPSession * sess,
@@ -268,6 +268,8 @@ static void gst_rtp_session_request_key_unit (RTPSession * sess,
     gboolean all_headers, gpointer user_data);
 static GstClockTime gst_rtp_session_request_time (RTPSession * session,
     gpointer user_data);
+static void gst_rtp_session_notify_nack (RTPSession * sess,
+    guint16 seqnum, guint16 blp, guint32 ssrc, gpointer user_data);
 
 static RTPSessionCallbacks callbacks = {
   gst_rtp_session_process_rtp,
@@ -277,7 +279,8 @@ static RTPSessionCallbacks callbacks = {
   gst_rtp_session_clock_rate,
   gst_rtp_session_reconsider,
   gst_rtp_session_request_key_unit,
-  gst_rtp_session_request_time
+  gst_rtp_session_request_time,
+  gst_rtp_session_notify_nack
 };
 
 /* GObject vmethods */
@@ -1038,7 +1041,7 @@ gst_rtp_session_clear_pt_map (GstRtpSession * rtpsession)
  * ready for further processing */
 static GstFlowReturn
 gst_rtp_session_process_rtp (RTPSession * sess, RTPSource * src,
-    GstBuffer * buffer, gpointer user_data)
+    gpointer data, gpointer user_data)
 {
   GstFlowReturn result;
   GstRtpSession *rtpsession;
@@ -1052,12 +1055,17 @@ gst_rtp_session_process_rtp (RTPSession * sess, RTPSource * src,
   GST_RTP_SESSION_UNLOCK (rtpsession);
 
   if (rtp_src) {
-    GST_LOG_OBJECT (rtpsession, "pushing received RTP packet");
-    result = gst_pad_push (rtp_src, buffer);
+    if (GST_IS_BUFFER (data)) {
+      GST_LOG_OBJECT (rtpsession, "pushing received RTP packet");
+      result = gst_pad_push (rtp_src, GST_BUFFER_CAST (data));
+    } else {
+      GST_LOG_OBJECT (rtpsession, "pushing received RTP list");
+      result = gst_pad_push_list (rtp_src, GST_BUFFER_LIST_CAST (data));
+    }
     gst_object_unref (rtp_src);
   } else {
-    GST_DEBUG_OBJECT (rtpsession, "dropping received RTP packet");
-    gst_buffer_unref (buffer);
+    GST_DEBUG_OBJECT (rtpsession, "dropping received RTP data");
+    gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
     result = GST_FLOW_OK;
   }
   return result;
@@ -1425,6 +1433,30 @@ gst_rtp_session_request_remote_key_unit (GstRtpSession * rtpsession,
   return FALSE;
 }
 
+/* only send a NACK when the receiver negotiated them with "a=rtcp-fb:pt nack",
+ * otherwise the sender would not understand them */
+static gboolean
+gst_rtp_session_request_nack (GstRtpSession * rtpsession, guint32 ssrc,
+    guint payload, guint seqnum, GstClockTime deadline)
+{
+  GstCaps *caps;
+  gboolean nack;
+
+  caps = gst_rtp_session_get_caps_for_pt (rtpsession, payload);
+  if (caps == NULL)
+    return FALSE;
+
+  nack = gst_structure_has_field (gst_caps_get_structure (caps, 0),
+      "rtcp-fb-nack");
+  gst_caps_unref (caps);
+
+  if (!nack)
+    return FALSE;
+
+  return rtp_session_request_nack (rtpsession->priv->session, ssrc, seqnum,
+      gst_clock_get_time (rtpsession->priv->sysclock), deadline);
+}
+
 static gboolean
 gst_rtp_session_event_recv_rtp_src (GstPad * pad, GstObject * parent,
     GstEvent * event)
@@ -1435,6 +1467,9 @@ gst_rtp_session_event_recv_rtp_src (GstPad * pad, GstObject * parent,
   const GstStructure *s;
   guint32 ssrc;
   guint pt;
+  gboolean nack = FALSE;
+  guint seqnum;
+  GstClockTime deadline = 100 * GST_MSECOND;
 
   rtpsession = GST_RTP_SESSION (parent);
 
@@ -1453,6 +1488,14 @@ gst_rtp_session_event_recv_rtp_src (GstPad * pad, GstObject * parent,
         if (gst_rtp_session_request_remote_key_unit (rtpsession, ssrc, pt,
                 all_headers, count))
           forward = FALSE;
+      } else if (gst_structure_has_name (s, "GstRTPRetransmissionRequest") &&
+          gst_structure_get_uint (s, "ssrc", &ssrc) &&
+          gst_structure_get_uint (s, "payload", &pt) &&
+          gst_structure_get_uint (s, "seqnum", &seqnum)) {
+        /* the NACK is sent after the request went upstream, an rtprtxreceive
+         * there needs it to map the retransmission to this SSRC */
+        gst_structure_get_clock_time (s, "deadline", &deadline);
+        nack = TRUE;
       }
       break;
     default:
@@ -1476,6 +1519,10 @@ gst_rtp_session_event_recv_rtp_src (GstPad * pad, GstObject * parent,
     gst_event_unref (event);
   }
 
+  if (nack && gst_rtp_session_request_nack (rtpsession, ssrc, pt, seqnum,
+          deadline))
+    ret = TRUE;
+
   return ret;
 }
 
@@ -1525,26 +1572,35 @@ gst_rtp_session_sink_setcaps (GstPad * pad, GstRtpSession * rtpsession,
   return TRUE;
 }
 
-/* receive a packet from a sender, send it to the RTP session manager and
- * forward the packet on the rtp_src pad
+/* receive a packet or a list of packets from a sender, send it to the RTP
+ * session manager and forward the packets on the rtp_src pad
  */
 static GstFlowReturn
-gst_rtp_session_chain_recv_rtp (GstPad * pad, GstObject * parent,
-    GstBuffer * buffer)
+gst_rtp_session_chain_recv_rtp_common (GstRtpSession * rtpsession,
+    gpointer data, gboolean is_list)
 {
-  GstRtpSession *rtpsession;
   GstRtpSessionPrivate *priv;
   GstFlowReturn ret;
   GstClockTime current_time, running_time;
   GstClockTime timestamp;
 
-  rtpsession = GST_RTP_SESSION (parent);
   priv = rtpsession->priv;
 
-  GST_LOG_OBJECT (rtpsession, "received RTP packet");
+  GST_LOG_OBJECT (rtpsession, "received RTP %s", is_list ? "list" : "packet");
 
-  /* get NTP time when this packet was captured, this depends on the timestamp. */
-  timestamp = GST_BUFFER_TIMESTAMP (buffer);
+  /* get NTP time when this packet was captured, this depends on the timestamp.
+   * The packets of a list arrived together, take it from the first one. */
+  if (is_list) {
+    GstBuffer *buffer;
+
+    buffer = gst_buffer_list_get (GST_BUFFER_LIST_CAST (data), 0);
+    if (buffer)
+      timestamp = GST_BUFFER_TIMESTAMP (buffer);
+    else
+      timestamp = -1;
+  } else {
+    timestamp = GST_BUFFER_TIMESTAMP (GST_BUFFER_CAST (data));
+  }
   if (GST_CLOCK_TIME_IS_VALID (timestamp)) {
     /* convert to running time using the segment values */
     running_time =
@@ -1555,8 +1611,12 @@ gst_rtp_session_chain_recv_rtp (GstPad * pad, GstObject * parent,
   }
   current_time = gst_clock_get_time (priv->sysclock);
 
-  ret = rtp_session_process_rtp (priv->session, buffer, current_time,
-      running_time);
+  if (is_list)
+    ret = rtp_session_process_rtp_list (priv->session,
+        GST_BUFFER_LIST_CAST (data), current_time, running_time);
+  else
+    ret = rtp_session_process_rtp (priv->session, GST_BUFFER_CAST (data),
+        current_time, running_time);
   if (ret != GST_FLOW_OK)
     goto push_error;
 
@@ -1573,6 +1633,24 @@ push_error:
   }
 }
 
+static GstFlowReturn
+gst_rtp_session_chain_recv_rtp (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstRtpSession *rtpsession = GST_RTP_SESSION (parent);
+
+  return gst_rtp_session_chain_recv_rtp_common (rtpsession, buffer, FALSE);
+}
+
+static GstFlowReturn
+gst_rtp_session_chain_recv_rtp_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstRtpSession *rtpsession = GST_RTP_SESSION (parent);
+
+  return gst_rtp_session_chain_recv_rtp_common (rtpsession, list, TRUE);
+}
+
 static gboolean
 gst_rtp_session_event_recv_rtcp_sink (GstPad * pad, GstObject * parent,
     GstEvent * event)
@@ -1952,6 +2030,8 @@ create_recv_rtp_sink (GstRtpSession * rtpsession)
       "recv_rtp_sink");
   gst_pad_set_chain_function (rtpsession->recv_rtp_sink,
       gst_rtp_session_chain_recv_rtp);
+  gst_pad_set_chain_list_function (rtpsession->recv_rtp_sink,
+      gst_rtp_session_chain_recv_rtp_list);
   gst_pad_set_event_function (rtpsession->recv_rtp_sink,
       gst_rtp_session_event_recv_rtp_sink);
   gst_pad_set_iterate_internal_links_function (rtpsession->recv_rtp_sink,
@@ -2266,6 +2346,43 @@ gst_rtp_session_request_key_unit (RTPSession * sess,
   }
 }
 
+/* ask upstream of the send pads, like rtprtxsend, to retransmit the packets of
+ * a NACK, one event per packet */
+static void
+gst_rtp_session_notify_nack (RTPSession * sess, guint16 seqnum,
+    guint16 blp, guint32 ssrc, gpointer user_data)
+{
+  GstRtpSession *rtpsession = GST_RTP_SESSION (user_data);
+  GstEvent *event;
+  GstPad *send_rtp_sink;
+
+  GST_RTP_SESSION_LOCK (rtpsession);
+  if ((send_rtp_sink = rtpsession->send_rtp_sink))
+    gst_object_ref (send_rtp_sink);
+  GST_RTP_SESSION_UNLOCK (rtpsession);
+
+  if (send_rtp_sink) {
+    while (TRUE) {
+      event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+          gst_structure_new ("GstRTPRetransmissionRequest",
+              "seqnum", G_TYPE_UINT, (guint) seqnum,
+              "ssrc", G_TYPE_UINT, (guint) ssrc, NULL));
+      gst_pad_push_event (send_rtp_sink, event);
+
+      if (blp == 0)
+        break;
+
+      seqnum++;
+      while ((blp & 1) == 0) {
+        seqnum++;
+        blp >>= 1;
+      }
+      blp >>= 1;
+    }
+    gst_object_unref (send_rtp_sink);
+  }
+}
+
 static GstClockTime
 gst_rtp_session_request_time (RTPSession * session, gpointer user_data)
 {
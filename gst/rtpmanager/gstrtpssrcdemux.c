@@ -118,6 +118,8 @@ static void gst_rtp_ssrc_demux_clear_ssrc (GstRtpSsrcDemux * demux,
 /* sinkpad stuff */
 static GstFlowReturn gst_rtp_ssrc_demux_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
+static GstFlowReturn gst_rtp_ssrc_demux_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 static gboolean gst_rtp_ssrc_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 
@@ -155,15 +157,58 @@ struct _GstRtpSsrcDemuxPad
 static GstRtpSsrcDemuxPad *
 find_demux_pad_for_ssrc (GstRtpSsrcDemux * demux, guint32 ssrc)
 {
-  GSList *walk;
+  return g_hash_table_lookup (demux->ssrcs, GUINT_TO_POINTER (ssrc));
+}
 
-  for (walk = demux->srcpads; walk; walk = g_slist_next (walk)) {
-    GstRtpSsrcDemuxPad *pad = (GstRtpSsrcDemuxPad *) walk->data;
+/* The caches are only used by the streaming thread of their sink pad, so
+ * looking up a known SSRC needs no lock. They hold no refs on the pads and
+ * are valid as long as the generation of the demuxer does not change, which
+ * happens whenever pads are removed. A lookup counts itself in readers while
+ * it checks the generation and refs the pad. Removing a pad bumps the
+ * generation and then waits until no lookups are in progress, so that the
+ * pad is still alive when a lookup that did not see the new generation takes
+ * its ref. */
 
-    if (pad->ssrc == ssrc)
-      return pad;
+/* returns a ref to the pad for @ssrc from @cache or NULL */
+static GstPad *
+lookup_cache (GstRtpSsrcDemux * demux, GstRtpSsrcDemuxCache * cache,
+    guint32 ssrc)
+{
+  GstPad *pad = NULL;
+
+  g_atomic_int_inc (&cache->readers);
+  if (G_LIKELY (cache->generation == g_atomic_int_get (&demux->generation))) {
+    pad = g_hash_table_lookup (cache->pads, GUINT_TO_POINTER (ssrc));
+    if (pad)
+      gst_object_ref (pad);
   }
-  return NULL;
+  g_atomic_int_add (&cache->readers, -1);
+
+  return pad;
+}
+
+/* remember @pad for @ssrc in @cache. Must be called with the PAD_LOCK from the
+ * streaming thread that owns @cache */
+static void
+update_cache (GstRtpSsrcDemux * demux, GstRtpSsrcDemuxCache * cache,
+    guint32 ssrc, GstPad * pad)
+{
+  if (cache->generation != demux->generation) {
+    g_hash_table_remove_all (cache->pads);
+    cache->generation = demux->generation;
+  }
+  g_hash_table_insert (cache->pads, GUINT_TO_POINTER (ssrc), pad);
+}
+
+/* makes the caches forget all pads. Must be called with the PAD_LOCK or when
+ * not streaming, the pads can be freed after this */
+static void
+invalidate_caches (GstRtpSsrcDemux * demux)
+{
+  g_atomic_int_inc (&demux->generation);
+  while (g_atomic_int_get (&demux->rtp_cache.readers) > 0 ||
+      g_atomic_int_get (&demux->rtcp_cache.readers) > 0)
+    g_thread_yield ();
 }
 
 static GstEvent *
@@ -244,6 +289,11 @@ find_or_create_demux_pad_for_ssrc (GstRtpSsrcDemux * demux, guint32 ssrc,
   GstRtpSsrcDemuxPad *demuxpad;
   GstPad *retpad;
   gulong rtp_block, rtcp_block;
+  GstRtpSsrcDemuxCache *cache;
+
+  cache = (padtype == RTP_PAD) ? &demux->rtp_cache : &demux->rtcp_cache;
+  if (G_LIKELY ((retpad = lookup_cache (demux, cache, ssrc))))
+    return retpad;
 
   GST_PAD_LOCK (demux);
 
@@ -270,6 +320,7 @@ find_or_create_demux_pad_for_ssrc (GstRtpSsrcDemux * demux, guint32 ssrc,
         retpad = NULL;
         g_assert_not_reached ();
     }
+    update_cache (demux, cache, ssrc, retpad);
 
     GST_PAD_UNLOCK (demux);
 
@@ -301,6 +352,7 @@ find_or_create_demux_pad_for_ssrc (GstRtpSsrcDemux * demux, guint32 ssrc,
   gst_pad_set_element_private (rtcp_pad, demuxpad);
 
   demux->srcpads = g_slist_prepend (demux->srcpads, demuxpad);
+  g_hash_table_insert (demux->ssrcs, GUINT_TO_POINTER (ssrc), demuxpad);
 
   gst_pad_set_query_function (rtp_pad, gst_rtp_ssrc_demux_src_query);
   gst_pad_set_iterate_internal_links_function (rtp_pad,
@@ -339,6 +391,7 @@ find_or_create_demux_pad_for_ssrc (GstRtpSsrcDemux * demux, guint32 ssrc,
       retpad = NULL;
       g_assert_not_reached ();
   }
+  update_cache (demux, cache, ssrc, retpad);
 
   gst_object_ref (rtp_pad);
   gst_object_ref (rtcp_pad);
@@ -451,6 +504,8 @@ gst_rtp_ssrc_demux_init (GstRtpSsrcDemux * demux)
       gst_pad_new_from_template (gst_element_class_get_pad_template (klass,
           "sink"), "sink");
   gst_pad_set_chain_function (demux->rtp_sink, gst_rtp_ssrc_demux_chain);
+  gst_pad_set_chain_list_function (demux->rtp_sink,
+      gst_rtp_ssrc_demux_chain_list);
   gst_pad_set_event_function (demux->rtp_sink, gst_rtp_ssrc_demux_sink_event);
   gst_pad_set_iterate_internal_links_function (demux->rtp_sink,
       gst_rtp_ssrc_demux_iterate_internal_links_sink);
@@ -466,6 +521,9 @@ gst_rtp_ssrc_demux_init (GstRtpSsrcDemux * demux)
   gst_element_add_pad (GST_ELEMENT_CAST (demux), demux->rtcp_sink);
 
   g_rec_mutex_init (&demux->padlock);
+  demux->ssrcs = g_hash_table_new (NULL, NULL);
+  demux->rtp_cache.pads = g_hash_table_new (NULL, NULL);
+  demux->rtcp_cache.pads = g_hash_table_new (NULL, NULL);
 }
 
 static void
@@ -473,6 +531,9 @@ gst_rtp_ssrc_demux_reset (GstRtpSsrcDemux * demux)
 {
   GSList *walk;
 
+  invalidate_caches (demux);
+  g_hash_table_remove_all (demux->ssrcs);
+
   for (walk = demux->srcpads; walk; walk = g_slist_next (walk)) {
     GstRtpSsrcDemuxPad *dpad = (GstRtpSsrcDemuxPad *) walk->data;
 
@@ -505,6 +566,9 @@ gst_rtp_ssrc_demux_finalize (GObject * object)
   GstRtpSsrcDemux *demux;
 
   demux = GST_RTP_SSRC_DEMUX (object);
+  g_hash_table_destroy (demux->ssrcs);
+  g_hash_table_destroy (demux->rtp_cache.pads);
+  g_hash_table_destroy (demux->rtcp_cache.pads);
   g_rec_mutex_clear (&demux->padlock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -525,6 +589,9 @@ gst_rtp_ssrc_demux_clear_ssrc (GstRtpSsrcDemux * demux, guint32 ssrc)
   GST_DEBUG_OBJECT (demux, "clearing pad for SSRC %08x", ssrc);
 
   demux->srcpads = g_slist_remove (demux->srcpads, dpad);
+  g_hash_table_remove (demux->ssrcs, GUINT_TO_POINTER (ssrc));
+  /* make the streaming threads look up their pad again */
+  invalidate_caches (demux);
   GST_PAD_UNLOCK (demux);
 
   gst_pad_set_active (dpad->rtp_pad, FALSE);
@@ -607,32 +674,24 @@ gst_rtp_ssrc_demux_sink_event (GstPad * pad, GstObject * parent,
   return fdata.res;
 }
 
+/* push @data, a buffer or a list of buffers of @ssrc, on the pad of @ssrc */
 static GstFlowReturn
-gst_rtp_ssrc_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+gst_rtp_ssrc_demux_push (GstRtpSsrcDemux * demux, guint32 ssrc, gpointer data,
+    gboolean is_list)
 {
   GstFlowReturn ret;
-  GstRtpSsrcDemux *demux;
-  guint32 ssrc;
-  GstRTPBuffer rtp = { NULL };
   GstPad *srcpad;
   GstRtpSsrcDemuxPad *dpad;
 
-  demux = GST_RTP_SSRC_DEMUX (parent);
-
-  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
-    goto invalid_payload;
-
-  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
-  gst_rtp_buffer_unmap (&rtp);
-
-  GST_DEBUG_OBJECT (demux, "received buffer of SSRC %08x", ssrc);
-
   srcpad = find_or_create_demux_pad_for_ssrc (demux, ssrc, RTP_PAD);
   if (srcpad == NULL)
     goto create_failed;
 
   /* push to srcpad */
-  ret = gst_pad_push (srcpad, buf);
+  if (is_list)
+    ret = gst_pad_push_list (srcpad, GST_BUFFER_LIST_CAST (data));
+  else
+    ret = gst_pad_push (srcpad, GST_BUFFER_CAST (data));
 
   if (ret != GST_FLOW_OK) {
     /* check if the ssrc still there, may have been removed */
@@ -649,6 +708,35 @@ gst_rtp_ssrc_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   return ret;
 
+  /* ERRORS */
+create_failed:
+  {
+    GST_ELEMENT_ERROR (demux, STREAM, DECODE, (NULL),
+        ("Could not create new pad"));
+    gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_rtp_ssrc_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstRtpSsrcDemux *demux;
+  guint32 ssrc;
+  GstRTPBuffer rtp = { NULL };
+
+  demux = GST_RTP_SSRC_DEMUX (parent);
+
+  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
+    goto invalid_payload;
+
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  GST_DEBUG_OBJECT (demux, "received buffer of SSRC %08x", ssrc);
+
+  return gst_rtp_ssrc_demux_push (demux, ssrc, buf, FALSE);
+
   /* ERRORS */
 invalid_payload:
   {
@@ -658,15 +746,94 @@ invalid_payload:
     gst_buffer_unref (buf);
     return GST_FLOW_ERROR;
   }
-create_failed:
+}
+
+typedef struct
+{
+  GstRtpSsrcDemux *demux;
+  /* consecutive packets of the same SSRC */
+  GstBufferList *run;
+  guint32 ssrc;
+  GstFlowReturn ret;
+} SplitListData;
+
+static gboolean
+split_list_item (GstBuffer ** buffer, guint idx, SplitListData * data)
+{
+  GstBuffer *buf;
+  guint32 ssrc;
+  GstRTPBuffer rtp = { NULL };
+
+  /* take the buffer out of the list, we keep the only reference */
+  buf = *buffer;
+  *buffer = NULL;
+
+  if (!gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp))
+    goto invalid_payload;
+
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (data->run && ssrc != data->ssrc) {
+    data->ret = gst_rtp_ssrc_demux_push (data->demux, data->ssrc, data->run,
+        TRUE);
+    data->run = NULL;
+    if (data->ret != GST_FLOW_OK) {
+      gst_buffer_unref (buf);
+      return FALSE;
+    }
+  }
+  if (data->run == NULL) {
+    data->run = gst_buffer_list_new ();
+    data->ssrc = ssrc;
+  }
+  gst_buffer_list_add (data->run, buf);
+
+  return TRUE;
+
+  /* ERRORS */
+invalid_payload:
   {
-    GST_ELEMENT_ERROR (demux, STREAM, DECODE, (NULL),
-        ("Could not create new pad"));
+    /* this is fatal and should be filtered earlier */
+    GST_ELEMENT_ERROR (data->demux, STREAM, DECODE, (NULL),
+        ("Dropping invalid RTP payload"));
     gst_buffer_unref (buf);
-    return GST_FLOW_ERROR;
+    data->ret = GST_FLOW_ERROR;
+    return FALSE;
   }
 }
 
+/* split the list in runs of packets with the same SSRC and push each run as a
+ * list */
+static GstFlowReturn
+gst_rtp_ssrc_demux_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  SplitListData data;
+
+  data.demux = GST_RTP_SSRC_DEMUX (parent);
+  data.run = NULL;
+  data.ssrc = 0;
+  data.ret = GST_FLOW_OK;
+
+  GST_DEBUG_OBJECT (data.demux, "received list of %u buffers",
+      gst_buffer_list_length (list));
+
+  list = gst_buffer_list_make_writable (list);
+  gst_buffer_list_foreach (list, (GstBufferListFunc) split_list_item, &data);
+  gst_buffer_list_unref (list);
+
+  if (data.run) {
+    if (data.ret == GST_FLOW_OK)
+      data.ret = gst_rtp_ssrc_demux_push (data.demux, data.ssrc, data.run,
+          TRUE);
+    else
+      gst_buffer_list_unref (data.run);
+  }
+
+  return data.ret;
+}
+
 static GstFlowReturn
 gst_rtp_ssrc_demux_rtcp_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf)
@@ -31,6 +31,18 @@
 typedef struct _GstRtpSsrcDemux GstRtpSsrcDemux;
 typedef struct _GstRtpSsrcDemuxClass GstRtpSsrcDemuxClass;
 typedef struct _GstRtpSsrcDemuxPad GstRtpSsrcDemuxPad;
+typedef struct _GstRtpSsrcDemuxCache GstRtpSsrcDemuxCache;
+
+/* the pads that were looked up from the streaming thread of a sink pad */
+struct _GstRtpSsrcDemuxCache
+{
+  /* SSRC -> GstPad, without refs */
+  GHashTable *pads;
+  /* the generation of the demuxer the pads are valid for */
+  gint generation;
+  /* number of lookups in progress */
+  gint readers;
+};
 
 struct _GstRtpSsrcDemux
 {
@@ -41,6 +53,13 @@ struct _GstRtpSsrcDemux
 
   GRecMutex padlock;
   GSList *srcpads;
+  /* SSRC -> GstRtpSsrcDemuxPad */
+  GHashTable *ssrcs;
+  /* changes when pads are removed, invalidates the caches */
+  gint generation;
+
+  GstRtpSsrcDemuxCache rtp_cache;
+  GstRtpSsrcDemuxCache rtcp_cache;
 };
 
 struct _GstRtpSsrcDemuxClass
@@ -0,0 +1,387 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * A process wide scheduler that runs many entries from a few threads.
+ *
+ * Timers are kept in a hashed timer wheel that is driven by the monotonic
+ * system time, with one slot per tick. Timers further away than the size of
+ * the wheel stay in their slot until the wheel comes around to their tick.
+ * A timer thread moves expired entries to a ready queue from which a small
+ * pool of worker threads runs them.
+ *
+ * Deadlines on a GstClock are converted to monotonic time when the timer is
+ * set. Users should check the clock again when their timer expires and set
+ * a new timer if it was too early.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtpscheduler.h"
+
+GST_DEBUG_CATEGORY_STATIC (rtp_scheduler_debug);
+#define GST_CAT_DEFAULT rtp_scheduler_debug
+
+/* number of worker threads when the number of processors is unknown */
+#define DEFAULT_THREADS         4
+/* upper limit for the number of worker threads */
+#define MAX_THREADS             64
+/* duration of a tick in microseconds */
+#define TICK                    1000
+/* number of slots in the wheel, must be a power of two */
+#define WHEEL_SIZE              1024
+#define WHEEL_MASK              (WHEEL_SIZE - 1)
+
+enum
+{
+  ENTRY_ACTIVE = (1 << 0),      /* entry can be scheduled */
+  ENTRY_QUEUED = (1 << 1),      /* in the ready queue */
+  ENTRY_TIMER = (1 << 2),       /* in a slot of the wheel */
+  ENTRY_RUNNING = (1 << 3),     /* running in a worker */
+  ENTRY_AGAIN = (1 << 4),       /* needs to run again after running */
+  ENTRY_TIMEOUT = (1 << 5)      /* timer expired */
+};
+
+struct _RTPScheduler
+{
+  GMutex lock;
+  GCond ready_cond;             /* entries were added to the ready queue */
+  GCond timer_cond;             /* wakes up the timer thread */
+  GCond idle_cond;              /* an entry stopped running */
+
+  GQueue ready;
+
+  GQueue wheel[WHEEL_SIZE];
+  guint n_timers;
+  gint64 tick;                  /* next tick to process */
+  gint64 wakeup_tick;           /* tick the timer thread sleeps until */
+};
+
+static void
+rtp_scheduler_queue_locked (RTPScheduler * sched, RTPSchedulerEntry * entry)
+{
+  if (!(entry->flags & ENTRY_ACTIVE) || (entry->flags & ENTRY_QUEUED))
+    return;
+
+  if (entry->flags & ENTRY_RUNNING) {
+    entry->flags |= ENTRY_AGAIN;
+    return;
+  }
+
+  entry->flags |= ENTRY_QUEUED;
+  g_queue_push_tail_link (&sched->ready, &entry->link);
+  g_cond_signal (&sched->ready_cond);
+}
+
+static void
+rtp_scheduler_cancel_timer_locked (RTPScheduler * sched,
+    RTPSchedulerEntry * entry)
+{
+  if (!(entry->flags & ENTRY_TIMER))
+    return;
+
+  g_queue_unlink (&sched->wheel[entry->tick & WHEEL_MASK], &entry->link);
+  entry->flags &= ~ENTRY_TIMER;
+  sched->n_timers--;
+}
+
+static gpointer
+rtp_scheduler_timer_thread (RTPScheduler * sched)
+{
+  gint64 now, now_tick, tick, last;
+  GList *l, *next;
+
+  g_mutex_lock (&sched->lock);
+  while (TRUE) {
+    now = g_get_monotonic_time ();
+    now_tick = now / TICK;
+
+    if (sched->n_timers == 0) {
+      sched->tick = now_tick + 1;
+      sched->wakeup_tick = G_MAXINT64;
+      g_cond_wait (&sched->timer_cond, &sched->lock);
+      continue;
+    }
+
+    /* run over the slots of all ticks that passed, at most once around */
+    last = MIN (now_tick, sched->tick + WHEEL_SIZE - 1);
+    for (tick = sched->tick; tick <= last; tick++) {
+      GQueue *slot = &sched->wheel[tick & WHEEL_MASK];
+
+      for (l = slot->head; l; l = next) {
+        RTPSchedulerEntry *entry = l->data;
+
+        next = l->next;
+        if (entry->tick > now_tick)
+          continue;
+
+        g_queue_unlink (slot, l);
+        entry->flags &= ~ENTRY_TIMER;
+        entry->flags |= ENTRY_TIMEOUT;
+        sched->n_timers--;
+        rtp_scheduler_queue_locked (sched, entry);
+      }
+    }
+    sched->tick = now_tick + 1;
+
+    if (sched->n_timers == 0)
+      continue;
+
+    /* sleep until the first tick with a timer in its slot */
+    for (tick = sched->tick; tick < sched->tick + WHEEL_SIZE; tick++)
+      if (sched->wheel[tick & WHEEL_MASK].head)
+        break;
+    sched->wakeup_tick = tick;
+    g_cond_wait_until (&sched->timer_cond, &sched->lock, tick * TICK);
+  }
+
+  return NULL;
+}
+
+static gpointer
+rtp_scheduler_worker_thread (RTPScheduler * sched)
+{
+  RTPSchedulerEntry *entry;
+  GList *link;
+  gboolean timeout;
+
+  g_mutex_lock (&sched->lock);
+  while (TRUE) {
+    while (!(link = g_queue_pop_head_link (&sched->ready)))
+      g_cond_wait (&sched->ready_cond, &sched->lock);
+
+    entry = link->data;
+    timeout = (entry->flags & ENTRY_TIMEOUT) != 0;
+    entry->flags &= ~(ENTRY_QUEUED | ENTRY_TIMEOUT);
+    entry->flags |= ENTRY_RUNNING;
+    entry->thread = g_thread_self ();
+    g_mutex_unlock (&sched->lock);
+
+    entry->func (entry, timeout, entry->user_data);
+
+    g_mutex_lock (&sched->lock);
+    entry->flags &= ~ENTRY_RUNNING;
+    entry->thread = NULL;
+    if (entry->flags & ENTRY_AGAIN) {
+      /* the link can only be in one queue, drop a timer that was set while
+       * we were running, we run again right away */
+      entry->flags &= ~ENTRY_AGAIN;
+      rtp_scheduler_cancel_timer_locked (sched, entry);
+      rtp_scheduler_queue_locked (sched, entry);
+    }
+    g_cond_broadcast (&sched->idle_cond);
+  }
+
+  return NULL;
+}
+
+static gpointer
+rtp_scheduler_create (gpointer data)
+{
+  RTPScheduler *sched;
+  GThread *thread;
+  const gchar *env;
+  gchar *name;
+  guint i, n_threads;
+
+  GST_DEBUG_CATEGORY_INIT (rtp_scheduler_debug, "rtpscheduler", 0,
+      "RTP shared scheduler");
+
+  sched = g_new0 (RTPScheduler, 1);
+  g_mutex_init (&sched->lock);
+  g_cond_init (&sched->ready_cond);
+  g_cond_init (&sched->timer_cond);
+  g_cond_init (&sched->idle_cond);
+  g_queue_init (&sched->ready);
+  for (i = 0; i < WHEEL_SIZE; i++)
+    g_queue_init (&sched->wheel[i]);
+  sched->tick = g_get_monotonic_time () / TICK + 1;
+  sched->wakeup_tick = G_MAXINT64;
+
+  /* the threads live as long as the process */
+  thread = g_thread_new ("rtpscheduler-timer",
+      (GThreadFunc) rtp_scheduler_timer_thread, sched);
+  g_thread_unref (thread);
+
+  /* one worker per processor, unless overridden from the environment */
+  n_threads = DEFAULT_THREADS;
+#if GLIB_CHECK_VERSION (2, 36, 0)
+  n_threads = g_get_num_processors ();
+#endif
+  if ((env = g_getenv ("GST_RTP_SCHEDULER_THREADS")) != NULL)
+    n_threads = strtoul (env, NULL, 10);
+  n_threads = CLAMP (n_threads, 1, MAX_THREADS);
+
+  for (i = 0; i < n_threads; i++) {
+    name = g_strdup_printf ("rtpscheduler-%u", i);
+    thread = g_thread_new (name, (GThreadFunc) rtp_scheduler_worker_thread,
+        sched);
+    g_thread_unref (thread);
+    g_free (name);
+  }
+
+  GST_DEBUG ("created scheduler with %u threads", n_threads);
+
+  return sched;
+}
+
+/**
+ * rtp_scheduler_get_default:
+ *
+ * Get the scheduler that is shared by the whole process. It is created
+ * together with its threads the first time it is needed.
+ *
+ * Returns: the default #RTPScheduler
+ */
+RTPScheduler *
+rtp_scheduler_get_default (void)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once (&once, rtp_scheduler_create, NULL);
+
+  return once.retval;
+}
+
+/**
+ * rtp_scheduler_entry_init:
+ * @entry: an #RTPSchedulerEntry
+ * @func: the function to run
+ * @user_data: user data for @func
+ *
+ * Initialize @entry.
+ */
+void
+rtp_scheduler_entry_init (RTPSchedulerEntry * entry, RTPSchedulerFunc func,
+    gpointer user_data)
+{
+  memset (entry, 0, sizeof (RTPSchedulerEntry));
+  entry->link.data = entry;
+  entry->func = func;
+  entry->user_data = user_data;
+}
+
+/**
+ * rtp_scheduler_add:
+ * @sched: an #RTPScheduler
+ * @entry: an #RTPSchedulerEntry
+ *
+ * Allow @entry to be run by @sched. The entry runs for the first time when
+ * it is woken up or its timer expires.
+ */
+void
+rtp_scheduler_add (RTPScheduler * sched, RTPSchedulerEntry * entry)
+{
+  g_mutex_lock (&sched->lock);
+  entry->flags |= ENTRY_ACTIVE;
+  g_mutex_unlock (&sched->lock);
+}
+
+/**
+ * rtp_scheduler_remove:
+ * @sched: an #RTPScheduler
+ * @entry: an #RTPSchedulerEntry
+ *
+ * Stop running @entry. When it is running in another thread, this function
+ * waits until it has finished. After this function returns, @entry will not
+ * run until it is added again.
+ */
+void
+rtp_scheduler_remove (RTPScheduler * sched, RTPSchedulerEntry * entry)
+{
+  g_mutex_lock (&sched->lock);
+  entry->flags &= ~(ENTRY_ACTIVE | ENTRY_AGAIN | ENTRY_TIMEOUT);
+  rtp_scheduler_cancel_timer_locked (sched, entry);
+  if (entry->flags & ENTRY_QUEUED) {
+    g_queue_unlink (&sched->ready, &entry->link);
+    entry->flags &= ~ENTRY_QUEUED;
+  }
+  /* can't wait for ourselves when called from the entry function */
+  while ((entry->flags & ENTRY_RUNNING) && entry->thread != g_thread_self ())
+    g_cond_wait (&sched->idle_cond, &sched->lock);
+  g_mutex_unlock (&sched->lock);
+}
+
+/**
+ * rtp_scheduler_wakeup:
+ * @sched: an #RTPScheduler
+ * @entry: an #RTPSchedulerEntry
+ *
+ * Run @entry as soon as possible. A pending timer of @entry is cancelled.
+ * When @entry is running already, it will run once more afterwards.
+ */
+void
+rtp_scheduler_wakeup (RTPScheduler * sched, RTPSchedulerEntry * entry)
+{
+  g_mutex_lock (&sched->lock);
+  rtp_scheduler_cancel_timer_locked (sched, entry);
+  rtp_scheduler_queue_locked (sched, entry);
+  g_mutex_unlock (&sched->lock);
+}
+
+/**
+ * rtp_scheduler_schedule:
+ * @sched: an #RTPScheduler
+ * @entry: an #RTPSchedulerEntry
+ * @clock: a #GstClock
+ * @time: the time on @clock to run @entry
+ *
+ * Run @entry when @clock reaches @time. This replaces a pending timer of
+ * @entry. Nothing happens when @entry is going to run already.
+ */
+void
+rtp_scheduler_schedule (RTPScheduler * sched, RTPSchedulerEntry * entry,
+    GstClock * clock, GstClockTime time)
+{
+  GstClockTime now;
+  gint64 deadline, tick;
+
+  now = gst_clock_get_time (clock);
+  deadline = g_get_monotonic_time ();
+  if (time > now)
+    deadline += (time - now) / GST_USECOND;
+  tick = (deadline + TICK - 1) / TICK;
+
+  g_mutex_lock (&sched->lock);
+  rtp_scheduler_cancel_timer_locked (sched, entry);
+
+  /* when queued or asked to run again after the current run, the entry will
+   * run anyway and can then schedule a new timer */
+  if (!(entry->flags & ENTRY_ACTIVE) ||
+      (entry->flags & (ENTRY_QUEUED | ENTRY_AGAIN)))
+    goto done;
+
+  if (tick < sched->tick) {
+    /* already expired */
+    entry->flags |= ENTRY_TIMEOUT;
+    rtp_scheduler_queue_locked (sched, entry);
+    goto done;
+  }
+
+  entry->tick = tick;
+  entry->flags |= ENTRY_TIMER;
+  g_queue_push_tail_link (&sched->wheel[tick & WHEEL_MASK], &entry->link);
+  sched->n_timers++;
+
+  if (tick < sched->wakeup_tick)
+    g_cond_signal (&sched->timer_cond);
+
+done:
+  g_mutex_unlock (&sched->lock);
+}
@@ -0,0 +1,74 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RTP_SCHEDULER_H__
+#define __RTP_SCHEDULER_H__
+
+#include <gst/gst.h>
+
+typedef struct _RTPScheduler RTPScheduler;
+typedef struct _RTPSchedulerEntry RTPSchedulerEntry;
+
+/**
+ * RTPSchedulerFunc:
+ * @entry: the entry that runs
+ * @timeout: %TRUE when the timer of the entry expired
+ * @user_data: user data of @entry
+ *
+ * Called from one of the threads of the scheduler. An entry never runs in
+ * two threads at the same time.
+ */
+typedef void (*RTPSchedulerFunc) (RTPSchedulerEntry * entry, gboolean timeout,
+    gpointer user_data);
+
+/**
+ * RTPSchedulerEntry:
+ *
+ * Something that is run by the scheduler, either as soon as possible after
+ * rtp_scheduler_wakeup() or when its timer expires. The entry is usually
+ * embedded in the structure of its user so that scheduling never allocates.
+ */
+struct _RTPSchedulerEntry {
+  /*< private >*/
+  GList             link;       /* in the ready queue or a wheel slot */
+  guint             flags;
+  gint64            tick;       /* wheel tick of the timer */
+  GThread          *thread;     /* thread running the entry */
+  RTPSchedulerFunc  func;
+  gpointer          user_data;
+};
+
+RTPScheduler *  rtp_scheduler_get_default   (void);
+
+void            rtp_scheduler_entry_init    (RTPSchedulerEntry * entry,
+                                             RTPSchedulerFunc func,
+                                             gpointer user_data);
+
+void            rtp_scheduler_add           (RTPScheduler * sched,
+                                             RTPSchedulerEntry * entry);
+void            rtp_scheduler_remove        (RTPScheduler * sched,
+                                             RTPSchedulerEntry * entry);
+
+void            rtp_scheduler_wakeup        (RTPScheduler * sched,
+                                             RTPSchedulerEntry * entry);
+void            rtp_scheduler_schedule      (RTPScheduler * sched,
+                                             RTPSchedulerEntry * entry,
+                                             GstClock * clock,
+                                             GstClockTime time);
+
+#endif /* __RTP_SCHEDULER_H__ */
@@ -854,6 +854,10 @@ rtp_session_set_callbacks (RTPSession * sess, RTPSessionCallbacks * callbacks,
     sess->callbacks.request_time = callbacks->request_time;
     sess->request_time_user_data = user_data;
   }
+  if (callbacks->notify_nack) {
+    sess->callbacks.notify_nack = callbacks->notify_nack;
+    sess->notify_nack_user_data = user_data;
+  }
 }
 
 /**
@@ -1171,14 +1175,19 @@ source_push_rtp (RTPSource * source, gpointer data, RTPSession * session)
     else {
       gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
     }
+  } else if (session->recv_list) {
+    /* processing a list, collect the packet and push them all at once */
+    GST_LOG ("source %08x collected receiver RTP packet", source->ssrc);
+    gst_buffer_list_add (session->recv_list, GST_BUFFER_CAST (data));
+    return GST_FLOW_OK;
   } else {
     GST_LOG ("source %08x pushed receiver RTP packet", source->ssrc);
     RTP_SESSION_UNLOCK (session);
 
     if (session->callbacks.process_rtp)
       result =
-          session->callbacks.process_rtp (session, source,
-          GST_BUFFER_CAST (data), session->process_rtp_user_data);
+          session->callbacks.process_rtp (session, source, data,
+          session->process_rtp_user_data);
     else
       gst_buffer_unref (GST_BUFFER_CAST (data));
   }
@@ -1682,51 +1691,37 @@ clean_arrival_stats (RTPArrivalStats * arrival)
     g_object_unref (arrival->address);
 }
 
-/**
- * rtp_session_process_rtp:
- * @sess: and #RTPSession
- * @buffer: an RTP buffer
- * @current_time: the current system time
- * @running_time: the running_time of @buffer
- *
- * Process an RTP buffer in the session manager. This function takes ownership
- * of @buffer.
- *
- * Returns: a #GstFlowReturn.
- */
-GstFlowReturn
-rtp_session_process_rtp (RTPSession * sess, GstBuffer * buffer,
-    GstClockTime current_time, GstClockTime running_time)
+/* process one RTP packet, takes ownership of @buffer. Must be called with
+ * the SESSION_LOCK */
+static GstFlowReturn
+process_rtp_locked (RTPSession * sess, GstBuffer * buffer,
+    RTPArrivalStats * arrival, GstClockTime current_time,
+    GstClockTime running_time)
 {
   GstFlowReturn result;
   guint32 ssrc;
   RTPSource *source;
   gboolean created;
   gboolean prevsender, prevactive;
-  RTPArrivalStats arrival = { NULL, };
   guint32 csrcs[16];
   guint8 i, count;
   guint64 oldrate;
   GstRTPBuffer rtp = { NULL };
 
-  g_return_val_if_fail (RTP_IS_SESSION (sess), GST_FLOW_ERROR);
-  g_return_val_if_fail (GST_IS_BUFFER (buffer), GST_FLOW_ERROR);
-
   if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp))
     goto invalid_packet;
 
-  RTP_SESSION_LOCK (sess);
   /* ignore more RTP packets when we left the session */
   if (sess->source->received_bye)
     goto ignore;
 
   /* update arrival stats */
-  update_arrival_stats (sess, &arrival, TRUE, buffer, current_time,
+  update_arrival_stats (sess, arrival, TRUE, buffer, current_time,
       running_time, -1);
 
   /* get SSRC and look up in session database */
   ssrc = gst_rtp_buffer_get_ssrc (&rtp);
-  source = obtain_source (sess, ssrc, &created, &arrival, TRUE);
+  source = obtain_source (sess, ssrc, &created, arrival, TRUE);
   if (!source)
     goto collision;
 
@@ -1746,7 +1741,7 @@ rtp_session_process_rtp (RTPSession * sess, GstBuffer * buffer,
   oldrate = source->bitrate;
 
   /* let source process the packet */
-  result = rtp_source_process_rtp (source, buffer, &arrival);
+  result = rtp_source_process_rtp (source, buffer, arrival);
 
   /* source became active */
   if (prevactive != RTP_SOURCE_IS_ACTIVE (source)) {
@@ -1777,7 +1772,7 @@ rtp_session_process_rtp (RTPSession * sess, GstBuffer * buffer,
       csrc = csrcs[i];
 
       /* get source */
-      csrc_src = obtain_source (sess, csrc, &created, &arrival, TRUE);
+      csrc_src = obtain_source (sess, csrc, &created, arrival, TRUE);
       if (!csrc_src)
         continue;
 
@@ -1793,10 +1788,6 @@ rtp_session_process_rtp (RTPSession * sess, GstBuffer * buffer,
   }
   g_object_unref (source);
 
-  RTP_SESSION_UNLOCK (sess);
-
-  clean_arrival_stats (&arrival);
-
   return result;
 
   /* ERRORS */
@@ -1808,7 +1799,6 @@ invalid_packet:
   }
 ignore:
   {
-    RTP_SESSION_UNLOCK (sess);
     gst_rtp_buffer_unmap (&rtp);
     gst_buffer_unref (buffer);
     GST_DEBUG ("ignoring RTP packet because we are leaving");
@@ -1816,15 +1806,109 @@ ignore:
   }
 collision:
   {
-    RTP_SESSION_UNLOCK (sess);
     gst_rtp_buffer_unmap (&rtp);
     gst_buffer_unref (buffer);
-    clean_arrival_stats (&arrival);
     GST_DEBUG ("ignoring packet because its collisioning");
     return GST_FLOW_OK;
   }
 }
 
+/**
+ * rtp_session_process_rtp:
+ * @sess: and #RTPSession
+ * @buffer: an RTP buffer
+ * @current_time: the current system time
+ * @running_time: the running_time of @buffer
+ *
+ * Process an RTP buffer in the session manager. This function takes ownership
+ * of @buffer.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+GstFlowReturn
+rtp_session_process_rtp (RTPSession * sess, GstBuffer * buffer,
+    GstClockTime current_time, GstClockTime running_time)
+{
+  GstFlowReturn result;
+  RTPArrivalStats arrival = { NULL, };
+
+  g_return_val_if_fail (RTP_IS_SESSION (sess), GST_FLOW_ERROR);
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), GST_FLOW_ERROR);
+
+  RTP_SESSION_LOCK (sess);
+  result = process_rtp_locked (sess, buffer, &arrival, current_time,
+      running_time);
+  RTP_SESSION_UNLOCK (sess);
+
+  clean_arrival_stats (&arrival);
+
+  return result;
+}
+
+/**
+ * rtp_session_process_rtp_list:
+ * @sess: and #RTPSession
+ * @list: a list of RTP buffers
+ * @current_time: the current system time
+ * @running_time: the running_time of @list
+ *
+ * Process a list of RTP buffers in the session manager. All packets are
+ * handled with the session lock taken only once and the packets that are
+ * ready for further processing are passed on as one list. This function takes
+ * ownership of @list.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+GstFlowReturn
+rtp_session_process_rtp_list (RTPSession * sess, GstBufferList * list,
+    GstClockTime current_time, GstClockTime running_time)
+{
+  GstFlowReturn result;
+  RTPArrivalStats arrival = { NULL, };
+  GstBufferList *out;
+  guint i, len;
+
+  g_return_val_if_fail (RTP_IS_SESSION (sess), GST_FLOW_ERROR);
+  g_return_val_if_fail (GST_IS_BUFFER_LIST (list), GST_FLOW_ERROR);
+
+  len = gst_buffer_list_length (list);
+
+  RTP_SESSION_LOCK (sess);
+  /* the receiver sources add the packets they push to this list */
+  sess->recv_list = gst_buffer_list_new_sized (len);
+  for (i = 0; i < len; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (list, i);
+
+    process_rtp_locked (sess, gst_buffer_ref (buffer), &arrival,
+        current_time, running_time);
+  }
+  out = sess->recv_list;
+  sess->recv_list = NULL;
+  RTP_SESSION_UNLOCK (sess);
+
+  clean_arrival_stats (&arrival);
+  /* drop our list first so that the packets are writable downstream */
+  gst_buffer_list_unref (list);
+
+  if (gst_buffer_list_length (out) == 0) {
+    gst_buffer_list_unref (out);
+    return GST_FLOW_OK;
+  }
+
+  GST_LOG ("pushing list of %u received RTP packets",
+      gst_buffer_list_length (out));
+
+  if (sess->callbacks.process_rtp)
+    result = sess->callbacks.process_rtp (sess, NULL, out,
+        sess->process_rtp_user_data);
+  else {
+    gst_buffer_list_unref (out);
+    result = GST_FLOW_OK;
+  }
+
+  return result;
+}
+
 static void
 rtp_session_process_rb (RTPSession * sess, RTPSource * source,
     GstRTCPPacket * packet, RTPArrivalStats * arrival)
@@ -2235,6 +2319,33 @@ rtp_session_process_fir (RTPSession * sess, guint32 sender_ssrc,
   rtp_session_request_local_key_unit (sess, src, TRUE, current_time);
 }
 
+static void
+rtp_session_process_nack (RTPSession * sess, guint32 sender_ssrc,
+    guint32 media_ssrc, guint8 * fci_data, guint fci_length,
+    GstClockTime current_time)
+{
+  if (!sess->callbacks.notify_nack)
+    return;
+
+  /* every FCI entry has a PID and a bitmask of following lost packets */
+  while (fci_length >= 4) {
+    guint16 seqnum, blp;
+
+    seqnum = GST_READ_UINT16_BE (fci_data);
+    blp = GST_READ_UINT16_BE (fci_data + 2);
+
+    GST_DEBUG ("NACK #%u, blp %04x, SSRC 0x%08x", seqnum, blp, media_ssrc);
+
+    RTP_SESSION_UNLOCK (sess);
+    sess->callbacks.notify_nack (sess, seqnum, blp, media_ssrc,
+        sess->notify_nack_user_data);
+    RTP_SESSION_LOCK (sess);
+
+    fci_data += 4;
+    fci_length -= 4;
+  }
+}
+
 static void
 rtp_session_process_feedback (RTPSession * sess, GstRTCPPacket * packet,
     RTPArrivalStats * arrival, GstClockTime current_time)
@@ -2296,6 +2407,15 @@ rtp_session_process_feedback (RTPSession * sess, GstRTCPPacket * packet,
         }
         break;
       case GST_RTCP_TYPE_RTPFB:
+        switch (fbtype) {
+          case GST_RTCP_RTPFB_TYPE_NACK:
+            rtp_session_process_nack (sess, sender_ssrc, media_ssrc,
+                fci_data, fci_length, current_time);
+            break;
+          default:
+            break;
+        }
+        break;
       default:
         break;
     }
@@ -2443,6 +2563,9 @@ ignore:
 void
 rtp_session_update_send_caps (RTPSession * sess, GstCaps * caps)
 {
+  GstStructure *s;
+  guint rtx_ssrc = 0;
+
   g_return_if_fail (RTP_IS_SESSION (sess));
   g_return_if_fail (GST_IS_CAPS (caps));
 
@@ -2450,9 +2573,38 @@ rtp_session_update_send_caps (RTPSession * sess, GstCaps * caps)
 
   RTP_SESSION_LOCK (sess);
   rtp_source_update_caps (sess->source, caps);
+  /* set by rtprtxsend on the caps of the stream it adds retransmissions to */
+  s = gst_caps_get_structure (caps, 0);
+  sess->have_rtx_ssrc = gst_structure_get_uint (s, "rtx-ssrc", &rtx_ssrc);
+  sess->rtx_ssrc = rtx_ssrc;
   RTP_SESSION_UNLOCK (sess);
 }
 
+/* check if @data are retransmissions of the RTX SSRC. Must be called with the
+ * session lock */
+static gboolean
+is_rtx_packet (RTPSession * sess, gpointer data, gboolean is_list)
+{
+  GstBuffer *buffer;
+  GstRTPBuffer rtp = { NULL };
+  guint32 ssrc;
+
+  if (!sess->have_rtx_ssrc)
+    return FALSE;
+
+  if (is_list)
+    buffer = gst_buffer_list_get (GST_BUFFER_LIST_CAST (data), 0);
+  else
+    buffer = GST_BUFFER_CAST (data);
+
+  if (buffer == NULL || !gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp))
+    return FALSE;
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return ssrc == sess->rtx_ssrc;
+}
+
 /**
  * rtp_session_send_rtp:
  * @sess: an #RTPSession
@@ -2483,6 +2635,15 @@ rtp_session_send_rtp (RTPSession * sess, gpointer data, gboolean is_list,
   RTP_SESSION_LOCK (sess);
   source = sess->source;
 
+  if (is_rtx_packet (sess, data, is_list)) {
+    /* the retransmission stream has its own sequence numbers and SSRC, it is
+     * pushed unchanged and doesn't count in the sender stats of our source */
+    GST_LOG ("pushing RTX %s", is_list ? "list" : "packet");
+    result = source_push_rtp (source, data, sess);
+    RTP_SESSION_UNLOCK (sess);
+    return result;
+  }
+
   /* update last activity */
   source->last_rtp_activity = current_time;
 
@@ -3317,6 +3478,46 @@ rtp_session_request_key_unit (RTPSession * sess, guint32 ssrc, GstClockTime now,
   return TRUE;
 }
 
+/**
+ * rtp_session_request_nack:
+ * @sess: a #RTPSession
+ * @ssrc: the SSRC of the media source
+ * @seqnum: the missing seqnum
+ * @now: the current time
+ * @max_delay: the maximum delay after which the NACK is not useful anymore
+ *
+ * Register a Generic NACK for @seqnum of @ssrc and schedule an early RTCP
+ * packet to send it.
+ *
+ * Returns: %TRUE if the NACK was registered.
+ */
+gboolean
+rtp_session_request_nack (RTPSession * sess, guint32 ssrc, guint16 seqnum,
+    GstClockTime now, GstClockTimeDiff max_delay)
+{
+  RTPSource *source;
+
+  RTP_SESSION_LOCK (sess);
+  source = g_hash_table_lookup (sess->ssrcs[sess->mask_idx],
+      GUINT_TO_POINTER (ssrc));
+  if (source == NULL)
+    goto no_source;
+
+  GST_DEBUG ("request NACK for %08x, #%u", ssrc, seqnum);
+  rtp_source_register_nack (source, seqnum);
+  RTP_SESSION_UNLOCK (sess);
+
+  rtp_session_request_early_rtcp (sess, now, max_delay);
+
+  return TRUE;
+
+no_source:
+  {
+    RTP_SESSION_UNLOCK (sess);
+    return FALSE;
+  }
+}
+
 static gboolean
 has_pli_compare_func (gconstpointer a, gconstpointer ignored)
 {
@@ -3337,6 +3538,67 @@ has_pli_compare_func (gconstpointer a, gconstpointer ignored)
   return ret;
 }
 
+/* add a Generic NACK for the registered seqnums of @media_src. The seqnums
+ * that follow a PID closely enough are folded into its bitmask. */
+static gboolean
+rtp_session_add_nacks (RTPSession * sess, GstRTCPBuffer * rtcp,
+    RTPSource * media_src)
+{
+  GstRTCPPacket nack;
+  guint16 *nacks;
+  guint n_nacks, n_fci, i, j;
+  guint8 *fci_data;
+
+  nacks = rtp_source_get_nacks (media_src, &n_nacks);
+
+  /* count the FCI entries first, the FCI length can only be set once */
+  for (i = 0, n_fci = 0; i < n_nacks; i = j, n_fci++) {
+    for (j = i + 1; j < n_nacks; j++) {
+      gint diff = gst_rtp_buffer_compare_seqnum (nacks[i], nacks[j]);
+
+      if (diff < 1 || diff > 16)
+        break;
+    }
+  }
+
+  if (!gst_rtcp_buffer_add_packet (rtcp, GST_RTCP_TYPE_RTPFB, &nack))
+    return FALSE;
+
+  gst_rtcp_packet_fb_set_type (&nack, GST_RTCP_RTPFB_TYPE_NACK);
+  gst_rtcp_packet_fb_set_sender_ssrc (&nack,
+      rtp_source_get_ssrc (sess->source));
+  gst_rtcp_packet_fb_set_media_ssrc (&nack, rtp_source_get_ssrc (media_src));
+
+  if (!gst_rtcp_packet_fb_set_fci_length (&nack, n_fci)) {
+    /* does not fit, try again in the next packet */
+    gst_rtcp_packet_remove (&nack);
+    return FALSE;
+  }
+
+  fci_data = gst_rtcp_packet_fb_get_fci (&nack);
+  for (i = 0; i < n_nacks; i = j) {
+    guint16 blp = 0;
+
+    for (j = i + 1; j < n_nacks; j++) {
+      gint diff = gst_rtp_buffer_compare_seqnum (nacks[i], nacks[j]);
+
+      if (diff < 1 || diff > 16)
+        break;
+      blp |= 1 << (diff - 1);
+    }
+    GST_DEBUG ("sending NACK #%u, blp %04x, SSRC 0x%08x", nacks[i], blp,
+        rtp_source_get_ssrc (media_src));
+
+    GST_WRITE_UINT16_BE (fci_data, nacks[i]);
+    GST_WRITE_UINT16_BE (fci_data + 2, blp);
+    fci_data += 4;
+  }
+
+  rtp_source_clear_nacks (media_src);
+
+  return TRUE;
+}
+
 static gboolean
 rtp_session_on_sending_rtcp (RTPSession * sess, GstBuffer * buffer,
     gboolean early)
@@ -3412,6 +3674,18 @@ rtp_session_on_sending_rtcp (RTPSession * sess, GstBuffer * buffer,
     }
     media_src->send_pli = FALSE;
   }
+
+  g_hash_table_iter_init (&iter, sess->ssrcs[sess->mask_idx]);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    RTPSource *media_src = value;
+
+    if (media_src->send_nack) {
+      if (!rtp_session_add_nacks (sess, &rtcp, media_src))
+        /* packet is full, the NACKs go in a further packet */
+        break;
+      ret = TRUE;
+    }
+  }
   gst_rtcp_buffer_unmap (&rtcp);
 
   RTP_SESSION_UNLOCK (sess);
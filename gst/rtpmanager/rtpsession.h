@@ -40,17 +40,17 @@ typedef struct _RTPSessionClass RTPSessionClass;
 /**
  * RTPSessionProcessRTP:
  * @sess: an #RTPSession
- * @src: the #RTPSource
- * @buffer: the RTP buffer ready for processing
+ * @src: the #RTPSource or %NULL for a list
+ * @data: the RTP buffer or buffer list ready for processing
  * @user_data: user data specified when registering
  *
- * This callback will be called when @sess has @buffer ready for further
+ * This callback will be called when @sess has @data ready for further
  * processing. Processing the buffer typically includes decoding and displaying
  * the buffer.
  *
  * Returns: a #GstFlowReturn.
  */
-typedef GstFlowReturn (*RTPSessionProcessRTP) (RTPSession *sess, RTPSource *src, GstBuffer *buffer, gpointer user_data);
+typedef GstFlowReturn (*RTPSessionProcessRTP) (RTPSession *sess, RTPSource *src, gpointer data, gpointer user_data);
 
 /**
  * RTPSessionSendRTP:
@@ -143,6 +143,20 @@ typedef void (*RTPSessionRequestKeyUnit) (RTPSession *sess,
 typedef GstClockTime (*RTPSessionRequestTime) (RTPSession *sess,
     gpointer user_data);
 
+/**
+ * RTPSessionNotifyNACK:
+ * @sess: an #RTPSession
+ * @seqnum: the missing seqnum
+ * @blp: bitmask of the 16 seqnums following @seqnum that are missing as well
+ * @ssrc: the SSRC of the media source the packets were sent with
+ * @user_data: user data specified when registering
+ *
+ * Notifies of a Generic NACK for packets that were sent by us. The packets
+ * should be retransmitted when possible.
+ */
+typedef void (*RTPSessionNotifyNACK) (RTPSession *sess,
+    guint16 seqnum, guint16 blp, guint32 ssrc, gpointer user_data);
+
 /**
  * RTPSessionCallbacks:
  * @RTPSessionProcessRTP: callback to process RTP packets
@@ -151,6 +165,8 @@ typedef GstClockTime (*RTPSessionRequestTime) (RTPSession *sess,
  * @RTPSessionSyncRTCP: callback for handling SR packets
  * @RTPSessionReconsider: callback for reconsidering the timeout
  * @RTPSessionRequestKeyUnit: callback for requesting a new key unit
+ * @RTPSessionRequestTime: callback for requesting the current time
+ * @RTPSessionNotifyNACK: callback for notifying a NACK
  *
  * These callbacks can be installed on the session manager to get notification
  * when RTP and RTCP packets are ready for further processing. These callbacks
@@ -165,6 +181,7 @@ typedef struct {
   RTPSessionReconsider  reconsider;
   RTPSessionRequestKeyUnit request_key_unit;
   RTPSessionRequestTime request_time;
+  RTPSessionNotifyNACK  notify_nack;
 } RTPSessionCallbacks;
 
 /**
@@ -199,6 +216,10 @@ struct _RTPSession {
   guint        rtcp_rs_bandwidth;
 
   RTPSource    *source;
+  /* SSRC of the RFC 4588 retransmissions sent next to the packets of source,
+   * they are sent unchanged */
+  gboolean      have_rtx_ssrc;
+  guint32       rtx_ssrc;
 
   /* for sender/receiver counting */
   guint32       key;
@@ -228,9 +249,13 @@ struct _RTPSession {
   gpointer              reconsider_user_data;
   gpointer              request_key_unit_user_data;
   gpointer              request_time_user_data;
+  gpointer              notify_nack_user_data;
 
   RTPSessionStats stats;
 
+  /* collects the received packets while processing a list */
+  GstBufferList *recv_list;
+
   gboolean      change_ssrc;
   gboolean      favor_new;
   GstClockTime  rtcp_feedback_retention_window;
@@ -328,6 +353,9 @@ RTPSource*      rtp_session_create_source          (RTPSession *sess);
 GstFlowReturn   rtp_session_process_rtp            (RTPSession *sess, GstBuffer *buffer,
                                                     GstClockTime current_time,
 						    GstClockTime running_time);
+GstFlowReturn   rtp_session_process_rtp_list       (RTPSession *sess, GstBufferList *list,
+                                                    GstClockTime current_time,
+                                                    GstClockTime running_time);
 GstFlowReturn   rtp_session_process_rtcp           (RTPSession *sess, GstBuffer *buffer,
                                                     GstClockTime current_time,
                                                     guint64 ntpnstime);
@@ -357,4 +385,11 @@ gboolean        rtp_session_request_key_unit       (RTPSession * sess,
                                                     gboolean fir,
                                                     gint count);
 
+/* Notify session of a missing packet that should be retransmitted */
+gboolean        rtp_session_request_nack           (RTPSession * sess,
+                                                    guint32 ssrc,
+                                                    guint16 seqnum,
+                                                    GstClockTime now,
+                                                    GstClockTimeDiff max_delay);
+
 #endif /* __RTP_SESSION_H__ */
@@ -248,6 +248,7 @@ rtp_source_init (RTPSource * src)
   src->last_rtptime = -1;
 
   src->retained_feedback = g_queue_new ();
+  src->nacks = g_array_new (FALSE, FALSE, sizeof (guint16));
 
   rtp_source_reset (src);
 }
@@ -285,6 +286,8 @@ rtp_source_finalize (GObject * object)
     gst_buffer_unref (buffer);
   g_queue_free (src->retained_feedback);
 
+  g_array_free (src->nacks, TRUE);
+
   if (src->rtp_from)
     g_object_unref (src->rtp_from);
   if (src->rtcp_from)
@@ -1872,3 +1875,56 @@ rtp_source_has_retained (RTPSource * src, GCompareFunc func, gconstpointer data)
   else
     return FALSE;
 }
+
+/**
+ * rtp_source_register_nack:
+ * @src: The #RTPSource
+ * @seqnum: a seqnum
+ *
+ * Register that @seqnum has not been received from @src. A Generic NACK for it
+ * will be sent in the next RTCP packet.
+ */
+void
+rtp_source_register_nack (RTPSource * src, guint16 seqnum)
+{
+  guint i;
+
+  for (i = 0; i < src->nacks->len; i++) {
+    if (g_array_index (src->nacks, guint16, i) == seqnum)
+      return;
+  }
+  g_array_append_val (src->nacks, seqnum);
+  src->send_nack = TRUE;
+}
+
+/**
+ * rtp_source_get_nacks:
+ * @src: The #RTPSource
+ * @n_nacks: result number of nacks
+ *
+ * Get the registered NACKS since the last rtp_source_clear_nacks().
+ *
+ * Returns: an array of @n_nacks seqnum values, in the order they were
+ * registered.
+ */
+guint16 *
+rtp_source_get_nacks (RTPSource * src, guint * n_nacks)
+{
+  if (n_nacks)
+    *n_nacks = src->nacks->len;
+
+  return (guint16 *) src->nacks->data;
+}
+
+/**
+ * rtp_source_clear_nacks:
+ * @src: The #RTPSource
+ *
+ * Forget the registered NACKS after they were sent.
+ */
+void
+rtp_source_clear_nacks (RTPSource * src)
+{
+  g_array_set_size (src->nacks, 0);
+  src->send_nack = FALSE;
+}
@@ -88,6 +88,14 @@
  * fields will be each a nested #GstValueArray. The first dimension are the
  * channels and the second dimension are the values.
  *
+ * If the #GstSpectrum:message-compact property is %TRUE, the magnitude and
+ * phase fields are instead a #GstBuffer containing the values as native
+ * endian #gfloat, with all bands of the first channel followed by all bands
+ * of the next one. The message then also contains the #guint fields
+ * <classname>&quot;bands&quot;</classname> and
+ * <classname>&quot;channels&quot;</classname>. This is much cheaper to create
+ * and to parse for large numbers of bands or short intervals.
+ *
  * <refsect2>
  * <title>Example application</title>
  * |[
@@ -128,6 +136,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_spectrum_debug);
 #define DEFAULT_BANDS			128
 #define DEFAULT_THRESHOLD		-60
 #define DEFAULT_MULTI_CHANNEL		FALSE
+#define DEFAULT_MESSAGE_COMPACT		FALSE
 
 enum
 {
@@ -138,7 +147,8 @@ enum
   PROP_INTERVAL,
   PROP_BANDS,
   PROP_THRESHOLD,
-  PROP_MULTI_CHANNEL
+  PROP_MULTI_CHANNEL,
+  PROP_MESSAGE_COMPACT
 };
 
 #define gst_spectrum_parent_class parent_class
@@ -217,6 +227,12 @@ gst_spectrum_class_init (GstSpectrumClass * klass)
           "Send separate results for each channel",
           DEFAULT_MULTI_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_MESSAGE_COMPACT,
+      g_param_spec_boolean ("message-compact", "Compact messages",
+          "Store magnitude and phase of all channels in a buffer of floats "
+          "instead of lists of values in 'spectrum' element messages",
+          DEFAULT_MESSAGE_COMPACT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (gst_spectrum_debug, "spectrum", 0,
       "audio spectrum analyser element");
 
@@ -241,6 +257,7 @@ gst_spectrum_init (GstSpectrum * spectrum)
   spectrum->interval = DEFAULT_INTERVAL;
   spectrum->bands = DEFAULT_BANDS;
   spectrum->threshold = DEFAULT_THRESHOLD;
+  spectrum->message_compact = DEFAULT_MESSAGE_COMPACT;
 
   g_mutex_init (&spectrum->lock);
 }
@@ -261,15 +278,28 @@ gst_spectrum_alloc_channel_data (GstSpectrum * spectrum)
   GST_DEBUG_OBJECT (spectrum, "allocating data for %d channels",
       spectrum->num_channels);
 
+  /* The FFTs of the channels run one after another, so they all use the
+   * same context with its twiddle factors and the same scratch memory */
+  spectrum->fft_ctx = gst_fft_f32_new (nfft, FALSE);
+  spectrum->input_tmp = g_new0 (gfloat, nfft);
+  spectrum->freqdata = g_new0 (GstFFTF32Complex, bands);
+
+  /* Calculate the window once instead of for every FFT */
+  spectrum->window = g_new (gfloat, nfft);
+  for (i = 0; i < nfft; i++)
+    spectrum->window[i] = 1.0;
+  gst_fft_f32_window (spectrum->fft_ctx, spectrum->window,
+      GST_FFT_WINDOW_HAMMING);
+
+  spectrum->spect_magnitude = g_new0 (gfloat, bands * spectrum->num_channels);
+  spectrum->spect_phase = g_new0 (gfloat, bands * spectrum->num_channels);
+
   spectrum->channel_data = g_new (GstSpectrumChannel, spectrum->num_channels);
   for (i = 0; i < spectrum->num_channels; i++) {
     cd = &spectrum->channel_data[i];
-    cd->fft_ctx = gst_fft_f32_new (nfft, FALSE);
     cd->input = g_new0 (gfloat, nfft);
-    cd->input_tmp = g_new0 (gfloat, nfft);
-    cd->freqdata = g_new0 (GstFFTF32Complex, bands);
-    cd->spect_magnitude = g_new0 (gfloat, bands);
-    cd->spect_phase = g_new0 (gfloat, bands);
+    cd->spect_magnitude = spectrum->spect_magnitude + i * bands;
+    cd->spect_phase = spectrum->spect_phase + i * bands;
   }
 }
 
@@ -285,16 +315,24 @@ gst_spectrum_free_channel_data (GstSpectrum * spectrum)
 
     for (i = 0; i < spectrum->num_channels; i++) {
       cd = &spectrum->channel_data[i];
-      if (cd->fft_ctx)
-        gst_fft_f32_free (cd->fft_ctx);
       g_free (cd->input);
-      g_free (cd->input_tmp);
-      g_free (cd->freqdata);
-      g_free (cd->spect_magnitude);
-      g_free (cd->spect_phase);
     }
     g_free (spectrum->channel_data);
     spectrum->channel_data = NULL;
+
+    if (spectrum->fft_ctx)
+      gst_fft_f32_free (spectrum->fft_ctx);
+    spectrum->fft_ctx = NULL;
+    g_free (spectrum->window);
+    spectrum->window = NULL;
+    g_free (spectrum->input_tmp);
+    spectrum->input_tmp = NULL;
+    g_free (spectrum->freqdata);
+    spectrum->freqdata = NULL;
+    g_free (spectrum->spect_magnitude);
+    spectrum->spect_magnitude = NULL;
+    g_free (spectrum->spect_phase);
+    spectrum->spect_phase = NULL;
   }
 }
 
@@ -376,6 +414,11 @@ gst_spectrum_set_property (GObject * object, guint prop_id,
       g_mutex_unlock (&filter->lock);
       break;
     }
+    case PROP_MESSAGE_COMPACT:
+      g_mutex_lock (&filter->lock);
+      filter->message_compact = g_value_get_boolean (value);
+      g_mutex_unlock (&filter->lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -410,6 +453,9 @@ gst_spectrum_get_property (GObject * object, guint prop_id,
     case PROP_MULTI_CHANNEL:
       g_value_set_boolean (value, filter->multi_channel);
       break;
+    case PROP_MESSAGE_COMPACT:
+      g_value_set_boolean (value, filter->message_compact);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -690,6 +736,18 @@ gst_spectrum_message_add_array (GValue * cv, gfloat * data, guint num_values)
   g_value_unset (&a);
 }
 
+static void
+gst_spectrum_message_add_buffer (GstStructure * s, const gchar * name,
+    gfloat * data, guint num_values)
+{
+  GstBuffer *buf;
+  gsize size = num_values * sizeof (gfloat);
+
+  buf = gst_buffer_new_wrapped (g_memdup (data, size), size);
+  gst_structure_set (s, name, GST_TYPE_BUFFER, buf, NULL);
+  gst_buffer_unref (buf);
+}
+
 static GstMessage *
 gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
     GstClockTime duration)
@@ -716,7 +774,20 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
       "running-time", G_TYPE_UINT64, running_time,
       "duration", G_TYPE_UINT64, duration, NULL);
 
-  if (!spectrum->multi_channel) {
+  if (spectrum->message_compact) {
+    guint num_values = spectrum->bands * spectrum->num_channels;
+
+    gst_structure_set (s, "bands", G_TYPE_UINT, spectrum->bands,
+        "channels", G_TYPE_UINT, spectrum->num_channels, NULL);
+    if (spectrum->message_magnitude) {
+      gst_spectrum_message_add_buffer (s, "magnitude",
+          spectrum->spect_magnitude, num_values);
+    }
+    if (spectrum->message_phase) {
+      gst_spectrum_message_add_buffer (s, "phase", spectrum->spect_phase,
+          num_values);
+    }
+  } else if (!spectrum->multi_channel) {
     cd = &spectrum->channel_data[0];
 
     if (spectrum->message_magnitude) {
@@ -764,17 +835,20 @@ gst_spectrum_run_fft (GstSpectrum * spectrum, GstSpectrumChannel * cd,
   guint bands = spectrum->bands;
   guint nfft = 2 * bands - 2;
   gint threshold = spectrum->threshold;
+  guint n = nfft - input_pos;
   gfloat *input = cd->input;
-  gfloat *input_tmp = cd->input_tmp;
+  gfloat *input_tmp = spectrum->input_tmp;
+  gfloat *window = spectrum->window;
   gfloat *spect_magnitude = cd->spect_magnitude;
   gfloat *spect_phase = cd->spect_phase;
-  GstFFTF32Complex *freqdata = cd->freqdata;
-  GstFFTF32 *fft_ctx = cd->fft_ctx;
-
-  for (i = 0; i < nfft; i++)
-    input_tmp[i] = input[(input_pos + i) % nfft];
+  GstFFTF32Complex *freqdata = spectrum->freqdata;
+  GstFFTF32 *fft_ctx = spectrum->fft_ctx;
 
-  gst_fft_f32_window (fft_ctx, input_tmp, GST_FFT_WINDOW_HAMMING);
+  /* Unwrap the ringbuffer and apply the window */
+  for (i = 0; i < n; i++)
+    input_tmp[i] = input[input_pos + i] * window[i];
+  for (; i < nfft; i++)
+    input_tmp[i] = input[i - n] * window[i];
 
   gst_fft_f32_fft (fft_ctx, input_tmp, freqdata);
 
@@ -800,37 +874,33 @@ gst_spectrum_run_fft (GstSpectrum * spectrum, GstSpectrumChannel * cd,
 }
 
 static void
-gst_spectrum_prepare_message_data (GstSpectrum * spectrum,
-    GstSpectrumChannel * cd)
+gst_spectrum_prepare_message_data (GstSpectrum * spectrum)
 {
   guint i;
-  guint bands = spectrum->bands;
+  guint num_values = spectrum->bands * spectrum->num_channels;
   guint num_fft = spectrum->num_fft;
 
   /* Calculate average */
   if (spectrum->message_magnitude) {
-    gfloat *spect_magnitude = cd->spect_magnitude;
-    for (i = 0; i < bands; i++)
+    gfloat *spect_magnitude = spectrum->spect_magnitude;
+    for (i = 0; i < num_values; i++)
       spect_magnitude[i] /= num_fft;
   }
   if (spectrum->message_phase) {
-    gfloat *spect_phase = cd->spect_phase;
-    for (i = 0; i < bands; i++)
+    gfloat *spect_phase = spectrum->spect_phase;
+    for (i = 0; i < num_values; i++)
       spect_phase[i] /= num_fft;
   }
 }
 
 static void
-gst_spectrum_reset_message_data (GstSpectrum * spectrum,
-    GstSpectrumChannel * cd)
+gst_spectrum_reset_message_data (GstSpectrum * spectrum)
 {
-  guint bands = spectrum->bands;
-  gfloat *spect_magnitude = cd->spect_magnitude;
-  gfloat *spect_phase = cd->spect_phase;
+  guint num_values = spectrum->bands * spectrum->num_channels;
 
   /* reset spectrum accumulators */
-  memset (spect_magnitude, 0, bands * sizeof (gfloat));
-  memset (spect_phase, 0, bands * sizeof (gfloat));
+  memset (spectrum->spect_magnitude, 0, num_values * sizeof (gfloat));
+  memset (spectrum->spect_phase, 0, num_values * sizeof (gfloat));
 }
 
 static GstFlowReturn
@@ -962,10 +1032,7 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
       if (spectrum->post_messages) {
         GstMessage *m;
 
-        for (c = 0; c < output_channels; c++) {
-          cd = &spectrum->channel_data[c];
-          gst_spectrum_prepare_message_data (spectrum, cd);
-        }
+        gst_spectrum_prepare_message_data (spectrum);
 
         m = gst_spectrum_message_new (spectrum, spectrum->message_ts,
             spectrum->interval);
@@ -977,10 +1044,7 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
         spectrum->message_ts +=
             gst_util_uint64_scale (spectrum->num_frames, GST_SECOND, rate);
 
-      for (c = 0; c < output_channels; c++) {
-        cd = &spectrum->channel_data[c];
-        gst_spectrum_reset_message_data (spectrum, cd);
-      }
+      gst_spectrum_reset_message_data (spectrum);
       spectrum->num_frames = 0;
       spectrum->num_fft = 0;
     }
@@ -92,6 +92,15 @@ static void gst_wavparse_get_property (GObject * object, guint prop_id,
 
 #define DEFAULT_IGNORE_LENGTH FALSE
 
+/* RF64 (EBU Tech 3306) is a RIFF file whose 32 bit sizes are set to
+ * 0xffffffff and replaced by the 64 bit sizes of a ds64 chunk */
+#define GST_RIFF_TAG_RF64 GST_MAKE_FOURCC ('R','F','6','4')
+#define GST_RIFF_TAG_ds64 GST_MAKE_FOURCC ('d','s','6','4')
+
+/* in pull mode we pull blocks of about this size from upstream and
+ * push sub-buffers of them downstream */
+#define PULL_BLOCK_SIZE (1024 * 1024)
+
 enum
 {
   PROP_0,
@@ -102,7 +111,7 @@ static GstStaticPadTemplate sink_template_factory =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("audio/x-wav")
+    GST_STATIC_CAPS ("audio/x-wav; audio/x-rf64")
     );
 
 #define DEBUG_INIT \
@@ -213,6 +222,13 @@ gst_wavparse_reset (GstWavParse * wav)
   wav->duration = 0;
   wav->got_fmt = FALSE;
   wav->first = TRUE;
+  wav->rf64 = FALSE;
+  wav->ds64_datasize = 0;
+
+  if (wav->pull_block)
+    gst_buffer_unref (wav->pull_block);
+  wav->pull_block = NULL;
+  wav->pull_block_offset = 0;
 
   if (wav->seek_event)
     gst_event_unref (wav->seek_event);
@@ -711,10 +727,19 @@ gst_wavparse_other (GstWavParse * wav)
 static gboolean
 gst_wavparse_parse_file_header (GstElement * element, GstBuffer * buf)
 {
+  GstWavParse *wav = GST_WAVPARSE (element);
+  guint8 data[12];
   guint32 doctype;
 
-  if (!gst_riff_parse_file_header (element, buf, &doctype))
+  /* the RIFF helper doesn't know about RF64, which has the same layout */
+  if (gst_buffer_extract (buf, 0, data, 12) == 12 &&
+      GST_READ_UINT32_LE (data) == GST_RIFF_TAG_RF64) {
+    doctype = GST_READ_UINT32_LE (data + 8);
+    gst_buffer_unref (buf);
+    wav->rf64 = TRUE;
+  } else if (!gst_riff_parse_file_header (element, buf, &doctype)) {
     return FALSE;
+  }
 
   if (doctype != GST_RIFF_RIFF_WAVE)
     goto not_wav;
@@ -1458,6 +1483,22 @@ gst_wavparse_stream_headers (GstWavParse * wav)
       continue;
     }
 
+    if (tag == GST_RIFF_TAG_ds64 && wav->rf64) {
+      GstMapInfo map;
+
+      /* riff size, data size and sample count, followed by a table
+       * of other chunk sizes we don't need */
+      gst_buffer_map (buf, &map, GST_MAP_READ);
+      if (map.size >= 24)
+        wav->ds64_datasize = GST_READ_UINT64_LE (map.data + 8);
+      gst_buffer_unmap (buf, &map);
+      gst_buffer_unref (buf);
+      buf = NULL;
+      GST_DEBUG_OBJECT (wav, "ds64 data size %" G_GUINT64_FORMAT,
+          wav->ds64_datasize);
+      continue;
+    }
+
     if (tag != GST_RIFF_TAG_fmt)
       goto invalid_wav;
 
@@ -1596,10 +1637,17 @@ gst_wavparse_stream_headers (GstWavParse * wav)
      */
     switch (tag) {
       case GST_RIFF_TAG_data:{
+        guint64 data_size = size;
+
         GST_DEBUG_OBJECT (wav, "Got 'data' TAG, size : %u", size);
+        if (wav->rf64 && size == G_MAXUINT32) {
+          data_size = wav->ds64_datasize;
+          GST_DEBUG_OBJECT (wav, "using ds64 size %" G_GUINT64_FORMAT,
+              data_size);
+        }
         if (wav->ignore_length) {
           GST_DEBUG_OBJECT (wav, "Ignoring length");
-          size = 0;
+          data_size = 0;
         }
         if (wav->streaming) {
           gst_adapter_flush (wav->adapter, 8);
@@ -1611,21 +1659,21 @@ gst_wavparse_stream_headers (GstWavParse * wav)
         wav->datastart = wav->offset;
         /* If size is zero, then the data chunk probably actually extends to
            the end of the file */
-        if (size == 0 && upstream_size) {
-          size = upstream_size - wav->datastart;
+        if (data_size == 0 && upstream_size) {
+          data_size = upstream_size - wav->datastart;
         }
         /* Or the file might be truncated */
         else if (upstream_size) {
-          size = MIN (size, (upstream_size - wav->datastart));
+          data_size = MIN (data_size, (upstream_size - wav->datastart));
         }
-        wav->datasize = (guint64) size;
-        wav->dataleft = (guint64) size;
-        wav->end_offset = size + wav->datastart;
+        wav->datasize = data_size;
+        wav->dataleft = data_size;
+        wav->end_offset = data_size + wav->datastart;
         if (!wav->streaming) {
           /* We will continue parsing tags 'till end */
-          wav->offset += size;
+          wav->offset += data_size;
         }
-        GST_DEBUG_OBJECT (wav, "datasize = %u", size);
+        GST_DEBUG_OBJECT (wav, "datasize = %" G_GUINT64_FORMAT, data_size);
         break;
       }
       case GST_RIFF_TAG_fact:{
@@ -2154,6 +2202,52 @@ gst_wavparse_add_src_pad (GstWavParse * wav, GstBuffer * buf)
   }
 }
 
+/* Get @desired bytes at the current offset in pull mode. Instead of doing
+ * one pull per output buffer we pull large blocks from upstream and return
+ * sub-buffers of them, which share the memory of the block. Like
+ * gst_pad_pull_range() this can return a short buffer at the end of the
+ * file. */
+static GstFlowReturn
+gst_wavparse_pull_data (GstWavParse * wav, guint64 desired, GstBuffer ** buf)
+{
+  GstFlowReturn res;
+  guint64 block_end, size;
+
+  if (wav->pull_block) {
+    block_end = wav->pull_block_offset + gst_buffer_get_size (wav->pull_block);
+
+    if (wav->offset < wav->pull_block_offset ||
+        wav->offset + desired > block_end) {
+      gst_buffer_unref (wav->pull_block);
+      wav->pull_block = NULL;
+    }
+  }
+
+  if (wav->pull_block == NULL) {
+    size = desired * MAX (1, PULL_BLOCK_SIZE / desired);
+    size = MIN (size, wav->dataleft);
+    if (size >= wav->blockalign && wav->blockalign > 0)
+      size -= (size % wav->blockalign);
+    size = MAX (size, desired);
+
+    GST_LOG_OBJECT (wav, "pulling block of %" G_GUINT64_FORMAT " bytes at "
+        "offset %" G_GUINT64_FORMAT, size, wav->offset);
+
+    if ((res = gst_pad_pull_range (wav->sinkpad, wav->offset, size,
+                &wav->pull_block)) != GST_FLOW_OK)
+      return res;
+    wav->pull_block_offset = wav->offset;
+    block_end = wav->pull_block_offset + gst_buffer_get_size (wav->pull_block);
+  }
+
+  /* block_end is only short of what we need at the end of the file */
+  size = MIN (desired, block_end - wav->offset);
+  *buf = gst_buffer_copy_region (wav->pull_block, GST_BUFFER_COPY_MEMORY,
+      wav->offset - wav->pull_block_offset, size);
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_wavparse_stream_data (GstWavParse * wav)
 {
@@ -2220,8 +2314,7 @@ iterate_adapter:
 
     buf = gst_adapter_take_buffer (wav->adapter, desired);
   } else {
-    if ((res = gst_pad_pull_range (wav->sinkpad, wav->offset,
-                desired, &buf)) != GST_FLOW_OK)
+    if ((res = gst_wavparse_pull_data (wav, desired, &buf)) != GST_FLOW_OK)
       goto pull_error;
 
     /* we may get a short buffer at the end of the file */
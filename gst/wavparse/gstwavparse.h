@@ -105,6 +105,15 @@ struct _GstWavParse {
   /* duration in time */
   guint64 	duration;
 
+  /* RF64 file with 64 bit sizes from the ds64 chunk */
+  gboolean      rf64;
+  guint64       ds64_datasize;
+
+  /* large block pulled from upstream that output buffers are
+   * sub-buffers of in pull mode */
+  GstBuffer    *pull_block;
+  guint64       pull_block_offset;
+
   /* pending seek */
   GstEvent *seek_event;
 
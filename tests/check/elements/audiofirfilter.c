@@ -23,6 +23,7 @@
 #define GLIB_DISABLE_DEPRECATION_WARNINGS
 
 #include <gst/gst.h>
+#include <gst/audio/audio.h>
 #include <gst/check/gstcheck.h>
 
 static gboolean have_eos = FALSE;
@@ -177,6 +178,112 @@ GST_START_TEST (test_pipeline)
 
 GST_END_TEST;
 
+#define LONG_KERNEL_LENGTH 200
+
+static void
+on_rate_changed_long (GstElement * element, gint rate, gpointer user_data)
+{
+  GValueArray *va;
+  GValue v = { 0, };
+  gint i;
+
+  fail_unless (rate > 0);
+
+  va = g_value_array_new (LONG_KERNEL_LENGTH);
+
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < LONG_KERNEL_LENGTH; i++) {
+    g_value_set_double (&v, ((i * 7) % 13 - 6) / (gdouble) (i + 1));
+    g_value_array_append (va, &v);
+    g_value_reset (&v);
+  }
+
+  g_object_set (G_OBJECT (element), "kernel", va, NULL);
+
+  g_value_array_free (va);
+}
+
+static void
+on_handoff_collect (GstElement * object, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  GArray *samples = user_data;
+  GstMapInfo map;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_array_append_vals (samples, map.data, map.size / sizeof (gdouble));
+  gst_buffer_unmap (buffer, &map);
+}
+
+static GArray *
+run_long_kernel_pipeline (guint max_latency)
+{
+  GstElement *pipeline, *filter, *sink;
+  GstBus *bus;
+  GstMessage *msg;
+  GArray *samples;
+
+  samples = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+  pipeline = gst_parse_launch ("audiotestsrc num-buffers=20 wave=saw ! audioconvert ! "
+      "audio/x-raw,format=" GST_AUDIO_NE (F64) ",channels=2 ! "
+      "audiofirfilter name=filter ! fakesink name=sink signal-handoffs=true",
+      NULL);
+  fail_unless (pipeline != NULL);
+
+  filter = gst_bin_get_by_name (GST_BIN (pipeline), "filter");
+  g_object_set (G_OBJECT (filter), "max-latency", max_latency, NULL);
+  g_signal_connect (G_OBJECT (filter), "rate-changed",
+      G_CALLBACK (on_rate_changed_long), NULL);
+  gst_object_unref (filter);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (G_OBJECT (sink), "handoff",
+      G_CALLBACK (on_handoff_collect), samples);
+  gst_object_unref (sink);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (pipeline);
+
+  return samples;
+}
+
+GST_START_TEST (test_partitioned)
+{
+  GArray *reference, *partitioned;
+  guint i;
+
+  reference = run_long_kernel_pipeline (0);
+  partitioned = run_long_kernel_pipeline (64);
+
+  fail_unless (reference->len > 0);
+  fail_unless_equals_int (partitioned->len, reference->len);
+
+  for (i = 0; i < reference->len; i++) {
+    fail_unless (ABS (g_array_index (reference, gdouble, i) -
+            g_array_index (partitioned, gdouble, i)) < 1e-9,
+        "sample %u differs: %lf != %lf", i,
+        g_array_index (reference, gdouble, i),
+        g_array_index (partitioned, gdouble, i));
+  }
+
+  g_array_free (reference, TRUE);
+  g_array_free (partitioned, TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 audiofirfilter_suite (void)
 {
@@ -185,6 +292,7 @@ audiofirfilter_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_pipeline);
+  tcase_add_test (tc_chain, test_partitioned);
 
   return s;
 }
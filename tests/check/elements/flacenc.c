@@ -0,0 +1,342 @@
+/* GStreamer unit tests for flacenc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+
+#include <string.h>
+#include <unistd.h>
+
+static GstPad *mysrcpad, *mysinkpad;
+
+#define AUDIO_CAPS_STRING \
+    "audio/x-raw, " \
+    "format = (string) S16LE, " \
+    "layout = (string) interleaved, " \
+    "rate = (int) 44100, " \
+    "channels = (int) 2"
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-flac"));
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (AUDIO_CAPS_STRING));
+
+#define BLOCKSIZE 1152
+/* several jobs of the parallel encoder and a short last frame */
+#define NUM_SAMPLES 160000
+#define SAMPLES_PER_BUFFER 1000
+
+/* the output file, written at the position of the last byte segment so
+ * that the header rewrite at EOS ends up in place */
+static GByteArray *output;
+static guint64 output_pos;
+
+static GstFlowReturn
+output_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  gsize size = gst_buffer_get_size (buffer);
+
+  if (output_pos + size > output->len)
+    g_byte_array_set_size (output, output_pos + size);
+  gst_buffer_extract (buffer, 0, output->data + output_pos, size);
+  output_pos += size;
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+output_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+    const GstSegment *segment;
+
+    gst_event_parse_segment (event, &segment);
+    if (segment->format == GST_FORMAT_BYTES)
+      output_pos = segment->start;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+output_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_SEEKING) {
+    gst_query_set_seeking (query, GST_FORMAT_BYTES, TRUE, 0, -1);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static guint8 *
+create_input (void)
+{
+  guint8 *data;
+  guint32 seed = 1;
+  guint i;
+
+  data = g_malloc (NUM_SAMPLES * 4);
+  for (i = 0; i < NUM_SAMPLES; i++) {
+    gint16 left, right;
+
+    /* a ramp with some noise, so that the frame sizes vary */
+    seed = seed * 1103515245 + 12345;
+    left = (gint16) ((i * 37) % 20000 - 10000 + ((seed >> 16) & 0x3ff));
+    right = (gint16) (left / 2 - ((seed >> 8) & 0xff));
+    GST_WRITE_UINT16_LE (data + i * 4, left);
+    GST_WRITE_UINT16_LE (data + i * 4 + 2, right);
+  }
+
+  return data;
+}
+
+static GByteArray *
+encode (const guint8 * input, gint quality, guint threads)
+{
+  GstElement *flacenc;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GByteArray *result;
+  guint i, samples;
+
+  flacenc = gst_check_setup_element ("flacenc");
+  /* the quality sets the blocksize too, so it goes first */
+  g_object_set (flacenc, "quality", quality, NULL);
+  g_object_set (flacenc, "blocksize", BLOCKSIZE, "threads", threads, NULL);
+
+  mysrcpad = gst_check_setup_src_pad (flacenc, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (flacenc, &sinktemplate);
+  gst_pad_set_chain_function (mysinkpad, output_chain);
+  gst_pad_set_event_function (mysinkpad, output_event);
+  gst_pad_set_query_function (mysinkpad, output_query);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  output = g_byte_array_new ();
+  output_pos = 0;
+
+  fail_unless_equals_int (gst_element_set_state (flacenc, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, flacenc, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < NUM_SAMPLES; i += samples) {
+    samples = MIN (SAMPLES_PER_BUFFER, NUM_SAMPLES - i);
+    buffer = gst_buffer_new_and_alloc (samples * 4);
+    gst_buffer_fill (buffer, 0, input + i * 4, samples * 4);
+    GST_BUFFER_TIMESTAMP (buffer) =
+        gst_util_uint64_scale (i, GST_SECOND, 44100);
+    GST_BUFFER_DURATION (buffer) =
+        gst_util_uint64_scale (samples, GST_SECOND, 44100);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (gst_element_set_state (flacenc, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (flacenc);
+  gst_check_teardown_sink_pad (flacenc);
+  gst_check_teardown_element (flacenc);
+
+  result = output;
+  output = NULL;
+
+  return result;
+}
+
+static void
+decode_handoff (GstElement * fakesink, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  GChecksum *md5 = user_data;
+  GstMapInfo map;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_checksum_update (md5, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+}
+
+/* decodes @data and returns the MD5 of the decoded samples */
+static gchar *
+decode (GByteArray * data)
+{
+  GstElement *pipeline, *fakesink;
+  GstMessage *msg;
+  GstBus *bus;
+  GChecksum *md5;
+  gchar *path, *pipe_desc, *result;
+  gint fd;
+
+  fd = g_file_open_tmp ("flacenc-XXXXXX.flac", &path, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (path, (gchar *) data->data, data->len,
+          NULL));
+
+  pipe_desc = g_strdup_printf ("filesrc location=\"%s\" ! flacparse ! "
+      "flacdec ! audioconvert ! audio/x-raw,format=S16LE ! "
+      "fakesink name=sink signal-handoffs=true", path);
+  pipeline = gst_parse_launch (pipe_desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (pipe_desc);
+
+  md5 = g_checksum_new (G_CHECKSUM_MD5);
+  fakesink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (fakesink, "handoff", G_CALLBACK (decode_handoff), md5);
+  gst_object_unref (fakesink);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  g_unlink (path);
+  g_free (path);
+
+  result = g_strdup (g_checksum_get_string (md5));
+  g_checksum_free (md5);
+
+  return result;
+}
+
+/* returns the STREAMINFO block of the file in @data */
+static const guint8 *
+get_streaminfo (GByteArray * data)
+{
+  fail_unless (data->len > 42);
+  fail_unless (memcmp (data->data, "fLaC", 4) == 0);
+  /* first metadata block, STREAMINFO with 34 bytes */
+  fail_unless_equals_int (data->data[4] & 0x7f, 0);
+  fail_unless_equals_int (GST_READ_UINT24_BE (data->data + 5), 34);
+
+  return data->data + 8;
+}
+
+static void
+check_threads (gint quality)
+{
+  GByteArray *serial, *parallel;
+  const guint8 *info_serial, *info_parallel;
+  guint8 *input;
+  GChecksum *checksum;
+  guint8 input_digest[16];
+  gsize digest_len = sizeof (input_digest);
+  gchar *input_md5, *md5;
+  guint64 total_samples;
+
+  input = create_input ();
+  checksum = g_checksum_new (G_CHECKSUM_MD5);
+  g_checksum_update (checksum, input, NUM_SAMPLES * 4);
+  input_md5 = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_get_digest (checksum, input_digest, &digest_len);
+  g_checksum_free (checksum);
+
+  serial = encode (input, quality, 1);
+  parallel = encode (input, quality, 4);
+  info_serial = get_streaminfo (serial);
+  info_parallel = get_streaminfo (parallel);
+
+  /* block sizes */
+  fail_unless_equals_int (GST_READ_UINT16_BE (info_parallel), BLOCKSIZE);
+  fail_unless_equals_int (GST_READ_UINT16_BE (info_parallel + 2), BLOCKSIZE);
+  /* min and max frame size */
+  fail_unless_equals_int (GST_READ_UINT24_BE (info_parallel + 4),
+      GST_READ_UINT24_BE (info_serial + 4));
+  fail_unless_equals_int (GST_READ_UINT24_BE (info_parallel + 7),
+      GST_READ_UINT24_BE (info_serial + 7));
+  fail_unless (GST_READ_UINT24_BE (info_parallel + 4) > 0);
+  /* total samples */
+  total_samples = GST_READ_UINT64_BE (info_parallel + 10) &
+      G_GUINT64_CONSTANT (0x0FFFFFFFFF);
+  fail_unless_equals_uint64 (total_samples, NUM_SAMPLES);
+  fail_unless_equals_uint64 (GST_READ_UINT64_BE (info_serial + 10) &
+      G_GUINT64_CONSTANT (0x0FFFFFFFFF), NUM_SAMPLES);
+  /* MD5 of the input */
+  fail_unless (memcmp (info_parallel + 18, input_digest, 16) == 0);
+  fail_unless (memcmp (info_serial + 18, input_digest, 16) == 0);
+  /* so the whole STREAMINFO is the same */
+  fail_unless (memcmp (info_parallel, info_serial, 34) == 0);
+  /* and so is everything else */
+  fail_unless_equals_int (parallel->len, serial->len);
+  fail_unless (memcmp (parallel->data, serial->data, serial->len) == 0);
+
+  /* both decode to the input */
+  md5 = decode (serial);
+  fail_unless_equals_string (md5, input_md5);
+  g_free (md5);
+  md5 = decode (parallel);
+  fail_unless_equals_string (md5, input_md5);
+  g_free (md5);
+
+  g_byte_array_free (serial, TRUE);
+  g_byte_array_free (parallel, TRUE);
+  g_free (input_md5);
+  g_free (input);
+}
+
+GST_START_TEST (test_threads)
+{
+  check_threads (5);
+}
+
+GST_END_TEST;
+
+/* loose mid-side stereo carries state from frame to frame */
+GST_START_TEST (test_threads_loose_mid_side)
+{
+  check_threads (1);
+}
+
+GST_END_TEST;
+
+static Suite *
+flacenc_suite (void)
+{
+  Suite *s = suite_create ("flacenc");
+  TCase *tc_chain = tcase_create ("general");
+
+  /* encodes and decodes several seconds of audio */
+  tcase_set_timeout (tc_chain, 60);
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_threads);
+  tcase_add_test (tc_chain, test_threads_loose_mid_side);
+
+  return s;
+}
+
+GST_CHECK_MAIN (flacenc);
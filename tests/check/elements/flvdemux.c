@@ -21,6 +21,8 @@
 #include <gst/check/gstcheck.h>
 
 #include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 static void
 pad_added_cb (GstElement * flvdemux, GstPad * pad, GstBin * pipeline)
@@ -166,6 +168,117 @@ GST_START_TEST (test_reuse_push)
 
 GST_END_TEST;
 
+/* video only, a frame every 500 ms and a keyframe every 30 seconds. The
+ * frames are big enough that seeks bisect the file. */
+#define LONG_GOP_FRAME_SIZE 4000
+#define LONG_GOP_DURATION_MS (90 * 1000)
+#define LONG_GOP_KEYFRAME_MS (30 * 1000)
+
+static gchar *
+create_long_gop_file (void)
+{
+  const guint8 header[] = { 'F', 'L', 'V', 0x01, 0x01, 0x00, 0x00, 0x00,
+    0x09, 0x00, 0x00, 0x00, 0x00
+  };
+  GByteArray *data;
+  guint8 tag[11], size[4], *frame;
+  gchar *filename;
+  guint32 ms;
+  gint fd;
+
+  data = g_byte_array_new ();
+  g_byte_array_append (data, header, sizeof (header));
+
+  frame = g_malloc0 (LONG_GOP_FRAME_SIZE);
+  for (ms = 0; ms < LONG_GOP_DURATION_MS; ms += 500) {
+    tag[0] = 9;
+    GST_WRITE_UINT24_BE (tag + 1, LONG_GOP_FRAME_SIZE);
+    GST_WRITE_UINT24_BE (tag + 4, ms & 0xffffff);
+    tag[7] = ms >> 24;
+    GST_WRITE_UINT24_BE (tag + 8, 0);
+    /* Sorenson H.263, keyframe or inter frame */
+    frame[0] = (ms % LONG_GOP_KEYFRAME_MS == 0 ? 0x10 : 0x20) | 0x02;
+    GST_WRITE_UINT32_BE (size, 11 + LONG_GOP_FRAME_SIZE);
+
+    g_byte_array_append (data, tag, sizeof (tag));
+    g_byte_array_append (data, frame, LONG_GOP_FRAME_SIZE);
+    g_byte_array_append (data, size, sizeof (size));
+  }
+  g_free (frame);
+
+  fd = g_file_open_tmp ("flvdemux-XXXXXX.flv", &filename, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (filename, (gchar *) data->data,
+          data->len, NULL));
+  g_byte_array_free (data, TRUE);
+
+  return filename;
+}
+
+static GstPadProbeReturn
+first_buffer_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstClockTime *first_ts = user_data;
+
+  if (!GST_CLOCK_TIME_IS_VALID (*first_ts)) {
+    *first_ts = GST_BUFFER_TIMESTAMP (GST_PAD_PROBE_INFO_BUFFER (info));
+    fail_if (GST_BUFFER_FLAG_IS_SET (GST_PAD_PROBE_INFO_BUFFER (info),
+            GST_BUFFER_FLAG_DELTA_UNIT));
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_seek_long_gop_pull)
+{
+  GstElement *pipeline, *src, *flvdemux, *sink;
+  GstClockTime first_ts = GST_CLOCK_TIME_NONE;
+  GstPad *pad;
+  gchar *filename;
+
+  filename = create_long_gop_file ();
+
+  pipeline = gst_pipeline_new ("pipeline");
+  src = gst_element_factory_make ("filesrc", "filesrc");
+  flvdemux = gst_element_factory_make ("flvdemux", "flvdemux");
+  sink = gst_element_factory_make ("fakesink", "fakesink");
+  fail_unless (pipeline && src && flvdemux && sink);
+  g_object_set (src, "location", filename, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, flvdemux, sink, NULL);
+  fail_unless (gst_element_link (src, flvdemux));
+  g_signal_connect (flvdemux, "pad-added", G_CALLBACK (pad_added_cb), pipeline);
+
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, first_buffer_probe,
+      &first_ts, NULL);
+  gst_object_unref (pad);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL, -1),
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_uint64 (first_ts, 0);
+
+  /* the keyframe before the target is 20 seconds before it, further back
+   * than the first scan window */
+  first_ts = GST_CLOCK_TIME_NONE;
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, 50 * GST_SECOND));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL, -1),
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_uint64 (first_ts, 30 * GST_SECOND);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (pipeline);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 flvdemux_suite (void)
 {
@@ -175,6 +288,7 @@ flvdemux_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_reuse_push);
   tcase_add_test (tc_chain, test_reuse_pull);
+  tcase_add_test (tc_chain, test_seek_long_gop_pull);
 
   return s;
 }
@@ -24,6 +24,7 @@
 #include <gio/gio.h>
 #include <gst/check/gstcheck.h>
 #include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
 #include <gst/pbutils/gstdiscoverer.h>
 
 /* Verify jpegdec is working when explictly requested by a pipeline. */
@@ -78,6 +79,144 @@ GST_START_TEST (test_jpegdec_explicit)
 
 GST_END_TEST;
 
+/* decodes @file with a jpegdec configured with @props and returns the first
+ * decoded sample. The pipeline is returned in @pipeline and needs to be shut
+ * down by the caller. */
+static GstSample *
+decode_sample (const gchar * file, const gchar * props, GstElement ** pipeline)
+{
+  GstElement *sink;
+  GstSample *sample;
+  gchar *filename, *desc;
+
+  filename = g_build_filename (GST_TEST_FILES_PATH, file, NULL);
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! jpegdec %s ! "
+      "appsink name=sink", filename, props);
+  *pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (*pipeline != NULL);
+  g_free (desc);
+  g_free (filename);
+
+  sink = gst_bin_get_by_name (GST_BIN (*pipeline), "sink");
+  gst_element_set_state (*pipeline, GST_STATE_PLAYING);
+
+  sample = gst_app_sink_pull_sample (GST_APP_SINK (sink));
+  fail_unless (GST_IS_SAMPLE (sample));
+  gst_object_unref (sink);
+
+  return sample;
+}
+
+static void
+check_decoded_size (const gchar * props, gint width, gint height)
+{
+  GstElement *pipeline;
+  GstSample *sample;
+  GstStructure *s;
+  gint w, h;
+
+  sample = decode_sample ("image.jpg", props, &pipeline);
+
+  s = gst_caps_get_structure (gst_sample_get_caps (sample), 0);
+  fail_unless (gst_structure_get_int (s, "width", &w));
+  fail_unless (gst_structure_get_int (s, "height", &h));
+  fail_unless_equals_int (w, width);
+  fail_unless_equals_int (h, height);
+  fail_unless (gst_buffer_get_size (gst_sample_get_buffer (sample)) > 0);
+  gst_sample_unref (sample);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+/* image-420.jpg is a 128x96 4:2:0 picture made of four flat quadrants that
+ * meet at 64,48. The Y, U and V values of the top left, top right, bottom
+ * left and bottom right quadrant. */
+static const guint8 quadrant_colors[4][3] = {
+  {64, 96, 160}, {192, 160, 96}, {128, 64, 64}, {32, 192, 192}
+};
+
+/* checks that the output of jpegdec with @props is a @width x @height I420
+ * picture with the quadrants of image-420.jpg meeting at @split_x,@split_y */
+static void
+check_decoded_pixels (const gchar * props, gint width, gint height,
+    gint split_x, gint split_y)
+{
+  GstElement *pipeline;
+  GstSample *sample;
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  gint c, x, y;
+
+  GST_INFO ("decoding with \"%s\"", props);
+
+  sample = decode_sample ("image-420.jpg", props, &pipeline);
+
+  fail_unless (gst_video_info_from_caps (&info, gst_sample_get_caps (sample)));
+  fail_unless_equals_int (GST_VIDEO_INFO_FORMAT (&info),
+      GST_VIDEO_FORMAT_I420);
+  fail_unless_equals_int (GST_VIDEO_INFO_WIDTH (&info), width);
+  fail_unless_equals_int (GST_VIDEO_INFO_HEIGHT (&info), height);
+
+  fail_unless (gst_video_frame_map (&frame, &info,
+          gst_sample_get_buffer (sample), GST_MAP_READ));
+  for (c = 0; c < 3; c++) {
+    guint8 *data = GST_VIDEO_FRAME_COMP_DATA (&frame, c);
+    gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, c);
+    /* the chroma planes have half the resolution */
+    gint shift = (c == 0) ? 0 : 1;
+
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, c); y++) {
+      for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&frame, c); x++) {
+        gint q = ((x << shift) >= split_x ? 1 : 0) +
+            ((y << shift) >= split_y ? 2 : 0);
+        gint value = data[y * stride + x];
+
+        fail_unless (ABS (value - quadrant_colors[q][c]) <= 2,
+            "component %d at %d,%d is %d instead of %d", c, x, y, value,
+            quadrant_colors[q][c]);
+      }
+    }
+  }
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+/* Verify scaled and cropped decoding gives the expected output size */
+GST_START_TEST (test_jpegdec_scale_crop)
+{
+  check_decoded_size ("", 120, 160);
+  check_decoded_size ("scale=2", 60, 80);
+  check_decoded_size ("scale=8", 15, 20);
+  /* crop is in full size pixels: 120 - 40 = 80 / 4 = 20 */
+  check_decoded_size ("scale=4 crop-left=40 crop-bottom=40", 20, 30);
+  check_decoded_size ("crop-top=20 crop-right=20", 100, 140);
+}
+
+GST_END_TEST;
+
+/* Verify scaled and cropped decoding of a 4:2:0 picture puts the luma and
+ * chroma of the picture in the right place */
+GST_START_TEST (test_jpegdec_scale_crop_420)
+{
+  check_decoded_pixels ("", 128, 96, 64, 48);
+  check_decoded_pixels ("scale=2", 64, 48, 32, 24);
+  check_decoded_pixels ("scale=4", 32, 24, 16, 12);
+  check_decoded_pixels ("scale=8", 16, 12, 8, 6);
+  check_decoded_pixels ("crop-left=32 crop-top=16", 96, 80, 32, 32);
+  check_decoded_pixels ("crop-right=16 crop-bottom=32", 112, 64, 64, 48);
+  /* x0 = 8, y0 = 8: 64 - 8 - 16 = 40, 48 - 8 - 8 = 32 */
+  check_decoded_pixels ("scale=2 crop-left=16 crop-top=16 crop-right=32 "
+      "crop-bottom=16", 40, 32, 24, 16);
+  /* x0 = 10: 32 - 10 = 22, 24 - 10 = 14 */
+  check_decoded_pixels ("scale=4 crop-left=40 crop-bottom=40", 22, 14, 6, 12);
+}
+
+GST_END_TEST;
+
 /* Verify JPEG discovery is working. Right now jpegdec would be used,
  * but I have no idea how to actually verify this. */
 GST_START_TEST (test_jpegdec_discover)
@@ -134,6 +273,8 @@ jpegdec_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_jpegdec_explicit);
   tcase_add_test (tc_chain, test_jpegdec_discover);
+  tcase_add_test (tc_chain, test_jpegdec_scale_crop);
+  tcase_add_test (tc_chain, test_jpegdec_scale_crop_420);
 
   return s;
 }
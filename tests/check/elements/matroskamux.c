@@ -21,6 +21,7 @@
  */
 
 #include <unistd.h>
+#include <string.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/base/gstadapter.h>
@@ -461,6 +462,213 @@ GST_START_TEST (test_link_webmmux_webm_sink)
 
 GST_END_TEST;
 
+static gboolean
+seekable_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_SEEKING) {
+    gst_query_set_seeking (query, GST_FORMAT_BYTES, TRUE, 0, -1);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+/* puts all buffers pushed so far at their offsets, like a file would */
+static GByteArray *
+assemble_output (void)
+{
+  GByteArray *data;
+  GList *l;
+
+  data = g_byte_array_new ();
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buffer = l->data;
+    guint64 offset = GST_BUFFER_OFFSET (buffer);
+    gsize size = gst_buffer_get_size (buffer);
+    guint len = data->len;
+
+    fail_if (offset == GST_BUFFER_OFFSET_NONE);
+    if (offset + size > len) {
+      g_byte_array_set_size (data, offset + size);
+      memset (data->data + len, 0, data->len - len);
+    }
+    gst_buffer_extract (buffer, 0, data->data + offset, size);
+  }
+
+  return data;
+}
+
+/* reads the 8 byte size of the element at @pos and returns its end */
+static guint64
+element_end (GByteArray * data, guint64 pos, guint id_len)
+{
+  guint64 size;
+
+  fail_unless (pos + id_len + 8 <= data->len);
+  fail_unless_equals_int (data->data[pos + id_len], 0x01);
+  size = GST_READ_UINT64_BE (data->data + pos + id_len) &
+      G_GUINT64_CONSTANT (0x00ffffffffffffff);
+
+  return pos + id_len + 8 + size;
+}
+
+/* returns the position in the file of SeekHead entry @entry and checks that
+ * an element with @id is found there */
+static guint64
+check_seek_entry (GByteArray * data, guint64 segment, guint entry, guint32 id)
+{
+  guint64 pos;
+
+  /* see gst_matroska_mux_finish() for the SeekHead layout */
+  pos = segment + GST_READ_UINT64_BE (data->data + segment + 32 + 28 * entry);
+  fail_unless (pos + 4 <= data->len);
+  fail_unless_equals_int (GST_READ_UINT32_BE (data->data + pos), id);
+
+  return pos;
+}
+
+/* checks the SeekHead and the Cues of a file with @reserved CuePoints
+ * reserved after the SeekHead and returns the number of CuePoints */
+static guint
+check_reserved_cues (GByteArray * data, guint reserved, gboolean at_end)
+{
+  guint64 segment, seekhead_end, info, cues, pos, end;
+  guint points = 0;
+
+  /* the Segment follows the EBML header */
+  segment = element_end (data, 0, 4);
+  fail_unless_equals_int (GST_READ_UINT32_BE (data->data + segment),
+      0x18538067);
+  segment += 12;
+
+  /* SeekHead with 5 entries */
+  fail_unless_equals_int (GST_READ_UINT32_BE (data->data + segment),
+      0x114d9b74);
+  seekhead_end = segment + 12 + 5 * 28;
+
+  /* Info and Tracks */
+  info = check_seek_entry (data, segment, 0, 0x1549a966);
+  check_seek_entry (data, segment, 1, 0x1654ae6b);
+
+  /* the reserved space is between the SeekHead and the Info */
+  fail_unless_equals_uint64 (info - seekhead_end, 12 + 41 * reserved + 9);
+
+  cues = check_seek_entry (data, segment, 3, 0x1c53bb6b);
+  if (at_end) {
+    /* it is one Void element then */
+    fail_unless (cues > info);
+    fail_unless_equals_int (data->data[seekhead_end], 0xec);
+    fail_unless_equals_uint64 (element_end (data, seekhead_end, 1), info);
+  } else {
+    /* Cues and a Void element that fills the rest */
+    fail_unless_equals_uint64 (cues, seekhead_end);
+    pos = element_end (data, cues, 4);
+    fail_unless_equals_int (data->data[pos], 0xec);
+    fail_unless_equals_uint64 (element_end (data, pos, 1), info);
+  }
+
+  end = element_end (data, cues, 4);
+  for (pos = cues + 12; pos < end; pos = element_end (data, pos, 1)) {
+    fail_unless_equals_int (data->data[pos], 0xbb);
+    points++;
+  }
+  fail_unless_equals_uint64 (pos, end);
+
+  return points;
+}
+
+static void
+push_audio_buffer (GstClockTime timestamp)
+{
+  GstBuffer *inbuffer;
+
+  inbuffer = gst_buffer_new_allocate (NULL, 1, 0);
+  GST_BUFFER_TIMESTAMP (inbuffer) = timestamp;
+  GST_BUFFER_DURATION (inbuffer) = 10 * GST_SECOND;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+}
+
+GST_START_TEST (test_reserved_cues)
+{
+  GstElement *matroskamux;
+  GByteArray *data;
+  GstCaps *caps;
+  guint i;
+
+  matroskamux = setup_matroskamux (&srcac3template);
+  gst_pad_set_query_function (mysinkpad, seekable_sink_query);
+  g_object_set (matroskamux, "max-cues-entries", 4, "cues-update-interval",
+      GST_SECOND, NULL);
+
+  caps = gst_caps_from_string (AC3_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, matroskamux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* the audio clusters are at most 32.767 seconds long, so the buffer at 40
+   * seconds starts the second cluster, which updates the Cues */
+  for (i = 0; i <= 4; i++)
+    push_audio_buffer (i * 10 * GST_SECOND);
+
+  data = assemble_output ();
+  fail_unless_equals_int (check_reserved_cues (data, 4, FALSE), 4);
+  g_byte_array_unref (data);
+
+  /* the index is thinned to stay within the reserved space */
+  for (; i <= 10; i++)
+    push_audio_buffer (i * 10 * GST_SECOND);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  data = assemble_output ();
+  fail_unless (check_reserved_cues (data, 4, FALSE) <= 4);
+  g_byte_array_unref (data);
+
+  cleanup_matroskamux (matroskamux);
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reserved_cues_overflow)
+{
+  GstElement *matroskamux;
+  GByteArray *data;
+  GstCaps *caps;
+  guint i;
+
+  matroskamux = setup_matroskamux (&srcac3template);
+  gst_pad_set_query_function (mysinkpad, seekable_sink_query);
+  g_object_set (matroskamux, "max-cues-entries", 2, "cues-update-interval",
+      GST_SECOND, NULL);
+
+  caps = gst_caps_from_string (AC3_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, matroskamux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* the Cues are written into the reserved space with the second cluster */
+  for (i = 0; i <= 4; i++)
+    push_audio_buffer (i * 10 * GST_SECOND);
+
+  data = assemble_output ();
+  fail_unless_equals_int (check_reserved_cues (data, 2, FALSE), 2);
+  g_byte_array_unref (data);
+
+  /* the space was reserved for 2 entries, the index outgrows it now */
+  g_object_set (matroskamux, "max-cues-entries", 100, NULL);
+  for (; i <= 10; i++)
+    push_audio_buffer (i * 10 * GST_SECOND);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* so the Cues are at the end and the reserved space is voided */
+  data = assemble_output ();
+  fail_unless (check_reserved_cues (data, 2, TRUE) > 2);
+  g_byte_array_unref (data);
+
+  cleanup_matroskamux (matroskamux);
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
 static Suite *
 matroskamux_suite (void)
 {
@@ -473,6 +681,8 @@ matroskamux_suite (void)
   tcase_add_test (tc_chain, test_block_group);
   tcase_add_test (tc_chain, test_reset);
   tcase_add_test (tc_chain, test_link_webmmux_webm_sink);
+  tcase_add_test (tc_chain, test_reserved_cues);
+  tcase_add_test (tc_chain, test_reserved_cues_overflow);
 
   return s;
 }
@@ -24,6 +24,8 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "audio/mpeg, parsed=(boolean)false, mpegversion=(int)1"
@@ -123,6 +125,108 @@ GST_START_TEST (test_parse_detect_stream)
 GST_END_TEST;
 
 
+/* 48 kHz, 1152 samples per frame */
+#define INDEX_TEST_FRAMES 2000
+
+static GstPadProbeReturn
+slow_pull_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  /* make the index task run long enough to seek while it runs */
+  g_usleep (10 * 1000);
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_seek_while_indexing)
+{
+  GstElement *pipeline, *src, *parse, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  GstPad *pad;
+  gchar *filename;
+  guint8 *data;
+  gint64 duration = -1, expected;
+  gsize size;
+  gint fd, i;
+
+  /* a CBR file that ends with an ID3v1 tag */
+  size = INDEX_TEST_FRAMES * sizeof (mp3_frame) + 128;
+  data = g_malloc0 (size);
+  for (i = 0; i < INDEX_TEST_FRAMES; i++)
+    memcpy (data + i * sizeof (mp3_frame), mp3_frame, sizeof (mp3_frame));
+  memcpy (data + size - 128, "TAG", 3);
+
+  fd = g_file_open_tmp ("mpegaudioparse-XXXXXX.mp3", &filename, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (filename, (gchar *) data, size, NULL));
+  g_free (data);
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  parse = gst_element_factory_make ("mpegaudioparse", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (pipeline && src && parse && sink);
+  g_object_set (src, "location", filename, NULL);
+  g_object_set (parse, "build-index", TRUE, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, parse, sink, NULL);
+  fail_unless (gst_element_link_many (src, parse, sink, NULL));
+
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_PULL | GST_PAD_PROBE_TYPE_BUFFER,
+      slow_pull_probe, NULL, NULL);
+  gst_object_unref (pad);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  /* the index task started with the first frame, the flushes of these seeks
+   * make its pulls fail */
+  for (i = 1; i <= 5; i++) {
+    fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH, i * GST_SECOND));
+    fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+            GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+  }
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  /* the index task resumed after the seeks and counts all frames. The exact
+   * duration is set with the first frame after it is done. */
+  expected = gst_util_uint64_scale (INDEX_TEST_FRAMES, 1152 * GST_SECOND,
+      48000);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE);
+  for (i = 0; i < 500 && duration != expected; i++) {
+    fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH, 0));
+    fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+            GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+    fail_unless (gst_element_query_duration (parse, GST_FORMAT_TIME,
+            &duration));
+    if (duration != expected)
+      g_usleep (10 * 1000);
+  }
+  fail_unless_equals_uint64 (duration, expected);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegaudioparse_suite (void)
 {
@@ -136,6 +240,7 @@ mpegaudioparse_suite (void)
   tcase_add_test (tc_chain, test_parse_split);
   tcase_add_test (tc_chain, test_parse_skip_garbage);
   tcase_add_test (tc_chain, test_parse_detect_stream);
+  tcase_add_test (tc_chain, test_seek_while_indexing);
 
   return s;
 }
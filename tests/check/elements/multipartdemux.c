@@ -0,0 +1,173 @@
+/* GStreamer unit tests for multipartdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("multipart/x-mixed-replace"));
+
+#define PART_HEADER \
+    "--ThisRandomString\r\nContent-type: text/plain\r\n\r\n"
+
+static const gchar *parts[] = {
+  "The first part, long enough to span many small input buffers. "
+      "The boundary string -- also appears partly in here: --ThisRandom",
+  "Second part\r\n--ThisRandomStrin",
+  "3"
+};
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, gpointer user_data)
+{
+  fail_unless_equals_int (gst_pad_link (pad, mysinkpad), GST_PAD_LINK_OK);
+}
+
+static GstElement *
+setup_multipartdemux (void)
+{
+  GstElement *demux;
+  GstCaps *caps;
+
+  demux = gst_check_setup_element ("multipartdemux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), NULL);
+
+  mysrcpad = gst_check_setup_src_pad (demux, &srctemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  /* the source pad of the demuxer only appears with the first part */
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, gst_check_chain_func);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string ("multipart/x-mixed-replace");
+  gst_check_setup_events (mysrcpad, demux, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  return demux;
+}
+
+static void
+cleanup_multipartdemux (GstElement * demux)
+{
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (demux);
+  gst_object_unref (mysinkpad);
+  mysinkpad = NULL;
+  gst_check_teardown_element (demux);
+}
+
+static gchar *
+create_stream (void)
+{
+  GString *stream;
+  guint i;
+
+  stream = g_string_new (NULL);
+  for (i = 0; i < G_N_ELEMENTS (parts); i++) {
+    g_string_append (stream, PART_HEADER);
+    g_string_append (stream, parts[i]);
+    g_string_append (stream, "\r\n");
+  }
+  g_string_append (stream, "--ThisRandomString--\r\n");
+
+  return g_string_free (stream, FALSE);
+}
+
+/* pushes the stream in chunks of @chunk_size bytes, so that boundaries and
+ * parts are split over many buffers, and checks the parts that come out */
+static void
+check_chunked_stream (gsize chunk_size)
+{
+  GstElement *demux;
+  GstBuffer *buffer;
+  gchar *stream;
+  gsize size, offset, len;
+  GList *l;
+  guint i;
+
+  GST_INFO ("chunk size %" G_GSIZE_FORMAT, chunk_size);
+
+  demux = setup_multipartdemux ();
+
+  stream = create_stream ();
+  size = strlen (stream);
+  for (offset = 0; offset < size; offset += len) {
+    len = MIN (chunk_size, size - offset);
+    buffer = gst_buffer_new_and_alloc (len);
+    gst_buffer_fill (buffer, 0, stream + offset, len);
+    /* the closing boundary ends the stream */
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer),
+        offset + len < size ? GST_FLOW_OK : GST_FLOW_EOS);
+  }
+  g_free (stream);
+
+  fail_unless_equals_int (g_list_length (buffers), G_N_ELEMENTS (parts));
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    buffer = l->data;
+
+    fail_unless_equals_int (gst_buffer_get_size (buffer), strlen (parts[i]));
+    fail_unless (gst_buffer_memcmp (buffer, 0, parts[i],
+            strlen (parts[i])) == 0);
+  }
+
+  cleanup_multipartdemux (demux);
+}
+
+GST_START_TEST (test_boundary_split)
+{
+  const gsize chunk_sizes[] = { 1, 2, 3, 5, 7, 13, 64, 4096 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (chunk_sizes); i++)
+    check_chunked_stream (chunk_sizes[i]);
+}
+
+GST_END_TEST;
+
+static Suite *
+multipartdemux_suite (void)
+{
+  Suite *s = suite_create ("multipartdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_boundary_split);
+
+  return s;
+}
+
+GST_CHECK_MAIN (multipartdemux);
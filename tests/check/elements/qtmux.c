@@ -28,6 +28,8 @@
 #include <unistd.h>
 #endif
 
+#include <string.h>
+
 #include <glib/gstdio.h>
 
 #include <gst/check/gstcheck.h>
@@ -889,6 +891,388 @@ GST_START_TEST (test_average_bitrate)
 GST_END_TEST;
 
 
+static gboolean
+seekable_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_SEEKING) {
+    gst_query_set_seeking (query, GST_FORMAT_BYTES, TRUE, 0, -1);
+    return TRUE;
+  }
+  return gst_pad_query_default (pad, parent, query);
+}
+
+/* the file qtmux writes, rebuilt by following the byte segments it sends
+ * to seek back */
+static GByteArray *output_file;
+static gsize output_pos;
+
+static GstPadProbeReturn
+output_file_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+    gsize size = gst_buffer_get_size (buf);
+
+    if (output_file->len < output_pos + size)
+      g_byte_array_set_size (output_file, output_pos + size);
+    gst_buffer_extract (buf, 0, output_file->data + output_pos, size);
+    output_pos += size;
+  } else {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+    const GstSegment *segment;
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+      gst_event_parse_segment (event, &segment);
+      if (segment->format == GST_FORMAT_BYTES)
+        output_pos = segment->start;
+    }
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+setup_output_file (void)
+{
+  output_file = g_byte_array_new ();
+  output_pos = 0;
+  gst_pad_add_probe (mysinkpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      output_file_probe, NULL, NULL);
+}
+
+static gsize
+get_atom_size (const guint8 * data)
+{
+  if (GST_READ_UINT32_BE (data) == 1)
+    return GST_READ_UINT64_BE (data + 8);
+  return GST_READ_UINT32_BE (data);
+}
+
+/* finds the child atom @fourcc of the container atom at @data */
+static const guint8 *
+find_child_atom (const guint8 * data, const gchar * fourcc)
+{
+  gsize offset = 8, size;
+
+  size = get_atom_size (data);
+  while (offset + 8 <= size) {
+    fail_unless (get_atom_size (data + offset) >= 8);
+    if (memcmp (data + offset + 4, fourcc, 4) == 0)
+      return data + offset;
+    offset += get_atom_size (data + offset);
+  }
+  fail ("no %s atom", fourcc);
+  return NULL;
+}
+
+/*
+ * Checks that the output file is made of the atoms in @order and that the
+ * chunk offsets of the track point into the mdat, at data filled with
+ * @fill. Frees the output file.
+ */
+static void
+check_output_file (const gchar ** order, guint8 fill)
+{
+  const guint8 *data, *moov = NULL, *stco;
+  gsize offset = 0, size, mdat_start = 0, mdat_end = 0;
+  guint32 i, n_chunks;
+
+  data = output_file->data;
+  for (; *order; order++) {
+    fail_unless (offset + 8 <= output_file->len);
+    size = get_atom_size (data + offset);
+    fail_unless (size >= 8);
+    fail_unless (offset + size <= output_file->len);
+    fail_unless (memcmp (data + offset + 4, *order, 4) == 0,
+        "expected %s at %" G_GSIZE_FORMAT, *order, offset);
+
+    if (strcmp (*order, "moov") == 0) {
+      moov = data + offset;
+    } else if (strcmp (*order, "mdat") == 0) {
+      mdat_start = offset + (GST_READ_UINT32_BE (data + offset) == 1 ? 16 : 8);
+      mdat_end = offset + size;
+    }
+    offset += size;
+  }
+  fail_unless_equals_int (offset, output_file->len);
+  fail_unless (moov != NULL);
+  fail_unless (mdat_end > mdat_start);
+
+  stco = find_child_atom (moov, "trak");
+  stco = find_child_atom (stco, "mdia");
+  stco = find_child_atom (stco, "minf");
+  stco = find_child_atom (stco, "stbl");
+  stco = find_child_atom (stco, "stco");
+
+  n_chunks = GST_READ_UINT32_BE (stco + 12);
+  fail_unless (n_chunks > 0);
+  for (i = 0; i < n_chunks; i++) {
+    guint32 chunk = GST_READ_UINT32_BE (stco + 16 + i * 4);
+
+    fail_unless (chunk >= mdat_start && chunk < mdat_end,
+        "chunk at %u outside of the mdat", chunk);
+    fail_unless_equals_int (data[chunk], fill);
+  }
+
+  g_byte_array_free (output_file, TRUE);
+  output_file = NULL;
+}
+
+GST_START_TEST (test_reserved_moov)
+{
+  GstElement *qtmux;
+  GstBuffer *inbuffer, *outbuffer;
+  GstCaps *caps;
+  int num_buffers;
+  int i;
+  guint8 data0[4] = "free";
+  guint8 data1[8] = "\000\000\000\001mdat";
+  guint8 data2[4] = "moov";
+  gsize reserved = 0, moov = 0;
+  GstSegment segment;
+  const gchar *order[] = { "ftyp", "moov", "free", "free", "mdat", NULL };
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u");
+  gst_pad_set_query_function (mysinkpad, seekable_sink_query);
+  setup_output_file ();
+  g_object_set (qtmux, "faststart", TRUE, "reserved-max-duration",
+      10 * GST_SECOND, NULL);
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  inbuffer = gst_buffer_new_and_alloc (1);
+  gst_buffer_memset (inbuffer, 0, 0xab, 1);
+  GST_BUFFER_TIMESTAMP (inbuffer) = 0;
+  GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  /* the moov and what is left of the reserved space come before the mdat,
+   * the first 8 bytes of its header became a free atom with the size
+   * update */
+  check_output_file (order, 0xab);
+
+  /* ftyp, reserved space, mdat header, buffer chunk, then moov and padding
+   * written over the reserved space and the mdat size update */
+  num_buffers = g_list_length (buffers);
+  fail_unless_equals_int (num_buffers, 7);
+
+  cleanup_qtmux (qtmux, "video_%u");
+
+  for (i = 0; i < num_buffers; ++i) {
+    outbuffer = GST_BUFFER (buffers->data);
+    fail_if (outbuffer == NULL);
+    buffers = g_list_remove (buffers, outbuffer);
+
+    switch (i) {
+      case 1:                  /* reserved space */
+        reserved = gst_buffer_get_size (outbuffer);
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data0,
+                sizeof (data0)) == 0);
+        break;
+      case 2:                  /* mdat header */
+        fail_unless (gst_buffer_get_size (outbuffer) == 16);
+        fail_unless (gst_buffer_memcmp (outbuffer, 0, data1,
+                sizeof (data1)) == 0);
+        break;
+      case 3:                  /* buffer we put in */
+        fail_unless (gst_buffer_get_size (outbuffer) == 1);
+        break;
+      case 4:                  /* moov */
+        moov = gst_buffer_get_size (outbuffer);
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data2,
+                sizeof (data2)) == 0);
+        break;
+      case 5:                  /* rest of the reserved space */
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data0,
+                sizeof (data0)) == 0);
+        fail_unless_equals_int (moov + gst_buffer_get_size (outbuffer),
+            reserved);
+        break;
+      default:
+        break;
+    }
+
+    gst_buffer_unref (outbuffer);
+    outbuffer = NULL;
+  }
+
+  g_list_free (buffers);
+  buffers = NULL;
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reserved_moov_too_small)
+{
+  GstElement *qtmux;
+  GstBuffer *inbuffer;
+  GstMessage *msg;
+  GError *err = NULL;
+  GstCaps *caps;
+  GstBus *bus;
+  GstSegment segment;
+  const gchar *order[] = { "ftyp", "free", "free", "mdat", "moov", NULL };
+  gint i;
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u");
+  gst_pad_set_query_function (mysinkpad, seekable_sink_query);
+  setup_output_file ();
+  bus = gst_bus_new ();
+  gst_element_set_bus (qtmux, bus);
+
+  /* reserves a little more than the fixed part of the moov, the sample
+   * sizes of 1000 buffers don't fit in it */
+  g_object_set (qtmux, "faststart", TRUE, "reserved-max-duration",
+      10 * GST_SECOND, "reserved-bytes-per-sec", 1, NULL);
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  /* alternate the sizes so that each sample gets an stsz entry */
+  for (i = 0; i < 1000; i++) {
+    inbuffer = gst_buffer_new_and_alloc (1 + i % 2);
+    gst_buffer_memset (inbuffer, 0, 0xab, 1 + i % 2);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_WARNING);
+  fail_unless (msg != NULL, "no warning about the reserved space");
+  gst_message_parse_warning (msg, &err, NULL);
+  fail_unless (g_error_matches (err, GST_STREAM_ERROR, GST_STREAM_ERROR_MUX));
+  g_error_free (err);
+  gst_message_unref (msg);
+
+  /* the reserved space stays a free atom and the moov is written after the
+   * media data, the mdat size is still updated */
+  check_output_file (order, 0xab);
+
+  gst_element_set_bus (qtmux, NULL);
+  gst_object_unref (bus);
+  cleanup_qtmux (qtmux, "video_%u");
+  gst_check_drop_buffers ();
+}
+
+GST_END_TEST;
+
+static gboolean
+non_seekable_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_SEEKING) {
+    gst_query_set_seeking (query, GST_FORMAT_BYTES, FALSE, 0, -1);
+    return TRUE;
+  }
+  return gst_pad_query_default (pad, parent, query);
+}
+
+GST_START_TEST (test_reserved_moov_not_seekable)
+{
+  GstElement *qtmux;
+  GstBuffer *inbuffer, *outbuffer;
+  GstCaps *caps;
+  int num_buffers;
+  int i;
+  guint8 data0[4] = "ftyp";
+  guint8 data1[4] = "moov";
+  guint8 data2[4] = "mdat";
+  GstSegment segment;
+
+  qtmux = setup_qtmux (&srcvideotemplate, "video_%u");
+  gst_pad_set_query_function (mysinkpad, non_seekable_sink_query);
+  g_object_set (qtmux, "faststart", TRUE, "reserved-max-duration",
+      10 * GST_SECOND, NULL);
+  fail_unless (gst_element_set_state (qtmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_pad_set_caps (mysrcpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  inbuffer = gst_buffer_new_and_alloc (1);
+  gst_buffer_memset (inbuffer, 0, 0, 1);
+  GST_BUFFER_TIMESTAMP (inbuffer) = 0;
+  GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()) == TRUE);
+
+  /* no space can be reserved, the data goes through the temporary file:
+   * the empty preroll buffer, then ftyp, moov, mdat header and the buffer
+   * chunk, without any seeking back */
+  num_buffers = g_list_length (buffers);
+  fail_unless_equals_int (num_buffers, 5);
+
+  cleanup_qtmux (qtmux, "video_%u");
+
+  for (i = 0; i < num_buffers; ++i) {
+    outbuffer = GST_BUFFER (buffers->data);
+    fail_if (outbuffer == NULL);
+    buffers = g_list_remove (buffers, outbuffer);
+
+    switch (i) {
+      case 0:                  /* preroll buffer */
+        fail_unless (gst_buffer_get_size (outbuffer) == 0);
+        break;
+      case 1:                  /* ftyp */
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data0,
+                sizeof (data0)) == 0);
+        break;
+      case 2:                  /* moov */
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data1,
+                sizeof (data1)) == 0);
+        break;
+      case 3:                  /* mdat header */
+        fail_unless (gst_buffer_get_size (outbuffer) == 8);
+        fail_unless (gst_buffer_memcmp (outbuffer, 4, data2,
+                sizeof (data2)) == 0);
+        break;
+      case 4:                  /* buffer we put in */
+        fail_unless (gst_buffer_get_size (outbuffer) == 1);
+        break;
+      default:
+        break;
+    }
+
+    gst_buffer_unref (outbuffer);
+    outbuffer = NULL;
+  }
+
+  g_list_free (buffers);
+  buffers = NULL;
+}
+
+GST_END_TEST;
+
 static Suite *
 qtmux_suite (void)
 {
@@ -918,6 +1302,9 @@ qtmux_suite (void)
   tcase_add_test (tc_chain, test_audio_pad_frag_asc_streamable);
 
   tcase_add_test (tc_chain, test_average_bitrate);
+  tcase_add_test (tc_chain, test_reserved_moov);
+  tcase_add_test (tc_chain, test_reserved_moov_too_small);
+  tcase_add_test (tc_chain, test_reserved_moov_not_seekable);
 
   tcase_add_test (tc_chain, test_reuse);
   tcase_add_test (tc_chain, test_encodebin_qtmux);
@@ -19,6 +19,7 @@
  */
 #include <gst/check/gstcheck.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #define RELEASE_ELEMENT(x) if(x) {gst_object_unref(x); x = NULL;}
@@ -669,6 +670,206 @@ GST_START_TEST (rtp_mp2t)
       "rtpmp2tpay", "rtpmp2tdepay", 0, 0, FALSE);
 }
 
+GST_END_TEST;
+
+/*
+ * rtpmp2tpay with TS packets that start a PES packet or carry a PCR, sent in
+ * buffers of one or more TS packets.
+ */
+#define MP2T_PUSI(i) ((i) == 0 || (i) == 6 || (i) == 14 || (i) == 22)
+#define MP2T_PCR(i) ((i) == 3 || (i) == 10 || (i) == 17 || (i) == 24)
+#define MP2T_DURATION (10 * GST_MSECOND)
+#define MP2T_PACKETS_PER_MTU 4
+
+/* TS packets per input buffer. The payloader only flushes when the MTU is
+ * full or a buffer has more than one TS packet, so the last one has two. */
+static const guint rtp_mp2t_buffers[] =
+    { 1, 1, 1, 1, 3, 1, 1, 2, 1, 1, 1, 4, 1, 1, 1, 2, 1, 2 };
+
+typedef struct
+{
+  gboolean align;
+  guint next;                   /* index of the next TS packet */
+  guint n_lists;
+} rtp_mp2t_data;
+
+static void
+rtp_mp2t_make_packet (guint8 * data, guint i)
+{
+  memset (data, 0xff, 188);
+  data[0] = 0x47;
+  data[1] = (MP2T_PUSI (i) ? 0x40 : 0x00) | 0x01;
+  data[2] = 0x00;
+  if (MP2T_PCR (i)) {
+    /* adaptation field with only a PCR, followed by the payload */
+    data[3] = 0x30 | (i & 0x0f);
+    data[4] = 7;
+    data[5] = 0x10;
+    memset (data + 6, 0, 6);
+  } else {
+    data[3] = 0x10 | (i & 0x0f);
+  }
+  /* the last byte says which TS packet this is */
+  data[187] = i;
+}
+
+/*
+ * RTP timestamp of the input buffer that holds TS packet @i.
+ */
+static guint32
+rtp_mp2t_rtptime (guint i)
+{
+  guint b;
+
+  for (b = 0; i >= rtp_mp2t_buffers[b]; b++)
+    i -= rtp_mp2t_buffers[b];
+
+  return gst_util_uint64_scale_int (b * MP2T_DURATION, 90000, GST_SECOND);
+}
+
+/*
+ * Probe on the payloader src pad, checks that the packets carry whole TS
+ * packets in order, that every packet of a list has the timestamp of the
+ * first TS packet in the list and, when aligning, that the TS packets which
+ * start a PES packet or carry a PCR are only found at the start of a packet.
+ */
+static GstPadProbeReturn
+rtp_mp2t_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  rtp_mp2t_data *d = user_data;
+  GstBufferList *list;
+  guint i, j, len;
+  guint32 rtptime;
+
+  fail_unless (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      "packet pushed outside of a list");
+
+  list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+  len = gst_buffer_list_length (list);
+  fail_unless (len > 0);
+  rtptime = rtp_mp2t_rtptime (d->next);
+
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_list_get (list, i);
+    GstMapInfo map;
+    guint n_packets;
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless (map.size > 12);
+    fail_unless_equals_int (map.data[0], 0x80);
+    fail_unless_equals_int (GST_READ_UINT32_BE (map.data + 4), rtptime);
+
+    fail_unless_equals_int ((map.size - 12) % 188, 0);
+    n_packets = (map.size - 12) / 188;
+    fail_unless (n_packets > 0);
+    fail_unless (n_packets <= MP2T_PACKETS_PER_MTU);
+
+    for (j = 0; j < n_packets; j++) {
+      const guint8 *ts = map.data + 12 + j * 188;
+
+      fail_unless_equals_int (ts[0], 0x47);
+      fail_unless_equals_int (ts[187], d->next);
+      if (d->align && j > 0) {
+        fail_if (MP2T_PUSI (d->next), "PES start %u not aligned", d->next);
+        fail_if (MP2T_PCR (d->next), "PCR %u not aligned", d->next);
+      }
+      d->next++;
+    }
+    gst_buffer_unmap (buf, &map);
+  }
+  d->n_lists++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+rtp_mp2t_test (gboolean align)
+{
+  GstElement *pipeline, *src, *pay;
+  GstFlowReturn flow_ret;
+  GstMessage *msg;
+  GstCaps *caps;
+  GstBus *bus;
+  GstPad *pad;
+  rtp_mp2t_data d = { 0, };
+  guint b, i, n_packets = 0;
+
+  d.align = align;
+
+  pipeline = gst_parse_launch ("appsrc name=src format=time ! "
+      "rtpmp2tpay name=pay timestamp-offset=0 ! fakesink", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pay = gst_bin_get_by_name (GST_BIN (pipeline), "pay");
+
+  caps = gst_caps_from_string ("video/mpegts,packetsize=188,"
+      "systemstream=true");
+  g_object_set (src, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  g_object_set (pay, "align", align, "mtu",
+      12 + MP2T_PACKETS_PER_MTU * 188, NULL);
+
+  pad = gst_element_get_static_pad (pay, "src");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      rtp_mp2t_probe, &d, NULL);
+  gst_object_unref (pad);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  for (b = 0; b < G_N_ELEMENTS (rtp_mp2t_buffers); b++) {
+    GstBuffer *buf;
+    GstMapInfo map;
+
+    buf = gst_buffer_new_allocate (NULL, rtp_mp2t_buffers[b] * 188, NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    for (i = 0; i < rtp_mp2t_buffers[b]; i++)
+      rtp_mp2t_make_packet (map.data + i * 188, n_packets++);
+    gst_buffer_unmap (buf, &map);
+
+    GST_BUFFER_PTS (buf) = b * MP2T_DURATION;
+    GST_BUFFER_DURATION (buf) = MP2T_DURATION;
+
+    g_signal_emit_by_name (src, "push-buffer", buf, &flow_ret);
+    fail_unless_equals_int (flow_ret, GST_FLOW_OK);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &flow_ret);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  /* all TS packets came out, in fewer lists than input buffers */
+  fail_unless_equals_int (d.next, n_packets);
+  fail_unless (d.n_lists > 1);
+  fail_unless (d.n_lists < G_N_ELEMENTS (rtp_mp2t_buffers));
+
+  gst_object_unref (src);
+  gst_object_unref (pay);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (rtp_mp2t_lists)
+{
+  rtp_mp2t_test (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_mp2t_align)
+{
+  rtp_mp2t_test (TRUE);
+}
+
 GST_END_TEST;
 static const guint8 rtp_mp4v_frame_data[] =
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -889,6 +1090,284 @@ GST_START_TEST (rtp_g729)
 
 GST_END_TEST;
 
+/*
+ * rtpvrawpay ! rtpvrawdepay round trip. The packets are checked on their way
+ * to the depayloader and the frame is rebuilt from them. Both that frame and
+ * the one that comes out of the depayloader are compared with the input.
+ */
+#define VRAW_WIDTH 24
+#define VRAW_HEIGHT 16
+#define VRAW_DURATION (GST_SECOND / 25)
+
+typedef struct
+{
+  guint stride;
+  guint pgroup;
+  guint xinc;
+  gboolean interlaced;
+  guint8 *frame;                /* rebuilt from the packets */
+  guint n_lists;
+  guint32 rtptime[2];           /* of the packets in each list */
+  GstBuffer *outbuf;            /* output of the depayloader */
+  gchar *outformat;
+} rtp_vraw_data;
+
+/*
+ * Checks the RFC 4175 headers of a packet and copies its lines into the
+ * rebuilt frame.
+ * @return the RTP timestamp of the packet.
+ */
+static guint32
+rtp_vraw_parse_packet (rtp_vraw_data * d, GstBuffer * buf, guint field,
+    gboolean last)
+{
+  GstMapInfo map;
+  guint8 *hdr, *hend, *data, *end;
+  guint32 rtptime;
+  guint cont;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  end = map.data + map.size;
+
+  /* version 2 without padding, extension or CSRCs, the marker is only set
+   * on the last packet of the field */
+  fail_unless (map.size > 14);
+  fail_unless_equals_int (map.data[0], 0x80);
+  fail_unless_equals_int ((map.data[1] & 0x80) != 0, last);
+  rtptime = GST_READ_UINT32_BE (map.data + 4);
+
+  /* skip the RTP header and the extended seqnum, the data starts after the
+   * header without continuation bit */
+  hdr = data = map.data + 14;
+  do {
+    fail_unless (data + 6 <= end);
+    cont = data[4] & 0x80;
+    data += 6;
+  } while (cont);
+  hend = data;
+
+  for (; hdr < hend; hdr += 6) {
+    guint length, line, offset;
+
+    length = GST_READ_UINT16_BE (hdr);
+    line = GST_READ_UINT16_BE (hdr + 2) & 0x7fff;
+    offset = GST_READ_UINT16_BE (hdr + 4) & 0x7fff;
+
+    fail_unless_equals_int (hdr[2] >> 7, field);
+    if (d->interlaced)
+      fail_unless_equals_int (line % 2, field);
+    fail_unless (line < VRAW_HEIGHT);
+    fail_unless (offset < VRAW_WIDTH);
+    fail_unless (length % d->pgroup == 0);
+    fail_unless ((offset / d->xinc) * d->pgroup + length <=
+        VRAW_WIDTH / d->xinc * d->pgroup);
+    fail_unless (data + length <= end);
+
+    memcpy (d->frame + line * d->stride + (offset / d->xinc) * d->pgroup,
+        data, length);
+    data += length;
+  }
+  fail_unless (data == end);
+
+  gst_buffer_unmap (buf, &map);
+
+  return rtptime;
+}
+
+/*
+ * Probe on the payloader src pad, all packets of a field must be in one list
+ * with the timestamp of that field.
+ */
+static GstPadProbeReturn
+rtp_vraw_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  rtp_vraw_data *d = user_data;
+  GstBufferList *list;
+  guint i, len;
+  guint32 rtptime;
+
+  fail_unless (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      "packet pushed outside of a list");
+  fail_unless (d->n_lists < (d->interlaced ? 2 : 1));
+
+  list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+  len = gst_buffer_list_length (list);
+  fail_unless (len > 1);
+
+  for (i = 0; i < len; i++) {
+    rtptime = rtp_vraw_parse_packet (d, gst_buffer_list_get (list, i),
+        d->n_lists, i == len - 1);
+    if (i == 0)
+      d->rtptime[d->n_lists] = rtptime;
+    else
+      fail_unless_equals_int (rtptime, d->rtptime[d->n_lists]);
+  }
+  d->n_lists++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+rtp_vraw_handoff (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    rtp_vraw_data * d)
+{
+  GstCaps *caps;
+
+  fail_unless (d->outbuf == NULL);
+  d->outbuf = gst_buffer_ref (buf);
+
+  caps = gst_pad_get_current_caps (pad);
+  d->outformat = g_strdup (gst_structure_get_string (gst_caps_get_structure
+          (caps, 0), "format"));
+  gst_caps_unref (caps);
+}
+
+/*
+ * Payloads one frame with a small MTU so that the lines are split over the
+ * packets.
+ * @param format Video format of the frame.
+ * @param stride Bytes per line.
+ * @param pgroup Bytes per pixel group.
+ * @param xinc Pixels per pixel group.
+ * @param interlaced The frame has two interleaved fields.
+ */
+static void
+rtp_vraw_test (const gchar * format, guint stride, guint pgroup, guint xinc,
+    gboolean interlaced)
+{
+  GstElement *pipeline, *src, *pay, *sink;
+  GstFlowReturn flow_ret;
+  GstMessage *msg;
+  GstMapInfo map;
+  GstBuffer *buf;
+  GstCaps *caps;
+  GstBus *bus;
+  GstPad *pad;
+  rtp_vraw_data d = { 0, };
+  guint8 *input;
+  guint i, size;
+
+  d.stride = stride;
+  d.pgroup = pgroup;
+  d.xinc = xinc;
+  d.interlaced = interlaced;
+  size = stride * VRAW_HEIGHT;
+  d.frame = g_malloc0 (size);
+
+  /* the depayloader does not handle interlaced video, the fields are only
+   * checked on the packets */
+  if (interlaced) {
+    pipeline = gst_parse_launch ("appsrc name=src format=time ! "
+        "rtpvrawpay name=pay mtu=200 timestamp-offset=0 ! "
+        "fakesink name=sink", NULL);
+  } else {
+    pipeline = gst_parse_launch ("appsrc name=src format=time ! "
+        "rtpvrawpay name=pay mtu=200 timestamp-offset=0 ! rtpvrawdepay ! "
+        "fakesink name=sink signal-handoffs=true", NULL);
+  }
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pay = gst_bin_get_by_name (GST_BIN (pipeline), "pay");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, format,
+      "width", G_TYPE_INT, VRAW_WIDTH, "height", G_TYPE_INT, VRAW_HEIGHT,
+      "framerate", GST_TYPE_FRACTION, 25, 1, "interlace-mode", G_TYPE_STRING,
+      interlaced ? "interleaved" : "progressive", NULL);
+  g_object_set (src, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  pad = gst_element_get_static_pad (pay, "src");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      rtp_vraw_probe, &d, NULL);
+  gst_object_unref (pad);
+
+  if (!interlaced)
+    g_signal_connect (sink, "handoff", G_CALLBACK (rtp_vraw_handoff), &d);
+
+  /* every byte differs from its neighbours so that a line taken from the
+   * wrong offset does not compare equal */
+  input = g_malloc (size);
+  for (i = 0; i < size; i++)
+    input[i] = i * 7 + 1;
+  buf = gst_buffer_new_wrapped (input, size);
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = VRAW_DURATION;
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (src, "push-buffer", buf, &flow_ret);
+  fail_unless_equals_int (flow_ret, GST_FLOW_OK);
+  g_signal_emit_by_name (src, "end-of-stream", &flow_ret);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  /* the second field is sent half a frame later */
+  fail_unless_equals_int (d.n_lists, interlaced ? 2 : 1);
+  fail_unless_equals_int (d.rtptime[0], 0);
+  if (interlaced)
+    fail_unless_equals_int (d.rtptime[1],
+        gst_util_uint64_scale_int (VRAW_DURATION / 2, 90000, GST_SECOND));
+
+  fail_unless (memcmp (d.frame, input, size) == 0);
+
+  if (!interlaced) {
+    fail_unless (d.outbuf != NULL);
+    fail_unless_equals_string (d.outformat, format);
+    gst_buffer_map (d.outbuf, &map, GST_MAP_READ);
+    fail_unless (map.size >= size);
+    fail_unless (memcmp (map.data, input, size) == 0);
+    gst_buffer_unmap (d.outbuf, &map);
+    gst_buffer_unref (d.outbuf);
+    g_free (d.outformat);
+  }
+
+  gst_buffer_unref (buf);
+  g_free (d.frame);
+  gst_object_unref (src);
+  gst_object_unref (pay);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (rtp_vraw_rgb)
+{
+  rtp_vraw_test ("RGB", VRAW_WIDTH * 3, 3, 1, FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_vraw_bgr)
+{
+  rtp_vraw_test ("BGR", VRAW_WIDTH * 3, 3, 1, FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_vraw_uyvy)
+{
+  rtp_vraw_test ("UYVY", VRAW_WIDTH * 2, 4, 2, FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_vraw_uyvy_interlaced)
+{
+  rtp_vraw_test ("UYVY", VRAW_WIDTH * 2, 4, 2, TRUE);
+}
+
+GST_END_TEST;
+
 /*
  * Creates the test suite.
  *
@@ -920,6 +1399,8 @@ rtp_payloading_suite (void)
   tcase_add_test (tc_chain, rtp_h264_list_gt_mtu_avc);
   tcase_add_test (tc_chain, rtp_L16);
   tcase_add_test (tc_chain, rtp_mp2t);
+  tcase_add_test (tc_chain, rtp_mp2t_lists);
+  tcase_add_test (tc_chain, rtp_mp2t_align);
   tcase_add_test (tc_chain, rtp_mp4v);
   tcase_add_test (tc_chain, rtp_mp4v_list);
   tcase_add_test (tc_chain, rtp_mp4g);
@@ -934,6 +1415,10 @@ rtp_payloading_suite (void)
   tcase_add_test (tc_chain, rtp_jpeg_list_height_greater_than_2040);
   tcase_add_test (tc_chain, rtp_jpeg_list_width_and_height_greater_than_2040);
   tcase_add_test (tc_chain, rtp_g729);
+  tcase_add_test (tc_chain, rtp_vraw_rgb);
+  tcase_add_test (tc_chain, rtp_vraw_bgr);
+  tcase_add_test (tc_chain, rtp_vraw_uyvy);
+  tcase_add_test (tc_chain, rtp_vraw_uyvy_interlaced);
   return s;
 }
 
@@ -290,6 +290,93 @@ GST_START_TEST (test_push_unordered)
 
 GST_END_TEST;
 
+GST_START_TEST (test_push_list)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 4;
+  GstBufferList *list;
+
+  jitterbuffer = setup_jitterbuffer (num_buffers);
+  fail_unless (start_jitterbuffer (jitterbuffer)
+      == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+  /* push one list with buffers 0,2,1,3 */
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, (GstBuffer *) inbuffers->data);
+  gst_buffer_list_add (list, g_list_nth_data (inbuffers, 2));
+  gst_buffer_list_add (list, g_list_nth_data (inbuffers, 1));
+  gst_buffer_list_add (list, g_list_nth_data (inbuffers, 3));
+  fail_unless (gst_pad_push_list (mysrcpad, list) == GST_FLOW_OK);
+
+  /* check the buffer list */
+  check_jitterbuffer_results (jitterbuffer, num_buffers);
+
+  /* cleanup */
+  cleanup_jitterbuffer (jitterbuffer);
+}
+
+GST_END_TEST;
+
+static guint num_rtx_requests = 0;
+static guint rtx_request_seqnum = 0;
+
+static gboolean
+rtx_request_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  const GstStructure *s = gst_event_get_structure (event);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CUSTOM_UPSTREAM &&
+      gst_structure_has_name (s, "GstRTPRetransmissionRequest")) {
+    fail_unless (gst_structure_get_uint (s, "seqnum", &rtx_request_seqnum));
+    num_rtx_requests++;
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+GST_START_TEST (test_retransmission_request)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 4;
+  GstBuffer *buffer;
+  guint8 seq[2];
+  guint16 missing;
+
+  jitterbuffer = setup_jitterbuffer (num_buffers);
+  g_object_set (jitterbuffer, "do-retransmission", TRUE, NULL);
+  gst_pad_set_event_function (mysrcpad, rtx_request_event);
+  num_rtx_requests = 0;
+  fail_unless (start_jitterbuffer (jitterbuffer)
+      == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+  /* the seqnum is at offset 2 in the RTP header */
+  buffer = g_list_nth_data (inbuffers, 1);
+  fail_unless (gst_buffer_extract (buffer, 2, seq, 2) == 2);
+  missing = GST_READ_UINT16_BE (seq);
+
+  /* push buffers 0,2,1,3, only the gap before 2 is requested */
+  buffer = (GstBuffer *) inbuffers->data;
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  buffer = g_list_nth_data (inbuffers, 2);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  fail_unless_equals_int (num_rtx_requests, 1);
+  fail_unless_equals_int (rtx_request_seqnum, missing);
+  buffer = g_list_nth_data (inbuffers, 1);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  buffer = g_list_nth_data (inbuffers, 3);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  fail_unless_equals_int (num_rtx_requests, 1);
+
+  /* check the buffer list */
+  check_jitterbuffer_results (jitterbuffer, num_buffers);
+
+  /* cleanup */
+  cleanup_jitterbuffer (jitterbuffer);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_basetime)
 {
   GstElement *jitterbuffer;
@@ -323,6 +410,182 @@ GST_START_TEST (test_basetime)
 
 GST_END_TEST;
 
+static gboolean got_eos = FALSE;
+static guint num_lost_events = 0;
+static guint lost_seqnum = 0;
+
+static gboolean
+shared_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  const GstStructure *s = gst_event_get_structure (event);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    g_mutex_lock (&check_mutex);
+    got_eos = TRUE;
+    g_cond_signal (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  } else if (GST_EVENT_TYPE (event) == GST_EVENT_CUSTOM_DOWNSTREAM &&
+      gst_structure_has_name (s, "GstRTPPacketLost")) {
+    fail_unless (gst_structure_get_uint (s, "seqnum", &lost_seqnum));
+    num_lost_events++;
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static guint16
+get_seqnum (GstBuffer * buffer)
+{
+  guint8 seq[2];
+
+  fail_unless (gst_buffer_extract (buffer, 2, seq, 2) == 2);
+
+  return GST_READ_UINT16_BE (seq);
+}
+
+/* waits until the shared threads pushed @num_buffers buffers */
+static void
+wait_for_buffers (guint num_buffers)
+{
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < num_buffers)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+}
+
+static void
+wait_for_eos (void)
+{
+  g_mutex_lock (&check_mutex);
+  while (!got_eos)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+}
+
+static void
+check_seqnums (const guint16 * seqnums, guint num_buffers)
+{
+  guint i;
+
+  fail_unless_equals_int (g_list_length (buffers), num_buffers);
+  for (i = 0; i < num_buffers; i++)
+    fail_unless_equals_int (get_seqnum (g_list_nth_data (buffers, i)),
+        seqnums[i]);
+}
+
+GST_START_TEST (test_shared_threads)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 8;
+  GstBuffer *buffer;
+  GstSegment segment;
+  GstCaps *caps;
+  guint16 seqnums[8], expected[3];
+  gint i;
+
+  jitterbuffer = setup_jitterbuffer (num_buffers);
+  g_object_set (jitterbuffer, "shared-threads", TRUE, "do-lost", TRUE, NULL);
+  gst_pad_set_event_function (mysinkpad, shared_sink_event);
+  got_eos = FALSE;
+  num_lost_events = 0;
+  for (i = 0; i < num_buffers; i++)
+    seqnums[i] = get_seqnum (g_list_nth_data (inbuffers, i));
+  fail_unless (start_jitterbuffer (jitterbuffer)
+      == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+  /* push buffers 0,2,1,3, the gap is filled before it expires */
+  buffer = (GstBuffer *) inbuffers->data;
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  buffer = g_list_nth_data (inbuffers, 2);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  buffer = g_list_nth_data (inbuffers, 1);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  buffer = g_list_nth_data (inbuffers, 3);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+  wait_for_buffers (4);
+  check_seqnums (seqnums, 4);
+  fail_unless_equals_int (num_lost_events, 0);
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+
+  /* flush, the loop on the shared threads must stop and start again */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_stop (TRUE)));
+  caps = gst_caps_from_string (RTP_CAPS_STRING);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  /* push buffers 4,6,7, 5 never arrives and is reported lost */
+  buffer = g_list_nth_data (inbuffers, 4);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  buffer = g_list_nth_data (inbuffers, 6);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  buffer = g_list_nth_data (inbuffers, 7);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  gst_buffer_unref (g_list_nth_data (inbuffers, 5));
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* the EOS is pushed after the buffers and the lost event */
+  wait_for_eos ();
+  fail_unless_equals_int (num_lost_events, 1);
+  fail_unless_equals_int (lost_seqnum, seqnums[5]);
+  expected[0] = seqnums[4];
+  expected[1] = seqnums[6];
+  expected[2] = seqnums[7];
+  check_seqnums (expected, 3);
+
+  /* cleanup */
+  cleanup_jitterbuffer (jitterbuffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_gap_filled_before_deadline)
+{
+  GstElement *jitterbuffer;
+  const guint num_buffers = 4;
+  GstBuffer *buffer;
+  gint shared;
+
+  for (shared = 0; shared < 2; shared++) {
+    jitterbuffer = setup_jitterbuffer (num_buffers);
+    g_object_set (jitterbuffer, "shared-threads", shared, "do-lost", TRUE,
+        NULL);
+    gst_pad_set_event_function (mysinkpad, shared_sink_event);
+    num_lost_events = 0;
+    fail_unless (start_jitterbuffer (jitterbuffer)
+        == GST_STATE_CHANGE_SUCCESS, "could not set to playing");
+
+    /* push buffers 0,2, the loop waits for 1 until the deadline */
+    buffer = (GstBuffer *) inbuffers->data;
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+    buffer = g_list_nth_data (inbuffers, 2);
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+    g_usleep (50 * 1000);
+
+    /* 1 arrives well before the latency expired, like a retransmission, and
+     * has to be pushed instead of being considered lost */
+    buffer = g_list_nth_data (inbuffers, 1);
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+    buffer = g_list_nth_data (inbuffers, 3);
+    fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+    wait_for_buffers (num_buffers);
+    check_jitterbuffer_results (jitterbuffer, num_buffers);
+    fail_unless_equals_int (num_lost_events, 0);
+
+    cleanup_jitterbuffer (jitterbuffer);
+  }
+}
+
+GST_END_TEST;
+
 #if 0
 static const guint payload_size = 160;
 static const guint clock_rate = 8000;
@@ -839,7 +1102,11 @@ rtpjitterbuffer_suite (void)
   tcase_add_test (tc_chain, test_push_forward_seq);
   tcase_add_test (tc_chain, test_push_backward_seq);
   tcase_add_test (tc_chain, test_push_unordered);
+  tcase_add_test (tc_chain, test_push_list);
+  tcase_add_test (tc_chain, test_retransmission_request);
   tcase_add_test (tc_chain, test_basetime);
+  tcase_add_test (tc_chain, test_shared_threads);
+  tcase_add_test (tc_chain, test_gap_filled_before_deadline);
 #if 0
   tcase_add_test (tc_chain, test_only_one_lost_event_on_large_gaps);
   tcase_add_test (tc_chain, test_two_lost_one_arrives_in_time);
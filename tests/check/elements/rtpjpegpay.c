@@ -0,0 +1,385 @@
+/* GStreamer unit tests for rtpjpegpay
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include <string.h>
+
+/* the type is registered by the plugin, only the instance struct is used */
+#include "../../gst/rtp/gstrtpjpegpay.h"
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define JPEG_CAPS_STRING \
+    "image/jpeg, width = (int) 16, height = (int) 16"
+
+#define RTP_CAPS_STRING \
+    "application/x-rtp, " \
+    "media = (string) video, " \
+    "payload = (int) 26, " \
+    "clock-rate = (int) 90000, " \
+    "encoding-name = (string) JPEG"
+
+#define MTU 200
+#define SCAN_SIZE 400
+
+/* size of the JPEG header up to the end of the SOS segment */
+#define JPEG_HEADER_SIZE (2 + 134 + 19 + 14)
+
+static const guint8 zigzag[] = {
+  0, 1, 8, 16, 9, 2, 3, 10,
+  17, 24, 32, 25, 18, 11, 4, 5,
+  12, 19, 26, 33, 40, 48, 41, 34,
+  27, 20, 13, 6, 7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36,
+  29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46,
+  53, 60, 61, 54, 47, 55, 62, 63
+};
+
+/* tables K.1 and K.2 of the JPEG spec, used by RFC 2435 for Q 1-99 */
+static const guint8 jpeg_luma_quantizer[64] = {
+  16, 11, 10, 16, 24, 40, 51, 61,
+  12, 12, 14, 19, 26, 58, 60, 55,
+  14, 13, 16, 24, 40, 57, 69, 56,
+  14, 17, 22, 29, 51, 87, 80, 62,
+  18, 22, 37, 56, 68, 109, 103, 77,
+  24, 35, 55, 64, 81, 104, 113, 92,
+  49, 64, 78, 87, 103, 121, 120, 101,
+  72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const guint8 jpeg_chroma_quantizer[64] = {
+  17, 18, 24, 47, 99, 99, 99, 99,
+  18, 21, 26, 66, 99, 99, 99, 99,
+  24, 26, 56, 99, 99, 99, 99, 99,
+  47, 66, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99
+};
+
+/* the luma and chroma tables in zigzag order, as in the DQT segment */
+typedef struct
+{
+  guint8 luma[64];
+  guint8 chroma[64];
+} QuantTables;
+
+static void
+make_standard_tables (QuantTables * tables, gint q)
+{
+  gint factor = (q < 50 ? 5000 / q : 200 - q * 2);
+  gint i;
+
+  for (i = 0; i < 64; i++) {
+    gint lq = (jpeg_luma_quantizer[zigzag[i]] * factor + 50) / 100;
+    gint cq = (jpeg_chroma_quantizer[zigzag[i]] * factor + 50) / 100;
+
+    tables->luma[i] = CLAMP (lq, 1, 255);
+    tables->chroma[i] = CLAMP (cq, 1, 255);
+  }
+}
+
+static void
+make_custom_tables (QuantTables * tables)
+{
+  gint i;
+
+  for (i = 0; i < 64; i++) {
+    tables->luma[i] = i + 1;
+    tables->chroma[i] = 64 - i;
+  }
+}
+
+/* a 4:2:0 JPEG with @tables and some scan data that doesn't contain
+ * markers */
+static GstBuffer *
+make_jpeg (const QuantTables * tables, GstClockTime timestamp)
+{
+  static const guint8 sof[] = {
+    0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x10, 0x00, 0x10, 0x03,
+    0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01
+  };
+  static const guint8 sos[] = {
+    0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11,
+    0x00, 0x3f, 0x00
+  };
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint8 *p;
+  guint i;
+
+  buffer = gst_buffer_new_and_alloc (JPEG_HEADER_SIZE + SCAN_SIZE + 2);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  p = map.data;
+
+  /* SOI */
+  *p++ = 0xff;
+  *p++ = 0xd8;
+  /* DQT with both tables */
+  *p++ = 0xff;
+  *p++ = 0xdb;
+  *p++ = 0x00;
+  *p++ = 2 + 2 * 65;
+  *p++ = 0x00;
+  memcpy (p, tables->luma, 64);
+  p += 64;
+  *p++ = 0x01;
+  memcpy (p, tables->chroma, 64);
+  p += 64;
+  memcpy (p, sof, sizeof (sof));
+  p += sizeof (sof);
+  memcpy (p, sos, sizeof (sos));
+  p += sizeof (sos);
+  fail_unless_equals_int (p - map.data, JPEG_HEADER_SIZE);
+
+  for (i = 0; i < SCAN_SIZE; i++)
+    *p++ = (i * 7) % 251;
+  /* EOI */
+  *p++ = 0xff;
+  *p++ = 0xd9;
+  gst_buffer_unmap (buffer, &map);
+
+  GST_BUFFER_TIMESTAMP (buffer) = timestamp;
+
+  return buffer;
+}
+
+static GstElement *
+setup_element (const gchar * name, const gchar * caps_str)
+{
+  GstElement *element;
+  GstCaps *caps;
+
+  element = gst_check_setup_element (name);
+  mysrcpad = gst_check_setup_src_pad (element, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (element, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless_equals_int (gst_element_set_state (element, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (caps_str);
+  gst_check_setup_events (mysrcpad, element, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return element;
+}
+
+static void
+cleanup_element (GstElement * element)
+{
+  fail_unless_equals_int (gst_element_set_state (element, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (element);
+  gst_check_teardown_sink_pad (element);
+  gst_check_teardown_element (element);
+}
+
+/* checks the packets of one frame in @packets, starting at @first, and
+ * returns the index of the first packet of the next frame */
+static guint
+check_frame_packets (GList * packets, guint first, GstBuffer * frame,
+    guint8 q, const QuantTables * tables)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstMapInfo map;
+  guint offset = 0, n = first;
+  gboolean marker = FALSE;
+
+  gst_buffer_map (frame, &map, GST_MAP_READ);
+
+  while (!marker) {
+    GstBuffer *packet = g_list_nth_data (packets, n++);
+    guint8 *payload;
+    guint len;
+
+    fail_unless (packet != NULL);
+    fail_unless (gst_rtp_buffer_map (packet, GST_MAP_READ, &rtp));
+    payload = gst_rtp_buffer_get_payload (&rtp);
+    len = gst_rtp_buffer_get_payload_len (&rtp);
+    marker = gst_rtp_buffer_get_marker (&rtp);
+
+    /* main JPEG header */
+    fail_unless (len > 8);
+    fail_unless_equals_int (GST_READ_UINT24_BE (payload + 1), offset);
+    fail_unless_equals_int (payload[4], 1);
+    fail_unless_equals_int (payload[5], q);
+    fail_unless_equals_int (payload[6], 2);
+    fail_unless_equals_int (payload[7], 2);
+    payload += 8;
+    len -= 8;
+
+    /* only the first packet carries the in-band tables */
+    if (q >= 128 && offset == 0) {
+      fail_unless (len > 4 + 128);
+      fail_unless_equals_int (payload[0], 0);
+      fail_unless_equals_int (payload[1], 0);
+      fail_unless_equals_int (GST_READ_UINT16_BE (payload + 2), 128);
+      fail_unless (memcmp (payload + 4, tables->luma, 64) == 0);
+      fail_unless (memcmp (payload + 68, tables->chroma, 64) == 0);
+      payload += 4 + 128;
+      len -= 4 + 128;
+    }
+
+    /* the frame after the JPEG header */
+    fail_unless (JPEG_HEADER_SIZE + offset + len <= map.size);
+    fail_unless (memcmp (payload, map.data + JPEG_HEADER_SIZE + offset,
+            len) == 0);
+    offset += len;
+
+    gst_rtp_buffer_unmap (&rtp);
+  }
+  fail_unless_equals_int (JPEG_HEADER_SIZE + offset, map.size);
+
+  gst_buffer_unmap (frame, &map);
+
+  return n;
+}
+
+/* checks that the depayloaded @jpeg has the tables and scan data of
+ * @frame */
+static void
+check_depayloaded_frame (GstBuffer * jpeg, GstBuffer * frame,
+    const QuantTables * tables)
+{
+  GstMapInfo map, frame_map;
+  gsize tail;
+
+  gst_buffer_map (jpeg, &map, GST_MAP_READ);
+  gst_buffer_map (frame, &frame_map, GST_MAP_READ);
+
+  /* SOI, then one DQT segment for each table */
+  fail_unless (map.size > 2 + 2 * 69);
+  fail_unless (map.data[0] == 0xff && map.data[1] == 0xd8);
+  fail_unless (map.data[2] == 0xff && map.data[3] == 0xdb);
+  fail_unless_equals_int (map.data[6], 0);
+  fail_unless (memcmp (map.data + 7, tables->luma, 64) == 0);
+  fail_unless (map.data[71] == 0xff && map.data[72] == 0xdb);
+  fail_unless_equals_int (map.data[75], 1);
+  fail_unless (memcmp (map.data + 76, tables->chroma, 64) == 0);
+
+  /* the scan data and EOI come last */
+  tail = frame_map.size - JPEG_HEADER_SIZE;
+  fail_unless (map.size > tail);
+  fail_unless (memcmp (map.data + map.size - tail,
+          frame_map.data + JPEG_HEADER_SIZE, tail) == 0);
+
+  gst_buffer_unmap (frame, &frame_map);
+  gst_buffer_unmap (jpeg, &map);
+}
+
+GST_START_TEST (test_header_cache)
+{
+  GstElement *pay, *depay;
+  GstRtpJPEGPay *jpegpay;
+  QuantTables q50, q75, custom;
+  const QuantTables *frame_tables[4];
+  const guint8 frame_q[4] = { 50, 50, 255, 75 };
+  GstBuffer *frames[4];
+  GList *packets, *l;
+  guint i, n;
+
+  make_standard_tables (&q50, 50);
+  make_standard_tables (&q75, 75);
+  make_custom_tables (&custom);
+
+  /* two identical frames, one with tables that are not the standard ones
+   * and one with standard tables of another Q */
+  frame_tables[0] = &q50;
+  frame_tables[1] = &q50;
+  frame_tables[2] = &custom;
+  frame_tables[3] = &q75;
+
+  pay = setup_element ("rtpjpegpay", JPEG_CAPS_STRING);
+  g_object_set (pay, "mtu", MTU, NULL);
+  jpegpay = (GstRtpJPEGPay *) pay;
+
+  for (i = 0; i < G_N_ELEMENTS (frames); i++) {
+    GstMapInfo map;
+
+    frames[i] = make_jpeg (frame_tables[i], i * GST_SECOND / 30);
+    fail_unless_equals_int (gst_pad_push (mysrcpad,
+            gst_buffer_ref (frames[i])), GST_FLOW_OK);
+
+    /* the cache holds the header of the last frame */
+    fail_unless_equals_int (jpegpay->header_size, JPEG_HEADER_SIZE);
+    gst_buffer_map (frames[i], &map, GST_MAP_READ);
+    fail_unless (memcmp (jpegpay->header, map.data, JPEG_HEADER_SIZE) == 0);
+    gst_buffer_unmap (frames[i], &map);
+  }
+
+  packets = buffers;
+  buffers = NULL;
+  cleanup_element (pay);
+
+  /* the standard tables are sent as Q, the others in-band with Q 255 */
+  n = 0;
+  for (i = 0; i < G_N_ELEMENTS (frames); i++)
+    n = check_frame_packets (packets, n, frames[i], frame_q[i],
+        frame_tables[i]);
+  fail_unless_equals_int (n, g_list_length (packets));
+
+  /* and they are depayloaded to the same tables and data */
+  depay = setup_element ("rtpjpegdepay", RTP_CAPS_STRING);
+  for (l = packets; l; l = l->next)
+    fail_unless_equals_int (gst_pad_push (mysrcpad, l->data), GST_FLOW_OK);
+  g_list_free (packets);
+
+  fail_unless_equals_int (g_list_length (buffers), G_N_ELEMENTS (frames));
+  for (l = buffers, i = 0; l; l = l->next, i++)
+    check_depayloaded_frame (l->data, frames[i], frame_tables[i]);
+  cleanup_element (depay);
+
+  for (i = 0; i < G_N_ELEMENTS (frames); i++)
+    gst_buffer_unref (frames[i]);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpjpegpay_suite (void)
+{
+  Suite *s = suite_create ("rtpjpegpay");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_header_cache);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpjpegpay);
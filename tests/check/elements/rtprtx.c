@@ -0,0 +1,468 @@
+/* GStreamer
+ *
+ * unit test for rtprtxsend and rtprtxreceive
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#define MEDIA_SSRC      0x11111111
+#define MEDIA_PT        96
+#define RTX_PT          97
+#define SEQNUM_BASE     1000
+#define PAYLOAD_LEN     20
+
+#define RTP_CAPS_STRING    \
+    "application/x-rtp, "               \
+    "media = (string) video, "          \
+    "payload = (int) 96, "              \
+    "clock-rate = (int) 90000, "        \
+    "encoding-name = (string) VP8, "    \
+    "ssrc = (uint) 286331153"
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+/* a packet of 20ms of the media stream, the payload depends on the seqnum */
+static GstBuffer *
+create_rtp_packet (guint16 seqnum)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  guint8 *payload;
+  guint i;
+
+  buffer = gst_rtp_buffer_new_allocate (PAYLOAD_LEN, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_ssrc (&rtp, MEDIA_SSRC);
+  gst_rtp_buffer_set_payload_type (&rtp, MEDIA_PT);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, (seqnum - SEQNUM_BASE) * 1800);
+  gst_rtp_buffer_set_marker (&rtp, TRUE);
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  for (i = 0; i < PAYLOAD_LEN; i++)
+    payload[i] = seqnum + i;
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+static void
+send_rtx_request (guint16 seqnum)
+{
+  GstEvent *event;
+
+  event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+      gst_structure_new ("GstRTPRetransmissionRequest",
+          "seqnum", G_TYPE_UINT, (guint) seqnum,
+          "ssrc", G_TYPE_UINT, (guint) MEDIA_SSRC,
+          "payload", G_TYPE_UINT, (guint) MEDIA_PT, NULL));
+  fail_unless (gst_pad_push_event (mysinkpad, event));
+}
+
+/* the packets between rtprtxsend and rtprtxreceive */
+static GList *wire_buffers = NULL;
+
+static GstPadProbeReturn
+wire_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  wire_buffers = g_list_append (wire_buffers,
+      gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info)));
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_rtx_round_trip)
+{
+  GstElement *rtxsend, *rtxreceive;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstPad *srcpad, *sinkpad;
+  GstBuffer *buffer, *expected;
+  GstMapInfo map;
+  GstCaps *caps;
+  guint8 *payload;
+  guint i, rtx_ssrc, value;
+
+  rtxsend = gst_check_setup_element ("rtprtxsend");
+  rtxreceive = gst_check_setup_element ("rtprtxreceive");
+  g_object_set (rtxsend, "rtx-payload-type", RTX_PT, "max-size-packets", 5,
+      NULL);
+  g_object_set (rtxreceive, "rtx-payload-type", RTX_PT, NULL);
+  g_object_get (rtxsend, "rtx-ssrc", &rtx_ssrc, NULL);
+
+  mysrcpad = gst_check_setup_src_pad (rtxsend, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (rtxreceive, &sinktemplate);
+  srcpad = gst_element_get_static_pad (rtxsend, "src");
+  sinkpad = gst_element_get_static_pad (rtxreceive, "sink");
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER, wire_probe, NULL,
+      NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (rtxsend,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_element_set_state (rtxreceive,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (RTP_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, rtxsend, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* rtpsession sends the packets with the RTX SSRC of the caps unchanged */
+  caps = gst_pad_get_current_caps (srcpad);
+  fail_unless (caps != NULL);
+  fail_unless (gst_structure_get_uint (gst_caps_get_structure (caps, 0),
+          "rtx-ssrc", &value));
+  fail_unless_equals_uint64 (value, rtx_ssrc);
+  fail_unless (rtx_ssrc != MEDIA_SSRC);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 10; i++) {
+    fail_unless (gst_pad_push (mysrcpad,
+            create_rtp_packet (SEQNUM_BASE + i)) == GST_FLOW_OK);
+  }
+  fail_unless_equals_int (g_list_length (buffers), 10);
+
+  /* only the last 5 packets are kept */
+  send_rtx_request (SEQNUM_BASE + 2);
+  fail_unless_equals_int (g_list_length (buffers), 10);
+  fail_unless_equals_int (g_list_length (wire_buffers), 10);
+
+  send_rtx_request (SEQNUM_BASE + 7);
+  fail_unless_equals_int (g_list_length (wire_buffers), 11);
+  fail_unless_equals_int (g_list_length (buffers), 11);
+
+  /* on the wire it has its own SSRC, payload type and seqnum with the
+   * original seqnum in front of the payload */
+  buffer = g_list_last (wire_buffers)->data;
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  fail_unless_equals_uint64 (gst_rtp_buffer_get_ssrc (&rtp), rtx_ssrc);
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_type (&rtp), RTX_PT);
+  fail_unless_equals_int (gst_rtp_buffer_get_timestamp (&rtp), 7 * 1800);
+  fail_unless (gst_rtp_buffer_get_marker (&rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+      PAYLOAD_LEN + 2);
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  fail_unless_equals_int (GST_READ_UINT16_BE (payload), SEQNUM_BASE + 7);
+  for (i = 0; i < PAYLOAD_LEN; i++)
+    fail_unless_equals_int (payload[i + 2], (guint8) (SEQNUM_BASE + 7 + i));
+  gst_rtp_buffer_unmap (&rtp);
+
+  /* and the receiver restores the original packet */
+  buffer = g_list_last (buffers)->data;
+  expected = create_rtp_packet (SEQNUM_BASE + 7);
+  gst_buffer_map (expected, &map, GST_MAP_READ);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), map.size);
+  fail_unless (gst_buffer_memcmp (buffer, 0, map.data, map.size) == 0);
+  gst_buffer_unmap (expected, &map);
+  gst_buffer_unref (expected);
+
+  g_object_get (rtxsend, "num-rtx-requests", &value, NULL);
+  fail_unless_equals_int (value, 2);
+  g_object_get (rtxsend, "num-rtx-packets", &value, NULL);
+  fail_unless_equals_int (value, 1);
+  g_object_get (rtxreceive, "num-rtx-requests", &value, NULL);
+  fail_unless_equals_int (value, 2);
+  g_object_get (rtxreceive, "num-rtx-packets", &value, NULL);
+  fail_unless_equals_int (value, 1);
+  g_object_get (rtxreceive, "num-rtx-assoc-packets", &value, NULL);
+  fail_unless_equals_int (value, 1);
+
+  g_list_free_full (wire_buffers, (GDestroyNotify) gst_buffer_unref);
+  wire_buffers = NULL;
+  gst_check_drop_buffers ();
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+
+  gst_element_set_state (rtxsend, GST_STATE_NULL);
+  gst_element_set_state (rtxreceive, GST_STATE_NULL);
+  gst_check_teardown_src_pad (rtxsend);
+  gst_check_teardown_sink_pad (rtxreceive);
+  gst_check_teardown_element (rtxsend);
+  gst_check_teardown_element (rtxreceive);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtx_receive_unrequested)
+{
+  GstElement *rtxreceive;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  guint8 *payload;
+  guint value;
+
+  rtxreceive = gst_check_setup_element ("rtprtxreceive");
+  g_object_set (rtxreceive, "rtx-payload-type", RTX_PT, NULL);
+  mysrcpad = gst_check_setup_src_pad (rtxreceive, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (rtxreceive, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless (gst_element_set_state (rtxreceive,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (RTP_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, rtxreceive, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* media packets pass */
+  fail_unless (gst_pad_push (mysrcpad,
+          create_rtp_packet (SEQNUM_BASE)) == GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  /* a retransmission nobody asked for can't be mapped to a stream */
+  buffer = create_rtp_packet (SEQNUM_BASE + 1);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_ssrc (&rtp, 0x22222222);
+  gst_rtp_buffer_set_payload_type (&rtp, RTX_PT);
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  GST_WRITE_UINT16_BE (payload, SEQNUM_BASE + 5);
+  gst_rtp_buffer_unmap (&rtp);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  g_object_get (rtxreceive, "num-rtx-packets", &value, NULL);
+  fail_unless_equals_int (value, 1);
+  g_object_get (rtxreceive, "num-rtx-assoc-packets", &value, NULL);
+  fail_unless_equals_int (value, 0);
+
+  gst_check_drop_buffers ();
+  gst_element_set_state (rtxreceive, GST_STATE_NULL);
+  gst_check_teardown_src_pad (rtxreceive);
+  gst_check_teardown_sink_pad (rtxreceive);
+  gst_check_teardown_element (rtxreceive);
+}
+
+GST_END_TEST;
+
+/* lossy loopback between two rtpbins: the packets go through rtprtxsend, the
+ * sending rtpbin, a link that loses some packets, rtprtxreceive and the
+ * receiving rtpbin. The RTCP of the receiver, with the NACKs, goes back to
+ * the sender. */
+#define NUM_PACKETS     50
+#define LATENCY_MS      200
+
+static GMutex loopback_lock;
+static GCond loopback_cond;
+static guint num_dropped;
+static guint num_received;
+static gboolean received_in_order;
+
+/* the first transmission of these packets is lost. After the last one there
+ * are more packets than fit in the latency, it would be given up on when the
+ * retransmission doesn't arrive in time */
+static gboolean
+is_lost_packet (guint16 seqnum)
+{
+  switch (seqnum - SEQNUM_BASE) {
+    case 10:
+    case 20:
+    case 21:
+    case 30:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+static GstPadProbeReturn
+lossy_link_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  gboolean lost;
+
+  /* only RTCP takes the way back, like on a network */
+  if (info->type & GST_PAD_PROBE_TYPE_EVENT_UPSTREAM)
+    return GST_PAD_PROBE_DROP;
+
+  buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp))
+    return GST_PAD_PROBE_OK;
+  lost = gst_rtp_buffer_get_payload_type (&rtp) == MEDIA_PT &&
+      is_lost_packet (gst_rtp_buffer_get_seq (&rtp));
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (!lost)
+    return GST_PAD_PROBE_OK;
+
+  g_mutex_lock (&loopback_lock);
+  num_dropped++;
+  g_mutex_unlock (&loopback_lock);
+
+  return GST_PAD_PROBE_DROP;
+}
+
+static void
+loopback_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seqnum;
+
+  gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp);
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  g_mutex_lock (&loopback_lock);
+  if (seqnum != SEQNUM_BASE + num_received)
+    received_in_order = FALSE;
+  num_received++;
+  g_cond_signal (&loopback_cond);
+  g_mutex_unlock (&loopback_lock);
+}
+
+static void
+loopback_pad_added (GstElement * rtpbin, GstPad * pad, GstElement * sink)
+{
+  GstPad *sinkpad;
+
+  if (!g_str_has_prefix (GST_PAD_NAME (pad), "recv_rtp_src_"))
+    return;
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+static GstCaps *
+loopback_request_pt_map (GstElement * rtpbin, guint session, guint pt,
+    GstCaps * caps)
+{
+  if (pt != MEDIA_PT)
+    return NULL;
+
+  return gst_caps_ref (caps);
+}
+
+GST_START_TEST (test_rtx_lossy_loopback)
+{
+  GstElement *pipeline, *src, *recv, *sink, *rtxsend, *rtxreceive;
+  GstPad *pad;
+  GstCaps *caps;
+  gint64 end_time;
+  guint i, value;
+
+  pipeline = gst_parse_launch ("rtpbin name=send "
+      "rtpbin name=recv do-retransmission=true latency=200 "
+      "appsrc name=src is-live=true do-timestamp=true format=time ! "
+      "rtprtxsend name=rtxsend rtx-payload-type=97 ! send.send_rtp_sink_0 "
+      "send.send_rtp_src_0 ! "
+      "rtprtxreceive name=rtxreceive rtx-payload-type=97 ! "
+      "recv.recv_rtp_sink_0 "
+      "recv.send_rtcp_src_0 ! send.recv_rtcp_sink_0 "
+      "fakesink name=sink sync=false async=false signal-handoffs=true", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  recv = gst_bin_get_by_name (GST_BIN (pipeline), "recv");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  rtxsend = gst_bin_get_by_name (GST_BIN (pipeline), "rtxsend");
+  rtxreceive = gst_bin_get_by_name (GST_BIN (pipeline), "rtxreceive");
+
+  /* the receiver negotiated NACKs */
+  caps = gst_caps_from_string (RTP_CAPS_STRING
+      ", rtcp-fb-nack = (boolean) true");
+  g_object_set (src, "caps", caps, NULL);
+  g_signal_connect (recv, "request-pt-map",
+      (GCallback) loopback_request_pt_map, caps);
+  g_signal_connect (recv, "pad-added", (GCallback) loopback_pad_added, sink);
+  g_signal_connect (sink, "handoff", (GCallback) loopback_handoff, NULL);
+
+  pad = gst_element_get_static_pad (rtxreceive, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_EVENT_UPSTREAM, lossy_link_probe, NULL, NULL);
+  gst_object_unref (pad);
+
+  num_dropped = 0;
+  num_received = 0;
+  received_in_order = TRUE;
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  /* in real time, so that the jitterbuffer waits for the lost packets like
+   * it would on a network */
+  for (i = 0; i < NUM_PACKETS; i++) {
+    GstFlowReturn ret;
+
+    g_signal_emit_by_name (src, "push-buffer",
+        create_rtp_packet (SEQNUM_BASE + i), &ret);
+    fail_unless_equals_int (ret, GST_FLOW_OK);
+    g_usleep (20 * G_USEC_PER_SEC / 1000);
+  }
+
+  end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&loopback_lock);
+  while (num_received < NUM_PACKETS) {
+    if (!g_cond_wait_until (&loopback_cond, &loopback_lock, end_time))
+      break;
+  }
+  g_mutex_unlock (&loopback_lock);
+
+  /* every lost packet was recovered before the jitterbuffer gave up on it */
+  fail_unless_equals_int (num_dropped, 4);
+  fail_unless_equals_int (num_received, NUM_PACKETS);
+  fail_unless (received_in_order);
+
+  g_object_get (rtxsend, "num-rtx-packets", &value, NULL);
+  fail_unless_equals_int (value, 4);
+  g_object_get (rtxreceive, "num-rtx-assoc-packets", &value, NULL);
+  fail_unless_equals_int (value, 4);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_caps_unref (caps);
+  gst_object_unref (src);
+  gst_object_unref (recv);
+  gst_object_unref (sink);
+  gst_object_unref (rtxsend);
+  gst_object_unref (rtxreceive);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtprtx_suite (void)
+{
+  Suite *s = suite_create ("rtprtx");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_rtx_round_trip);
+  tcase_add_test (tc_chain, test_rtx_receive_unrequested);
+  tcase_add_test (tc_chain, test_rtx_lossy_loopback);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtprtx);
@@ -0,0 +1,226 @@
+/* GStreamer
+ *
+ * unit test for rtpssrcdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+static GstPad *mysrcpad;
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+#define RTP_CAPS_STRING    \
+    "application/x-rtp, "               \
+    "media = (string)audio, "           \
+    "payload = (int) 0, "               \
+    "clock-rate = (int) 8000, "         \
+    "encoding-name = (string)PCMU"
+
+/* one for every src pad of the demuxer */
+typedef struct
+{
+  guint32 ssrc;
+  GstPad *srcpad;
+  GstPad *sinkpad;
+  guint count;
+} Output;
+
+static GList *outputs = NULL;
+
+static GstFlowReturn
+output_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  Output *output = g_object_get_data (G_OBJECT (pad), "output");
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtp), output->ssrc);
+  /* the packets of an SSRC arrive in order */
+  fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp), output->count);
+  gst_rtp_buffer_unmap (&rtp);
+  output->count++;
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static void
+new_ssrc_pad_cb (GstElement * demux, guint ssrc, GstPad * pad,
+    gpointer user_data)
+{
+  Output *output;
+
+  output = g_new0 (Output, 1);
+  output->ssrc = ssrc;
+  output->srcpad = gst_object_ref (pad);
+  output->sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  g_object_set_data (G_OBJECT (output->sinkpad), "output", output);
+  gst_pad_set_chain_function (output->sinkpad, output_chain);
+  gst_pad_set_active (output->sinkpad, TRUE);
+  fail_unless_equals_int (gst_pad_link (pad, output->sinkpad),
+      GST_PAD_LINK_OK);
+
+  outputs = g_list_append (outputs, output);
+}
+
+static Output *
+find_output (guint32 ssrc, guint n)
+{
+  GList *l;
+
+  for (l = outputs; l; l = l->next) {
+    Output *output = l->data;
+
+    if (output->ssrc == ssrc && n-- == 0)
+      return output;
+  }
+
+  return NULL;
+}
+
+static GstElement *
+setup_rtpssrcdemux (void)
+{
+  GstElement *demux;
+  GstCaps *caps;
+
+  demux = gst_check_setup_element ("rtpssrcdemux");
+  g_signal_connect (demux, "new-ssrc-pad", G_CALLBACK (new_ssrc_pad_cb),
+      NULL);
+
+  mysrcpad = gst_check_setup_src_pad_by_name (demux, &srctemplate, "sink");
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (RTP_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, demux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return demux;
+}
+
+static void
+cleanup_rtpssrcdemux (GstElement * demux)
+{
+  GList *l;
+
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  for (l = outputs; l; l = l->next) {
+    Output *output = l->data;
+
+    gst_pad_set_active (output->sinkpad, FALSE);
+    gst_object_unref (output->sinkpad);
+    gst_object_unref (output->srcpad);
+    g_free (output);
+  }
+  g_list_free (outputs);
+  outputs = NULL;
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad_by_name (demux, "sink");
+  gst_check_teardown_element (demux);
+}
+
+static void
+push_packet (guint32 ssrc, guint16 seqnum)
+{
+  GstBuffer *buffer;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  buffer = gst_rtp_buffer_new_allocate (20, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_ssrc (&rtp, ssrc);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_payload_type (&rtp, 0);
+  gst_rtp_buffer_set_timestamp (&rtp, seqnum * 160);
+  gst_rtp_buffer_unmap (&rtp);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+}
+
+GST_START_TEST (test_interleaved_ssrcs)
+{
+  const guint32 ssrcs[] = { 0x11111111, 0x22222222, 0x33333333, 0x44444444 };
+  GstElement *demux;
+  Output *output;
+  GstPad *srcpad;
+  guint i, n;
+
+  demux = setup_rtpssrcdemux ();
+
+  /* every packet has another SSRC than the one before */
+  for (n = 0; n < 10; n++)
+    for (i = 0; i < G_N_ELEMENTS (ssrcs); i++)
+      push_packet (ssrcs[i], n);
+
+  fail_unless_equals_int (g_list_length (outputs), G_N_ELEMENTS (ssrcs));
+  for (i = 0; i < G_N_ELEMENTS (ssrcs); i++) {
+    output = find_output (ssrcs[i], 0);
+    fail_unless (output != NULL);
+    fail_unless_equals_int (output->count, 10);
+  }
+
+  /* after removing a pad, only our ref on it is left */
+  output = find_output (ssrcs[1], 0);
+  srcpad = output->srcpad;
+  g_signal_emit_by_name (demux, "clear-ssrc", ssrcs[1]);
+  ASSERT_OBJECT_REFCOUNT (srcpad, "removed pad", 1);
+
+  /* a new pad is made for the SSRC, the others keep theirs */
+  for (i = 0; i < G_N_ELEMENTS (ssrcs); i++)
+    push_packet (ssrcs[i], i == 1 ? 0 : 10);
+
+  fail_unless_equals_int (g_list_length (outputs), G_N_ELEMENTS (ssrcs) + 1);
+  fail_unless_equals_int (output->count, 10);
+  output = find_output (ssrcs[1], 1);
+  fail_unless (output != NULL);
+  fail_unless_equals_int (output->count, 1);
+  for (i = 0; i < G_N_ELEMENTS (ssrcs); i++) {
+    if (i == 1)
+      continue;
+    fail_unless_equals_int (find_output (ssrcs[i], 0)->count, 11);
+  }
+
+  cleanup_rtpssrcdemux (demux);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtpssrcdemux_suite (void)
+{
+  Suite *s = suite_create ("rtpssrcdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_interleaved_ssrcs);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpssrcdemux);
@@ -0,0 +1,214 @@
+/* GStreamer unit tests for scaletempo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/audio/audio.h>
+#include <gst/check/gstcheck.h>
+
+#include <math.h>
+
+/* the type is registered by the plugin, only the instance struct is used */
+#include "../../gst/audiofx/gstscaletempo.h"
+
+static GstPad *mysrcpad, *mysinkpad;
+
+#define SCALETEMPO_CAPS_TEMPLATE_STRING \
+    "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }, " \
+    "rate = (int) [ 1, MAX ], " \
+    "channels = (int) [ 1, MAX ], " \
+    "layout = (string) interleaved"
+
+#define SCALETEMPO_CAPS_STRING_F32 \
+    "audio/x-raw, " \
+    "format = (string) " GST_AUDIO_NE (F32) ", " \
+    "rate = (int) 44100, " \
+    "channels = (int) 2, " \
+    "layout = (string) interleaved"
+
+#define SCALETEMPO_CAPS_STRING_S16 \
+    "audio/x-raw, " \
+    "format = (string) " GST_AUDIO_NE (S16) ", " \
+    "rate = (int) 44100, " \
+    "channels = (int) 2, " \
+    "layout = (string) interleaved"
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SCALETEMPO_CAPS_TEMPLATE_STRING));
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SCALETEMPO_CAPS_TEMPLATE_STRING));
+
+/* 100 ms of stereo audio per buffer */
+#define FRAMES_PER_BUFFER 4410
+#define NUM_BUFFERS 20
+
+static GstElement *
+setup_scaletempo (const gchar * caps_str, guint search)
+{
+  GstElement *scaletempo;
+  GstSegment segment;
+  GstCaps *caps;
+
+  scaletempo = gst_check_setup_element ("scaletempo");
+  g_object_set (scaletempo, "search", search, NULL);
+
+  mysrcpad = gst_check_setup_src_pad (scaletempo, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (scaletempo, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless_equals_int (gst_element_set_state (scaletempo,
+          GST_STATE_PLAYING), GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (caps_str);
+  gst_check_setup_events (mysrcpad, scaletempo, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* scaletempo is passthrough at the normal rate */
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  segment.rate = 1.5;
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_segment (&segment)));
+
+  return scaletempo;
+}
+
+static void
+cleanup_scaletempo (GstElement * scaletempo)
+{
+  fail_unless_equals_int (gst_element_set_state (scaletempo,
+          GST_STATE_NULL), GST_STATE_CHANGE_SUCCESS);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (scaletempo);
+  gst_check_teardown_sink_pad (scaletempo);
+  gst_check_teardown_element (scaletempo);
+}
+
+/* two tones and some noise, different in both channels */
+static GstBuffer *
+create_buffer (gboolean use_int, guint n)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint32 seed = n + 1;
+  guint i, j;
+
+  buffer = gst_buffer_new_and_alloc (FRAMES_PER_BUFFER * 2 *
+      (use_int ? sizeof (gint16) : sizeof (gfloat)));
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  for (i = 0; i < FRAMES_PER_BUFFER; i++) {
+    gdouble t = (gdouble) (n * FRAMES_PER_BUFFER + i) / 44100;
+
+    for (j = 0; j < 2; j++) {
+      gdouble v;
+
+      seed = seed * 1103515245 + 12345;
+      v = 0.5 * sin (2 * G_PI * (220 + 110 * j) * t) +
+          0.3 * sin (2 * G_PI * 1234.5 * t) +
+          0.1 * ((gdouble) ((seed >> 16) & 0x7fff) / 0x7fff - 0.5);
+
+      if (use_int)
+        ((gint16 *) map.data)[i * 2 + j] = (gint16) (v * 32767);
+      else
+        ((gfloat *) map.data)[i * 2 + j] = (gfloat) v;
+    }
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  GST_BUFFER_TIMESTAMP (buffer) =
+      gst_util_uint64_scale (n * FRAMES_PER_BUFFER, GST_SECOND, 44100);
+  GST_BUFFER_DURATION (buffer) =
+      gst_util_uint64_scale (FRAMES_PER_BUFFER, GST_SECOND, 44100);
+
+  return buffer;
+}
+
+static void
+check_fft_search (const gchar * caps_str, gboolean use_int)
+{
+  GstElement *scaletempo;
+  GstScaletempo *st;
+  GstBuffer *buffer;
+  guint (*direct_search) (GstScaletempo * st);
+  guint n;
+
+  /* a short search window uses the direct search, remember it */
+  scaletempo = setup_scaletempo (caps_str, 1);
+  buffer = create_buffer (use_int, 0);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  st = (GstScaletempo *) scaletempo;
+  fail_unless (st->best_overlap_offset != NULL);
+  fail_unless_equals_int (st->fft_len, 0);
+  direct_search = st->best_overlap_offset;
+  cleanup_scaletempo (scaletempo);
+
+  /* a long one uses the FFT, which must find the same offsets as the
+   * direct search on the same queue and overlap */
+  scaletempo = setup_scaletempo (caps_str, 60);
+  st = (GstScaletempo *) scaletempo;
+  for (n = 0; n < NUM_BUFFERS; n++) {
+    guint fft_off, direct_off;
+
+    buffer = create_buffer (use_int, n);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+    fail_unless (st->fft_len > 0);
+    fail_unless (st->best_overlap_offset != direct_search);
+
+    fft_off = st->best_overlap_offset (st);
+    direct_off = direct_search (st);
+    GST_DEBUG ("buffer %u: offset %u", n, fft_off);
+    fail_unless_equals_int (fft_off, direct_off);
+  }
+  cleanup_scaletempo (scaletempo);
+}
+
+GST_START_TEST (test_fft_search_float)
+{
+  check_fft_search (SCALETEMPO_CAPS_STRING_F32, FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fft_search_s16)
+{
+  check_fft_search (SCALETEMPO_CAPS_STRING_S16, TRUE);
+}
+
+GST_END_TEST;
+
+static Suite *
+scaletempo_suite (void)
+{
+  Suite *s = suite_create ("scaletempo");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_fft_search_float);
+  tcase_add_test (tc_chain, test_fft_search_s16);
+
+  return s;
+}
+
+GST_CHECK_MAIN (scaletempo);
@@ -0,0 +1,323 @@
+/* GStreamer unit tests for the souphttpclientsink element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <libsoup/soup.h>
+#include <gst/check/gstcheck.h>
+
+#define BUFFER_SIZE 1000
+#define NUM_BUFFERS 10
+
+/* The server runs in its own thread and main context. The sink is given a
+ * session on the default main context, so it only sends data while the test
+ * iterates that context. */
+static guint http_port = 0;
+static SoupServer *server;      /* NULL */
+static GMainContext *server_context;
+static GMainLoop *server_loop;
+static GThread *server_thread;
+
+/* what the server received, written from the server thread */
+static GMutex server_lock;
+static guint put_requests;
+static gboolean put_chunked;
+static GByteArray *put_body;
+
+/* buffers that reached the sink */
+static gint buffers_in;
+
+static void
+server_callback (SoupServer * server, SoupMessage * msg,
+    const char *path, GHashTable * query,
+    SoupClientContext * context, gpointer data)
+{
+  GST_DEBUG ("%s %s HTTP/1.%d", msg->method, path,
+      soup_message_get_http_version (msg));
+
+  if (msg->method != SOUP_METHOD_PUT) {
+    soup_message_set_status (msg, SOUP_STATUS_NOT_IMPLEMENTED);
+    return;
+  }
+
+  g_mutex_lock (&server_lock);
+  put_requests++;
+  put_chunked = (soup_message_headers_get_encoding (msg->request_headers) ==
+      SOUP_ENCODING_CHUNKED);
+  g_byte_array_append (put_body, (const guint8 *) msg->request_body->data,
+      msg->request_body->length);
+  g_mutex_unlock (&server_lock);
+
+  soup_message_set_status (msg, SOUP_STATUS_OK);
+}
+
+static gpointer
+server_thread_func (gpointer data)
+{
+  g_main_context_push_thread_default (server_context);
+  g_main_loop_run (server_loop);
+  g_main_context_pop_thread_default (server_context);
+
+  return NULL;
+}
+
+static void
+setup_server (void)
+{
+  put_requests = 0;
+  put_chunked = FALSE;
+  put_body = g_byte_array_new ();
+  buffers_in = 0;
+
+  server_context = g_main_context_new ();
+  server = soup_server_new (SOUP_SERVER_PORT, SOUP_ADDRESS_ANY_PORT,
+      SOUP_SERVER_ASYNC_CONTEXT, server_context, NULL);
+  if (!server) {
+    GST_DEBUG ("Unable to bind to server port");
+    http_port = 0;
+    return;
+  }
+  http_port = soup_server_get_port (server);
+  GST_INFO ("HTTP server listening on port %u", http_port);
+  soup_server_add_handler (server, NULL, server_callback, NULL, NULL);
+  soup_server_run_async (server);
+
+  server_loop = g_main_loop_new (server_context, FALSE);
+  server_thread = g_thread_new ("server", server_thread_func, NULL);
+}
+
+static void
+teardown_server (void)
+{
+  if (server) {
+    g_main_loop_quit (server_loop);
+    g_thread_join (server_thread);
+    g_main_loop_unref (server_loop);
+    soup_server_disconnect (server);
+    g_object_unref (server);
+    server = NULL;
+  }
+  g_main_context_unref (server_context);
+  g_byte_array_free (put_body, TRUE);
+}
+
+static GstPadProbeReturn
+count_buffers (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  g_atomic_int_inc (&buffers_in);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static guint64
+get_stat (GstElement * sink, const gchar * field)
+{
+  GstStructure *stats;
+  const GValue *value;
+  guint64 res;
+
+  g_object_get (sink, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  value = gst_structure_get_value (stats, field);
+  fail_unless (value != NULL && G_VALUE_HOLDS_UINT64 (value));
+  res = g_value_get_uint64 (value);
+  gst_structure_free (stats);
+
+  return res;
+}
+
+/*
+ * Sets up appsrc ! souphttpclientsink in streaming mode with @session and
+ * @max_backlog, then pushes @n_buffers buffers of BUFFER_SIZE bytes and EOS.
+ * Byte i of the stream is i % 251.
+ */
+static GstElement *
+start_pipeline (SoupSession * session, guint64 max_backlog, guint n_buffers,
+    GstElement ** p_sink)
+{
+  GstElement *pipe, *src, *sink;
+  GstFlowReturn flow_ret;
+  gchar *location;
+  GstPad *pad;
+  guint i;
+
+  pipe = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("appsrc", NULL);
+  fail_unless (src != NULL);
+  sink = gst_element_factory_make ("souphttpclientsink", NULL);
+  fail_unless (sink != NULL);
+  gst_bin_add_many (GST_BIN (pipe), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  location = g_strdup_printf ("http://127.0.0.1:%u/put", http_port);
+  g_object_set (sink, "location", location, "session", session,
+      "streaming", TRUE, "max-backlog", max_backlog, NULL);
+  g_free (location);
+
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, count_buffers, NULL,
+      NULL);
+  gst_object_unref (pad);
+
+  fail_unless (gst_element_set_state (pipe,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < n_buffers; i++) {
+    GstBuffer *buf;
+    GstMapInfo map;
+    gsize j;
+
+    buf = gst_buffer_new_allocate (NULL, BUFFER_SIZE, NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    for (j = 0; j < BUFFER_SIZE; j++)
+      map.data[j] = (i * BUFFER_SIZE + j) % 251;
+    gst_buffer_unmap (buf, &map);
+
+    g_signal_emit_by_name (src, "push-buffer", buf, &flow_ret);
+    fail_unless_equals_int (flow_ret, GST_FLOW_OK);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &flow_ret);
+
+  *p_sink = sink;
+
+  return pipe;
+}
+
+/*
+ * Waits until @n_buffers reached the sink, then checks that no more come in
+ * and that nothing was sent, so the last one is blocked on the backlog.
+ */
+static void
+check_blocked (GstElement * sink, guint64 backlog, gint n_buffers)
+{
+  gint i;
+
+  for (i = 0; i < 500 && g_atomic_int_get (&buffers_in) < n_buffers; i++)
+    g_usleep (G_USEC_PER_SEC / 100);
+  g_usleep (G_USEC_PER_SEC / 10);
+
+  fail_unless_equals_int (g_atomic_int_get (&buffers_in), n_buffers);
+  fail_unless_equals_uint64 (get_stat (sink, "backlog"), backlog);
+  fail_unless_equals_uint64 (get_stat (sink, "bytes-sent"), 0);
+}
+
+GST_START_TEST (test_streaming)
+{
+  SoupSession *session;
+  GstElement *pipe, *sink;
+  GstMessage *msg;
+  guint i;
+
+  if (http_port == 0) {
+    GST_INFO ("no local http server, skipping");
+    return;
+  }
+
+  session = soup_session_async_new ();
+  pipe = start_pipeline (session, 3 * BUFFER_SIZE, NUM_BUFFERS, &sink);
+
+  /* three buffers fill the backlog, the fourth waits in render */
+  check_blocked (sink, 3 * BUFFER_SIZE, 4);
+
+  /* running the default main context sends the data, which lets the sink
+   * take the rest of the buffers and finish the request at EOS */
+  msg = gst_bus_poll (GST_ELEMENT_BUS (pipe),
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  fail_unless_equals_int (g_atomic_int_get (&buffers_in), NUM_BUFFERS);
+  fail_unless_equals_uint64 (get_stat (sink, "bytes-sent"),
+      NUM_BUFFERS * BUFFER_SIZE);
+  fail_unless_equals_uint64 (get_stat (sink, "backlog"), 0);
+  fail_unless (get_stat (sink, "bitrate") > 0);
+
+  gst_element_set_state (pipe, GST_STATE_NULL);
+
+  /* all of it arrived in one chunked request */
+  g_mutex_lock (&server_lock);
+  fail_unless_equals_int (put_requests, 1);
+  fail_unless (put_chunked);
+  fail_unless_equals_int (put_body->len, NUM_BUFFERS * BUFFER_SIZE);
+  for (i = 0; i < put_body->len; i++)
+    fail_unless_equals_int (put_body->data[i], i % 251);
+  g_mutex_unlock (&server_lock);
+
+  gst_object_unref (pipe);
+  soup_session_abort (session);
+  g_object_unref (session);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_streaming_unlock)
+{
+  SoupSession *session;
+  GstElement *pipe, *sink;
+
+  if (http_port == 0) {
+    GST_INFO ("no local http server, skipping");
+    return;
+  }
+
+  session = soup_session_async_new ();
+  pipe = start_pipeline (session, BUFFER_SIZE, 3, &sink);
+
+  check_blocked (sink, BUFFER_SIZE, 2);
+
+  /* shutting down flushes the sink, which has to wake up the render that
+   * waits for the backlog to drain */
+  fail_unless_equals_int (gst_element_set_state (pipe, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  g_mutex_lock (&server_lock);
+  fail_unless_equals_int (put_requests, 0);
+  g_mutex_unlock (&server_lock);
+
+  gst_object_unref (pipe);
+  soup_session_abort (session);
+  g_object_unref (session);
+}
+
+GST_END_TEST;
+
+static Suite *
+souphttpclientsink_suite (void)
+{
+  TCase *tc_chain;
+  Suite *s;
+
+  /* we don't support exceptions from the proxy, so just unset the environment
+   * variable, it would prevent us from connecting to localhost */
+  g_unsetenv ("http_proxy");
+
+  s = suite_create ("souphttpclientsink");
+  tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup_server, teardown_server);
+  tcase_add_test (tc_chain, test_streaming);
+  tcase_add_test (tc_chain, test_streaming_unlock);
+
+  return s;
+}
+
+GST_CHECK_MAIN (souphttpclientsink);
@@ -53,6 +53,11 @@ static const char *realm = "SOUPHTTPSRC_REALM";
 static const char *basic_auth_path = "/basic_auth";
 static const char *digest_auth_path = "/digest_auth";
 
+/* Variables for the block cache test, /range serves RANGE_DATA_SIZE bytes
+ * with byte i being i % 251 and honours Range requests */
+#define RANGE_DATA_SIZE 300000
+static guint range_requests = 0;
+
 static gboolean run_server (guint * http_port, guint * https_port);
 static void stop_server (void);
 
@@ -199,6 +204,78 @@ done:
   return rc;
 }
 
+static void
+cache_handoff_cb (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    guint64 * p_received)
+{
+  GstMapInfo map;
+  gsize i;
+
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), *p_received);
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  for (i = 0; i < map.size; i++)
+    fail_unless_equals_int (map.data[i], (*p_received + i) % 251);
+  gst_buffer_unmap (buf, &map);
+
+  *p_received += map.size;
+}
+
+static void
+run_cache_pipeline (GstElement * pipe, guint64 * p_received)
+{
+  GstMessage *msg;
+
+  *p_received = 0;
+  fail_unless (gst_element_set_state (pipe,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_poll (GST_ELEMENT_BUS (pipe),
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  fail_unless_equals_uint64 (*p_received, RANGE_DATA_SIZE);
+  fail_unless (gst_element_set_state (pipe,
+          GST_STATE_READY) == GST_STATE_CHANGE_SUCCESS);
+}
+
+GST_START_TEST (test_cache)
+{
+  GstElement *pipe, *src, *sink;
+  guint64 received = 0;
+  guint requests;
+  gchar *url;
+
+  pipe = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("souphttpsrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (src != NULL && sink != NULL);
+  gst_bin_add_many (GST_BIN (pipe), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  url = g_strdup_printf ("http://127.0.0.1:%u/range", http_port);
+  g_object_set (src, "location", url, "cache-size", (guint64) 1024 * 1024,
+      "readahead-blocks", 2, NULL);
+  g_free (url);
+  g_object_set (sink, "signal-handoffs", TRUE, "sync", FALSE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (cache_handoff_cb),
+      &received);
+
+  /* The data is fetched in ranges */
+  range_requests = 0;
+  run_cache_pipeline (pipe, &received);
+  requests = range_requests;
+  fail_unless (requests > 1);
+
+  /* and served from the cache when read again */
+  run_cache_pipeline (pipe, &received);
+  fail_unless_equals_int (range_requests, requests);
+
+  gst_element_set_state (pipe, GST_STATE_NULL);
+  gst_object_unref (pipe);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_first_buffer_has_offset)
 {
   fail_unless (run_test ("http://127.0.0.1:%u/", http_port) == 0);
@@ -478,6 +555,7 @@ souphttpsrc_suite (void)
     tcase_add_test (tc_chain, test_good_user_digest_auth);
     tcase_add_test (tc_chain, test_bad_user_digest_auth);
     tcase_add_test (tc_chain, test_bad_password_digest_auth);
+    tcase_add_test (tc_chain, test_cache);
 
     if (ssl_server != NULL)
       tcase_add_test (tc_chain, test_https);
@@ -495,6 +573,39 @@ souphttpsrc_suite (void)
 
 GST_CHECK_MAIN (souphttpsrc);
 
+static void
+do_get_range (SoupMessage * msg)
+{
+  SoupRange *ranges;
+  int nranges;
+  goffset start = 0, end = RANGE_DATA_SIZE - 1;
+  char *buf;
+  goffset i;
+
+  range_requests++;
+
+  if (soup_message_headers_get_ranges (msg->request_headers, RANGE_DATA_SIZE,
+          &ranges, &nranges)) {
+    start = ranges[0].start;
+    end = ranges[0].end;
+    soup_message_headers_free_ranges (msg->request_headers, ranges);
+    soup_message_headers_set_content_range (msg->response_headers, start,
+        end, RANGE_DATA_SIZE);
+    soup_message_set_status (msg, SOUP_STATUS_PARTIAL_CONTENT);
+  } else {
+    soup_message_set_status (msg, SOUP_STATUS_OK);
+  }
+
+  if (msg->method != SOUP_METHOD_GET)
+    return;
+
+  buf = g_malloc (end - start + 1);
+  for (i = start; i <= end; i++)
+    buf[i - start] = i % 251;
+  soup_message_body_append (msg->response_body, SOUP_MEMORY_TAKE,
+      buf, end - start + 1);
+}
+
 static void
 do_get (SoupMessage * msg, const char *path)
 {
@@ -508,6 +619,12 @@ do_get (SoupMessage * msg, const char *path)
   uri = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
   GST_DEBUG ("request: \"%s\"", uri);
 
+  if (!strcmp (path, "/range")) {
+    do_get_range (msg);
+    g_free (uri);
+    return;
+  }
+
   if (!strcmp (path, "/301"))
     status = SOUP_STATUS_MOVED_PERMANENTLY;
   else if (!strcmp (path, "/302"))
@@ -322,23 +322,28 @@ GST_START_TEST (test_int32)
 
 GST_END_TEST;
 
-GST_START_TEST (test_float32)
+/* checks the message for a 11025 Hz sine wave, with the magnitudes either
+ * in a list per band or in one buffer for all bands */
+static void
+check_float32 (gboolean compact)
 {
   GstElement *spectrum;
-  GstBuffer *inbuffer, *outbuffer;
+  GstBuffer *inbuffer, *outbuffer, *magbuffer = NULL;
   GstBus *bus;
   GstMessage *message;
   const GstStructure *structure;
   int i, j;
-  gfloat *data;
-  GstMapInfo map;
-  const GValue *list, *value;
+  gfloat *data, *levels = NULL;
+  GstMapInfo map, magmap;
+  const GValue *list = NULL, *value;
   GstClockTime endtime;
   gfloat level;
+  guint bands, channels;
 
   spectrum = setup_spectrum (SPECT_CAPS_STRING_F32);
   g_object_set (spectrum, "post-messages", TRUE, "interval", GST_SECOND / 100,
-      "bands", SPECT_BANDS, "threshold", -80, NULL);
+      "bands", SPECT_BANDS, "threshold", -80, "message-compact", compact,
+      NULL);
 
   fail_unless (gst_element_set_state (spectrum,
           GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
@@ -387,10 +392,28 @@ GST_START_TEST (test_float32)
       "spectrum");
   fail_unless (gst_structure_get_clock_time (structure, "endtime", &endtime));
 
-  list = gst_structure_get_value (structure, "magnitude");
+  if (compact) {
+    fail_unless (gst_structure_get_uint (structure, "bands", &bands));
+    fail_unless_equals_int (bands, SPECT_BANDS);
+    fail_unless (gst_structure_get_uint (structure, "channels", &channels));
+    fail_unless_equals_int (channels, 1);
+    fail_unless (gst_structure_get (structure, "magnitude", GST_TYPE_BUFFER,
+            &magbuffer, NULL));
+
+    gst_buffer_map (magbuffer, &magmap, GST_MAP_READ);
+    fail_unless_equals_int (magmap.size, SPECT_BANDS * sizeof (gfloat));
+    levels = (gfloat *) magmap.data;
+  } else {
+    list = gst_structure_get_value (structure, "magnitude");
+  }
+
   for (i = 0; i < SPECT_BANDS; ++i) {
-    value = gst_value_list_get_value (list, i);
-    level = g_value_get_float (value);
+    if (compact) {
+      level = levels[i];
+    } else {
+      value = gst_value_list_get_value (list, i);
+      level = g_value_get_float (value);
+    }
     GST_DEBUG ("band[%3d] is %.2f", i, level);
     /* Only the bands in the middle should have a level above 60 */
     fail_if ((i == SPECT_BANDS / 2 || i == SPECT_BANDS / 2 - 1)
@@ -398,6 +421,11 @@ GST_START_TEST (test_float32)
     fail_if ((i != SPECT_BANDS / 2 && i != SPECT_BANDS / 2 - 1)
         && level > -20.0);
   }
+
+  if (compact) {
+    gst_buffer_unmap (magbuffer, &magmap);
+    gst_buffer_unref (magbuffer);
+  }
   fail_unless_equals_int (g_list_length (buffers), 1);
   fail_if ((outbuffer = (GstBuffer *) buffers->data) == NULL);
   fail_unless (inbuffer == outbuffer);
@@ -420,6 +448,11 @@ GST_START_TEST (test_float32)
   cleanup_spectrum (spectrum);
 }
 
+GST_START_TEST (test_float32)
+{
+  check_float32 (FALSE);
+}
+
 GST_END_TEST;
 
 GST_START_TEST (test_float64)
@@ -522,6 +555,13 @@ GST_START_TEST (test_float64)
 
 GST_END_TEST;
 
+GST_START_TEST (test_float32_compact)
+{
+  check_float32 (TRUE);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 spectrum_suite (void)
@@ -534,6 +574,7 @@ spectrum_suite (void)
   tcase_add_test (tc_chain, test_int32);
   tcase_add_test (tc_chain, test_float32);
   tcase_add_test (tc_chain, test_float64);
+  tcase_add_test (tc_chain, test_float32_compact);
 
   return s;
 }
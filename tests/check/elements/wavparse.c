@@ -20,6 +20,9 @@
 #endif
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
 
 static void
 do_test_empty_file (gboolean can_activate_pull)
@@ -66,6 +69,113 @@ GST_START_TEST (test_empty_file)
 
 GST_END_TEST;
 
+#define RF64_FRAMES 400000
+
+static void
+rf64_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    guint64 * frames)
+{
+  GstMapInfo map;
+  guint i;
+
+  /* every frame contains its index in both channels */
+  fail_unless_equals_int (GST_BUFFER_OFFSET (buf), *frames);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless (map.size % 4 == 0);
+  for (i = 0; i < map.size / 4; i++) {
+    fail_unless_equals_int (GST_READ_UINT16_LE (map.data + i * 4),
+        (guint16) (*frames + i));
+    fail_unless_equals_int (GST_READ_UINT16_LE (map.data + i * 4 + 2),
+        (guint16) (*frames + i));
+  }
+  *frames += map.size / 4;
+  gst_buffer_unmap (buf, &map);
+}
+
+GST_START_TEST (test_rf64)
+{
+  GstElement *pipeline, *src, *wavparse, *fakesink;
+  GstMessage *msg;
+  GstBus *bus;
+  guint64 frames = 0;
+  guint8 *data, *p;
+  gsize size;
+  gchar *filename;
+  gint fd, i;
+
+  /* RF64 header, ds64 chunk, fmt chunk and data chunk with unknown size */
+  size = 12 + 8 + 28 + 8 + 16 + 8 + RF64_FRAMES * 4;
+  data = p = g_malloc0 (size);
+  memcpy (p, "RF64", 4);
+  GST_WRITE_UINT32_LE (p + 4, G_MAXUINT32);
+  memcpy (p + 8, "WAVE", 4);
+  p += 12;
+  memcpy (p, "ds64", 4);
+  GST_WRITE_UINT32_LE (p + 4, 28);
+  GST_WRITE_UINT64_LE (p + 8, size - 8);
+  GST_WRITE_UINT64_LE (p + 16, RF64_FRAMES * 4);
+  GST_WRITE_UINT64_LE (p + 24, RF64_FRAMES);
+  GST_WRITE_UINT32_LE (p + 32, 0);
+  p += 8 + 28;
+  memcpy (p, "fmt ", 4);
+  GST_WRITE_UINT32_LE (p + 4, 16);
+  GST_WRITE_UINT16_LE (p + 8, 1);
+  GST_WRITE_UINT16_LE (p + 10, 2);
+  GST_WRITE_UINT32_LE (p + 12, 44100);
+  GST_WRITE_UINT32_LE (p + 16, 44100 * 4);
+  GST_WRITE_UINT16_LE (p + 20, 4);
+  GST_WRITE_UINT16_LE (p + 22, 16);
+  p += 8 + 16;
+  memcpy (p, "data", 4);
+  GST_WRITE_UINT32_LE (p + 4, G_MAXUINT32);
+  p += 8;
+  for (i = 0; i < RF64_FRAMES; i++) {
+    GST_WRITE_UINT16_LE (p + i * 4, (guint16) i);
+    GST_WRITE_UINT16_LE (p + i * 4 + 2, (guint16) i);
+  }
+
+  fd = g_file_open_tmp ("wavparse-XXXXXX.wav", &filename, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (filename, (gchar *) data, size, NULL));
+  g_free (data);
+
+  pipeline = gst_pipeline_new ("testpipe");
+  src = gst_element_factory_make ("filesrc", NULL);
+  fail_if (src == NULL);
+  wavparse = gst_element_factory_make ("wavparse", NULL);
+  fail_if (wavparse == NULL);
+  fakesink = gst_element_factory_make ("fakesink", NULL);
+  fail_if (fakesink == NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, wavparse, fakesink, NULL);
+  g_object_set (src, "location", filename, NULL);
+  g_object_set (fakesink, "signal-handoffs", TRUE, "sync", FALSE, NULL);
+  g_signal_connect (fakesink, "handoff", G_CALLBACK (rf64_handoff), &frames);
+  fail_unless (gst_element_link_many (src, wavparse, fakesink, NULL));
+
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  /* all data was pushed in order across several pulled blocks */
+  fail_unless_equals_int (frames, RF64_FRAMES);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 wavparse_suite (void)
 {
@@ -74,6 +184,7 @@ wavparse_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_empty_file);
+  tcase_add_test (tc_chain, test_rf64);
   return s;
 }
 
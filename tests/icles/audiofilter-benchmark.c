@@ -0,0 +1,152 @@
+/* GStreamer benchmark for multichannel audio filters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Runs a fixed amount of noise through audio filter elements with 2, 8 and
+ * 64 channels and prints the time spent for each of them. The time of an
+ * identity run is printed too and includes the cost of generating and
+ * upmixing the input.
+ *
+ * Usage: audiofilter-benchmark [-f FORMAT] [-n BUFFERS] ["element props" ...]
+ *
+ * e.g. audiofilter-benchmark -f S16LE level
+ *
+ * Compare the results of builds before and after a change to see its
+ * effect.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+static const gchar *default_elements[] = {
+  "identity",
+  "audiocheblimit mode=low-pass poles=8 cutoff=1000",
+  "audiochebband mode=band-pass poles=8 lower-frequency=500 "
+      "upper-frequency=2000",
+  "equalizer-10bands band0=6.0 band3=-3.0 band6=3.0 band9=-6.0",
+  "level interval=10000000",
+  NULL
+};
+
+static const gint channel_counts[] = { 2, 8, 64 };
+
+static gdouble
+run_pipeline (const gchar * format, const gchar * element, gint channels,
+    gint num_buffers)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *desc;
+  gint64 start, end;
+  gdouble ret;
+
+  desc = g_strdup_printf ("audiotestsrc wave=white-noise num-buffers=%d "
+      "samplesperbuffer=1024 ! audioconvert ! "
+      "audio/x-raw,format=%s,rate=48000,channels=%d,"
+      "channel-mask=(bitmask)0,layout=interleaved ! %s ! fakesink",
+      num_buffers, format, channels, element);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+
+  if (pipeline == NULL) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1.0;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = g_get_monotonic_time ();
+  ret = (end - start) / 1000.0;
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gchar *debug = NULL;
+
+    gst_message_parse_error (msg, &err, &debug);
+    g_printerr ("Error: %s [%s]\n", err->message, debug);
+    g_error_free (err);
+    g_free (debug);
+    ret = -1.0;
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  gchar *format = NULL;
+  gint num_buffers = 1000;
+  gchar **elements = NULL;
+  GOptionEntry options[] = {
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Sample format to test", "FORMAT"},
+    {"buffers", 'n', 0, G_OPTION_ARG_INT, &num_buffers,
+        "Number of buffers of 1024 frames to process", "BUFFERS"},
+    {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &elements,
+        NULL, NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  const gchar **e;
+  guint i;
+
+  ctx = g_option_context_new ("[\"element props\" ...]");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (format == NULL)
+    format = g_strdup (GST_AUDIO_NE (F32));
+
+  g_print ("%-64s %12s %12s %12s\n", "element (ms)", "2 ch", "8 ch", "64 ch");
+
+  for (e = elements ? (const gchar **) elements : default_elements; *e; e++) {
+    g_print ("%-64.64s", *e);
+    for (i = 0; i < G_N_ELEMENTS (channel_counts); i++)
+      g_print (" %12.1f", run_pipeline (format, *e, channel_counts[i],
+              num_buffers));
+    g_print ("\n");
+  }
+
+  g_strfreev (elements);
+  g_free (format);
+
+  return 0;
+}